@@ -0,0 +1,111 @@
+#include "batch_writer.h"
+
+#include <algorithm>
+
+namespace collector {
+
+namespace {
+
+size_t shard_of(uint64_t device_id, size_t shards) {
+    // MACs from one vendor share their top bytes; mix before taking the modulus
+    uint64_t x = device_id;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return static_cast<size_t>(x % shards);
+}
+
+}  // namespace
+
+BatchWriter::BatchWriter(const WriterConfig& config) : config_(config) {
+    const size_t n = std::max<size_t>(config_.shards, 1);
+    for (size_t i = 0; i < n; ++i) shards_.emplace_back(new Shard(config_));
+    for (auto& shard : shards_) {
+        Shard* s = shard.get();
+        s->thread = std::thread([this, s] { run(*s); });
+    }
+}
+
+BatchWriter::~BatchWriter() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        shard->stop = true;
+        shard->cv_work.notify_all();
+    }
+    for (auto& shard : shards_) shard->thread.join();
+}
+
+void BatchWriter::submit(Upload&& upload, Done done) {
+    Shard& shard = *shards_[shard_of(upload.device_id, shards_.size())];
+    const size_t records = upload.records.size();
+    std::unique_lock<std::mutex> lock(shard.mu);
+    shard.cv_space.wait(lock, [&] {
+        return shard.queued_records == 0 || shard.queued_records + records <= config_.max_queued_records;
+    });
+    shard.queued_records += records;
+    shard.queue.push_back(Pending{std::move(upload), std::move(done)});
+    shard.cv_work.notify_one();
+}
+
+void BatchWriter::run(Shard& shard) {
+    std::deque<Pending> batch;
+    std::vector<Ack> acks;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(shard.mu);
+            shard.cv_work.wait(lock, [&] { return shard.stop || !shard.queue.empty(); });
+            if (shard.queue.empty()) return;  // stop requested and drained
+            batch.swap(shard.queue);
+            shard.queued_records = 0;
+            shard.cv_space.notify_all();
+        }
+
+        acks.resize(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const AppendResult r = shard.store.stage(batch[i].upload);
+            acks[i].status = r.ok ? Status::kOk : Status::kStorageError;
+            acks[i].accepted = r.accepted;
+            acks[i].duplicates = r.duplicates;
+            acks[i].next_seq = r.next_seq;
+            acks[i].device_id = batch[i].upload.device_id;
+        }
+        if (!shard.store.flush_all()) {
+            for (Ack& ack : acks) {
+                if (ack.accepted) ack.status = Status::kStorageError;
+            }
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (batch[i].done) batch[i].done(acks[i]);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(shard.mu);
+            shard.stats.uploads += batch.size();
+            shard.stats.batches += 1;
+            shard.stats.max_batch_uploads = std::max<uint64_t>(shard.stats.max_batch_uploads, batch.size());
+            shard.stats.store = shard.store.stats();
+        }
+        batch.clear();
+    }
+}
+
+WriterStats BatchWriter::stats() const {
+    WriterStats total;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        const WriterStats& s = shard->stats;
+        total.uploads += s.uploads;
+        total.batches += s.batches;
+        total.max_batch_uploads = std::max(total.max_batch_uploads, s.max_batch_uploads);
+        total.store.rows_written += s.store.rows_written;
+        total.store.duplicates += s.store.duplicates;
+        total.store.gaps += s.store.gaps;
+        total.store.flushes += s.store.flushes;
+        total.store.opens += s.store.opens;
+        total.store.evictions += s.store.evictions;
+        total.store.write_errors += s.store.write_errors;
+    }
+    return total;
+}
+
+}  // namespace collector
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "column_store.h"
+#include "protocol.h"
+
+// Pool of writer threads with batched (group) commits. Devices are sharded
+// by id across the threads, so each device's files and sequence state are
+// owned by exactly one thread and need no locking. A shard thread drains
+// everything queued since its last pass, stages it per device, writes each
+// touched device once per column, and only then runs the completion
+// callbacks (the acks), so an ack always means the records are on disk.
+namespace collector {
+
+struct WriterConfig {
+    std::string root = "data";
+    size_t shards = 4;
+    size_t max_open_per_shard = 256;
+    size_t max_queued_records = 1 << 20;  // submit() blocks beyond this (backpressure)
+    bool sync = false;                    // fdatasync every batch
+};
+
+struct WriterStats {
+    uint64_t uploads = 0;
+    uint64_t batches = 0;
+    uint64_t max_batch_uploads = 0;
+    StoreStats store;
+};
+
+class BatchWriter {
+public:
+    using Done = std::function<void(const Ack&)>;
+
+    explicit BatchWriter(const WriterConfig& config);
+    ~BatchWriter();  // drains the queues, flushes, joins
+
+    // Queue an upload; `done` runs on the writer thread after the commit.
+    void submit(Upload&& upload, Done done);
+
+    WriterStats stats() const;
+
+private:
+    struct Pending {
+        Upload upload;
+        Done done;
+    };
+
+    struct Shard {
+        explicit Shard(const WriterConfig& config)
+            : store(config.root, config.max_open_per_shard, config.sync) {}
+        std::mutex mu;
+        std::condition_variable cv_work;
+        std::condition_variable cv_space;
+        std::deque<Pending> queue;
+        size_t queued_records = 0;
+        bool stop = false;
+        ColumnStore store;  // writer thread only
+        WriterStats stats;  // guarded by mu
+        std::thread thread;
+    };
+
+    void run(Shard& shard);
+
+    WriterConfig config_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace collector
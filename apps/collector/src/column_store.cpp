@@ -0,0 +1,191 @@
+#include "column_store.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+namespace collector {
+
+namespace {
+
+struct ColumnSpec {
+    const char* name;
+    size_t width;
+};
+
+constexpr ColumnSpec kColumns[DeviceColumns::kColumnCount] = {
+    {"seq.u32", 4}, {"ts.u32", 4}, {"hr_x10.u16", 2}, {"temp_x100.i16", 2}, {"steps.u16", 2}, {"flags.u8", 1},
+};
+
+void put(std::vector<uint8_t>& col, uint32_t v, size_t width) {
+    for (size_t i = 0; i < width; ++i) col.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+bool write_all(int fd, const uint8_t* p, size_t n) {
+    while (n > 0) {
+        const ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+bool make_dir(const std::string& path) {
+    return ::mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+}  // namespace
+
+DeviceColumns::DeviceColumns(const std::string& dir, uint64_t device_id) : dir_(dir), device_id_(device_id) {
+    std::fill(fds_, fds_ + kColumnCount, -1);
+}
+
+DeviceColumns::~DeviceColumns() {
+    for (int fd : fds_) {
+        if (fd >= 0) ::close(fd);
+    }
+}
+
+bool DeviceColumns::open() {
+    if (!make_dir(dir_)) return false;
+    uint64_t rows = UINT64_MAX;
+    for (size_t c = 0; c < kColumnCount; ++c) {
+        const std::string path = dir_ + "/" + kColumns[c].name;
+        fds_[c] = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fds_[c] < 0) return false;
+        struct stat st;
+        if (::fstat(fds_[c], &st) != 0) return false;
+        rows = std::min<uint64_t>(rows, static_cast<uint64_t>(st.st_size) / kColumns[c].width);
+    }
+    for (size_t c = 0; c < kColumnCount; ++c) {
+        if (::ftruncate(fds_[c], static_cast<off_t>(rows * kColumns[c].width)) != 0) return false;
+    }
+    rows_ = rows;
+    if (rows_ > 0) {
+        uint8_t last[4];
+        if (::pread(fds_[0], last, 4, static_cast<off_t>((rows_ - 1) * 4)) != 4) return false;
+        const uint32_t seq = last[0] | (last[1] << 8) | (last[2] << 16) | (static_cast<uint32_t>(last[3]) << 24);
+        next_seq_ = seq + 1;
+        have_rows_ = true;
+    }
+    return true;
+}
+
+AppendResult DeviceColumns::stage(const Upload& upload) {
+    AppendResult r;
+    for (size_t i = 0; i < upload.records.size(); ++i) {
+        const uint32_t seq = upload.first_seq + static_cast<uint32_t>(i);
+        if (have_rows_ && seq < next_seq_) {
+            ++r.duplicates;  // retransmission of something already stored
+            continue;
+        }
+        if (have_rows_ && seq > next_seq_) r.gaps += seq - next_seq_;
+        const Record& rec = upload.records[i];
+        put(staged_[0], seq, 4);
+        put(staged_[1], rec.timestamp, 4);
+        put(staged_[2], rec.avg_hr_x10, 2);
+        put(staged_[3], static_cast<uint16_t>(rec.avg_temp_x100), 2);
+        put(staged_[4], rec.step_count, 2);
+        put(staged_[5], rec.flags, 1);
+        ++staged_rows_;
+        ++r.accepted;
+        next_seq_ = seq + 1;
+        have_rows_ = true;
+    }
+    r.next_seq = next_seq_;
+    return r;
+}
+
+bool DeviceColumns::flush(bool sync) {
+    if (staged_rows_ == 0) return true;
+    bool ok = true;
+    for (size_t c = 0; c < kColumnCount; ++c) {
+        ok = write_all(fds_[c], staged_[c].data(), staged_[c].size()) && ok;
+        if (sync) ok = ::fdatasync(fds_[c]) == 0 && ok;
+        staged_[c].clear();
+    }
+    rows_ += staged_rows_;
+    staged_rows_ = 0;
+    return ok;
+}
+
+ColumnStore::ColumnStore(std::string root, size_t max_open, bool sync)
+    : root_(std::move(root)), max_open_(std::max<size_t>(max_open, 1)), sync_(sync) {
+    make_dir(root_);
+}
+
+DeviceColumns* ColumnStore::device(uint64_t device_id) {
+    auto it = open_.find(device_id);
+    if (it != open_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return lru_.front().get();
+    }
+
+    if (open_.size() >= max_open_) {
+        DeviceColumns* victim = lru_.back().get();
+        if (victim->has_staged()) {
+            if (!victim->flush(sync_)) {
+                ++stats_.write_errors;
+                evict_failed_ = true;  // reported by the next flush_all()
+            }
+            ++stats_.flushes;
+            dirty_.erase(std::remove(dirty_.begin(), dirty_.end(), victim), dirty_.end());
+        }
+        open_.erase(victim->device_id());
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+
+    std::unique_ptr<DeviceColumns> cols(new DeviceColumns(root_ + "/" + device_hex(device_id), device_id));
+    if (!cols->open()) {
+        ++stats_.write_errors;
+        return nullptr;
+    }
+    ++stats_.opens;
+    lru_.push_front(std::move(cols));
+    open_[device_id] = lru_.begin();
+    return lru_.front().get();
+}
+
+AppendResult ColumnStore::stage(const Upload& upload) {
+    DeviceColumns* cols = device(upload.device_id);
+    if (!cols) {
+        AppendResult failed;
+        failed.ok = false;
+        return failed;
+    }
+    const bool was_dirty = cols->has_staged();
+    const AppendResult r = cols->stage(upload);
+    if (!was_dirty && cols->has_staged()) dirty_.push_back(cols);
+    stats_.duplicates += r.duplicates;
+    stats_.gaps += r.gaps;
+    stats_.rows_written += r.accepted;
+    return r;
+}
+
+bool ColumnStore::flush_all() {
+    bool ok = !evict_failed_;
+    evict_failed_ = false;
+    for (DeviceColumns* cols : dirty_) {
+        ++stats_.flushes;
+        if (cols->flush(sync_)) continue;
+        // Close it so the next upload reopens from what actually reached the
+        // disk and the gateway's retransmission is not taken for a duplicate
+        ++stats_.write_errors;
+        ok = false;
+        auto it = open_.find(cols->device_id());
+        lru_.erase(it->second);
+        open_.erase(it);
+    }
+    dirty_.clear();
+    return ok;
+}
+
+}  // namespace collector
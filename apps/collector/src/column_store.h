@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "protocol.h"
+
+// Per-device columnar record files:
+//
+//   <root>/<device id hex>/seq.u32  ts.u32  hr_x10.u16  temp_x100.i16  steps.u16  flags.u8
+//
+// Each column is a flat little-endian array, one entry per accepted record,
+// in arrival (= sequence) order, so analytics can mmap one column without
+// touching the others. Appends are batched: a writer shard collects all the
+// uploads for a device that arrived since its last flush and issues one
+// write() per column.
+//
+// Not thread-safe; each writer shard owns a ColumnStore over a disjoint set
+// of devices.
+namespace collector {
+
+struct AppendResult {
+    bool ok = true;           // false if the device's files could not be opened
+    uint32_t accepted = 0;
+    uint32_t duplicates = 0;
+    uint32_t gaps = 0;        // sequence numbers skipped (lost on the way)
+    uint32_t next_seq = 0;
+};
+
+class DeviceColumns {
+public:
+    static constexpr size_t kColumnCount = 6;
+
+    DeviceColumns(const std::string& dir, uint64_t device_id);
+    ~DeviceColumns();
+    DeviceColumns(const DeviceColumns&) = delete;
+    DeviceColumns& operator=(const DeviceColumns&) = delete;
+
+    // Opens (creating) the column files. A torn batch from a crash leaves
+    // columns of different lengths; they are truncated to the shortest.
+    bool open();
+
+    // Stage the records of `upload` not yet stored (seq >= next_seq()).
+    AppendResult stage(const Upload& upload);
+    // Write staged rows; `sync` adds an fdatasync per column.
+    bool flush(bool sync);
+
+    uint64_t device_id() const { return device_id_; }
+    uint32_t next_seq() const { return next_seq_; }
+    uint64_t rows() const { return rows_; }
+    bool has_staged() const { return staged_rows_ > 0; }
+
+private:
+    std::string dir_;
+    uint64_t device_id_;
+    int fds_[kColumnCount];
+    std::vector<uint8_t> staged_[kColumnCount];
+    size_t staged_rows_ = 0;
+    uint64_t rows_ = 0;
+    uint32_t next_seq_ = 0;
+    bool have_rows_ = false;
+};
+
+struct StoreStats {
+    uint64_t rows_written = 0;
+    uint64_t duplicates = 0;
+    uint64_t gaps = 0;
+    uint64_t flushes = 0;      // write batches (one per device per flush cycle)
+    uint64_t opens = 0;
+    uint64_t evictions = 0;
+    uint64_t write_errors = 0;
+};
+
+class ColumnStore {
+public:
+    // `max_open` bounds open devices (6 fds each); least recently used are
+    // flushed and closed beyond it.
+    ColumnStore(std::string root, size_t max_open = 256, bool sync = false);
+
+    // nullptr if the device's files cannot be opened
+    DeviceColumns* device(uint64_t device_id);
+    AppendResult stage(const Upload& upload);
+    // Write every device staged since the last call. False if any write
+    // failed (including devices flushed early on eviction).
+    bool flush_all();
+
+    const StoreStats& stats() const { return stats_; }
+    size_t open_devices() const { return open_.size(); }
+
+private:
+    using Lru = std::list<std::unique_ptr<DeviceColumns>>;
+
+    std::string root_;
+    size_t max_open_;
+    bool sync_;
+    Lru lru_;  // front = most recently used
+    std::unordered_map<uint64_t, Lru::iterator> open_;
+    std::vector<DeviceColumns*> dirty_;
+    bool evict_failed_ = false;
+    StoreStats stats_;
+};
+
+}  // namespace collector
@@ -0,0 +1,138 @@
+#include "protocol.h"
+
+#include <cstdio>
+
+namespace collector {
+
+namespace {
+
+uint16_t get16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t get32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+uint64_t get64(const uint8_t* p) { return get32(p) | (static_cast<uint64_t>(get32(p + 4)) << 32); }
+
+void put16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+void put64(uint8_t* p, uint64_t v) {
+    put32(p, static_cast<uint32_t>(v));
+    put32(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+struct CrcTable {
+    uint32_t t[256];
+    CrcTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+    }
+};
+const CrcTable kCrc;
+
+}  // namespace
+
+uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) crc = kCrc.t[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void decode_record(const uint8_t* p, Record& out) {
+    out.avg_hr_x10 = get16(p);
+    out.avg_temp_x100 = static_cast<int16_t>(get16(p + 2));
+    out.step_count = get16(p + 4);
+    out.timestamp = get32(p + 6);
+    out.flags = p[10];
+}
+
+void encode_record(const Record& r, uint8_t* p) {
+    put16(p, r.avg_hr_x10);
+    put16(p + 2, static_cast<uint16_t>(r.avg_temp_x100));
+    put16(p + 4, r.step_count);
+    put32(p + 6, r.timestamp);
+    p[10] = r.flags;
+}
+
+std::vector<uint8_t> encode_upload(const Upload& upload) {
+    const size_t body = kHeaderSize + upload.records.size() * kRecordSize;
+    std::vector<uint8_t> out(body + 4);
+    put32(&out[0], kUploadMagic);
+    out[4] = kVersion;
+    out[5] = kRecordSize;
+    put16(&out[6], static_cast<uint16_t>(upload.records.size()));
+    put64(&out[8], upload.device_id);
+    put32(&out[16], upload.first_seq);
+    for (size_t i = 0; i < upload.records.size(); ++i) {
+        encode_record(upload.records[i], &out[kHeaderSize + i * kRecordSize]);
+    }
+    put32(&out[body], crc32(out.data(), body));
+    return out;
+}
+
+void encode_ack(const Ack& ack, uint8_t* out) {
+    put32(out, kAckMagic);
+    out[4] = static_cast<uint8_t>(ack.status);
+    out[5] = out[6] = out[7] = 0;
+    put32(out + 8, ack.accepted);
+    put32(out + 12, ack.duplicates);
+    put32(out + 16, ack.next_seq);
+    put64(out + 20, ack.device_id);
+}
+
+bool decode_ack(const uint8_t* in, Ack& out) {
+    if (get32(in) != kAckMagic) return false;
+    out.status = static_cast<Status>(in[4]);
+    out.accepted = get32(in + 8);
+    out.duplicates = get32(in + 12);
+    out.next_seq = get32(in + 16);
+    out.device_id = get64(in + 20);
+    return true;
+}
+
+void FrameParser::feed(const uint8_t* data, size_t len) {
+    // Compact once the consumed prefix dominates, so the buffer stays small
+    if (pos_ > 0 && pos_ >= buf_.size() / 2) {
+        buf_.erase(buf_.begin(), buf_.begin() + static_cast<std::ptrdiff_t>(pos_));
+        pos_ = 0;
+    }
+    buf_.insert(buf_.end(), data, data + len);
+}
+
+FrameParser::Result FrameParser::next(Upload& out) {
+    if (error_ != Status::kOk) return Result::kError;
+    const size_t avail = buf_.size() - pos_;
+    if (avail < kHeaderSize) return Result::kNeedMore;
+
+    const uint8_t* h = &buf_[pos_];
+    const uint16_t count = get16(h + 6);
+    if (get32(h) != kUploadMagic || h[4] != kVersion || h[5] != kRecordSize || count > kMaxRecordsPerUpload) {
+        error_ = Status::kBadHeader;
+        return Result::kError;
+    }
+    const size_t body = kHeaderSize + count * kRecordSize;
+    if (avail < body + 4) return Result::kNeedMore;
+    if (crc32(h, body) != get32(h + body)) {
+        error_ = Status::kBadCrc;
+        return Result::kError;
+    }
+
+    out.device_id = get64(h + 8);
+    out.first_seq = get32(h + 16);
+    out.records.resize(count);
+    for (size_t i = 0; i < count; ++i) decode_record(h + kHeaderSize + i * kRecordSize, out.records[i]);
+    pos_ += body + 4;
+    return Result::kFrame;
+}
+
+std::string device_hex(uint64_t device_id) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(device_id));
+    return buf;
+}
+
+}  // namespace collector
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Upload wire format between a gateway (BLE phone app, Wi-Fi bridge) and the
+// collector. A gateway forwards the records a device streamed to it, tagged
+// with the device id and the device-relative sequence number of the first
+// record. All integers little-endian. Acks for one device come back in
+// frame order; a gateway multiplexing devices on a connection matches them
+// up by device id.
+//
+//   Upload frame                       Ack (one per frame)
+//   0   u32  magic 'PDU1'              0   u32 magic 'PDA1'
+//   4   u8   version (1)               4   u8  status (Status)
+//   5   u8   record size (11)          5   u8[3] reserved
+//   6   u16  record count (<= 4096)    8   u32 records accepted
+//   8   u64  device id (BLE MAC)       12  u32 duplicates dropped
+//   16  u32  first sequence number     16  u32 next expected sequence
+//   20  records, count * 11 bytes      20  u64 device id
+//   ..  u32  CRC-32 of everything above
+namespace collector {
+
+constexpr uint32_t kUploadMagic = 0x31554450;  // "PDU1"
+constexpr uint32_t kAckMagic = 0x31414450;     // "PDA1"
+constexpr uint8_t kVersion = 1;
+constexpr size_t kRecordSize = 11;
+constexpr size_t kHeaderSize = 20;
+constexpr size_t kAckSize = 28;
+constexpr uint16_t kMaxRecordsPerUpload = 4096;
+
+// Firmware consolidate::ConsolidatedRecord (15 s interval)
+struct Record {
+    uint16_t avg_hr_x10;
+    int16_t avg_temp_x100;
+    uint16_t step_count;
+    uint32_t timestamp;
+    uint8_t flags;
+};
+
+struct Upload {
+    uint64_t device_id = 0;
+    uint32_t first_seq = 0;
+    std::vector<Record> records;
+};
+
+enum class Status : uint8_t { kOk = 0, kBadCrc = 1, kBadHeader = 2, kStorageError = 3 };
+
+struct Ack {
+    Status status = Status::kOk;
+    uint32_t accepted = 0;
+    uint32_t duplicates = 0;
+    uint32_t next_seq = 0;
+    uint64_t device_id = 0;
+};
+
+uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+
+void decode_record(const uint8_t* p, Record& out);
+void encode_record(const Record& r, uint8_t* p);
+
+// Serialises a whole frame (header, records, CRC)
+std::vector<uint8_t> encode_upload(const Upload& upload);
+void encode_ack(const Ack& ack, uint8_t* out);
+bool decode_ack(const uint8_t* in, Ack& out);
+
+// Incremental frame decoder for a byte stream. Feed whatever recv() returned
+// and call next() until it stops returning kFrame. A kError leaves the
+// stream unusable (the connection is closed after the error ack).
+class FrameParser {
+public:
+    enum class Result { kNeedMore, kFrame, kError };
+
+    void feed(const uint8_t* data, size_t len);
+    Result next(Upload& out);
+    Status error() const { return error_; }
+    size_t buffered() const { return buf_.size() - pos_; }
+
+private:
+    std::vector<uint8_t> buf_;
+    size_t pos_ = 0;
+    Status error_ = Status::kOk;
+};
+
+std::string device_hex(uint64_t device_id);
+
+}  // namespace collector
@@ -0,0 +1,217 @@
+#include "server.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <mutex>
+#include <unordered_map>
+
+namespace collector {
+
+class Server::Connection {
+public:
+    explicit Connection(int fd) : fd_(fd) {}
+    ~Connection() { ::close(fd_); }
+
+    int fd() const { return fd_; }
+    FrameParser& parser() { return parser_; }
+
+    // Called from writer threads; acks are tiny and the gateway reads them,
+    // so a full send buffer means a stuck peer and the connection is dropped.
+    void send_ack(const Ack& ack) {
+        uint8_t buf[kAckSize];
+        encode_ack(ack, buf);
+        std::lock_guard<std::mutex> lock(send_mu_);
+        if (::send(fd_, buf, sizeof(buf), MSG_NOSIGNAL | MSG_DONTWAIT) != static_cast<ssize_t>(sizeof(buf))) {
+            ::shutdown(fd_, SHUT_RDWR);
+        }
+    }
+
+private:
+    int fd_;
+    FrameParser parser_;
+    std::mutex send_mu_;
+};
+
+class Server::IoLoop {
+public:
+    IoLoop(Server& server, int listen_fd) : server_(server), listen_fd_(listen_fd) {}
+
+    ~IoLoop() {
+        if (epoll_fd_ >= 0) ::close(epoll_fd_);
+        if (wake_fd_ >= 0) ::close(wake_fd_);
+    }
+
+    bool start() {
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd_ < 0 || wake_fd_ < 0) return false;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.fd = listen_fd_;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev) != 0) return false;
+        ev.events = EPOLLIN;
+        ev.data.fd = wake_fd_;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev) != 0) return false;
+        thread_ = std::thread([this] { run(); });
+        return true;
+    }
+
+    void stop() {
+        const uint64_t one = 1;
+        (void)!::write(wake_fd_, &one, sizeof(one));
+        if (thread_.joinable()) thread_.join();
+        server_.open_connections_ -= conns_.size();
+        conns_.clear();
+    }
+
+private:
+    void run() {
+        epoll_event events[64];
+        for (;;) {
+            const int n = ::epoll_wait(epoll_fd_, events, 64, -1);
+            if (n < 0 && errno != EINTR) return;
+            for (int i = 0; i < n; ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == wake_fd_) return;
+                if (fd == listen_fd_) {
+                    accept_all();
+                } else {
+                    service(fd);
+                }
+            }
+        }
+    }
+
+    void accept_all() {
+        for (;;) {
+            const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;  // EAGAIN: another loop took it, or none left
+            const int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.fd = fd;
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                ::close(fd);
+                continue;
+            }
+            conns_[fd] = std::make_shared<Connection>(fd);
+            ++server_.connections_;
+            ++server_.open_connections_;
+        }
+    }
+
+    void service(int fd) {
+        auto it = conns_.find(fd);
+        if (it == conns_.end()) return;
+        std::shared_ptr<Connection> conn = it->second;
+
+        uint8_t buf[64 * 1024];
+        bool open = true;
+        while (open) {
+            const ssize_t got = ::recv(fd, buf, sizeof(buf), 0);
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (got <= 0) {
+                open = false;  // EOF or reset
+                break;
+            }
+            server_.bytes_in_ += static_cast<uint64_t>(got);
+            conn->parser().feed(buf, static_cast<size_t>(got));
+            open = dispatch(conn);
+        }
+        if (!open) close(fd);
+    }
+
+    // Hand every complete frame to the writer. False on a protocol error.
+    bool dispatch(const std::shared_ptr<Connection>& conn) {
+        for (;;) {
+            Upload upload;
+            const FrameParser::Result r = conn->parser().next(upload);
+            if (r == FrameParser::Result::kNeedMore) return true;
+            if (r == FrameParser::Result::kError) {
+                ++server_.bad_frames_;
+                Ack ack;
+                ack.status = conn->parser().error();
+                conn->send_ack(ack);
+                return false;
+            }
+            ++server_.frames_;
+            server_.writer_.submit(std::move(upload), [conn](const Ack& ack) { conn->send_ack(ack); });
+        }
+    }
+
+    void close(int fd) {
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::shutdown(fd, SHUT_RD);
+        conns_.erase(fd);  // the fd closes once in-flight acks release it
+        --server_.open_connections_;
+    }
+
+    Server& server_;
+    int listen_fd_;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    std::thread thread_;
+    std::unordered_map<int, std::shared_ptr<Connection>> conns_;
+};
+
+Server::Server(const ServerConfig& config, BatchWriter& writer) : config_(config), writer_(writer) {}
+
+Server::~Server() {
+    stop();
+}
+
+bool Server::start() {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) return false;
+    const int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config_.port);
+    if (::inet_pton(AF_INET, config_.bind_address.c_str(), &addr.sin_addr) != 1) return false;
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) return false;
+    if (::listen(listen_fd_, SOMAXCONN) != 0) return false;
+
+    socklen_t len = sizeof(addr);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+
+    const size_t n = config_.io_threads ? config_.io_threads : 1;
+    for (size_t i = 0; i < n; ++i) {
+        loops_.emplace_back(new IoLoop(*this, listen_fd_));
+        if (!loops_.back()->start()) return false;
+    }
+    return true;
+}
+
+void Server::stop() {
+    for (auto& loop : loops_) loop->stop();
+    loops_.clear();
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+ServerStats Server::stats() const {
+    ServerStats s;
+    s.connections = connections_;
+    s.open_connections = open_connections_;
+    s.frames = frames_;
+    s.bad_frames = bad_frames_;
+    s.bytes_in = bytes_in_;
+    return s;
+}
+
+}  // namespace collector
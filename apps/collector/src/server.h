@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch_writer.h"
+
+// TCP front end. A pool of I/O threads, each with its own epoll set, shares
+// the non-blocking listening socket (EPOLLEXCLUSIVE, so a new connection
+// wakes one thread) and owns the connections it accepted. Frames are decoded
+// and CRC-checked on the I/O thread and handed to the BatchWriter; the ack
+// goes back from the writer thread once the batch is on disk. A gateway may
+// pipeline frames; acks come back in order per device.
+namespace collector {
+
+struct ServerConfig {
+    std::string bind_address = "0.0.0.0";
+    uint16_t port = 7300;  // 0 picks a free port (tests)
+    size_t io_threads = 2;
+};
+
+struct ServerStats {
+    uint64_t connections = 0;
+    uint64_t open_connections = 0;
+    uint64_t frames = 0;
+    uint64_t bad_frames = 0;
+    uint64_t bytes_in = 0;
+};
+
+class Server {
+public:
+    Server(const ServerConfig& config, BatchWriter& writer);
+    ~Server();
+
+    bool start();
+    void stop();
+    uint16_t port() const { return port_; }
+    ServerStats stats() const;
+
+    class Connection;
+    class IoLoop;
+
+private:
+    ServerConfig config_;
+    BatchWriter& writer_;
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::vector<std::unique_ptr<IoLoop>> loops_;
+
+    friend class IoLoop;
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<uint64_t> open_connections_{0};
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> bad_frames_{0};
+    std::atomic<uint64_t> bytes_in_{0};
+};
+
+}  // namespace collector
@@ -0,0 +1,286 @@
+// Collector unit and end-to-end tests (ctest). Each test uses a fresh
+// directory under /tmp; the server test runs on an ephemeral port.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch_writer.h"
+#include "column_store.h"
+#include "protocol.h"
+#include "server.h"
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            ++g_failures;                                                        \
+        }                                                                        \
+    } while (0)
+
+std::string temp_dir() {
+    char tmpl[] = "/tmp/collector_test_XXXXXX";
+    const char* dir = ::mkdtemp(tmpl);
+    return dir ? dir : "/tmp";
+}
+
+off_t file_size(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+collector::Upload make_upload(uint64_t device, uint32_t first_seq, size_t n) {
+    collector::Upload u;
+    u.device_id = device;
+    u.first_seq = first_seq;
+    for (size_t i = 0; i < n; ++i) {
+        collector::Record r{};
+        r.avg_hr_x10 = static_cast<uint16_t>(700 + i);
+        r.avg_temp_x100 = -5;
+        r.step_count = static_cast<uint16_t>(i);
+        r.timestamp = 1700000000u + 15u * (first_seq + static_cast<uint32_t>(i));
+        r.flags = static_cast<uint8_t>(i & 3);
+        u.records.push_back(r);
+    }
+    return u;
+}
+
+void test_frame_round_trip_byte_by_byte() {
+    const collector::Upload in = make_upload(0xA1B2C3D4E5F6ULL, 42, 5);
+    const std::vector<uint8_t> wire = collector::encode_upload(in);
+    CHECK(wire.size() == collector::kHeaderSize + 5 * collector::kRecordSize + 4);
+
+    collector::FrameParser parser;
+    collector::Upload out;
+    size_t frames = 0;
+    for (uint8_t b : wire) {  // worst-case fragmentation
+        parser.feed(&b, 1);
+        if (parser.next(out) == collector::FrameParser::Result::kFrame) ++frames;
+    }
+    CHECK(frames == 1);
+    CHECK(out.device_id == in.device_id);
+    CHECK(out.first_seq == 42);
+    CHECK(out.records.size() == 5);
+    CHECK(out.records[3].avg_hr_x10 == 703);
+    CHECK(out.records[3].avg_temp_x100 == -5);
+    CHECK(out.records[3].timestamp == in.records[3].timestamp);
+    CHECK(out.records[3].flags == 3);
+    CHECK(parser.buffered() == 0);
+}
+
+void test_frame_rejects_corruption() {
+    std::vector<uint8_t> wire = collector::encode_upload(make_upload(1, 0, 3));
+    wire[collector::kHeaderSize + 4] ^= 0x40;
+    collector::FrameParser parser;
+    parser.feed(wire.data(), wire.size());
+    collector::Upload out;
+    CHECK(parser.next(out) == collector::FrameParser::Result::kError);
+    CHECK(parser.error() == collector::Status::kBadCrc);
+
+    std::vector<uint8_t> junk(64, 0x55);
+    collector::FrameParser p2;
+    p2.feed(junk.data(), junk.size());
+    CHECK(p2.next(out) == collector::FrameParser::Result::kError);
+    CHECK(p2.error() == collector::Status::kBadHeader);
+}
+
+void test_column_store_dedup_and_recovery() {
+    const std::string root = temp_dir();
+    const uint64_t dev = 0x1234;
+    {
+        collector::ColumnStore store(root);
+        collector::AppendResult r = store.stage(make_upload(dev, 0, 10));
+        CHECK(r.accepted == 10 && r.duplicates == 0 && r.next_seq == 10);
+        r = store.stage(make_upload(dev, 5, 10));  // half retransmitted
+        CHECK(r.accepted == 5 && r.duplicates == 5 && r.next_seq == 15);
+        r = store.stage(make_upload(dev, 20, 2));  // 5 lost in transit
+        CHECK(r.accepted == 2 && r.gaps == 5 && r.next_seq == 22);
+        CHECK(store.flush_all());
+    }
+    const std::string dir = root + "/" + collector::device_hex(dev);
+    CHECK(file_size(dir + "/seq.u32") == 17 * 4);
+    CHECK(file_size(dir + "/flags.u8") == 17);
+
+    // A crash between column writes leaves one column long; reopening trims it
+    FILE* f = std::fopen((dir + "/hr_x10.u16").c_str(), "ab");
+    std::fputc(1, f);
+    std::fputc(2, f);
+    std::fclose(f);
+    collector::ColumnStore reopened(root);
+    collector::DeviceColumns* cols = reopened.device(dev);
+    CHECK(cols != nullptr);
+    CHECK(cols->rows() == 17);
+    CHECK(cols->next_seq() == 22);
+    CHECK(file_size(dir + "/hr_x10.u16") == 17 * 2);
+    const collector::AppendResult r = reopened.stage(make_upload(dev, 0, 22));
+    CHECK(r.accepted == 0 && r.duplicates == 22);
+}
+
+void test_column_store_evicts_lru() {
+    const std::string root = temp_dir();
+    collector::ColumnStore store(root, 4);
+    for (uint64_t dev = 0; dev < 10; ++dev) store.stage(make_upload(dev, 0, 3));
+    CHECK(store.open_devices() == 4);
+    CHECK(store.flush_all());
+    CHECK(store.stats().evictions == 6);
+    for (uint64_t dev = 0; dev < 10; ++dev) {
+        CHECK(file_size(root + "/" + collector::device_hex(dev) + "/seq.u32") == 12);
+    }
+    // Evicted devices come back with their sequence state
+    const collector::AppendResult r = store.stage(make_upload(0, 0, 4));
+    CHECK(r.duplicates == 3 && r.accepted == 1);
+}
+
+void test_batch_writer_concurrent_submitters() {
+    collector::WriterConfig cfg;
+    cfg.root = temp_dir();
+    cfg.shards = 3;
+    std::atomic<uint32_t> acked{0}, accepted{0};
+    {
+        collector::BatchWriter writer(cfg);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                for (uint32_t k = 0; k < 50; ++k) {
+                    for (uint64_t dev = 0; dev < 8; ++dev) {
+                        // every thread owns 2 devices
+                        if (dev % 4 != static_cast<uint64_t>(t)) continue;
+                        writer.submit(make_upload(dev, k * 10, 10), [&](const collector::Ack& ack) {
+                            ++acked;
+                            accepted += ack.accepted;
+                        });
+                    }
+                }
+            });
+        }
+        for (auto& th : threads) th.join();
+    }  // destructor drains
+    CHECK(acked == 4 * 2 * 50);
+    CHECK(accepted == 8 * 500);
+    for (uint64_t dev = 0; dev < 8; ++dev) {
+        CHECK(file_size(cfg.root + "/" + collector::device_hex(dev) + "/ts.u32") == 500 * 4);
+    }
+}
+
+int connect_local(uint16_t port) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool read_ack(int fd, collector::Ack& ack) {
+    uint8_t buf[collector::kAckSize];
+    size_t got = 0;
+    while (got < sizeof(buf)) {
+        const ssize_t n = ::recv(fd, buf + got, sizeof(buf) - got, 0);
+        if (n <= 0) return false;
+        got += static_cast<size_t>(n);
+    }
+    return collector::decode_ack(buf, ack);
+}
+
+void test_server_end_to_end() {
+    collector::WriterConfig wcfg;
+    wcfg.root = temp_dir();
+    wcfg.shards = 2;
+    collector::BatchWriter writer(wcfg);
+    collector::ServerConfig scfg;
+    scfg.bind_address = "127.0.0.1";
+    scfg.port = 0;
+    scfg.io_threads = 2;
+    collector::Server server(scfg, writer);
+    CHECK(server.start());
+
+    constexpr int kDevices = 32;
+    std::atomic<int> ok_acks{0}, dup_records{0};
+    std::vector<std::thread> clients;
+    for (int d = 0; d < kDevices; ++d) {
+        clients.emplace_back([&, d] {
+            const int fd = connect_local(server.port());
+            if (fd < 0) return;
+            // Pipeline three frames, then retransmit the second one
+            std::vector<uint8_t> wire;
+            for (uint32_t k = 0; k < 3; ++k) {
+                const std::vector<uint8_t> f = collector::encode_upload(make_upload(100 + d, k * 20, 20));
+                wire.insert(wire.end(), f.begin(), f.end());
+            }
+            const std::vector<uint8_t> again = collector::encode_upload(make_upload(100 + d, 20, 20));
+            wire.insert(wire.end(), again.begin(), again.end());
+            ::send(fd, wire.data(), wire.size(), 0);
+            uint32_t last_next = 0;
+            for (int k = 0; k < 4; ++k) {
+                collector::Ack ack;
+                if (!read_ack(fd, ack)) break;
+                if (ack.status == collector::Status::kOk && ack.device_id == static_cast<uint64_t>(100 + d)) ++ok_acks;
+                dup_records += static_cast<int>(ack.duplicates);
+                last_next = ack.next_seq;
+            }
+            if (last_next != 60) dup_records += 1000;  // flag a bad sequence
+            ::close(fd);
+        });
+    }
+    for (auto& c : clients) c.join();
+    CHECK(ok_acks == kDevices * 4);
+    CHECK(dup_records == kDevices * 20);
+
+    // A corrupt frame gets an error ack and the connection is closed
+    const int fd = connect_local(server.port());
+    std::vector<uint8_t> bad = collector::encode_upload(make_upload(7, 0, 2));
+    bad.back() ^= 0xFF;
+    ::send(fd, bad.data(), bad.size(), 0);
+    collector::Ack ack;
+    CHECK(read_ack(fd, ack));
+    CHECK(ack.status == collector::Status::kBadCrc);
+    uint8_t byte;
+    CHECK(::recv(fd, &byte, 1, 0) == 0);
+    ::close(fd);
+
+    server.stop();
+    const collector::ServerStats s = server.stats();
+    CHECK(s.frames == kDevices * 4);
+    CHECK(s.bad_frames == 1);
+    CHECK(file_size(wcfg.root + "/" + collector::device_hex(100) + "/steps.u16") == 60 * 2);
+}
+
+}  // namespace
+
+int main() {
+    struct {
+        const char* name;
+        void (*fn)();
+    } tests[] = {
+        {"frame_round_trip_byte_by_byte", test_frame_round_trip_byte_by_byte},
+        {"frame_rejects_corruption", test_frame_rejects_corruption},
+        {"column_store_dedup_and_recovery", test_column_store_dedup_and_recovery},
+        {"column_store_evicts_lru", test_column_store_evicts_lru},
+        {"batch_writer_concurrent_submitters", test_batch_writer_concurrent_submitters},
+        {"server_end_to_end", test_server_end_to_end},
+    };
+    for (const auto& t : tests) {
+        const int before = g_failures;
+        t.fn();
+        std::printf("%s %s\n", g_failures == before ? "PASS" : "FAIL", t.name);
+    }
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,262 @@
+// Load generator for the collector: replays synthetic device streams over
+// many concurrent connections and reports throughput and ack latency.
+//
+//   loadgen --port 7300 --devices 2000 --uploads 20 --records 240 --threads 4
+//
+// Each simulated device (one TCP connection) sends `uploads` frames of
+// `records` 15 s interval records, waiting for each ack. A fraction of frames
+// is sent twice (gateway retry after a lost ack); the collector must report
+// those records as duplicates.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "protocol.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    uint16_t port = 7300;
+    size_t devices = 1000;
+    size_t uploads = 10;
+    size_t records = 240;  // one hour of 15 s records
+    size_t threads = 4;
+    double retry_rate = 0.02;
+    uint64_t device_base = 0x24a1600000000000ULL;
+};
+
+struct DeviceSim {
+    int fd = -1;
+    uint64_t id = 0;
+    uint32_t next_seq = 0;
+    uint32_t timestamp = 1700000000;
+    size_t sent = 0;         // frames acked
+    bool retry_pending = false;
+    std::vector<uint8_t> out;
+    size_t out_pos = 0;
+    uint8_t ack_buf[collector::kAckSize];
+    size_t ack_len = 0;
+    Clock::time_point sent_at;
+    bool done = false;
+};
+
+struct Totals {
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> records_sent{0};
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint64_t> duplicates{0};
+    std::atomic<uint64_t> errors{0};
+    std::mutex mu;
+    std::vector<uint32_t> latencies_us;
+};
+
+collector::Upload make_upload(DeviceSim& d, size_t n, std::mt19937& rng) {
+    collector::Upload u;
+    u.device_id = d.id;
+    u.first_seq = d.next_seq;
+    u.records.resize(n);
+    std::normal_distribution<double> hr(72.0, 8.0);
+    for (auto& r : u.records) {
+        d.timestamp += 15;
+        r.avg_hr_x10 = static_cast<uint16_t>(std::max(0.0, hr(rng) * 10));
+        r.avg_temp_x100 = static_cast<int16_t>(3300 + rng() % 300);
+        r.step_count = static_cast<uint16_t>(rng() % 40);
+        r.timestamp = d.timestamp;
+        r.flags = 0;
+    }
+    return u;
+}
+
+int connect_to(const Options& opt) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    ::inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    const int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+bool flush_out(DeviceSim& d) {
+    while (d.out_pos < d.out.size()) {
+        const ssize_t w = ::send(d.fd, d.out.data() + d.out_pos, d.out.size() - d.out_pos, MSG_NOSIGNAL);
+        if (w < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+        d.out_pos += static_cast<size_t>(w);
+    }
+    return true;
+}
+
+void start_frame(DeviceSim& d, const Options& opt, std::mt19937& rng, Totals& totals) {
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    if (!d.retry_pending) {
+        const collector::Upload u = make_upload(d, opt.records, rng);
+        d.out = collector::encode_upload(u);
+        d.next_seq += static_cast<uint32_t>(opt.records);
+        d.retry_pending = coin(rng) < opt.retry_rate;  // resend this one after its ack
+    } else {
+        d.retry_pending = false;  // d.out still holds the previous frame
+    }
+    d.out_pos = 0;
+    d.sent_at = Clock::now();
+    totals.records_sent += opt.records;
+}
+
+void run_worker(const Options& opt, size_t first, size_t count, Totals& totals) {
+    std::mt19937 rng(static_cast<uint32_t>(first * 7919 + 1));
+    std::vector<DeviceSim> devs(count);
+    const int ep = ::epoll_create1(EPOLL_CLOEXEC);
+    size_t active = 0;
+    std::vector<uint32_t> lat;
+
+    for (size_t i = 0; i < count; ++i) {
+        DeviceSim& d = devs[i];
+        d.id = opt.device_base + first + i;
+        d.fd = connect_to(opt);
+        if (d.fd < 0) {
+            ++totals.errors;
+            d.done = true;
+            continue;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        ::epoll_ctl(ep, EPOLL_CTL_ADD, d.fd, &ev);
+        start_frame(d, opt, rng, totals);
+        flush_out(d);
+        ++active;
+    }
+
+    epoll_event events[256];
+    while (active > 0) {
+        const int n = ::epoll_wait(ep, events, 256, 100);
+        for (int k = 0; k < n; ++k) {
+            DeviceSim& d = devs[events[k].data.u64];
+            if (d.done) continue;
+            const ssize_t got = ::recv(d.fd, d.ack_buf + d.ack_len, collector::kAckSize - d.ack_len, 0);
+            if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+            if (got <= 0) {
+                ++totals.errors;
+                d.done = true;
+                --active;
+                continue;
+            }
+            d.ack_len += static_cast<size_t>(got);
+            if (d.ack_len < collector::kAckSize) continue;
+            d.ack_len = 0;
+
+            collector::Ack ack;
+            if (!collector::decode_ack(d.ack_buf, ack) || ack.status != collector::Status::kOk) {
+                ++totals.errors;
+                d.done = true;
+                --active;
+                continue;
+            }
+            lat.push_back(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - d.sent_at).count()));
+            ++totals.frames;
+            totals.accepted += ack.accepted;
+            totals.duplicates += ack.duplicates;
+            if (!d.retry_pending) ++d.sent;
+            if (d.sent >= opt.uploads) {
+                d.done = true;
+                --active;
+                continue;
+            }
+            start_frame(d, opt, rng, totals);
+            if (!flush_out(d)) {
+                ++totals.errors;
+                d.done = true;
+                --active;
+            }
+        }
+        // Frames bigger than the socket buffer finish here
+        for (DeviceSim& d : devs) {
+            if (!d.done && d.out_pos < d.out.size()) flush_out(d);
+        }
+    }
+    for (DeviceSim& d : devs) {
+        if (d.fd >= 0) ::close(d.fd);
+    }
+    ::close(ep);
+    std::lock_guard<std::mutex> lock(totals.mu);
+    totals.latencies_us.insert(totals.latencies_us.end(), lat.begin(), lat.end());
+}
+
+uint32_t percentile(std::vector<uint32_t>& v, double pct) {
+    if (v.empty()) return 0;
+    const size_t idx = std::min(v.size() - 1, static_cast<size_t>(pct / 100.0 * v.size()));
+    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(idx), v.end());
+    return v[idx];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        const char* v = argv[i + 1];
+        if (arg == "--host") opt.host = v;
+        else if (arg == "--port") opt.port = static_cast<uint16_t>(std::atoi(v));
+        else if (arg == "--devices") opt.devices = std::strtoul(v, nullptr, 10);
+        else if (arg == "--uploads") opt.uploads = std::strtoul(v, nullptr, 10);
+        else if (arg == "--records") opt.records = std::min<size_t>(std::strtoul(v, nullptr, 10), collector::kMaxRecordsPerUpload);
+        else if (arg == "--threads") opt.threads = std::max<size_t>(1, std::strtoul(v, nullptr, 10));
+        else if (arg == "--retry-rate") opt.retry_rate = std::atof(v);
+        else if (arg == "--device-base") opt.device_base = std::strtoull(v, nullptr, 0);
+        else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return 2;
+        }
+    }
+
+    Totals totals;
+    const Clock::time_point start = Clock::now();
+    std::vector<std::thread> workers;
+    const size_t per = (opt.devices + opt.threads - 1) / opt.threads;
+    for (size_t t = 0; t < opt.threads; ++t) {
+        const size_t first = t * per;
+        if (first >= opt.devices) break;
+        const size_t count = std::min(per, opt.devices - first);
+        workers.emplace_back([&opt, first, count, &totals] { run_worker(opt, first, count, totals); });
+    }
+    for (auto& w : workers) w.join();
+    const double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::printf("devices=%zu frames=%llu records_sent=%llu accepted=%llu duplicates=%llu errors=%llu\n", opt.devices,
+                (unsigned long long)totals.frames, (unsigned long long)totals.records_sent,
+                (unsigned long long)totals.accepted, (unsigned long long)totals.duplicates,
+                (unsigned long long)totals.errors);
+    std::printf("%.2f s, %.0f frames/s, %.0f records/s, ack latency p50=%u us p99=%u us\n", secs,
+                totals.frames / secs, totals.accepted / secs, percentile(totals.latencies_us, 50),
+                percentile(totals.latencies_us, 99));
+    return totals.errors ? 1 : 0;
+}
@@ -14,6 +14,7 @@ struct FirmwareRecord {
     let temperature: Double
     let stepCount: Int
     let timestamp: Date
+    var offWrist: Bool = false  // flags bit 0: HR/temp not valid for this interval
 }
 
 class BLEProtocolParser {
@@ -22,9 +23,10 @@ class BLEProtocolParser {
     static let DATA_MARKER: UInt8 = 0x02
     static let END_MARKER: UInt8   = 0x03
     
-    // Struct size: 2 (HR) + 2 (Temp) + 2 (Steps) + 4 (Time) = 10 bytes
-    // Matches firmware ConsolidatedRecord
+    // Struct size: 2 (HR) + 2 (Temp) + 2 (Steps) + 4 (Time) = 10 bytes,
+    // followed by 1 byte of flags on current firmware (ConsolidatedRecord is 11 bytes)
     static let RECORD_SIZE = 10
+    static let FLAG_OFF_WRIST: UInt8 = 0x01
     
     static func parseRecord(_ data: Data) -> FirmwareRecord? {
         // Data payload starts after the marker byte, so we expect exactly RECORD_SIZE bytes passed here
@@ -43,11 +45,15 @@ class BLEProtocolParser {
         // 4. Timestamp (UInt32)
         let timeRaw = data.subdata(in: 6..<10).withUnsafeBytes { $0.load(as: UInt32.self) }
         
+        // 5. Flags (UInt8) - optional, absent on older firmware
+        let flags: UInt8 = data.count > RECORD_SIZE ? data[data.startIndex + RECORD_SIZE] : 0
+        
         return FirmwareRecord(
             heartRate: Double(hrRaw) / 10.0,
             temperature: Double(tempRaw) / 100.0,
             stepCount: Int(stepsRaw),
-            timestamp: Date(timeIntervalSince1970: TimeInterval(timeRaw))
+            timestamp: Date(timeIntervalSince1970: TimeInterval(timeRaw)),
+            offWrist: (flags & FLAG_OFF_WRIST) != 0
         )
     }
 }
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <iostream>
+#ifdef ARDUINO
 #include <Arduino.h>
+#endif
 // General configuration values for the firmware application.
 
 // Device identification
@@ -14,7 +17,9 @@ constexpr char kDataCharUuid[] = "12345678-1234-5678-1234-56789abc1001";
 constexpr char kControlCharUuid[] = "12345678-1234-5678-1234-56789abc1002";
 
 // Filesystem configuration
-constexpr char kFsDataPath[] = "/consolidated.dat";
+// Record layout v2 (11 bytes, with flags). Files from the 10-byte layout
+// ("/consolidated.dat") are left untouched and no longer read.
+constexpr char kFsDataPath[] = "/records_v2.dat";
 constexpr size_t kFsChunkSize = 200;  // chunk size used for BLE notifications
 
 // Register buffer configuration
@@ -26,10 +31,51 @@ constexpr size_t kRegisterSize = 256;
 // File operations
 constexpr uint32_t kLoopIntervalMs = 5000;
 
+// Warm-restart snapshot of the consolidation pipeline (RTC memory)
+constexpr uint32_t kSnapshotIntervalMs = 1000;
+
+// Stack/heap high-water telemetry
+constexpr uint32_t kMemStatsIntervalMs = 1000;
+
+// Energy budget estimate (telemetry kPower* stats, see energy.h)
+constexpr uint32_t kEnergyIntervalMs = 10000;
+
+// Storage writer task (store_writer.h): queued interval records (16 = 4 min)
+// and how long ERASE / transfer start wait for the queue to drain
+constexpr size_t kStoreQueueDepth = 16;
+constexpr uint32_t kStoreBarrierTimeoutMs = 5000;
+// Idle-time pre-erase: keep this many free sectors ahead of the allocator
+// erased (every append takes a fresh 4 KB block), one sector per request,
+// requested while the writer queue is empty and the ring is below the mark
+constexpr size_t kPreErasePoolSectors = 4;
+constexpr uint32_t kPreEraseIntervalMs = 250;
+constexpr size_t kPreEraseRingWatermark = 64;
+// Sample spill (sample_spill.h): the sensor task diverts samples to flash
+// once the ring (256) holds this many, about 4.5 s the loop has not drained
+constexpr char kFsSpillPath[] = "/spill.bin";
+constexpr size_t kSpillRingWatermark = 224;
+#ifndef STORE_WRITER_STACK_BYTES
+#define STORE_WRITER_STACK_BYTES 4096
+#endif
+
+// Bulk SEND over an L2CAP connection-oriented channel (l2cap_channel.h).
+// Needs NimBLE built with CoC support: build_flags
+// -DBLE_L2CAP_COC=1 -DCONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM=1, as in the
+// esp32dev_l2cap env (pio run -e esp32dev_l2cap). Centrals that
+// do not open the channel get notifications either way.
+#ifndef BLE_L2CAP_COC
+#define BLE_L2CAP_COC 0
+#endif
+constexpr uint16_t kL2capPsm = 0x0081;      // dynamic (LE) PSM range
+constexpr uint16_t kL2capRxMtu = 64;       // the central sends nothing on the channel
+
 // BLE command keywords
 constexpr char kCmdList[] = "LIST";
 constexpr char kCmdSend[] = "SEND";
 constexpr char kCmdErase[] = "ERASE";
+constexpr char kCmdStats[] = "STATS";
+constexpr char kCmdLog[] = "LOG";
+constexpr char kCmdTree[] = "TREE";
 
 // LED configuration
 constexpr int kBlueLedPin = 25;  // Avoid strap pins (GPIO2) on bare modules; use GPIO25
@@ -58,9 +104,20 @@ constexpr uint32_t kLedFlashDurationMs = 100;  // LED flash duration for BLE act
 
 // Sampling cadences (ms)
 #define PPG_INTERVAL_MS         20     // ~50 Hz
+// PPG FIFO drain period in 10 ms sensor ticks. Beats are timed on the sample
+// clock (beat_timing.h), so bursts cost no HR accuracy; the 32-sample FIFO
+// holds 320 ms at 100 Hz.
+#ifndef PPG_DRAIN_TICKS
+#define PPG_DRAIN_TICKS         5
+#endif
 #define IMU_INTERVAL_MS         10     // ~100 Hz
 #define TEMP_INTERVAL_MS        1000   // ~1 Hz
 
+// Sensor task stack (bytes). Check the kStackFreeSensors stat before shrinking.
+#ifndef SENSORS_TASK_STACK_BYTES
+#define SENSORS_TASK_STACK_BYTES 4096
+#endif
+
 // Optional GPIO interrupt pins (set to actual pins if wired; leave -1 if not used)
 #ifndef MAX30102_INT_PIN
 #define MAX30102_INT_PIN        -1    // e.g., 19 if MAX30102 INT connected
@@ -69,11 +126,31 @@ constexpr uint32_t kLedFlashDurationMs = 100;  // LED flash duration for BLE act
 #define BMI270_INT_PIN          34    // BMI270 INT wired to GPIO34 (input-only)
 #endif
 
+// BMI270 on-chip step counter. When enabled its count is reconciled with the
+// software peak detector; IMU_STEPS_ONLY additionally drops the IMU read rate
+// to the no-motion rate permanently and trusts the hardware count alone.
+#ifndef USE_BMI270_STEP_COUNTER
+#define USE_BMI270_STEP_COUNTER 0
+#endif
+#ifndef IMU_STEPS_ONLY
+#define IMU_STEPS_ONLY          0
+#endif
+
 // Optional light sleep between interrupts (requires proper wake-capable pins and wiring)
 #ifndef ENABLE_LIGHT_SLEEP
 #define ENABLE_LIGHT_SLEEP      0
 #endif
 
+// Idle current floor for the energy model (uA). Measure the board with the
+// sensors idle and the BLE link down and set it here.
+#ifndef ENERGY_BASELINE_UA
+#if ENABLE_LIGHT_SLEEP
+#define ENERGY_BASELINE_UA      1500
+#else
+#define ENERGY_BASELINE_UA      20000
+#endif
+#endif
+
 // Optional: integrate with your ring buffer
 // #define SUB1_USE_RINGBUF 1
 
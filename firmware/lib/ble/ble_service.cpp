@@ -2,14 +2,17 @@
 #include "app_config.h"
 #include "compute/consolidate.h"
 #include "storage/fs_store.h"
+#include "sync_tree.h"
+#include "telemetry/binlog.h"
+#include "telemetry/telemetry.h"
 
 BLEServerClass bleServer;
 
 namespace {
-    constexpr uint8_t kStartMarker = 0x01;
-    constexpr uint8_t kDataMarker = 0x02;
-    constexpr uint8_t kEndMarker = 0x03;
-    constexpr const char kTimePrefix[] = "TIME:";
+    constexpr uint8_t kStatsMarker = 0x04;
+    constexpr uint8_t kLogMarker = 0x05;     // + up to 19 bytes of the binlog stream
+    constexpr uint8_t kLogEndMarker = 0x06;  // + entries sent u32, entries written since boot u32
+    constexpr size_t kLogPacketBytes = 20;   // default ATT MTU payload
 }
 
 void BLEServerClass::begin() {
@@ -27,6 +30,9 @@ void BLEServerClass::begin() {
     pControl->setCallbacks(this); // We handle our own char events
 
     pService->start();
+#if BLE_L2CAP_COC
+    _bulk.begin();
+#endif
     NimBLEDevice::getAdvertising()->addServiceUUID(kServiceUuid);
     NimBLEDevice::startAdvertising();
 
@@ -39,33 +45,31 @@ void BLEServerClass::begin() {
 
 void BLEServerClass::onConnect(NimBLEServer* pServer) {
     deviceConnected = true;
-    // Serial.println("[BLE] Connected");
+    BINLOG("[BLE] Connected");
+}
+
+void BLEServerClass::onConnect(NimBLEServer* pServer, ble_gap_conn_desc* desc) {
+    _connHandle = desc->conn_handle;
 }
 
 void BLEServerClass::onDisconnect(NimBLEServer* pServer) {
     deviceConnected = false;
-    // Serial.println("[BLE] Disconnected");
+    _connHandle = BLE_HS_CONN_HANDLE_NONE;
+    BINLOG("[BLE] Disconnected");
 }
 
+// NimBLE host task: parse and queue only. Flash, the clock and paced
+// notifications are left to update() on the loop task.
 void BLEServerClass::onWrite(NimBLECharacteristic* characteristic) {
     std::string val = characteristic->getValue();
     if (val.empty()) return;
 
     // Serial.printf("[BLE] Cmd: %s\n", val.c_str());
 
-    if (val == kCmdSend) {
-        _sendRequested = true; // Set flag for main loop
-    } 
-    else if (val == kCmdErase) {
-        if (onErase) onErase();
-        notify((uint8_t*)"ERASED", 6);
-    } 
-    else if (val.rfind(kTimePrefix, 0) == 0) { // Starts with TIME:
-        long long epoch = atoll(val.c_str() + 5);
-        if (epoch > 0 && onTimeSync) {
-            onTimeSync((time_t)epoch);
-            notify((uint8_t*)"TIME_OK", 7);
-        }
+    command_queue::Command command;
+    if (!command_queue::parse(val.data(), val.size(), command)) return;
+    if (!_commands.push(command)) {
+        telemetry::add(telemetry::Stat::kBleCommandsDropped, 1);
     }
 }
 
@@ -74,53 +78,150 @@ void BLEServerClass::onWrite(NimBLECharacteristic* characteristic) {
 // ============================================================================
 
 void BLEServerClass::update() {
-    if (_sendRequested) {
-        _sendRequested = false;
+    command_queue::Command command;
+    while (_commands.pop(command)) {
+        execute(command);
+    }
+}
+
+void BLEServerClass::execute(const command_queue::Command& command) {
+    switch (command.op) {
+    case command_queue::Op::kSend:
         stream_all_records();
+        break;
+    case command_queue::Op::kErase:
+        if (onErase) onErase();
+        _treeCache.clear();
+        notify((uint8_t*)"ERASED", 6);
+        break;
+    case command_queue::Op::kStats:
+        send_stats();
+        break;
+    case command_queue::Op::kLog:
+        send_log();
+        break;
+    case command_queue::Op::kTime:
+        if (onTimeSync) {
+            onTimeSync((time_t)command.arg);
+            notify((uint8_t*)"TIME_OK", 7);
+        }
+        break;
+    case command_queue::Op::kTree:
+        send_tree(static_cast<uint8_t>(command.arg2), static_cast<size_t>(command.arg));
+        break;
+    case command_queue::Op::kRange: {
+        const size_t first = static_cast<size_t>(command.arg);
+        const size_t length = command.arg2;
+        stream_records([first, length](size_t& count) {
+            const transfer::RecordSource source =
+                sync_tree::range(fs_store::for_each_record_from, fs_store::record_count(), first, length, count);
+            BINLOG("[BLE] Range of %u records from %u", static_cast<unsigned>(count), static_cast<unsigned>(first));
+            return source;
+        });
+        break;
+    }
     }
 }
 
 void BLEServerClass::stream_all_records() {
+    stream_records([](size_t& count) {
+        count = fs_store::record_count();
+        BINLOG("[BLE] Streaming %u records...", static_cast<unsigned>(count));
+        return transfer::RecordSource(fs_store::for_each_record);
+    });
+}
+
+void BLEServerClass::stream_records(const OpenRecords& open) {
     if (!deviceConnected) return;
+    // Submits the held record and flushes the writer: count after it
     if (onTransferStart) onTransferStart();
+    size_t count = 0;
+    const transfer::RecordSource source = open(count);
+
+    // Over the bulk channel if the central opened one, else notifications
+#if BLE_L2CAP_COC
+    if (_bulk.connected()) {
+        const transfer::Result result = transfer::stream_bulk(_bulk, count, source);
+        BINLOG("[BLE] L2CAP sent %u, dropped %u", static_cast<unsigned>(result.sent), static_cast<unsigned>(result.dropped));
+        if (onTransferComplete) onTransferComplete();
+        return;
+    }
+#endif
+    const transfer::Result result = transfer::stream(*this, count, source);
+    BINLOG("[BLE] Sent %u, dropped %u", static_cast<unsigned>(result.sent), static_cast<unsigned>(result.dropped));
 
-    size_t count = fs_store::record_count();
-    // Serial.printf("[BLE] Streaming %u records...\n", count);
-
-    // 1. Send Start
-    uint8_t startBuf[5] = {kStartMarker};
-    memcpy(&startBuf[1], &count, 4);
-    notify(startBuf, 5);
-    
-    delay(50); 
+    // Serial.println("[BLE] Done");
+    if (onTransferComplete) onTransferComplete();
+}
 
-    // 2. Send Data
-    fs_store::for_each_record([this](const consolidate::ConsolidatedRecord& rec, size_t i) {
-        if (!deviceConnected) return false;
+// Digests for hash-tree reconciliation (sync_tree.h). High nodes fold the
+// cached digests of completed nodes, so a TREE reads only the records
+// appended since the last one.
+void BLEServerClass::send_tree(uint8_t level, size_t first) {
+    if (!deviceConnected) return;
+    sync_tree::send_nodes(*this, fs_store::for_each_record_from, fs_store::record_count(), level, first,
+                          transfer::Pacing(), &_treeCache);
+}
 
-        uint8_t packet[1 + sizeof(rec)];
-        packet[0] = kDataMarker;
-        memcpy(&packet[1], &rec, sizeof(rec));
+// One packet per stat: [marker][id][value u32 LE]
+void BLEServerClass::send_stats() {
+    for (size_t id = 0; id < telemetry::count(); ++id) {
+        const uint32_t value = telemetry::get(static_cast<telemetry::Stat>(id));
+        uint8_t packet[6] = {kStatsMarker, static_cast<uint8_t>(id)};
+        memcpy(&packet[2], &value, 4);
+        notify(packet, sizeof(packet));
+    }
+}
 
-        if (!notify(packet, sizeof(packet))) {
-            // Serial.println("[BLE] Congestion drop");
+// Non-destructive dump of the binlog ring as a byte stream cut into
+// [marker][chunk] packets; entries may span packets. scripts/binlog_decode.py
+// reassembles and formats it.
+void BLEServerClass::send_log() {
+    const transfer::Pacing pacing;
+    uint32_t cursor = binlog::oldest();
+    const uint32_t stop = binlog::written();  // entries logged during the dump wait for the next one
+    uint32_t sent = 0;
+    uint8_t stream[kLogPacketBytes - 1 + binlog::kMaxEntryBytes];
+    size_t buffered = 0;
+    uint8_t packet[kLogPacketBytes] = {kLogMarker};
+
+    for (;;) {
+        const uint32_t before = cursor;
+        uint32_t lost = 0;
+        const size_t n = binlog::read(cursor, stream + buffered, sizeof(stream) - buffered, &lost);
+        buffered += n;
+        sent += cursor - before - lost;
+        const bool done = n == 0 || static_cast<int32_t>(cursor - stop) >= 0;
+        while (buffered >= kLogPacketBytes - 1 || (done && buffered > 0)) {
+            const size_t chunk = buffered < kLogPacketBytes - 1 ? buffered : kLogPacketBytes - 1;
+            memcpy(&packet[1], stream, chunk);
+            if (!notify(packet, chunk + 1)) return;
+            memmove(stream, stream + chunk, buffered - chunk);
+            buffered -= chunk;
+            delay_ms(pacing.per_record_ms);
         }
+        if (done) break;
+    }
 
-        delay(15); // Critical for flow control
-        return true;
-    });
-
-    // 3. Send End
-    uint8_t endMarker = kEndMarker;
-    notify(&endMarker, 1);
-
-    // Serial.println("[BLE] Done");
-    if (onTransferComplete) onTransferComplete();
+    uint8_t end[9] = {kLogEndMarker};
+    const uint32_t written = binlog::written();
+    memcpy(&end[1], &sent, 4);
+    memcpy(&end[5], &written, 4);
+    notify(end, sizeof(end));
 }
 
+// NimBLECharacteristic::notify() returns void and only logs a failed send,
+// so it goes to the host directly here: a packet the host has no mbuf or
+// queue room for comes back false and transfer::stream() counts it dropped.
 bool BLEServerClass::notify(const uint8_t* data, size_t length) {
     if (!deviceConnected || !pNotifyCharacteristic) return false;
-    pNotifyCharacteristic->setValue(data, length);
-    pNotifyCharacteristic->notify();
+    if (_connHandle == BLE_HS_CONN_HANDLE_NONE || pNotifyCharacteristic->getSubscribedCount() == 0) return false;
+    pNotifyCharacteristic->setValue(data, length);  // what a READ returns
+    os_mbuf* om = ble_hs_mbuf_from_flat(data, static_cast<uint16_t>(length));
+    if (!om) return false;
+    // Consumes om whether or not it is queued
+    if (ble_gattc_notify_custom(_connHandle, pNotifyCharacteristic->getHandle(), om) != 0) return false;
+    telemetry::add(telemetry::Stat::kRadioTxPackets, 1);
+    telemetry::add(telemetry::Stat::kRadioTxBytes, length);
     return true;
 }
\ No newline at end of file
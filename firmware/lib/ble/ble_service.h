@@ -5,35 +5,59 @@
 #include <Arduino.h>
 #include <functional>
 
+#include "command_queue.h"
+#include "l2cap_channel.h"
+#include "sync_tree.h"
+#include "transfer.h"
+
 namespace consolidate { struct ConsolidatedRecord; }
 
 // Inherit directly from callbacks to simplify structure
-class BLEServerClass : public NimBLEServerCallbacks, public NimBLECharacteristicCallbacks {
+class BLEServerClass : public NimBLEServerCallbacks, public NimBLECharacteristicCallbacks,
+                       public transfer::Link {
 public:
     void begin();
-    void update(); // Call this in loop()
+    void update(); // Call this in loop(); runs queued commands
 
-    // Public callbacks (assign these directly)
+    // Public callbacks (assign these directly); all run on the loop task
     std::function<void()> onErase;
     std::function<void(time_t)> onTimeSync;
     std::function<void()> onTransferStart;
     std::function<void()> onTransferComplete;
 
 private:
-    volatile bool _sendRequested = false;
+    command_queue::Queue _commands;  // onWrite() -> update()
+#if BLE_L2CAP_COC
+    L2capChannel _bulk;              // SEND and RANGE go here when the central opened it
+#endif
+    sync_tree::NodeCache _treeCache;  // completed TREE nodes, dropped on ERASE
     bool deviceConnected = false;
+    uint16_t _connHandle = BLE_HS_CONN_HANDLE_NONE;  // notify() sends to it directly
     NimBLECharacteristic* pNotifyCharacteristic = nullptr;
 
     // Overrides from NimBLEServerCallbacks
     void onConnect(NimBLEServer* pServer) override;
+    void onConnect(NimBLEServer* pServer, ble_gap_conn_desc* desc) override;
     void onDisconnect(NimBLEServer* pServer) override;
 
     // Overrides from NimBLECharacteristicCallbacks
     void onWrite(NimBLECharacteristic* characteristic) override;
 
+    // transfer::Link
+    bool connected() const override { return deviceConnected; }
+    bool notify(const uint8_t* data, size_t length) override;
+    void delay_ms(uint32_t ms) override { delay(ms); }
+
     // Helpers
+    void execute(const command_queue::Command& command);
     void stream_all_records();
-    bool notify(const uint8_t* data, size_t length);
+    // Opens the records to send once onTransferStart() has flushed the
+    // writer, so the count it sets includes everything queued before
+    typedef std::function<transfer::RecordSource(size_t& count)> OpenRecords;
+    void stream_records(const OpenRecords& open);
+    void send_tree(uint8_t level, size_t first);
+    void send_stats();
+    void send_log();
 };
 
 extern BLEServerClass bleServer;
@@ -0,0 +1,112 @@
+#include "command_queue.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "app_config.h"
+#include "sync_tree.h"
+
+namespace command_queue {
+
+namespace {
+
+constexpr char kTimePrefix[] = "TIME:";
+constexpr char kTreePrefix[] = "TREE:";
+constexpr char kRangePrefix[] = "RANGE:";
+constexpr size_t kMaxCommandBytes = 32;
+
+bool equals(const char* data, size_t length, const char* keyword) {
+    return length == strlen(keyword) && memcmp(data, keyword, length) == 0;
+}
+
+bool starts_with(const char* data, size_t length, const char* prefix) {
+    const size_t n = strlen(prefix);
+    return length > n && memcmp(data, prefix, n) == 0;
+}
+
+// Decimal digits up to `end` or `stop`; false if there are none or the
+// value does not fit 32 bits
+bool parse_u32(const char*& p, const char* end, char stop, uint32_t& out) {
+    uint64_t value = 0;
+    const char* start = p;
+    for (; p < end && *p != stop; ++p) {
+        if (*p < '0' || *p > '9') return false;
+        value = value * 10 + static_cast<uint64_t>(*p - '0');
+        if (value > UINT32_MAX) return false;
+    }
+    out = static_cast<uint32_t>(value);
+    return p > start;
+}
+
+// "<prefix><a>:<b>" with nothing after b
+bool parse_pair(const char* data, size_t length, const char* prefix, uint32_t& a, uint32_t& b) {
+    const char* p = data + strlen(prefix);
+    const char* end = data + length;
+    if (!parse_u32(p, end, ':', a) || p == end) return false;
+    ++p;
+    return parse_u32(p, end, ':', b) && p == end;
+}
+
+}  // namespace
+
+bool parse(const char* data, size_t length, Command& out) {
+    out.arg = 0;
+    out.arg2 = 0;
+    if (equals(data, length, kCmdSend)) {
+        out.op = Op::kSend;
+    } else if (equals(data, length, kCmdErase)) {
+        out.op = Op::kErase;
+    } else if (equals(data, length, kCmdStats)) {
+        out.op = Op::kStats;
+    } else if (equals(data, length, kCmdLog)) {
+        out.op = Op::kLog;
+    } else if (equals(data, length, kCmdTree)) {
+        out.op = Op::kTree;
+        out.arg2 = sync_tree::kTopLevel;
+    } else if (starts_with(data, length, kTreePrefix) || starts_with(data, length, kRangePrefix)) {
+        const bool tree = starts_with(data, length, kTreePrefix);
+        uint32_t a, b;
+        if (!parse_pair(data, length, tree ? kTreePrefix : kRangePrefix, a, b)) return false;
+        if (tree) {
+            if (a >= sync_tree::kMaxLevels) return false;
+            out.op = Op::kTree;
+            out.arg = b;
+            out.arg2 = a;
+        } else {
+            if (b == 0) return false;
+            out.op = Op::kRange;
+            out.arg = a;
+            out.arg2 = b;
+        }
+    } else if (length > sizeof(kTimePrefix) - 1 && length < kMaxCommandBytes &&
+               memcmp(data, kTimePrefix, sizeof(kTimePrefix) - 1) == 0) {
+        char digits[kMaxCommandBytes];
+        memcpy(digits, data + sizeof(kTimePrefix) - 1, length - (sizeof(kTimePrefix) - 1));
+        digits[length - (sizeof(kTimePrefix) - 1)] = '\0';
+        const long long epoch = atoll(digits);
+        if (epoch <= 0) return false;
+        out.op = Op::kTime;
+        out.arg = epoch;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool Queue::push(const Command& command) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == kDepth) return false;
+    slots_[tail & (kDepth - 1)] = command;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool Queue::pop(Command& command) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return false;
+    command = slots_[head & (kDepth - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+}  // namespace command_queue
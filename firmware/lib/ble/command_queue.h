@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Control-characteristic commands, parsed on the NimBLE host task and run
+// later by the loop task. Writes arrive in onWrite() on the host task, which
+// must not touch flash (ERASE would race loop()'s appends) or block the
+// stack; it only parses the write into a Command and pushes it here.
+// BLEServerClass::update() pops and executes them between loop passes.
+namespace command_queue {
+
+enum class Op : uint8_t {
+    kSend,   // stream all records
+    kErase,  // clear stored records and the sample pipeline
+    kStats,  // notify telemetry
+    kLog,    // dump the binlog
+    kTime,   // set the clock; arg = epoch seconds
+    kTree,   // notify hash-tree digests (sync_tree.h); arg = first node, arg2 = level
+    kRange,  // stream records; arg = first record, arg2 = record count
+};
+
+struct Command {
+    Op op;
+    int64_t arg;
+    uint32_t arg2;
+};
+
+// Parse one control write ("SEND", "TIME:<epoch>", "TREE:<level>:<first>",
+// ...). False for unknown commands, a TIME without a positive epoch and a
+// TREE or RANGE with missing or malformed numbers. A bare "TREE" asks for
+// the root (level sync_tree::kTopLevel).
+bool parse(const char* data, size_t length, Command& out);
+
+// Fixed-depth single-producer (host task) / single-consumer (loop task)
+// queue; push() never blocks or allocates.
+class Queue {
+public:
+    static constexpr size_t kDepth = 8;
+
+    // Producer: false (command dropped) when full
+    bool push(const Command& command);
+    // Consumer
+    bool pop(Command& command);
+
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+
+private:
+    static_assert((kDepth & (kDepth - 1)) == 0, "kDepth must be a power of two");
+
+    Command slots_[kDepth];
+    std::atomic<size_t> head_{0};  // next to pop; written by the consumer
+    std::atomic<size_t> tail_{0};  // next free slot; written by the producer
+};
+
+}  // namespace command_queue
@@ -0,0 +1,101 @@
+#include "l2cap_channel.h"
+
+#if BLE_L2CAP_COC
+
+#include <NimBLEDevice.h>
+#if defined(CONFIG_NIMBLE_CPP_IDF)
+#include "host/ble_l2cap.h"
+#else
+#include "nimble/nimble/host/include/host/ble_l2cap.h"
+#endif
+
+#if !CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM
+#error "BLE_L2CAP_COC needs CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM >= 1"
+#endif
+
+#include "telemetry/binlog.h"
+#include "telemetry/telemetry.h"
+
+bool L2capChannel::begin() {
+    if (!lock_) lock_ = xSemaphoreCreateMutex();
+    const int rc = ble_l2cap_create_server(kL2capPsm, kL2capRxMtu, on_event, this);
+    if (rc != 0) BINLOG("[BLE] L2CAP server on PSM 0x%x failed (%d)", kL2capPsm, rc);
+    return rc == 0;
+}
+
+bool L2capChannel::connected() const {
+    return chan_ != nullptr;
+}
+
+size_t L2capChannel::sdu_bytes() const {
+    return peer_mtu_;
+}
+
+bool L2capChannel::send(const uint8_t* data, size_t length) {
+    if (!lock_) return false;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    bool queued = false;
+    if (chan_ && !stalled_) {
+        os_mbuf* sdu = ble_hs_mbuf_from_flat(data, static_cast<uint16_t>(length));
+        const int rc = sdu ? ble_l2cap_send(chan_, sdu) : BLE_HS_ENOMEM;
+        if (rc == 0 || rc == BLE_HS_ESTALLED) {
+            // Stalled SDUs are queued; the next waits for TX_UNSTALLED
+            stalled_ = rc == BLE_HS_ESTALLED;
+            queued = true;
+            telemetry::add(telemetry::Stat::kRadioTxPackets, 1);
+            telemetry::add(telemetry::Stat::kRadioTxBytes, length);
+        } else if (sdu) {
+            os_mbuf_free_chain(sdu);  // not taken (BUSY, no buffers)
+        }
+    }
+    xSemaphoreGive(lock_);
+    return queued;
+}
+
+// The central sends nothing we use; keep a receive buffer posted so the
+// channel stays open if it does
+void L2capChannel::arm_receive(ble_l2cap_chan* chan) {
+    os_mbuf* rx = os_msys_get_pkthdr(kL2capRxMtu, 0);
+    if (rx && ble_l2cap_recv_ready(chan, rx) != 0) os_mbuf_free_chain(rx);
+}
+
+int L2capChannel::on_event(ble_l2cap_event* event, void* arg) {
+    L2capChannel& self = *static_cast<L2capChannel*>(arg);
+    switch (event->type) {
+    case BLE_L2CAP_EVENT_COC_ACCEPT:
+        self.arm_receive(event->accept.chan);
+        return 0;
+    case BLE_L2CAP_EVENT_COC_CONNECTED: {
+        if (event->connect.status != 0) return 0;
+        ble_l2cap_chan_info info;
+        if (ble_l2cap_get_chan_info(event->connect.chan, &info) != 0) return 0;
+        xSemaphoreTake(self.lock_, portMAX_DELAY);
+        self.chan_ = event->connect.chan;
+        self.peer_mtu_ = info.peer_coc_mtu;
+        self.stalled_ = false;
+        xSemaphoreGive(self.lock_);
+        BINLOG("[BLE] L2CAP channel open, peer MTU %u", info.peer_coc_mtu);
+        return 0;
+    }
+    case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+        xSemaphoreTake(self.lock_, portMAX_DELAY);
+        if (self.chan_ == event->disconnect.chan) self.chan_ = nullptr;
+        self.stalled_ = false;
+        xSemaphoreGive(self.lock_);
+        BINLOG("[BLE] L2CAP channel closed");
+        return 0;
+    case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+        if (event->receive.sdu_rx) os_mbuf_free_chain(event->receive.sdu_rx);
+        self.arm_receive(event->receive.chan);
+        return 0;
+    case BLE_L2CAP_EVENT_COC_TX_UNSTALLED:
+        xSemaphoreTake(self.lock_, portMAX_DELAY);
+        self.stalled_ = false;
+        xSemaphoreGive(self.lock_);
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+#endif  // BLE_L2CAP_COC
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "app_config.h"
+#include "transfer.h"
+
+struct ble_l2cap_chan;
+struct ble_l2cap_event;
+
+// Bulk SEND channel: an LE L2CAP connection-oriented channel on kL2capPsm,
+// served next to the GATT service. A central that wants bulk transfer
+// opens the channel after connecting and then writes SEND as usual; the
+// records come back as large SDUs (transfer::stream_bulk) that the stack
+// segments and paces by the central's credits, instead of one ATT
+// notification per record. Centrals that never open it are unaffected.
+//
+// NimBLE-Arduino has no CoC wrapper, so this drives the NimBLE host API
+// directly; events arrive on the host task, send() runs on the loop task.
+// Built only with BLE_L2CAP_COC (app_config.h).
+class L2capChannel : public transfer::Channel {
+public:
+    // After NimBLEDevice::init()
+    bool begin();
+
+    bool connected() const override;
+    size_t sdu_bytes() const override;
+    bool send(const uint8_t* data, size_t length) override;
+    void delay_ms(uint32_t ms) override { delay(ms); }
+
+private:
+    static int on_event(ble_l2cap_event* event, void* arg);
+    void arm_receive(ble_l2cap_chan* chan);
+
+    // Guards chan_ against the host task freeing it mid-send, and stalled_
+    // against an unstall landing between a send and its result
+    SemaphoreHandle_t lock_ = nullptr;
+    ble_l2cap_chan* chan_ = nullptr;
+    volatile uint16_t peer_mtu_ = 0;
+    volatile bool stalled_ = false;  // last SDU waits for credits
+};
@@ -0,0 +1,192 @@
+#include "sync_tree.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sync_tree {
+
+namespace {
+
+constexpr uint64_t kFnvPrime = 0x100000001b3ull;
+
+size_t ceil_div(size_t a, size_t b) {
+    return (a + b - 1) / b;
+}
+
+// Folds records into node digests bottom-up: one running hash per level,
+// closed when its segment or its kFanout children are complete, or at the
+// end of the file. Digests of `level` are written to `out`.
+class Fold {
+public:
+    Fold(uint8_t level, uint64_t* out) : level_(level), out_(out) {
+        for (size_t l = 0; l <= level_; ++l) {
+            hash_[l] = kFnvOffset;
+            fill_[l] = 0;
+        }
+    }
+
+    void add(const consolidate::ConsolidatedRecord& record) {
+        hash_[0] = fnv1a64(&record, sizeof(record), hash_[0]);
+        if (++fill_[0] == kSegmentRecords) close(0);
+    }
+
+    // A completed node of level `l` (below or at the output level) whose
+    // digest is already known
+    void add_node(uint8_t l, uint64_t digest) {
+        if (l == level_) {
+            out_[emitted_++] = digest;
+            return;
+        }
+        hash_[l + 1] = fnv1a64(&digest, sizeof(digest), hash_[l + 1]);
+        if (++fill_[l + 1] == kFanout) close(l + 1);
+    }
+
+    // End of the file: close the partial node of every level
+    void finish() {
+        for (uint8_t l = 0; l <= level_; ++l) {
+            if (fill_[l]) close(l);
+        }
+    }
+
+    size_t emitted() const { return emitted_; }
+
+private:
+    void close(uint8_t l) {
+        const uint64_t digest = hash_[l];
+        hash_[l] = kFnvOffset;
+        fill_[l] = 0;
+        add_node(l, digest);
+    }
+
+    uint8_t level_;
+    uint64_t* out_;
+    size_t emitted_ = 0;
+    uint64_t hash_[kMaxLevels];
+    size_t fill_[kMaxLevels];
+};
+
+}  // namespace
+
+uint64_t fnv1a64(const void* data, size_t length, uint64_t hash) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= p[i];
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+uint8_t levels(size_t records) {
+    if (records == 0) return 0;
+    uint8_t n = 1;
+    for (size_t nodes = ceil_div(records, kSegmentRecords); nodes > 1; nodes = ceil_div(nodes, kFanout)) ++n;
+    return n;
+}
+
+size_t node_count(size_t records, uint8_t level) {
+    if (level >= levels(records)) return 0;
+    size_t nodes = ceil_div(records, kSegmentRecords);
+    for (uint8_t l = 0; l < level; ++l) nodes = ceil_div(nodes, kFanout);
+    return nodes;
+}
+
+size_t records_per_node(uint8_t level) {
+    size_t span = kSegmentRecords;
+    for (uint8_t l = 0; l < level; ++l) span *= kFanout;
+    return span;
+}
+
+size_t digests(const RangeSource& source, size_t records, uint8_t level, size_t first, uint64_t* out,
+               size_t max, const NodeCache* cache) {
+    const size_t nodes = node_count(records, level);
+    if (first >= nodes || max == 0) return 0;
+    const size_t n = std::min(max, nodes - first);
+    const size_t end = std::min(records, (first + n) * records_per_node(level));
+    size_t begin = first * records_per_node(level);
+
+    Fold fold(level, out);
+    // Completed cached nodes under the range stand in for their records
+    if (cache && level >= kCachedLevel) {
+        const size_t span = records_per_node(kCachedLevel);
+        for (size_t c = begin / span; c < cache->size() && (c + 1) * span <= end; ++c) {
+            fold.add_node(kCachedLevel, (*cache)[c]);
+            begin = (c + 1) * span;
+        }
+    }
+
+    size_t seen = 0;
+    if (begin < end) {
+        source(begin, [&](const consolidate::ConsolidatedRecord& record, size_t index) {
+            if (index >= end) return false;
+            fold.add(record);
+            ++seen;
+            return true;
+        });
+    }
+    // A short read would hash a partial node as if it were the whole one
+    if (seen != end - begin) return 0;
+    fold.finish();
+    return fold.emitted();
+}
+
+bool NodeCache::update(const RangeSource& source, size_t records) {
+    if (records < this->records()) clear();  // shorter file: erased and refilled
+    const size_t span = records_per_node(kCachedLevel);
+    const size_t complete = records / span;
+    while (nodes_.size() < complete) {
+        // In kFanout-node steps so the pass needs no buffer beyond this
+        uint64_t found[kFanout];
+        const size_t want = std::min(kFanout, complete - nodes_.size());
+        const size_t got = digests(source, complete * span, kCachedLevel, nodes_.size(), found, want);
+        if (got != want) return false;
+        nodes_.insert(nodes_.end(), found, found + got);
+    }
+    return true;
+}
+
+void NodeCache::clear() {
+    nodes_.clear();
+    nodes_.shrink_to_fit();
+}
+
+bool send_nodes(transfer::Link& link, const RangeSource& source, size_t records, uint8_t level, size_t first,
+                const transfer::Pacing& pacing, NodeCache* cache) {
+    const uint8_t top = levels(records);
+    if (level == kTopLevel) level = top ? top - 1 : 0;
+    if (cache && !cache->update(source, records)) cache = nullptr;
+    uint64_t found[kFanout];
+    const size_t n = digests(source, records, level, first, found, kFanout, cache);
+
+    uint8_t header[kHeaderPacketBytes] = {kTreeMarker};
+    const uint32_t records32 = static_cast<uint32_t>(records);
+    memcpy(&header[1], &records32, 4);
+    header[5] = top;
+    header[6] = level;
+    header[7] = static_cast<uint8_t>(n);
+    if (!link.notify(header, sizeof(header))) return false;
+    link.delay_ms(pacing.per_record_ms);
+
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t packet[kNodePacketBytes] = {kNodeMarker};
+        const uint32_t index = static_cast<uint32_t>(first + i);
+        memcpy(&packet[1], &index, 4);
+        memcpy(&packet[5], &found[i], 8);
+        if (!link.notify(packet, sizeof(packet))) return false;
+        link.delay_ms(pacing.per_record_ms);
+    }
+    return true;
+}
+
+transfer::RecordSource range(const RangeSource& source, size_t records, size_t first, size_t count,
+                             size_t& clipped) {
+    clipped = first < records ? std::min(count, records - first) : 0;
+    const size_t end = first + clipped;
+    return [source, first, end](const transfer::RecordCallback& callback) {
+        if (first >= end) return;
+        source(first, [&](const consolidate::ConsolidatedRecord& record, size_t index) {
+            return index < end && callback(record, index);
+        });
+    };
+}
+
+}  // namespace sync_tree
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "transfer.h"
+
+// Hash-tree reconciliation of the record file (TREE and RANGE), so a client
+// that lost or damaged part of its copy fetches only what differs instead of
+// a full SEND. The file is cut into segments of kSegmentRecords records; a
+// segment's digest is FNV-1a 64 over its records' bytes, and each level
+// above holds one digest per kFanout nodes of the level below (FNV-1a 64
+// over their digests, little-endian), up to a single root. The last node of
+// every level covers whatever is left. The client builds the same tree over
+// its copy, walks down from the root with TREE through the nodes that
+// differ, then fetches the segments under them with RANGE:
+//   [0x09][records u32][levels u8][level u8][nodes u8]  TREE reply header
+//   [0x08][index u32][digest u64]                      one per node
+// Appends only change the last node of each level. FNV-1a finds lost or
+// corrupted records; it is no defence against a peer forging them.
+namespace sync_tree {
+
+constexpr size_t kSegmentRecords = 32;   // 8 min of 15 s intervals
+constexpr size_t kFanout = 8;            // also the nodes per TREE reply
+constexpr uint8_t kMaxLevels = 8;        // 32 * 8^7 records, far past the partition
+constexpr uint8_t kTopLevel = 0xFF;      // TREE with no arguments: the root
+constexpr uint8_t kNodeMarker = 0x08;
+constexpr uint8_t kTreeMarker = 0x09;
+constexpr size_t kHeaderPacketBytes = 1 + 4 + 3;
+constexpr size_t kNodePacketBytes = 1 + 4 + 8;
+
+constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+uint64_t fnv1a64(const void* data, size_t length, uint64_t hash = kFnvOffset);
+
+// Tree shape over `records` records: 0 levels when there are none
+uint8_t levels(size_t records);
+size_t node_count(size_t records, uint8_t level);
+size_t records_per_node(uint8_t level);
+
+// Records from index `first` on, in order (fs_store::for_each_record_from
+// on the device); the callback gets absolute indices
+typedef std::function<void(size_t first, const transfer::RecordCallback&)> RangeSource;
+
+// Digests of the completed nodes of kCachedLevel, kept between TREE
+// commands. Appends never change a completed node, so update() reads only
+// the records after the last one. Level 1 rather than the segments: a full
+// partition is ~5.9k segments (47 KB of digests) but ~740 level-1 nodes, and
+// a TREE below kCachedLevel reads at most kFanout segments anyway. Clear it
+// when the file is erased.
+constexpr uint8_t kCachedLevel = 1;
+
+class NodeCache {
+public:
+    // Cover the completed nodes of the first `records` records; false (cache
+    // unchanged) if the source came up short
+    bool update(const RangeSource& source, size_t records);
+    void clear();
+
+    size_t size() const { return nodes_.size(); }
+    size_t records() const { return nodes_.size() * kFanout * kSegmentRecords; }
+    uint64_t operator[](size_t i) const { return nodes_[i]; }
+
+private:
+    std::vector<uint64_t> nodes_;
+};
+
+// Digests of up to `max` nodes of `level` from node `first`, in one pass
+// over the records under them (only those past the cache's completed nodes
+// if `cache` is given and level >= kCachedLevel). Returns the digests written.
+size_t digests(const RangeSource& source, size_t records, uint8_t level, size_t first, uint64_t* out,
+               size_t max, const NodeCache* cache = nullptr);
+
+// Answer TREE: the header, then up to kFanout digests of `level` from node
+// `first` (kTopLevel: the root). False if the link refused a packet. With a
+// cache, it is brought up to date first.
+bool send_nodes(transfer::Link& link, const RangeSource& source, size_t records, uint8_t level, size_t first,
+                const transfer::Pacing& pacing = transfer::Pacing(), NodeCache* cache = nullptr);
+
+// RANGE: `count` records from `first` as a transfer::RecordSource, clipped
+// to the `records` stored; `clipped` gets the count actually covered
+transfer::RecordSource range(const RangeSource& source, size_t records, size_t first, size_t count,
+                             size_t& clipped);
+
+}  // namespace sync_tree
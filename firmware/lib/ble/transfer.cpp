@@ -0,0 +1,95 @@
+#include "transfer.h"
+
+#include <cstring>
+
+namespace transfer {
+
+namespace {
+
+bool send_sdu(Channel& channel, const uint8_t* data, size_t length, const BulkPacing& pacing) {
+    uint32_t waited_ms = 0;
+    while (!channel.send(data, length)) {
+        if (!channel.connected() || waited_ms >= pacing.stall_timeout_ms) return false;
+        channel.delay_ms(pacing.retry_ms);
+        waited_ms += pacing.retry_ms;
+    }
+    return true;
+}
+
+}  // namespace
+
+Result stream(Link& link, size_t count, const RecordSource& source, const Pacing& pacing) {
+    Result result;
+    result.announced = count;
+
+    uint8_t start[kStartPacketBytes] = {kStartMarker};
+    const uint32_t count32 = static_cast<uint32_t>(count);
+    memcpy(&start[1], &count32, 4);
+    link.notify(start, sizeof(start));
+    link.delay_ms(pacing.after_start_ms);
+
+    source([&](const consolidate::ConsolidatedRecord& rec, size_t) {
+        if (!link.connected()) return false;
+
+        uint8_t packet[kDataPacketBytes];
+        packet[0] = kDataMarker;
+        memcpy(&packet[1], &rec, sizeof(rec));
+
+        if (link.notify(packet, sizeof(packet))) {
+            ++result.sent;
+        } else {
+            ++result.dropped;
+            // Serial.println("[BLE] Congestion drop");
+        }
+
+        link.delay_ms(pacing.per_record_ms);
+        return true;
+    });
+
+    const uint8_t end = kEndMarker;
+    result.completed = link.notify(&end, 1);
+    return result;
+}
+
+Result stream_bulk(Channel& channel, size_t count, const RecordSource& source, const BulkPacing& pacing) {
+    Result result;
+    result.announced = count;
+
+    const size_t record_bytes = sizeof(consolidate::ConsolidatedRecord);
+    const size_t sdu_bytes = channel.sdu_bytes() < kMaxBulkSduBytes ? channel.sdu_bytes() : kMaxBulkSduBytes;
+    const size_t per_sdu = sdu_bytes > 1 ? (sdu_bytes - 1) / record_bytes : 0;
+    if (per_sdu == 0) return result;
+
+    uint8_t start[kStartPacketBytes] = {kStartMarker};
+    const uint32_t count32 = static_cast<uint32_t>(count);
+    memcpy(&start[1], &count32, 4);
+    if (!send_sdu(channel, start, sizeof(start), pacing)) return result;
+
+    uint8_t sdu[kMaxBulkSduBytes] = {kBulkMarker};
+    size_t packed = 0;
+    bool ok = true;
+    auto flush = [&]() {
+        if (packed == 0) return;
+        if (send_sdu(channel, sdu, 1 + packed * record_bytes, pacing)) {
+            result.sent += packed;
+        } else {
+            result.dropped += packed;
+            ok = false;
+        }
+        packed = 0;
+    };
+
+    source([&](const consolidate::ConsolidatedRecord& rec, size_t) {
+        if (!channel.connected()) return false;
+        memcpy(&sdu[1 + packed * record_bytes], &rec, record_bytes);
+        if (++packed == per_sdu) flush();
+        return ok;
+    });
+    if (ok) flush();
+
+    const uint8_t end = kEndMarker;
+    result.completed = ok && channel.connected() && send_sdu(channel, &end, 1, pacing);
+    return result;
+}
+
+}  // namespace transfer
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "compute/consolidate.h"
+
+// Record transfer (SEND) framing and pacing, independent of the radio:
+//   [0x01][count u32]  start
+//   [0x02][record]     one notification per record
+//   [0x03]             end
+// When the central has opened the bulk L2CAP channel, the same start and
+// end frames go over it as SDUs and records are packed into large SDUs:
+//   [0x07][record]...  as many records as fit the central's SDU size
+// BLEServerClass is the NimBLE-backed Link and L2capChannel
+// (l2cap_channel.h) the NimBLE-backed Channel; test_ble_transfer runs the
+// same code against a simulated link to measure sync throughput.
+namespace transfer {
+
+constexpr uint8_t kStartMarker = 0x01;
+constexpr uint8_t kDataMarker = 0x02;
+constexpr uint8_t kEndMarker = 0x03;
+constexpr uint8_t kBulkMarker = 0x07;
+constexpr size_t kStartPacketBytes = 1 + 4;
+constexpr size_t kDataPacketBytes = 1 + sizeof(consolidate::ConsolidatedRecord);
+// Largest bulk SDU sent, whatever the central accepts (a few mbufs)
+constexpr size_t kMaxBulkRecords = 45;
+constexpr size_t kMaxBulkSduBytes = 1 + kMaxBulkRecords * sizeof(consolidate::ConsolidatedRecord);
+
+// What the stream needs from the radio
+class Link {
+public:
+    virtual bool connected() const = 0;
+    // Queue one notification; false when the stack refused it (congested or
+    // disconnected). Refused data packets are not retried.
+    virtual bool notify(const uint8_t* data, size_t length) = 0;
+    virtual void delay_ms(uint32_t ms) = 0;
+
+protected:
+    ~Link() {}
+};
+
+// What the bulk stream needs from an L2CAP connection-oriented channel.
+// The channel is credit-flow-controlled and reliable: a refused SDU means
+// "not yet", never "lost".
+class Channel {
+public:
+    virtual bool connected() const = 0;
+    // Largest SDU the central accepts (its CoC MTU)
+    virtual size_t sdu_bytes() const = 0;
+    // Queue one SDU; false while the previous one is stalled on credits or
+    // the stack has no buffers (nothing was queued)
+    virtual bool send(const uint8_t* data, size_t length) = 0;
+    virtual void delay_ms(uint32_t ms) = 0;
+
+protected:
+    ~Channel() {}
+};
+
+struct Pacing {
+    uint32_t after_start_ms = 50;
+    uint32_t per_record_ms = 15;   // flow control: keeps the notify queue from overflowing
+};
+
+struct BulkPacing {
+    uint32_t retry_ms = 2;            // wait before offering a refused SDU again
+    uint32_t stall_timeout_ms = 5000; // give up when the central stops granting credits
+};
+
+struct Result {
+    size_t announced = 0;      // count carried in the start packet
+    size_t sent = 0;           // records the stack accepted
+    size_t dropped = 0;        // records refused (lost to the central)
+    bool completed = false;    // end marker accepted
+};
+
+typedef std::function<bool(const consolidate::ConsolidatedRecord&, size_t)> RecordCallback;
+typedef std::function<void(const RecordCallback&)> RecordSource;
+
+// Stream `count` records from `source` (fs_store::for_each_record on the
+// device). Stops early if the link disconnects.
+Result stream(Link& link, size_t count, const RecordSource& source, const Pacing& pacing = Pacing());
+
+// Same over the bulk channel. Refused SDUs are retried, so nothing is
+// dropped unless the channel stalls past the timeout or disconnects; the
+// stream stops there.
+Result stream_bulk(Channel& channel, size_t count, const RecordSource& source,
+                   const BulkPacing& pacing = BulkPacing());
+
+}  // namespace transfer
@@ -1,5 +1,5 @@
 #include "consolidate.h"
-#include <Arduino.h>
+#include "telemetry/alloc_track.h"
 #include <cmath>
 #include <algorithm>
 #include <array>
@@ -26,24 +26,73 @@ namespace {
     // 0.03G is very sensitive, necessary if holding a coffee cup.
     constexpr float kMinPeakHeight = 0.03f; 
 
+    // samples_since_step only matters up to the silence timeout; saturate so a
+    // months-long still period cannot wrap it back under the debounce
+    constexpr uint32_t kSamplesSinceStepCap = 1000;
+
     struct StepContext {
         uint32_t samples_since_step = 1000;
         float running_avg = 1.0f; // Smoothed magnitude memory
         bool valid_walking = false;
         uint8_t streak = 0;
+        // Base periods the previous window ran past its end (see from_rings)
+        size_t overshoot = 0;
     };
 
     static StepContext ctx; 
 
+    // Slow channels and the readings currently held from them
+    static reg_buffer::ChannelRing* hr_channel = nullptr;
+    static reg_buffer::ChannelRing* temp_channel = nullptr;
+    static reg_buffer::ChannelRing* wear_channel = nullptr;
+    static float held_hr = 0.0f;
+    static float held_temp = 0.0f;
+    static float held_off_wrist = 0.0f;  // 1 while off-wrist (kWearOff)
+
+    // Filtered magnitudes for the window being processed. Static rather than
+    // on the caller's stack: consolidate() only runs on the loop task and 1 KB
+    // of stack there is worth more than 1 KB of .bss.
+    static float smooth_mags[kMaxBufferSize];
+
     template<typename T>
     T clamp(T value, T min_val, T max_val) {
         return std::max(min_val, std::min(value, max_val));
     }
+
+    uint8_t stride_at(const uint8_t* strides, size_t i) {
+        return strides ? reg_buffer::stride_periods(strides[i]) : 1;
+    }
+
+    // Filter coefficient equivalent to `stride` full-rate updates
+    float strided_alpha(uint8_t stride) {
+        return 1.0f - std::pow(1.0f - kFilterAlpha, static_cast<float>(stride));
+    }
+
+    // Take the channel's readings up to `timestamp`; the last one is held
+    void advance(reg_buffer::ChannelRing* channel, uint32_t timestamp, float& held) {
+        if (!channel) return;
+        reg_buffer::ChannelSample c;
+        while (channel->pop_through(timestamp, c)) held = c.value;
+    }
+}
+
+void attach_channels(reg_buffer::ChannelRing* hr, reg_buffer::ChannelRing* temp,
+                     reg_buffer::ChannelRing* wear) {
+    hr_channel = hr;
+    temp_channel = temp;
+    wear_channel = wear;
+}
+
+void clock_stepped_back() {
+    advance(hr_channel, UINT32_MAX, held_hr);
+    advance(temp_channel, UINT32_MAX, held_temp);
+    advance(wear_channel, UINT32_MAX, held_off_wrist);
 }
 
 bool consolidate(const reg_buffer::Sample* samples,
                  size_t sample_count,
-                 ConsolidatedRecord& record_out) {
+                 ConsolidatedRecord& record_out,
+                 const uint8_t* strides) {
     
     if (!samples || sample_count == 0) return false;
     if (sample_count > kMaxBufferSize) sample_count = kMaxBufferSize;
@@ -54,10 +103,11 @@ bool consolidate(const reg_buffer::Sample* samples,
 
     double hr_sum = 0;
     double temp_sum = 0;
+    uint32_t total_ticks = 0;
+    uint32_t worn_ticks = 0;  // HR/temp average over these only
     
     // We need 3 samples to detect a peak (Previous, Current, Next)
-    // We process from index 1 to count-1
-    float smooth_mags[kMaxBufferSize];
+    // We process from index 1 to count-1 (smooth_mags holds the filtered window)
 
     // --- PASS 1: Calculate Magnitude & Apply Low-Pass Filter ---
     // This removes the "jitter" of the wrist watch.
@@ -65,25 +115,35 @@ bool consolidate(const reg_buffer::Sample* samples,
     
     for (size_t i = 0; i < sample_count; ++i) {
         const auto& s = samples[i];
+        const uint8_t stride = stride_at(strides, i);
         
         // 1. Raw Magnitude
         float m = std::sqrt(s.ax*s.ax + s.ay*s.ay + s.az*s.az);
 
         // 2. Low Pass Filter (The "Smoothing" Step)
         // New = (Old * 0.85) + (Raw * 0.15)
-        current_avg = (current_avg * (1.0f - kFilterAlpha)) + (m * kFilterAlpha);
+        // A sample covering N base periods gets the decay of N full-rate steps.
+        const float alpha = stride == 1 ? kFilterAlpha : strided_alpha(stride);
+        current_avg = (current_avg * (1.0f - alpha)) + (m * alpha);
         smooth_mags[i] = current_avg;
 
-        hr_sum += s.hr_bpm;
-        temp_sum += s.temp_c;
+        advance(hr_channel, s.timestamp, held_hr);
+        advance(temp_channel, s.timestamp, held_temp);
+        advance(wear_channel, s.timestamp, held_off_wrist);
+        if (held_off_wrist < kWearOff / 2) {
+            hr_sum += held_hr * stride;
+            temp_sum += held_temp * stride;
+            worn_ticks += stride;
+        }
+        total_ticks += stride;
     }
     // Save the filter state for next time
     ctx.running_avg = current_avg;
 
     // Calculate a local baseline for THIS window to find relative peaks
     double window_sum = 0;
-    for(size_t i=0; i<sample_count; ++i) window_sum += smooth_mags[i];
-    float window_baseline = window_sum / sample_count;
+    for(size_t i=0; i<sample_count; ++i) window_sum += smooth_mags[i] * stride_at(strides, i);
+    float window_baseline = window_sum / total_ticks;
 
 
     // --- PASS 2: Peak Detection ---
@@ -92,7 +152,8 @@ bool consolidate(const reg_buffer::Sample* samples,
 
     // We loop from 1 to count-1 because we look at neighbors [i-1] and [i+1]
     for (size_t i = 1; i < sample_count - 1; ++i) {
-        ctx.samples_since_step++;
+        ctx.samples_since_step = std::min<uint32_t>(ctx.samples_since_step + stride_at(strides, i),
+                                                    kSamplesSinceStepCap);
 
         float prev = smooth_mags[i-1];
         float curr = smooth_mags[i];
@@ -130,10 +191,19 @@ bool consolidate(const reg_buffer::Sample* samples,
     }
 
     // --- OUTPUT ---
-    record_out.avg_hr_x10 = static_cast<uint16_t>(clamp<double>(hr_sum/sample_count * 10.0, 0, 65535));
-    record_out.avg_temp_x100 = static_cast<int16_t>(clamp<double>(temp_sum/sample_count * 100.0, -32768, 32767));
+    // Off-wrist only when no sample of the window was taken on the wrist
+    const uint32_t worn = worn_ticks ? worn_ticks : 1;
+    record_out.avg_hr_x10 = static_cast<uint16_t>(clamp<double>(hr_sum/worn * 10.0, 0, 65535));
+    record_out.avg_temp_x100 = static_cast<int16_t>(clamp<double>(temp_sum/worn * 100.0, -32768, 32767));
     record_out.step_count = window_steps;
     record_out.timestamp = samples[sample_count - 1].timestamp;
+    record_out.flags = worn_ticks ? 0 : kFlagOffWrist;
+    for (size_t i = 0; strides && i < sample_count; ++i) {
+        if (strides[i] & reg_buffer::kStrideDecimated) {
+            record_out.flags |= kFlagDecimated;
+            break;
+        }
+    }
 
     // Serial.printf("[WRIST] Steps:+%u | Streak:%u | Base:%.2f\n", 
     //               window_steps, ctx.streak, window_baseline);
@@ -141,12 +211,64 @@ bool consolidate(const reg_buffer::Sample* samples,
     return true;
 }
 
+namespace {
+
+bool from_rings(reg_buffer::SampleRingBuffer* older,
+                reg_buffer::SampleRingBuffer& ring,
+                ConsolidatedRecord& record_out) {
+    ALLOC_STAGE("consolidate");
+    // A reduced-rate sample can straddle the window boundary; the overshoot is
+    // taken off the next window so records keep a 2.5 s cadence on average.
+    const size_t needed = kSamplesPerWindow - std::min(ctx.overshoot, kSamplesPerWindow - 1);
+    if ((older ? older->ticks() : 0) + ring.ticks() < needed) return false;
+    static std::array<reg_buffer::Sample, kSamplesPerWindow> window{};
+    static std::array<uint8_t, kSamplesPerWindow> strides{};
+    size_t n = 0;
+    size_t ticks = 0;
+    while (ticks < needed &&
+           ((older && older->pop(window[n], &strides[n])) || ring.pop(window[n], &strides[n]))) {
+        ticks += reg_buffer::stride_periods(strides[n]);
+        ++n;
+    }
+    ctx.overshoot = ticks - needed;
+    return consolidate(window.data(), n, record_out, strides.data());
+}
+
+}  // namespace
+
 bool consolidate_from_ring(reg_buffer::SampleRingBuffer& ring,
                            ConsolidatedRecord& record_out) {
-    if (ring.size() < kSamplesPerWindow) return false;
-    static std::array<reg_buffer::Sample, kSamplesPerWindow> window{};
-    for (size_t i = 0; i < kSamplesPerWindow; ++i) ring.pop(window[i]);
-    return consolidate(window.data(), window.size(), record_out);
+    return from_rings(nullptr, ring, record_out);
+}
+
+bool consolidate_from_ring(reg_buffer::SampleRingBuffer& older,
+                           reg_buffer::SampleRingBuffer& ring,
+                           ConsolidatedRecord& record_out) {
+    return from_rings(&older, ring, record_out);
+}
+
+DetectorState detector_state() {
+    DetectorState state = kInitialDetectorState;
+    state.samples_since_step = ctx.samples_since_step;
+    state.running_avg = ctx.running_avg;
+    state.valid_walking = ctx.valid_walking ? 1 : 0;
+    state.streak = ctx.streak;
+    state.overshoot = static_cast<uint16_t>(ctx.overshoot);
+    state.hr_bpm = held_hr;
+    state.temp_c = held_temp;
+    state.off_wrist = held_off_wrist >= kWearOff / 2 ? 1 : 0;
+    return state;
+}
+
+void restore_detector_state(const DetectorState& state) {
+    ctx.samples_since_step = std::min(state.samples_since_step, kSamplesSinceStepCap);
+    ctx.running_avg = std::isfinite(state.running_avg) ? state.running_avg : 1.0f;
+    ctx.valid_walking = state.valid_walking != 0;
+    ctx.streak = state.streak;
+    ctx.overshoot = std::min<size_t>(state.overshoot, kSamplesPerWindow - 1);
+    held_hr = std::isfinite(state.hr_bpm) ? state.hr_bpm : 0.0f;
+    held_temp = std::isfinite(state.temp_c) ? state.temp_c : 0.0f;
+    held_off_wrist = state.off_wrist ? kWearOff : kWearOn;
 }
 
 void IntervalAccumulator::reset() {
@@ -154,19 +276,28 @@ void IntervalAccumulator::reset() {
     sum_temp_x100 = 0;
     sum_steps = 0;
     count = 0;
+    worn_count = 0;
+    sticky_flags = 0;
 }
 
 bool IntervalAccumulator::add(const ConsolidatedRecord& input, ConsolidatedRecord& output) {
-    sum_hr_x10 += input.avg_hr_x10;
-    sum_temp_x100 += input.avg_temp_x100;
+    ALLOC_STAGE("interval");
+    // Off-wrist windows still count towards the interval but not the averages
+    if (!(input.flags & kFlagOffWrist)) {
+        sum_hr_x10 += input.avg_hr_x10;
+        sum_temp_x100 += input.avg_temp_x100;
+        worn_count++;
+    }
     sum_steps += input.step_count;
+    sticky_flags |= input.flags & (kFlagHwSteps | kFlagDecimated);
     count++;
 
     if (count >= kRecordsPerInterval) {
-        output.avg_hr_x10 = static_cast<uint16_t>(sum_hr_x10 / count);
-        output.avg_temp_x100 = static_cast<int16_t>(sum_temp_x100 / count);
-        output.step_count = static_cast<uint16_t>(sum_steps); // Accumulate steps
+        output.avg_hr_x10 = worn_count ? static_cast<uint16_t>(sum_hr_x10 / worn_count) : 0;
+        output.avg_temp_x100 = worn_count ? static_cast<int16_t>(sum_temp_x100 / worn_count) : 0;
+        output.step_count = static_cast<uint16_t>(std::min<uint32_t>(sum_steps, UINT16_MAX)); // Accumulate steps
         output.timestamp = input.timestamp; // Use timestamp of the last record
+        output.flags = (worn_count ? 0 : kFlagOffWrist) | sticky_flags;
         
         reset();
         return true;
@@ -174,4 +305,22 @@ bool IntervalAccumulator::add(const ConsolidatedRecord& input, ConsolidatedRecor
     return false;
 }
 
+IntervalAccumulator::State IntervalAccumulator::state() const {
+    return State{sum_hr_x10, sum_temp_x100, sum_steps, count, worn_count, sticky_flags};
+}
+
+bool IntervalAccumulator::restore(const State& state) {
+    if (state.count < 0 || state.count >= kRecordsPerInterval ||
+        state.worn_count < 0 || state.worn_count > state.count) {
+        return false;
+    }
+    sum_hr_x10 = state.sum_hr_x10;
+    sum_temp_x100 = state.sum_temp_x100;
+    sum_steps = state.sum_steps;
+    count = state.count;
+    worn_count = state.worn_count;
+    sticky_flags = state.sticky_flags & (kFlagHwSteps | kFlagDecimated);
+    return true;
+}
+
 } // namespace
\ No newline at end of file
@@ -7,7 +7,14 @@
 
 namespace consolidate {
 
-constexpr size_t kSamplesPerWindow = 125;  // 2.5 s @ 25 Hz
+// Window length in base IMU periods (2.5 s @ 50 Hz). Reduced-rate samples
+// count for their ring stride, so a window always spans the same time.
+constexpr size_t kSamplesPerWindow = 125;
+
+// ConsolidatedRecord::flags bits
+constexpr uint8_t kFlagOffWrist = 1 << 0;  // not worn: HR/temp fields carry no data
+constexpr uint8_t kFlagHwSteps = 1 << 1;   // step_count from the BMI270 step counter
+constexpr uint8_t kFlagDecimated = 1 << 2; // IMU averaged to a lower rate under backpressure
 
 #pragma pack(push, 1)
 struct ConsolidatedRecord {
@@ -15,31 +22,98 @@ struct ConsolidatedRecord {
     int16_t avg_temp_x100;
     uint16_t step_count;
     uint32_t timestamp;
+    uint8_t flags;
 };
 #pragma pack(pop)
 
-static_assert(sizeof(ConsolidatedRecord) == 10, "ConsolidatedRecord must be 10 bytes");
+static_assert(sizeof(ConsolidatedRecord) == 11, "ConsolidatedRecord must be 11 bytes");
+
+// Detector state carried from one window to the next (step debounce and
+// streak, filter memory, window overshoot, the HR, temperature and wear
+// state held from the slow channels). Exposed for warm-restart snapshots.
+struct DetectorState {
+    uint32_t samples_since_step;
+    float running_avg;
+    uint8_t valid_walking;
+    uint8_t streak;
+    uint16_t overshoot;
+    float hr_bpm;
+    float temp_c;
+    uint8_t off_wrist;
+};
+
+constexpr DetectorState kInitialDetectorState{1000, 1.0f, 0, 0, 0, 0.0f, 0.0f, 0};
+
+DetectorState detector_state();
+void restore_detector_state(const DetectorState& state);
 
 class IntervalAccumulator {
 public:
+    // Partial sums of the interval in progress
+    struct State {
+        uint32_t sum_hr_x10;
+        int32_t sum_temp_x100;
+        uint32_t sum_steps;
+        int32_t count;
+        int32_t worn_count;
+        uint8_t sticky_flags;  // kFlagHwSteps / kFlagDecimated seen in the interval
+    };
+
     void reset();
     bool add(const ConsolidatedRecord& input, ConsolidatedRecord& output);
 
+    State state() const;
+    bool restore(const State& state);  // false (and no change) if out of range
+
 private:
     uint32_t sum_hr_x10 = 0;
     int32_t sum_temp_x100 = 0;
     uint32_t sum_steps = 0;
     int count = 0;
+    int worn_count = 0;  // records contributing to the HR/temp averages
+    uint8_t sticky_flags = 0;
     
     // 15 seconds / 2.5 seconds per record = 6 records
     static constexpr int kRecordsPerInterval = 6;
 };
 
+// Heart rate and body temperature come from their own rings, joined to the
+// IMU samples by timestamp: each sample takes the latest reading stamped at
+// or before it (the same second included), held until the next one, so the
+// record averages are weighted by time exactly as when every sample carried
+// a copy. Before the first reading, or with no rings attached, they read 0.
+// Loop task only, like consolidate() itself.
+//
+// The wear ring carries kWearOff / kWearOn at each off-wrist transition and
+// is joined the same way, so a window consolidated late (spill replay after a
+// long SEND) is judged by the state its samples were taken in. HR and
+// temperature average over the on-wrist samples only; a window with none is
+// flagged kFlagOffWrist. No wear ring: always on the wrist.
+constexpr float kWearOn = 0.0f;
+constexpr float kWearOff = 1.0f;
+void attach_channels(reg_buffer::ChannelRing* hr, reg_buffer::ChannelRing* temp,
+                     reg_buffer::ChannelRing* wear = nullptr);
+
+// The wall clock was set back: readings already queued are stamped ahead of
+// every sample to come and would never be taken. Take them all now, holding
+// the newest.
+void clock_stepped_back();
+
+// `strides` (optional, one per sample) gives the base periods each sample
+// covers; nullptr means every sample is full rate. A stride flagged
+// reg_buffer::kStrideDecimated sets kFlagDecimated on the record.
 bool consolidate(const reg_buffer::Sample* samples,
                                  size_t sample_count,
-                                 ConsolidatedRecord& record_out);
+                                 ConsolidatedRecord& record_out,
+                                 const uint8_t* strides = nullptr);
 
 bool consolidate_from_ring(reg_buffer::SampleRingBuffer& ring,
                                                      ConsolidatedRecord& record_out);
 
+// Same, taking samples from `older` first (spill replay, sample_spill.h)
+// and then from `ring`, as one stream
+bool consolidate_from_ring(reg_buffer::SampleRingBuffer& older,
+                           reg_buffer::SampleRingBuffer& ring,
+                           ConsolidatedRecord& record_out);
+
 }  // namespace consolidate
@@ -0,0 +1,117 @@
+#include "snapshot.h"
+
+#include <cstring>
+
+#include "telemetry/alloc_track.h"
+
+namespace snapshot {
+
+namespace {
+    size_t covered_bytes(const Image& image) {
+        const size_t samples = image.sample_count <= kMaxSamples ? image.sample_count : kMaxSamples;
+        return offsetof(Image, samples) + samples * sizeof(reg_buffer::Sample);
+    }
+
+    uint32_t image_crc(const Image& image) {
+        const uint8_t* base = reinterpret_cast<const uint8_t*>(&image);
+        const size_t start = offsetof(Image, sequence);
+        return crc32(base + start, covered_bytes(image) - start);
+    }
+}
+
+uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc) {
+    // Nibble table: small enough for flash, ~2x the speed of bitwise
+    static const uint32_t kTable[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+        0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ kTable[crc & 0x0F];
+        crc = (crc >> 4) ^ kTable[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+void PendingRecords::push(const consolidate::ConsolidatedRecord& record) {
+    if (count_ == kMaxPending) {
+        memmove(records_, records_ + 1, (kMaxPending - 1) * sizeof(records_[0]));
+        --count_;
+    }
+    records_[count_++] = record;
+}
+
+void PendingRecords::replace_last(const consolidate::ConsolidatedRecord& record) {
+    if (count_ == 0) {
+        push(record);
+        return;
+    }
+    records_[count_ - 1] = record;
+}
+
+size_t capture(Image& image,
+               const reg_buffer::SampleRingBuffer& replay,
+               const reg_buffer::SampleRingBuffer& ring,
+               const consolidate::IntervalAccumulator& accumulator,
+               const PendingRecords& pending) {
+    ALLOC_STAGE("snapshot");
+    const uint32_t sequence = image.magic == kMagic ? image.sequence + 1 : 1;
+
+    image.magic = kMagic;
+    image.version = kVersion;
+    image.sequence = sequence;
+    image.detector = consolidate::detector_state();
+    image.accumulator = accumulator.state();
+    image.pending_count = static_cast<uint16_t>(pending.size());
+    memcpy(image.pending, pending.data(), pending.size() * sizeof(image.pending[0]));
+
+    // The sensor task keeps pushing: count against the sizes from before the copy
+    const size_t available = replay.size() + ring.size();
+    size_t n = 0;
+    while (n < kMaxSamples && replay.peek(n, image.samples[n], &image.strides[n])) ++n;
+    image.replay_count = static_cast<uint16_t>(n);
+    for (size_t i = 0; n < kMaxSamples && ring.peek(i, image.samples[n], &image.strides[n]); ++i) ++n;
+    image.sample_count = static_cast<uint16_t>(n);
+    image.dropped_samples = static_cast<uint32_t>(available > n ? available - n : 0);
+    image.crc = image_crc(image);
+    return covered_bytes(image);
+}
+
+bool valid(const Image& image) {
+    return image.magic == kMagic && image.version == kVersion &&
+           image.sample_count <= kMaxSamples && image.replay_count <= image.sample_count &&
+           image.pending_count <= kMaxPending && image.crc == image_crc(image);
+}
+
+bool restore(const Image& image,
+             reg_buffer::SampleRingBuffer& replay,
+             reg_buffer::SampleRingBuffer& ring,
+             consolidate::IntervalAccumulator& accumulator) {
+    if (!valid(image)) return false;
+    if (!accumulator.restore(image.accumulator)) return false;
+    consolidate::restore_detector_state(image.detector);
+    size_t n = replay.reserve_n(image.replay_count);
+    for (size_t i = 0; i < n; ++i) replay.reserved(i, image.strides[i]) = image.samples[i];
+    replay.commit(n);
+    const size_t base = image.replay_count;
+    n = ring.reserve_n(image.sample_count - base);
+    for (size_t i = 0; i < n; ++i) ring.reserved(i, image.strides[base + i]) = image.samples[base + i];
+    ring.commit(n);
+    return true;
+}
+
+size_t first_unsaved(const consolidate::ConsolidatedRecord* pending, size_t pending_count,
+                     const consolidate::ConsolidatedRecord* tail, size_t tail_count) {
+    for (size_t k = pending_count < tail_count ? pending_count : tail_count; k > 0; --k) {
+        if (memcmp(tail + tail_count - k, pending, k * sizeof(pending[0])) == 0) return k;
+    }
+    return 0;
+}
+
+void invalidate(Image& image) {
+    image.magic = 0;
+}
+
+}  // namespace snapshot
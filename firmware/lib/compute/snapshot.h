@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "compute/consolidate.h"
+#include "ringbuf/reg_buffer.h"
+
+// Warm-restart snapshot of the consolidation pipeline: detector state, the
+// interval accumulator's partial sums, the samples waiting in the replay and
+// live rings, and the interval records that may not have reached flash yet.
+// The HR/temperature/wear channel rings are not kept, only the readings held
+// from them (in the detector state); fresh ones follow within a second or a
+// beat, and the sensor task reports its wear state with its first sample.
+// The image is a flat, CRC-protected struct so it can live in RTC memory
+// (or be copied to NVS) and be checked before it is trusted on boot.
+//
+// Take it right after an interval record is handed to the writer (and
+// periodically in between): an image from before the hand-off would emit
+// that interval a second time after a reset.
+namespace snapshot {
+
+constexpr uint32_t kMagic = 0x50535331;  // "PSS1"
+constexpr uint16_t kVersion = 4;  // 3: replay samples, pending records, dropped count; 4: wear state
+
+// One window's worth of samples: the loop drains the rings every pass, so
+// they rarely hold more. The rest (after a stall) are counted, not kept.
+constexpr size_t kMaxSamples = consolidate::kSamplesPerWindow;
+
+// The storage writer queue (kStoreQueueDepth) plus the record held for it
+constexpr size_t kMaxPending = 17;
+
+// Interval records handed to the storage writer, oldest first: the last
+// kMaxPending of them, whether or not they have been appended since.
+class PendingRecords {
+public:
+    void push(const consolidate::ConsolidatedRecord& record);
+    // The newest record was dropped in favour of `record` (writer stuck)
+    void replace_last(const consolidate::ConsolidatedRecord& record);
+    void clear() { count_ = 0; }
+
+    const consolidate::ConsolidatedRecord* data() const { return records_; }
+    size_t size() const { return count_; }
+
+private:
+    consolidate::ConsolidatedRecord records_[kMaxPending];
+    size_t count_ = 0;
+};
+
+struct Image {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sample_count;
+    uint32_t crc;           // over everything after this field up to the last sample
+    uint32_t sequence;      // incremented on every capture
+    uint16_t replay_count;  // leading samples that go back to the replay ring
+    uint16_t pending_count;
+    uint32_t dropped_samples;  // ring samples past kMaxSamples, not captured
+    consolidate::DetectorState detector;
+    consolidate::IntervalAccumulator::State accumulator;
+    consolidate::ConsolidatedRecord pending[kMaxPending];
+    uint8_t strides[kMaxSamples];
+    reg_buffer::Sample samples[kMaxSamples];
+};
+
+// Stored and restored as raw bytes
+static_assert(std::is_trivially_copyable<Image>::value, "snapshot::Image must stay trivially copyable");
+
+// Fill `image` from the live pipeline and seal it: the replay ring's samples
+// first (they are consolidated first), then the live ring's. Returns the
+// bytes covered by the CRC (the part that has to be written).
+size_t capture(Image& image,
+               const reg_buffer::SampleRingBuffer& replay,
+               const reg_buffer::SampleRingBuffer& ring,
+               const consolidate::IntervalAccumulator& accumulator,
+               const PendingRecords& pending);
+
+// True if `image` has the right magic/version and its CRC matches.
+bool valid(const Image& image);
+
+// Restore the pipeline from a valid image. The rings should be empty;
+// samples that do not fit are dropped. The pending records stay in the image
+// for the caller to resubmit (see first_unsaved). Returns false (pipeline
+// untouched) if the image is not valid.
+bool restore(const Image& image,
+             reg_buffer::SampleRingBuffer& replay,
+             reg_buffer::SampleRingBuffer& ring,
+             consolidate::IntervalAccumulator& accumulator);
+
+// The pending records already on flash, given the last records of the file
+// (oldest first): the longest run at the start of `pending` that the file
+// ends with. Records from that index on were lost with the writer queue.
+size_t first_unsaved(const consolidate::ConsolidatedRecord* pending, size_t pending_count,
+                     const consolidate::ConsolidatedRecord* tail, size_t tail_count);
+
+// Mark the image as unusable (e.g. after ERASE).
+void invalidate(Image& image);
+
+uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+
+}  // namespace snapshot
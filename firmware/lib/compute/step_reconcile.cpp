@@ -0,0 +1,59 @@
+#include "step_reconcile.h"
+
+#include <algorithm>
+
+#include "telemetry/alloc_track.h"
+
+namespace step_reconcile {
+
+uint16_t Reconciler::reconcile(uint16_t sw_steps, bool sw_valid, uint32_t hw_total, bool hw_valid) {
+    ALLOC_STAGE("step_reconcile");
+    if (!hw_valid) {
+        last_source_ = Source::kSoftware;
+        return sw_steps;
+    }
+
+    uint32_t hw_delta = 0;
+    if (!have_baseline_) {
+        have_baseline_ = true;  // first reading only sets the baseline
+    } else if (hw_total < last_hw_total_) {
+        hw_delta = hw_total;    // counter restarted (sensor re-initialised)
+        ++hw_resets_;
+    } else {
+        hw_delta = hw_total - last_hw_total_;
+    }
+    last_hw_total_ = hw_total;
+    const uint16_t hw_steps = static_cast<uint16_t>(std::min<uint32_t>(hw_delta, UINT16_MAX));
+
+    if (!sw_valid) {
+        last_source_ = Source::kHardware;
+        return hw_steps;
+    }
+
+    period_sw_ += sw_steps;
+    period_hw_ += hw_steps;
+    if (++period_windows_ >= config_.windows_per_check) check_period();
+
+    last_source_ = hw_trusted_ ? Source::kHardware : Source::kSoftware;
+    return hw_trusted_ ? hw_steps : sw_steps;
+}
+
+void Reconciler::check_period() {
+    const uint32_t diff = period_hw_ > period_sw_ ? period_hw_ - period_sw_ : period_sw_ - period_hw_;
+    const uint32_t larger = std::max(period_hw_, period_sw_);
+    const bool agree = diff <= config_.tolerance_steps || diff * 100 <= larger * config_.tolerance_pct;
+
+    if (agree) {
+        failed_checks_ = 0;
+        hw_trusted_ = true;
+    } else {
+        ++disagreements_;
+        if (failed_checks_ < UINT8_MAX) ++failed_checks_;
+        if (failed_checks_ >= config_.fallback_after) hw_trusted_ = false;
+    }
+    period_sw_ = 0;
+    period_hw_ = 0;
+    period_windows_ = 0;
+}
+
+}  // namespace step_reconcile
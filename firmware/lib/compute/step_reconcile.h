@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+// Reconciles the BMI270 hardware step counter with the software peak
+// detector in consolidate(). The hardware count is read as a running total;
+// each consolidation window takes its delta. The two sources are compared
+// over a check period rather than per window because the BMI270 reports
+// steps with a short lag. If they keep disagreeing the reconciler falls back
+// to the software count until they agree again.
+namespace step_reconcile {
+
+enum class Source : uint8_t { kSoftware, kHardware };
+
+struct Config {
+    uint8_t windows_per_check = 24;    // 60 s of 2.5 s windows
+    uint16_t tolerance_steps = 6;      // allowed |hw - sw| per check ...
+    uint8_t tolerance_pct = 20;        // ... or this share of the larger count
+    uint8_t fallback_after = 3;        // consecutive failed checks before using software
+};
+
+class Reconciler {
+public:
+    explicit Reconciler(const Config& config = Config()) : config_(config) {}
+
+    // Steps to record for one window. `sw_valid` is false when the IMU is
+    // sampled too slowly for the software detector (steps-only mode); the
+    // hardware count is then used unconditionally.
+    uint16_t reconcile(uint16_t sw_steps, bool sw_valid, uint32_t hw_total, bool hw_valid);
+
+    Source last_source() const { return last_source_; }
+    uint32_t disagreements() const { return disagreements_; }
+    uint32_t hardware_resets() const { return hw_resets_; }
+
+private:
+    void check_period();
+
+    Config config_;
+    bool have_baseline_ = false;
+    uint32_t last_hw_total_ = 0;
+    uint32_t period_sw_ = 0;
+    uint32_t period_hw_ = 0;
+    uint8_t period_windows_ = 0;
+    uint8_t failed_checks_ = 0;
+    bool hw_trusted_ = true;
+    Source last_source_ = Source::kSoftware;
+    uint32_t disagreements_ = 0;
+    uint32_t hw_resets_ = 0;
+};
+
+}  // namespace step_reconcile
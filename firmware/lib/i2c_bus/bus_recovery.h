@@ -0,0 +1,42 @@
+#pragma once
+
+// I2C bus recovery (UM10204 3.1.16): a slave that lost a clock edge mid-byte
+// keeps driving SDA low and waits for more clocks. Clocking SCL until it lets
+// go and then issuing a STOP returns every slave to idle.
+//
+// `Pins` drives the lines open-drain and is supplied by the caller (GPIO on
+// the device, a fault-injecting fake on the host):
+//   bool sda() / bool scl()        line levels (true = high)
+//   void sda_low() / sda_release()
+//   void scl_low() / scl_release()
+//   void wait()                    half an SCL period
+namespace i2c_bus {
+
+// Returns true if both lines are high (bus idle) afterwards.
+template <typename Pins>
+bool clock_out_stuck_slave(Pins& pins, int max_pulses = 16) {
+    pins.sda_release();
+    pins.scl_release();
+    pins.wait();
+    if (!pins.scl()) return false;  // SCL held low: nothing the master can do
+
+    for (int i = 0; i < max_pulses && !pins.sda(); ++i) {
+        pins.scl_low();
+        pins.wait();
+        pins.scl_release();
+        pins.wait();
+    }
+
+    // STOP: SDA rises while SCL is high
+    pins.scl_low();
+    pins.wait();
+    pins.sda_low();
+    pins.wait();
+    pins.scl_release();
+    pins.wait();
+    pins.sda_release();
+    pins.wait();
+    return pins.sda() && pins.scl();
+}
+
+}  // namespace i2c_bus
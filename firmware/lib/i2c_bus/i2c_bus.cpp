@@ -1,9 +1,70 @@
 #include <Wire.h>
 #include "app_config.h"
 #include "i2c_bus.h"
+#include "bus_recovery.h"
+#include "telemetry/telemetry.h"
+
+namespace {
+
+// Open-drain GPIO access to the bus while Wire is detached
+struct GpioPins {
+    bool sda() const { return digitalRead(I2C_SDA_PIN) == HIGH; }
+    bool scl() const { return digitalRead(I2C_SCL_PIN) == HIGH; }
+    void sda_low() { digitalWrite(I2C_SDA_PIN, LOW); }
+    void sda_release() { digitalWrite(I2C_SDA_PIN, HIGH); }
+    void scl_low() { digitalWrite(I2C_SCL_PIN, LOW); }
+    void scl_release() { digitalWrite(I2C_SCL_PIN, HIGH); }
+    void wait() { delayMicroseconds(5); }  // 100 kHz
+};
+
+}  // namespace
 
 void i2c_setup() {
     // Explicitly set ESP32 DevKit V1 pins: SDA=21, SCL=22
     Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
     Wire.setClock(I2C_CLOCK_HZ);
 }
+
+bool i2c_write8(uint8_t addr, uint8_t reg, uint8_t val) {
+    Wire.beginTransmission(addr);
+    Wire.write(reg);
+    Wire.write(val);
+    telemetry::add(telemetry::Stat::kI2cBytes, 3);
+    return Wire.endTransmission() == 0;
+}
+
+int i2c_read8(uint8_t addr, uint8_t reg) {
+    Wire.beginTransmission(addr);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) return -1;
+    telemetry::add(telemetry::Stat::kI2cBytes, 4);
+    if (Wire.requestFrom((int)addr, 1) != 1) return -1;
+    return Wire.read();
+}
+
+size_t i2c_readN(uint8_t addr, uint8_t reg, uint8_t* buf, size_t n) {
+    Wire.beginTransmission(addr);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) return 0;
+    size_t got = Wire.requestFrom((int)addr, (int)n);
+    telemetry::add(telemetry::Stat::kI2cBytes, 3 + got);
+    for (size_t i = 0; i < got; ++i) buf[i] = Wire.read();
+    return got;
+}
+
+bool i2c_ping(uint8_t addr) {
+    Wire.beginTransmission(addr);
+    telemetry::add(telemetry::Stat::kI2cBytes, 1);
+    return Wire.endTransmission() == 0;
+}
+
+bool i2c_bus_recover() {
+    Wire.end();
+    pinMode(I2C_SDA_PIN, OUTPUT_OPEN_DRAIN);
+    pinMode(I2C_SCL_PIN, OUTPUT_OPEN_DRAIN);
+    GpioPins pins;
+    const bool idle = i2c_bus::clock_out_stuck_slave(pins);
+    i2c_setup();
+    // Serial.printf("[I2C] Bus recovery %s\n", idle ? "ok" : "failed (SCL/SDA still low)");
+    return idle;
+}
@@ -1,2 +1,16 @@
 #pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
 void i2c_setup();
+
+// Blocking register access on Wire. Reads return -1 / 0 bytes on a NACK.
+bool i2c_write8(uint8_t addr, uint8_t reg, uint8_t val);
+int i2c_read8(uint8_t addr, uint8_t reg);
+size_t i2c_readN(uint8_t addr, uint8_t reg, uint8_t* buf, size_t n);
+bool i2c_ping(uint8_t addr);
+
+// Free a bus held by a stuck slave (see bus_recovery.h) and restart Wire.
+// Returns true if both lines are idle afterwards.
+bool i2c_bus_recover();
@@ -0,0 +1,62 @@
+#include "i2c_health.h"
+
+namespace i2c_health {
+
+bool Monitor::should_read(Device device, uint32_t now_ms) {
+    State& s = state(device);
+    if (!s.down) return true;
+    return now_ms - s.last_attempt_ms >= s.retry_ms;
+}
+
+Action Monitor::report(Device device, bool ok, uint32_t latency_us, uint32_t now_ms) {
+    State& s = state(device);
+    DeviceStats& st = s.stats;
+    ++st.reads;
+    st.last_latency_us = latency_us;
+    if (latency_us > st.max_latency_us) st.max_latency_us = latency_us;
+    if (latency_us >= config_.slow_read_us) ++st.slow_reads;
+    s.last_attempt_ms = now_ms;
+
+    if (ok) {
+        if (s.down) {
+            const uint32_t outage = now_ms - s.first_fail_ms;
+            st.outage_ms_total += outage;
+            if (outage > st.longest_outage_ms) st.longest_outage_ms = outage;
+        }
+        s.down = false;
+        st.consecutive_failures = 0;
+        return Action::kNone;
+    }
+
+    ++st.failures;
+    if (st.consecutive_failures++ == 0) s.first_fail_ms = now_ms;
+    const uint32_t streak = st.consecutive_failures;
+
+    if (streak == config_.reinit_after) {
+        s.down = true;
+        s.retry_ms = 0;  // try the re-initialised device on the next tick
+        ++st.outages;
+        ++st.reinits;
+        return Action::kReinit;
+    }
+    if (streak >= config_.recover_after) {
+        s.down = true;
+        ++st.bus_recoveries;
+        ++st.reinits;
+        if (streak == config_.recover_after) {
+            s.retry_ms = config_.retry_interval_ms;
+        } else {
+            s.retry_ms = s.retry_ms * 2 > config_.max_retry_interval_ms ? config_.max_retry_interval_ms
+                                                                       : s.retry_ms * 2;
+        }
+        return Action::kRecoverBus;
+    }
+    return Action::kNone;
+}
+
+uint32_t Monitor::current_outage_ms(Device device, uint32_t now_ms) const {
+    const State& s = state(device);
+    return s.down ? now_ms - s.first_fail_ms : 0;
+}
+
+}  // namespace i2c_health
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Per-device I2C health tracking. The sensor task reports every read (result
+// and latency); the monitor decides when to re-initialise a device or recover
+// the bus, rate-limits reads while a device is down so Wire timeouts do not
+// stall the task, and records how long each outage lasted.
+//
+// Escalation for one device:
+//   reinit_after consecutive failures  -> kReinit (re-run the driver's begin), device down
+//   recover_after consecutive failures -> kRecoverBus (clock out SDA, restart Wire, reinit)
+// A re-initialised device is retried on the next read; after a bus recovery
+// it is retried every retry_interval_ms, doubling after each failed recovery
+// up to max_retry_interval_ms so a dead part costs little bus time.
+namespace i2c_health {
+
+enum class Device : uint8_t { kImu, kPpg, kTemp, kCount };
+
+enum class Action : uint8_t { kNone, kReinit, kRecoverBus };
+
+struct Config {
+    uint8_t reinit_after = 3;
+    uint8_t recover_after = 4;
+    uint32_t retry_interval_ms = 250;
+    uint32_t max_retry_interval_ms = 8000;
+    uint32_t slow_read_us = 2000;  // a 6-byte read at 400 kHz takes ~250 us
+};
+
+struct DeviceStats {
+    uint32_t reads;
+    uint32_t failures;
+    uint32_t slow_reads;
+    uint32_t consecutive_failures;
+    uint32_t last_latency_us;
+    uint32_t max_latency_us;
+    uint32_t reinits;
+    uint32_t bus_recoveries;
+    uint32_t outages;            // failure streaks long enough to need a reinit
+    uint32_t outage_ms_total;
+    uint32_t longest_outage_ms;
+};
+
+class Monitor {
+public:
+    explicit Monitor(const Config& config = Config()) : config_(config) {}
+
+    // Whether the device should be read now. Always true while healthy; while
+    // down, once per retry interval.
+    bool should_read(Device device, uint32_t now_ms);
+
+    // Result of one read. Returns the recovery step the caller should run
+    // before the next read.
+    Action report(Device device, bool ok, uint32_t latency_us, uint32_t now_ms);
+
+    bool down(Device device) const { return state(device).down; }
+    const DeviceStats& stats(Device device) const { return state(device).stats; }
+
+    // Outage currently in progress (0 if healthy)
+    uint32_t current_outage_ms(Device device, uint32_t now_ms) const;
+
+private:
+    struct State {
+        DeviceStats stats{};
+        bool down = false;           // past reinit_after, reads rate-limited
+        uint32_t first_fail_ms = 0;  // start of the current failure streak
+        uint32_t last_attempt_ms = 0;
+        uint32_t retry_ms = 0;
+    };
+
+    State& state(Device device) { return devices_[static_cast<size_t>(device)]; }
+    const State& state(Device device) const { return devices_[static_cast<size_t>(device)]; }
+
+    Config config_;
+    State devices_[static_cast<size_t>(Device::kCount)];
+};
+
+}  // namespace i2c_health
@@ -4,39 +4,140 @@ namespace reg_buffer {
 
 SampleRingBuffer::SampleRingBuffer() = default;
 
-bool SampleRingBuffer::push(const Sample& sample) {
-  if (full()) {
+bool SampleRingBuffer::push(const Sample& sample, uint8_t stride) {
+  Sample* s = reserve(stride);
+  if (!s) {
     return false;
   }
-  buffer_[tail_] = sample;
-  tail_ = (tail_ + 1) % kCapacity;
-  ++count_;
+  *s = sample;
+  commit();
   return true;
 }
 
-bool SampleRingBuffer::pop(Sample& sample_out) {
+Sample* SampleRingBuffer::reserve(uint8_t stride) {
+  if (reserve_n(1) == 0) {
+    return nullptr;
+  }
+  return &reserved(0, stride);
+}
+
+size_t SampleRingBuffer::reserve_n(size_t n) {
+  const size_t free = kCapacity - size();
+  reserved_ = n < free ? n : free;
+  return reserved_;
+}
+
+Sample& SampleRingBuffer::reserved(size_t i, uint8_t stride) {
+  const size_t pos = slot(tail_.load(std::memory_order_relaxed) + i);
+  strides_[pos] = (stride & kStridePeriods) ? stride : static_cast<uint8_t>(stride | 1);
+  return buffer_[pos];
+}
+
+void SampleRingBuffer::commit(size_t n) {
+  if (n > reserved_) n = reserved_;
+  if (n == 0) return;
+  const size_t tail = tail_.load(std::memory_order_relaxed);
+  size_t ticks = 0;
+  for (size_t i = 0; i < n; ++i) ticks += stride_periods(strides_[slot(tail + i)]);
+  tail_.store(tail + n, std::memory_order_release);
+  ticks_in_.fetch_add(ticks, std::memory_order_release);
+  reserved_ = 0;
+}
+
+bool SampleRingBuffer::pop(Sample& sample_out, uint8_t* stride_out) {
   if (empty()) {
     return false;
   }
-  sample_out = buffer_[head_];
-  head_ = (head_ + 1) % kCapacity;
-  --count_;
+  const size_t head = head_.load(std::memory_order_relaxed);
+  const size_t pos = slot(head);
+  sample_out = buffer_[pos];
+  if (stride_out) *stride_out = strides_[pos];
+  ticks_out_.fetch_add(stride_periods(strides_[pos]), std::memory_order_relaxed);
+  head_.store(head + 1, std::memory_order_release);
   return true;
 }
 
-bool SampleRingBuffer::peek(size_t index, Sample& sample_out) const {
-  if (index >= count_) {
+bool SampleRingBuffer::peek(size_t index, Sample& sample_out, uint8_t* stride_out) const {
+  if (index >= size()) {
     return false;
   }
-  size_t pos = (head_ + index) % kCapacity;
+  size_t pos = slot(head_.load(std::memory_order_relaxed) + index);
   sample_out = buffer_[pos];
+  if (stride_out) *stride_out = strides_[pos];
   return true;
 }
 
+// The producer adds its strides just after publishing, so a sample already
+// popped may not be counted in yet; the difference is clamped at zero.
+size_t SampleRingBuffer::ticks() const {
+  const size_t in = ticks_in_.load(std::memory_order_acquire);
+  const size_t out = ticks_out_.load(std::memory_order_relaxed);
+  return static_cast<std::ptrdiff_t>(in - out) > 0 ? in - out : 0;
+}
+
 void SampleRingBuffer::clear() {
-  head_ = 0;
-  tail_ = 0;
-  count_ = 0;
+  const size_t tail = tail_.load(std::memory_order_acquire);
+  size_t head = head_.load(std::memory_order_relaxed);
+  size_t ticks = 0;
+  for (; head != tail; ++head) ticks += stride_periods(strides_[slot(head)]);
+  ticks_out_.fetch_add(ticks, std::memory_order_relaxed);
+  head_.store(tail, std::memory_order_release);
+}
+
+bool ChannelRing::push(const ChannelSample& sample) {
+  const size_t tail = tail_.load(std::memory_order_relaxed);
+  bool kept = true;
+  size_t head = head_.load(std::memory_order_acquire);
+  // Full: take the oldest slot, unless the consumer frees one first
+  while (tail - head == kCapacity) {
+    if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      kept = false;
+      break;
+    }
+  }
+  buffer_[tail & (kCapacity - 1)] = sample;
+  tail_.store(tail + 1, std::memory_order_release);
+  return kept;
+}
+
+bool ChannelRing::pop(ChannelSample& sample_out) {
+  return pop_through(UINT32_MAX, sample_out);
+}
+
+bool ChannelRing::pop_through(uint32_t timestamp, ChannelSample& sample_out) {
+  size_t head = head_.load(std::memory_order_acquire);
+  for (;;) {
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    const ChannelSample sample = buffer_[head & (kCapacity - 1)];
+    if (sample.timestamp > timestamp) {
+      // Overwritten while being read: look again at the new oldest
+      if (head_.load(std::memory_order_acquire) != head) {
+        head = head_.load(std::memory_order_acquire);
+        continue;
+      }
+      return false;
+    }
+    // Fails if the producer overwrote this slot meanwhile; head is reloaded
+    if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      sample_out = sample;
+      return true;
+    }
+  }
+}
+
+bool ChannelRing::front(ChannelSample& sample_out) const {
+  const size_t head = head_.load(std::memory_order_acquire);
+  if (head == tail_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  sample_out = buffer_[head & (kCapacity - 1)];
+  return true;
+}
+
+void ChannelRing::clear() {
+  head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
 }
 
-}  // namespace reg_buffer
\ No newline at end of file
+}  // namespace reg_buffer
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <array>
-#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 
@@ -75,6 +75,8 @@ struct float16 {
     }
 };
 
+// One IMU reading. Heart rate and body temperature change far slower than
+// the 50 Hz IMU and travel in their own ChannelRings.
 struct Sample {
     float16 ax;       // accel X (g or raw units)
     float16 ay;       // accel Y
@@ -82,34 +84,106 @@ struct Sample {
     float16 gx;       // gyro X (dps or raw)
     float16 gy;       // gyro Y
     float16 gz;       // gyro Z
-    float16 hr_bpm;   // heart rate BPM
-    float16 temp_c;   // body temperature Celsius
     uint32_t timestamp; // Unix timestamp (seconds)
 };
+
+// One reading of a slow channel: HR when the median changes, body
+// temperature at 1 Hz. Same timestamp scale as Sample.
+struct ChannelSample {
+    float16 value;
+    uint32_t timestamp;
+};
 #pragma pack(pop)
 
-static_assert(sizeof(Sample) == 20, "Sample must remain 20 bytes (8*half + uint32)");
+static_assert(sizeof(Sample) == 16, "Sample must remain 16 bytes (6*half + uint32)");
+static_assert(sizeof(ChannelSample) == 6, "ChannelSample must remain 6 bytes");
+
+// Stride byte: the base IMU periods a sample stands for in the low 7 bits;
+// kStrideDecimated marks a sample averaged from several reads under
+// backpressure (decimator.h)
+constexpr uint8_t kStridePeriods = 0x7F;
+constexpr uint8_t kStrideDecimated = 0x80;
+inline uint8_t stride_periods(uint8_t stride) {
+    return (stride & kStridePeriods) ? (stride & kStridePeriods) : 1;
+}
 
 // Fixed-size circular buffer tailored for 64 sensor samples.
+// Each sample carries a stride: the number of base IMU periods (20 ms) it
+// stands for. Full-rate samples have stride 1; reduced-rate samples (e.g. the
+// no-motion ODR) have larger strides so consumers can stay time-aligned.
+//
+// Single producer (sensor task), single consumer (main loop). The producer
+// can build samples in place: reserve() hands out the next free slot,
+// reserve_n() up to n of them for a burst, and commit() publishes them with
+// one index store, so the consumer never sees a half-written sample.
+//
+//   if (reg_buffer::Sample* s = ring.reserve(stride)) { fill(*s); ring.commit(); }
 class SampleRingBuffer {
  public:
     static constexpr size_t kCapacity = 256;
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "indices are free-running");
 
     SampleRingBuffer();
 
-    bool push(const Sample& sample);        // returns false if buffer is full
-    bool pop(Sample& sample_out);           // returns false if buffer is empty
-    bool peek(size_t index, Sample& sample_out) const;  // index relative to oldest
-    size_t size() const { return count_; }
-    bool empty() const { return count_ == 0; }
-    bool full() const { return count_ == kCapacity; }
-    void clear();
+    bool push(const Sample& sample, uint8_t stride = 1);  // returns false if buffer is full
+    bool pop(Sample& sample_out, uint8_t* stride_out = nullptr);  // returns false if buffer is empty
+    bool peek(size_t index, Sample& sample_out, uint8_t* stride_out = nullptr) const;  // index relative to oldest
+
+    // Producer side, in place. reserve() returns the next free slot or
+    // nullptr if full; reserve_n() reserves up to `n` slots and returns how
+    // many, filled through reserved(i). Either way nothing is visible until
+    // commit(n) publishes the first n reserved slots; a new reserve replaces
+    // whatever was left uncommitted.
+    Sample* reserve(uint8_t stride = 1);
+    size_t reserve_n(size_t n);
+    Sample& reserved(size_t i, uint8_t stride = 1);
+    void commit(size_t n = 1);
+
+    size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+    size_t ticks() const;  // sum of strides currently buffered (never more than published)
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() == kCapacity; }
+    void clear();  // consumer side: drops everything published so far
 
  private:
+    static size_t slot(size_t index) { return index & (kCapacity - 1); }
+
     std::array<Sample, kCapacity> buffer_{};
-    size_t head_ = 0;  // points to oldest element
-    size_t tail_ = 0;  // points to next insertion slot
-    size_t count_ = 0;
+    std::array<uint8_t, kCapacity> strides_{};
+    std::atomic<size_t> head_{0};  // oldest element; written by the consumer
+    std::atomic<size_t> tail_{0};  // next insertion; written by the producer
+    std::atomic<size_t> ticks_in_{0};   // strides committed, stored after tail_
+    std::atomic<size_t> ticks_out_{0};  // strides popped or cleared
+    size_t reserved_ = 0;          // producer only
+};
+
+// Ring for one slow channel, single producer and single consumer.
+// Consolidation joins it to the IMU stream by timestamp, holding each value
+// until the next one (consolidate.h). 64 entries cover about a minute of
+// loop stall at HR-per-beat plus 1 Hz temperature; past that a push
+// overwrites the oldest reading, so after a longer stall the channel
+// resumes from its newest readings instead of freezing at the 64th. Both
+// sides move head_ by compare-exchange: a consumer whose slot was taken
+// over mid-read loses the exchange and reads the new oldest instead.
+class ChannelRing {
+ public:
+    static constexpr size_t kCapacity = 64;
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "indices are free-running");
+
+    bool push(const ChannelSample& sample);  // always stored; false if the oldest was overwritten
+    bool pop(ChannelSample& sample_out);
+    // Pop the oldest reading if it is stamped at or before `timestamp`
+    bool pop_through(uint32_t timestamp, ChannelSample& sample_out);
+    bool front(ChannelSample& sample_out) const;  // oldest, not removed
+
+    size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+    void clear();  // consumer side
+
+ private:
+    std::array<ChannelSample, kCapacity> buffer_{};
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
 };
 
 }  // namespace reg_buffer
\ No newline at end of file
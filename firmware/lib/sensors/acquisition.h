@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "compute/consolidate.h"
+#include "decimator.h"
+#include "ringbuf/reg_buffer.h"
+#include "sensor_driver.h"
+
+// Sampling pipeline shared by the device (real drivers) and host tests
+// (fakes): batched reads, ring-buffer hand-off and the 1 s window averages
+// the sensor task uses for AGC and wear detection. Templated on the driver
+// types so every driver call is static.
+namespace acquisition {
+
+// Means over one window; NAN where the sensor produced nothing
+struct WindowAverages {
+    uint32_t imu_count;
+    double ax, ay, az, gx, gy, gz;
+    double imu_temp_f;
+    uint32_t ppg_count;
+    double red, ir;
+    uint32_t temp_count;
+    double body_c, body_f;
+};
+
+template <typename Imu, typename Ppg, typename Temp>
+class Pipeline {
+public:
+    // PPG readings per read_batch. sample_ppg() repeats the read until one
+    // comes back short, so the whole FIFO (32 deep, 320 ms at 100 Hz) is
+    // drained however late the tick ran; 8 only sets the stack buffer size.
+    static constexpr size_t kPpgBatch = 8;
+
+    Pipeline(Imu& imu, Ppg& ppg, Temp& temp) : imu_(imu), ppg_(ppg), temp_(temp) {}
+
+    void set_ring(reg_buffer::SampleRingBuffer* ring) { ring_ = ring; }
+    // Heart rate, body temperature and wear state go to their own rings at
+    // their own rate rather than into every IMU sample
+    void set_channels(reg_buffer::ChannelRing* hr, reg_buffer::ChannelRing* temp,
+                      reg_buffer::ChannelRing* wear = nullptr) {
+        hr_ring_ = hr;
+        temp_ring_ = temp;
+        wear_ring_ = wear;
+    }
+
+    // Optional overflow path for the ring (sample_spill on the device): while
+    // divert(ring) is true samples go to add() instead; add() false is a drop.
+    struct Overflow {
+        bool (*divert)(reg_buffer::SampleRingBuffer& ring);
+        bool (*add)(const reg_buffer::Sample& sample, uint8_t stride);
+    };
+    void set_overflow(const Overflow& overflow) { overflow_ = overflow; }
+
+    // One IMU read standing for `stride` base periods, pushed to the ring
+    // (averaged with the next reads first while the ring is backed up, see
+    // decimator.h).
+    bool sample_imu(uint8_t stride, uint32_t timestamp, sensor_driver::ImuReading* out = nullptr) {
+        sensor_driver::ImuReading r;
+        if (imu_.read_batch(sensor_driver::Span<sensor_driver::ImuReading>(&r, 1)) != 1) return false;
+
+        if (ring_) {
+            // Under backpressure reads are averaged down before they reach the
+            // ring. Not while the overflow path is taking them: the spill keeps
+            // the full rate unless it is refusing samples as well.
+            decimator_.update(spilling_ && !spill_refused_ ? 0 : ring_->size());
+            sensor_driver::ImuReading d;
+            uint8_t d_stride;
+            if (decimator_.add(r, stride, d, d_stride)) push(d, d_stride, timestamp);
+        }
+
+        ax_ += r.ax; ay_ += r.ay; az_ += r.az;
+        gx_ += r.gx; gy_ += r.gy; gz_ += r.gz;
+        if (!std::isnan(r.temp_c)) imu_temp_f_ += r.temp_c * 1.8 + 32.0;
+        ++imu_count_;
+        if (out) *out = r;
+        return true;
+    }
+
+    // Drain the PPG FIFO in batches; `on_sample(const PpgReading&)` runs for
+    // each reading (beat detection). Returns readings consumed.
+    template <typename OnSample>
+    size_t sample_ppg(OnSample on_sample) {
+        size_t total = 0;
+        for (;;) {
+            const size_t n = ppg_.read_batch(sensor_driver::Span<sensor_driver::PpgReading>(ppg_buf_));
+            for (size_t i = 0; i < n; ++i) {
+                red_ += ppg_buf_[i].red;
+                ir_ += ppg_buf_[i].ir;
+                on_sample(ppg_buf_[i]);
+            }
+            ppg_count_ += static_cast<uint32_t>(n);
+            total += n;
+            if (n < kPpgBatch) return total;
+        }
+    }
+
+    // Current heart rate; a reading goes to the HR ring only when it differs
+    // from the last one pushed. A full ring overwrites its oldest reading
+    // (counted in channel_drops).
+    void set_hr(float bpm, uint32_t timestamp) {
+        const reg_buffer::float16 value(bpm);
+        if (!hr_ring_ || (hr_sent_ && value.bits == last_hr_.bits)) return;
+        if (!hr_ring_->push(reg_buffer::ChannelSample{value, timestamp})) ++channel_drops_;
+        last_hr_ = value;
+        hr_sent_ = true;
+    }
+
+    // Current wear state, the same way: the first call and every change go
+    // to the wear ring (consolidate::kWearOff / kWearOn)
+    void set_off_wrist(bool off, uint32_t timestamp) {
+        if (!wear_ring_ || (wear_sent_ && off == off_wrist_)) return;
+        const reg_buffer::float16 value(off ? consolidate::kWearOff : consolidate::kWearOn);
+        if (!wear_ring_->push(reg_buffer::ChannelSample{value, timestamp})) ++channel_drops_;
+        off_wrist_ = off;
+        wear_sent_ = true;
+    }
+
+    bool sample_temp(uint32_t timestamp) {
+        sensor_driver::TempReading t;
+        if (temp_.read_batch(sensor_driver::Span<sensor_driver::TempReading>(&t, 1)) != 1) return false;
+        if (temp_ring_ && !temp_ring_->push(reg_buffer::ChannelSample{reg_buffer::float16(t.celsius), timestamp})) {
+            ++channel_drops_;
+        }
+        last_body_c_ = t.celsius;
+        body_c_ += t.celsius;
+        body_f_ += t.celsius * 9.0 / 5.0 + 32.0;
+        ++temp_count_;
+        return true;
+    }
+
+    // Averages since the previous call; resets the sums.
+    WindowAverages finish_window() {
+        WindowAverages w;
+        w.imu_count = imu_count_;
+        w.ax = mean(ax_, imu_count_); w.ay = mean(ay_, imu_count_); w.az = mean(az_, imu_count_);
+        w.gx = mean(gx_, imu_count_); w.gy = mean(gy_, imu_count_); w.gz = mean(gz_, imu_count_);
+        w.imu_temp_f = imu_temp_f_ > 0 ? mean(imu_temp_f_, imu_count_) : NAN;
+        w.ppg_count = ppg_count_;
+        w.red = mean(red_, ppg_count_);
+        w.ir = mean(ir_, ppg_count_);
+        w.temp_count = temp_count_;
+        w.body_c = mean(body_c_, temp_count_);
+        w.body_f = mean(body_f_, temp_count_);
+
+        ax_ = ay_ = az_ = gx_ = gy_ = gz_ = imu_temp_f_ = 0;
+        red_ = ir_ = 0;
+        body_c_ = body_f_ = 0;
+        imu_count_ = ppg_count_ = temp_count_ = 0;
+        return w;
+    }
+
+    float last_body_temp_c() const { return last_body_c_; }
+    uint32_t ring_drops() const { return ring_drops_; }
+    uint32_t channel_drops() const { return channel_drops_; }
+    const decimator::Decimator& decimation() const { return decimator_; }
+
+private:
+    static double mean(double sum, uint32_t n) { return n ? sum / n : NAN; }
+
+    void push(const sensor_driver::ImuReading& r, uint8_t stride, uint32_t timestamp) {
+        spilling_ = overflow_.divert && overflow_.divert(*ring_);
+        spill_refused_ = false;
+        if (spilling_) {
+            reg_buffer::Sample rs{};
+            fill(rs, r, timestamp);
+            spill_refused_ = !overflow_.add(rs, stride);
+            if (spill_refused_) ++ring_drops_;
+        } else if (reg_buffer::Sample* rs = ring_->reserve(stride)) {
+            // Built in the ring slot itself and published in one store
+            fill(*rs, r, timestamp);
+            ring_->commit();
+        } else {
+            ++ring_drops_;
+        }
+    }
+
+    static void fill(reg_buffer::Sample& rs, const sensor_driver::ImuReading& r, uint32_t timestamp) {
+        rs.ax = reg_buffer::float16(r.ax);
+        rs.ay = reg_buffer::float16(r.ay);
+        rs.az = reg_buffer::float16(r.az);
+        rs.gx = reg_buffer::float16(r.gx);
+        rs.gy = reg_buffer::float16(r.gy);
+        rs.gz = reg_buffer::float16(r.gz);
+        rs.timestamp = timestamp;
+    }
+
+    Imu& imu_;
+    Ppg& ppg_;
+    Temp& temp_;
+    reg_buffer::SampleRingBuffer* ring_ = nullptr;
+    reg_buffer::ChannelRing* hr_ring_ = nullptr;
+    reg_buffer::ChannelRing* temp_ring_ = nullptr;
+    reg_buffer::ChannelRing* wear_ring_ = nullptr;
+    reg_buffer::float16 last_hr_;
+    bool hr_sent_ = false;
+    bool off_wrist_ = false;
+    bool wear_sent_ = false;
+    Overflow overflow_ = {nullptr, nullptr};
+    bool spilling_ = false;       // the last sample went to the overflow path
+    bool spill_refused_ = false;  // ... and was dropped there
+    decimator::Decimator decimator_;
+    sensor_driver::PpgReading ppg_buf_[kPpgBatch];
+
+    double ax_ = 0, ay_ = 0, az_ = 0, gx_ = 0, gy_ = 0, gz_ = 0, imu_temp_f_ = 0;
+    double red_ = 0, ir_ = 0;
+    double body_c_ = 0, body_f_ = 0;
+    uint32_t imu_count_ = 0, ppg_count_ = 0, temp_count_ = 0;
+    float last_body_c_ = 0.0f;
+    uint32_t ring_drops_ = 0;
+    uint32_t channel_drops_ = 0;
+};
+
+}  // namespace acquisition
@@ -0,0 +1,96 @@
+#include "beat_timing.h"
+
+namespace beat_timing {
+
+namespace {
+
+// The read time is a noisy anchor (the newest sample is up to one period
+// older, plus I2C latency). While it stays within a few periods of the
+// sample clock, plus the drift an unfitted period could build up, the clock
+// keeps counting samples; a bigger jump means samples were lost or the
+// stream restarted.
+constexpr uint32_t kReanchorPeriods = 3;
+constexpr uint32_t kMaxSkewPct = 5;       // oscillator tolerance
+// The period is fitted to the anchor over the whole epoch once it spans
+// this many samples (1 s at 100 Hz), so its error shrinks as the epoch grows
+constexpr uint32_t kFitSamples = 100;
+// Epochs restart every 5 min to stay clear of the 71 min micros() wrap
+constexpr uint32_t kEpochSamples = 30000;
+
+}  // namespace
+
+uint32_t BeatClock::offset_us(uint32_t samples) const {
+    return static_cast<uint32_t>((static_cast<uint64_t>(samples) * period_q8_) >> 8);
+}
+
+void BeatClock::begin_drain(uint32_t read_us) {
+    read_us_ = read_us;
+    drain_samples_ = 0;
+    beats_ = 0;
+}
+
+void BeatClock::sample(bool beat) {
+    if (beat && beats_ < kMaxBeatsPerDrain) beat_offsets_[beats_++] = drain_samples_;
+    ++drain_samples_;
+}
+
+// Pin the last beat to an absolute time before positions are renumbered
+void BeatClock::detach_last_beat() {
+    if (have_beat_ && beat_in_epoch_) {
+        last_beat_us_ = base_us_ + offset_us(last_beat_pos_);
+        beat_in_epoch_ = false;
+    }
+}
+
+size_t BeatClock::end_drain() {
+    if (drain_samples_ == 0) return 0;
+
+    const uint32_t anchored_first = read_us_ - offset_us(drain_samples_ - 1);
+    const uint32_t predicted_first = base_us_ + offset_us(since_base_);
+    const int32_t error = static_cast<int32_t>(anchored_first - predicted_first);
+    const uint32_t nominal_us = nominal_q8_ >> 8;
+    const uint32_t unfitted = fitted_ ? drain_samples_ : since_base_;
+    const int32_t limit = static_cast<int32_t>(kReanchorPeriods * nominal_us +
+                                               static_cast<uint64_t>(unfitted) * nominal_us * kMaxSkewPct / 100);
+    if (!anchored_ || error > limit || error < -limit) {
+        if (anchored_) ++reanchors_;
+        detach_last_beat();
+        anchored_ = true;
+        base_us_ = anchored_first;
+        since_base_ = 0;
+    } else if (since_base_ >= kFitSamples) {
+        const uint64_t span_q8 = static_cast<uint64_t>(anchored_first - base_us_) << 8;
+        const uint64_t tolerance = static_cast<uint64_t>(nominal_q8_) * kMaxSkewPct / 100;
+        uint64_t measured = span_q8 / since_base_;
+        if (measured > nominal_q8_ + tolerance) measured = nominal_q8_ + tolerance;
+        if (measured < nominal_q8_ - tolerance) measured = nominal_q8_ - tolerance;
+        period_q8_ = static_cast<uint32_t>(measured);
+        fitted_ = true;
+    }
+
+    // Intervals within an epoch are sample counts times the current period,
+    // so refitting the period never shifts a beat already timed
+    for (size_t i = 0; i < beats_; ++i) {
+        const uint32_t pos = since_base_ + beat_offsets_[i];
+        if (!have_beat_) {
+            intervals_[i] = 0;
+        } else if (beat_in_epoch_) {
+            intervals_[i] = offset_us(pos - last_beat_pos_);
+        } else {
+            intervals_[i] = base_us_ + offset_us(pos) - last_beat_us_;
+        }
+        last_beat_pos_ = pos;
+        beat_in_epoch_ = true;
+        have_beat_ = true;
+    }
+    since_base_ += drain_samples_;
+
+    if (since_base_ >= kEpochSamples) {
+        detach_last_beat();
+        base_us_ += offset_us(since_base_);
+        since_base_ = 0;
+    }
+    return beats_;
+}
+
+}  // namespace beat_timing
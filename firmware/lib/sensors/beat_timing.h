@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Beat timestamps from the PPG sample clock instead of the time the sample
+// was processed. A FIFO drain hands over several samples at once, so
+// millis() in the beat callback gives them all the same time; here each
+// sample's time is its position in the stream times the configured sample
+// period, anchored to the time the FIFO was read. Batch size no longer
+// matters, and samples lost to a FIFO overflow show up as a gap instead of
+// shortening an interval. The sensor's own oscillator is not the ESP32's, so
+// the sample period is calibrated against the read times as it runs.
+//
+//   clock.begin_drain(micros());
+//   for each sample: clock.sample(checkForBeat(ir));
+//   for (size_t i = 0; i < clock.end_drain(); ++i) use(clock.interval_us(i));
+namespace beat_timing {
+
+class BeatClock {
+public:
+    static constexpr size_t kMaxBeatsPerDrain = 4;
+
+    explicit BeatClock(uint32_t sample_period_us)
+        : nominal_q8_(sample_period_us << 8), period_q8_(sample_period_us << 8) {}
+
+    // The FIFO is about to be drained; the newest sample in it was taken
+    // just before `read_us` (micros())
+    void begin_drain(uint32_t read_us);
+
+    // One sample of the drain, oldest first
+    void sample(bool beat);
+
+    // Place the drain's samples on the sample clock and time its beats.
+    // Returns the number of beats; interval_us(i) is the time from the
+    // previous beat, 0 for the first beat after a reset().
+    size_t end_drain();
+    uint32_t interval_us(size_t i) const { return intervals_[i]; }
+
+    // Forget the last beat (sensor was off or paused)
+    void reset() { have_beat_ = false; }
+
+    // Current sample period estimate (us)
+    float period_us() const { return period_q8_ / 256.0f; }
+    // Times the clock jumped to the read time (lost samples, restarts)
+    uint32_t reanchors() const { return reanchors_; }
+
+private:
+    uint32_t offset_us(uint32_t samples) const;
+    void detach_last_beat();
+
+    uint32_t nominal_q8_;           // configured period, 1/256 us
+    uint32_t period_q8_;            // calibrated period, 1/256 us
+    uint32_t read_us_ = 0;
+    uint32_t base_us_ = 0;          // time of the epoch's first sample
+    uint32_t since_base_ = 0;       // samples in the epoch so far
+    bool anchored_ = false;
+    bool fitted_ = false;           // period fitted to the read times at least once
+    uint32_t drain_samples_ = 0;
+    uint32_t beat_offsets_[kMaxBeatsPerDrain] = {};
+    size_t beats_ = 0;
+    uint32_t intervals_[kMaxBeatsPerDrain] = {};
+    uint32_t last_beat_pos_ = 0;    // sample position in the epoch...
+    uint32_t last_beat_us_ = 0;     // ...or absolute time once the epoch ended
+    bool beat_in_epoch_ = false;
+    bool have_beat_ = false;
+    uint32_t reanchors_ = 0;
+};
+
+}  // namespace beat_timing
@@ -0,0 +1,66 @@
+#include "bmi270_driver.h"
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "telemetry/telemetry.h"
+
+namespace {
+constexpr uint8_t kAddr = 0x68;
+constexpr uint8_t kAddrAlt = 0x69;
+// Data registers (12 bytes) + temperature (2), each a write-reg/restart-read
+constexpr uint32_t kI2cBytesPerRead = (3 + 12) + (3 + 2);
+}  // namespace
+
+bool Bmi270Driver::do_begin() {
+    if (imu_.beginI2C(kAddr, Wire) != BMI2_OK && imu_.beginI2C(kAddrAlt, Wire) != BMI2_OK) {
+        // Serial.println("BMI270: not found");
+        return false;
+    }
+    int8_t rs = imu_.setAccelODR(BMI2_ACC_ODR_50HZ);
+    if (rs != BMI2_OK) {
+        // Serial.printf("BMI270 accel ODR fail (%d)\n", rs);
+    }
+    rs = imu_.setGyroODR(BMI2_GYR_ODR_50HZ);
+    if (rs != BMI2_OK) {
+        // Serial.printf("BMI270 gyro ODR fail (%d)\n", rs);
+    }
+    // Serial.println("BMI270 ready");
+    return true;
+}
+
+size_t Bmi270Driver::do_read_batch(sensor_driver::Span<sensor_driver::ImuReading> out, bool& ok) {
+    if (out.empty()) return 0;
+    if (imu_.getSensorData() != BMI2_OK) {
+        ok = false;
+        return 0;
+    }
+    telemetry::add(telemetry::Stat::kI2cBytes, kI2cBytesPerRead);
+    sensor_driver::ImuReading& r = out[0];
+    r.ax = imu_.data.accelX; r.ay = imu_.data.accelY; r.az = imu_.data.accelZ;
+    r.gx = imu_.data.gyroX;  r.gy = imu_.data.gyroY;  r.gz = imu_.data.gyroZ;
+    float t;
+    r.temp_c = imu_.getTemperature(&t) == BMI2_OK ? t : NAN;
+    return 1;
+}
+
+bool Bmi270Driver::do_power_mode(sensor_driver::PowerMode mode) {
+    switch (mode) {
+        case sensor_driver::PowerMode::kOff:
+            return imu_.disableFeature(BMI2_GYRO) == BMI2_OK &&
+                   imu_.disableFeature(BMI2_ACCEL) == BMI2_OK;
+        case sensor_driver::PowerMode::kLowPower:
+            (void)imu_.disableFeature(BMI2_GYRO);
+            return imu_.setAccelPowerMode(BMI2_POWER_OPT_MODE) == BMI2_OK;
+        case sensor_driver::PowerMode::kNormal:
+        default:
+            (void)imu_.enableFeature(BMI2_ACCEL);
+            (void)imu_.setAccelPowerMode(BMI2_PERF_OPT_MODE);
+            (void)imu_.enableFeature(BMI2_GYRO);
+            return imu_.setGyroODR(BMI2_GYR_ODR_50HZ) == BMI2_OK;
+    }
+}
+
+uint32_t Bmi270Driver::now_us() const {
+    return micros();
+}
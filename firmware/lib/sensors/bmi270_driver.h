@@ -0,0 +1,25 @@
+#pragma once
+
+#include <SparkFun_BMI270_Arduino_Library.h>
+
+#include "sensor_driver.h"
+
+// BMI270 accel/gyro on Wire (0x68, falling back to 0x69). One reading per
+// batch from the data registers. Low power keeps the accelerometer at its
+// ODR with the power-optimised filter (the motion feature engine needs it)
+// and turns the gyro off.
+class Bmi270Driver : public sensor_driver::Driver<Bmi270Driver, sensor_driver::ImuReading> {
+public:
+    // Feature engine access (motion interrupts, step counter)
+    BMI270& device() { return imu_; }
+
+private:
+    friend class sensor_driver::Driver<Bmi270Driver, sensor_driver::ImuReading>;
+
+    bool do_begin();
+    size_t do_read_batch(sensor_driver::Span<sensor_driver::ImuReading> out, bool& ok);
+    bool do_power_mode(sensor_driver::PowerMode mode);
+    uint32_t now_us() const;
+
+    BMI270 imu_;
+};
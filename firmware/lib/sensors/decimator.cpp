@@ -0,0 +1,45 @@
+#include "decimator.h"
+
+#include "ringbuf/reg_buffer.h"
+
+namespace decimator {
+
+uint8_t Decimator::update(size_t occupancy) {
+    if (occupancy >= config_.x4_on) {
+        factor_ = 4;
+    } else if (occupancy < config_.x2_off) {
+        factor_ = 1;
+    } else if (factor_ == 4 ? occupancy < config_.x4_off : occupancy >= config_.x2_on) {
+        factor_ = 2;
+    }
+    return factor_;
+}
+
+bool Decimator::add(const sensor_driver::ImuReading& r, uint8_t stride,
+                    sensor_driver::ImuReading& out, uint8_t& out_stride) {
+    const uint8_t periods = reg_buffer::stride_periods(stride);
+    ax_ += static_cast<double>(r.ax) * periods; ay_ += static_cast<double>(r.ay) * periods;
+    az_ += static_cast<double>(r.az) * periods; gx_ += static_cast<double>(r.gx) * periods;
+    gy_ += static_cast<double>(r.gy) * periods; gz_ += static_cast<double>(r.gz) * periods;
+    periods_ += periods;
+    ++reads_;
+    // Still-mode strides are already long; keep the sum inside the stride byte
+    if (reads_ < factor_ && periods_ <= reg_buffer::kStridePeriods / 2) return false;
+
+    out = r;  // temperature: the latest read
+    out.ax = static_cast<float>(ax_ / periods_); out.ay = static_cast<float>(ay_ / periods_);
+    out.az = static_cast<float>(az_ / periods_); out.gx = static_cast<float>(gx_ / periods_);
+    out.gy = static_cast<float>(gy_ / periods_); out.gz = static_cast<float>(gz_ / periods_);
+    const uint32_t capped = periods_ < reg_buffer::kStridePeriods ? periods_ : reg_buffer::kStridePeriods;
+    out_stride = static_cast<uint8_t>(capped);
+    if (reads_ > 1) {
+        out_stride |= reg_buffer::kStrideDecimated;
+        folded_ += reads_ - 1u;
+    }
+    reads_ = 0;
+    periods_ = 0;
+    ax_ = ay_ = az_ = gx_ = gy_ = gz_ = 0;
+    return true;
+}
+
+}  // namespace decimator
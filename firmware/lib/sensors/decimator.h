@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sensor_driver.h"
+
+// Backpressure on the IMU stream. When the loop falls behind and the sample
+// ring fills, the sensor task averages 2 or 4 consecutive reads into one
+// sample (a box-car low-pass, so motion above the new Nyquist rate is
+// attenuated instead of aliased into the step band) and pushes it with the
+// summed stride, flagged reg_buffer::kStrideDecimated. Consolidation keeps
+// its 2.5 s windows and marks the record; without this the ring would drop
+// samples and the windows would silently close over holes. The factor
+// follows ring occupancy with hysteresis, below the spill watermark. Once
+// the spill takes over, the caller passes an occupancy of 0 so the spilled
+// samples stay at full rate, and decimates again only if the spill starts
+// refusing them (acquisition::Pipeline).
+namespace decimator {
+
+struct Config {
+    // Ring occupancy (samples) at which each factor engages and releases.
+    // The ring normally peaks at one window (125) before consolidation.
+    uint16_t x2_on = 160;
+    uint16_t x2_off = 128;
+    uint16_t x4_on = 192;
+    uint16_t x4_off = 160;
+};
+
+class Decimator {
+public:
+    explicit Decimator(const Config& config = Config()) : config_(config) {}
+
+    // Track the ring's occupancy; returns the factor now in force (1, 2, 4)
+    uint8_t update(size_t occupancy);
+
+    // Fold one read covering `stride` base periods into the average. True
+    // when a sample is due: `out` is the stride-weighted mean of the reads
+    // since the last one and `out_stride` their periods, flagged decimated
+    // if more than one read went in.
+    bool add(const sensor_driver::ImuReading& r, uint8_t stride,
+             sensor_driver::ImuReading& out, uint8_t& out_stride);
+
+    uint8_t factor() const { return factor_; }
+    uint32_t folded() const { return folded_; }  // reads averaged into a later one
+
+private:
+    Config config_;
+    uint8_t factor_ = 1;
+    uint8_t reads_ = 0;
+    uint32_t periods_ = 0;
+    double ax_ = 0, ay_ = 0, az_ = 0, gx_ = 0, gy_ = 0, gz_ = 0;
+    uint32_t folded_ = 0;
+};
+
+}  // namespace decimator
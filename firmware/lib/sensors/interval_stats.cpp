@@ -0,0 +1,70 @@
+#include "interval_stats.h"
+
+namespace interval_stats {
+
+Histogram::Histogram(uint32_t nominal_us, uint32_t slack_us)
+    : nominal_us_(nominal_us ? nominal_us : 1),
+      slack_us_(slack_us ? slack_us : nominal_us_ / 2),
+      bucket_us_(nominal_us_ / 16 ? nominal_us_ / 16 : 1) {}
+
+void Histogram::record(uint32_t now_us, uint32_t periods) {
+    if (!have_last_) {
+        have_last_ = true;
+        last_us_ = now_us;
+        return;
+    }
+    if (periods == 0) periods = 1;
+    const uint32_t interval = now_us - last_us_;  // wraps with micros()
+    last_us_ = now_us;
+
+    const int64_t expected = static_cast<int64_t>(periods) * nominal_us_;
+    const int64_t error = static_cast<int64_t>(interval) - expected;
+    const int64_t norm = nominal_us_ + error;
+    const uint32_t normalised = norm < 0 ? 0 : (norm > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(norm));
+
+    if (count_ == 0 || normalised < min_us_) min_us_ = normalised;
+    if (count_ == 0 || normalised > max_us_) max_us_ = normalised;
+    ++count_;
+
+    if (error > static_cast<int64_t>(slack_us_)) {
+        ++missed_;
+        skipped_ += static_cast<uint32_t>((error + nominal_us_ / 2) / nominal_us_);
+    }
+
+    // error in [-nominal, 3 * nominal) -> bucket
+    const int64_t offset = error + nominal_us_;
+    size_t idx = 0;
+    if (offset > 0) {
+        const int64_t b = offset / bucket_us_;
+        idx = b >= static_cast<int64_t>(kBuckets) ? kBuckets - 1 : static_cast<size_t>(b);
+    }
+    ++buckets_[idx];
+}
+
+void Histogram::reset() {
+    count_ = 0;
+    missed_ = 0;
+    skipped_ = 0;
+    min_us_ = 0;
+    max_us_ = 0;
+    for (size_t i = 0; i < kBuckets; ++i) buckets_[i] = 0;
+}
+
+uint32_t Histogram::percentile_us(uint8_t pct) const {
+    if (count_ == 0) return 0;
+    if (pct > 100) pct = 100;
+    // Smallest bucket with at least pct% of samples at or below it
+    const uint64_t target = (static_cast<uint64_t>(count_) * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets_[i];
+        if (seen >= target && seen > 0) {
+            if (i == kBuckets - 1) return max_us_;
+            const uint32_t edge = static_cast<uint32_t>((i + 1) * bucket_us_);  // offset from -nominal
+            return edge < max_us_ ? edge : max_us_;
+        }
+    }
+    return max_us_;
+}
+
+}  // namespace interval_stats
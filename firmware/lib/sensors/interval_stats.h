@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Inter-sample interval histogram for one sensor. The sensor task calls
+// record() with a microsecond timestamp at each read; min/max/percentiles and
+// missed deadlines are read out at the 1 Hz telemetry tick. record() is a
+// few integer operations with no loop or allocation (the interval and its
+// error, min/max, the missed-deadline check and a bucket index), so it can
+// run on every sample.
+//
+// Buckets hold the interval's error against the expected time (periods *
+// nominal), nominal/16 wide, from -nominal to +3 * nominal; later samples land
+// in the last bucket and are still counted in max and missed.
+namespace interval_stats {
+
+class Histogram {
+public:
+    static constexpr size_t kBuckets = 64;
+
+    // `slack_us` is how late a sample may be before it counts as a missed
+    // deadline (default: half a period).
+    explicit Histogram(uint32_t nominal_us, uint32_t slack_us = 0);
+
+    // A sample taken at `now_us` standing for `periods` nominal periods
+    // (reduced-rate IMU reads cover several). The first call only sets the
+    // reference time.
+    void record(uint32_t now_us, uint32_t periods = 1);
+
+    // Clears the statistics; the next interval is still measured from the
+    // last recorded sample.
+    void reset();
+
+    uint32_t count() const { return count_; }
+    uint32_t missed() const { return missed_; }
+    uint32_t skipped_periods() const { return skipped_; }
+
+    // Intervals normalised to one period (interval - (periods - 1) * nominal)
+    uint32_t min_us() const { return count_ ? min_us_ : 0; }
+    uint32_t max_us() const { return count_ ? max_us_ : 0; }
+    uint32_t percentile_us(uint8_t pct) const;  // upper bucket edge; max_us() in the overflow bucket
+
+    uint32_t nominal_us() const { return nominal_us_; }
+
+private:
+    uint32_t nominal_us_;
+    uint32_t slack_us_;
+    uint32_t bucket_us_;
+    bool have_last_ = false;
+    uint32_t last_us_ = 0;
+    uint32_t count_ = 0;
+    uint32_t missed_ = 0;
+    uint32_t skipped_ = 0;
+    uint32_t min_us_ = 0;
+    uint32_t max_us_ = 0;
+    uint32_t buckets_[kBuckets] = {};
+};
+
+}  // namespace interval_stats
@@ -0,0 +1,73 @@
+#include "max30102_driver.h"
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "i2c_bus/i2c_bus.h"
+#include "max30102_fifo.h"
+
+namespace {
+
+constexpr uint8_t kAddress = 0x57;
+
+// max30102_fifo's bus: burst register reads on Wire (counted in kI2cBytes)
+struct WireBus {
+    bool read(uint8_t reg, uint8_t* buf, size_t n) { return i2c_readN(kAddress, reg, buf, n) == n; }
+};
+
+}  // namespace
+
+bool Max30102Driver::do_begin() {
+    if (!sensor_.begin(Wire, I2C_SPEED_FAST)) { // Use default I2C port, 400kHz speed
+        // Serial.println("MAX30102: not found");
+        return false;
+    }
+
+    // LED amplitude and pulse width are starting points only; the AGC loop
+    // retunes them once per second.
+    byte ledBrightness = agc_.led_amplitude; // 0=Off to 255=50mA
+    byte sampleAverage = 1;    // Options: 1, 2, 4, 8, 16, 32
+    byte ledMode = 3;          // Options: 1 = Red only, 2 = Red + DC, 3 = Red + IR
+    int sampleRate = kSampleRateHz; // Options: 50, 100, 200, 400, 800, 1000, 1600, 3200
+    int pulseWidth = agc_.pulse_width_us(); // Options: 69, 118, 215, 411
+    int adcRange = 4096;       // Options: 2048, 4096, 8192, 16384
+
+    sensor_.setup(ledBrightness, sampleAverage, ledMode, sampleRate, pulseWidth, adcRange);
+    sensor_.setPulseAmplitudeRed(ledBrightness);
+    sensor_.setPulseAmplitudeGreen(0); // Turn off Green LED
+    // Serial.println("MAX30102 ready");
+    return true;
+}
+
+// Pulse width register codes 0..3 map 1:1 to ppg_agc::kPulseWidthsUs.
+void Max30102Driver::apply(const ppg_agc::Settings& agc) {
+    agc_ = agc;
+    if (!present()) return;
+    sensor_.setPulseAmplitudeRed(agc.led_amplitude);
+    sensor_.setPulseAmplitudeIR(agc.led_amplitude);
+    sensor_.setPulseWidth(agc.pulse_width_idx);
+}
+
+void Max30102Driver::clear_fifo() {
+    if (present()) sensor_.clearFIFO();
+}
+
+// Straight from the FIFO registers rather than check()/getFIFOIR(): the
+// library's 4-slot buffer drops samples once a drain finds more than 4
+size_t Max30102Driver::do_read_batch(sensor_driver::Span<sensor_driver::PpgReading> out, bool& ok) {
+    WireBus bus;
+    return max30102_fifo::read(bus, out, ok);
+}
+
+bool Max30102Driver::do_power_mode(sensor_driver::PowerMode mode) {
+    if (mode == sensor_driver::PowerMode::kNormal) {
+        sensor_.wakeUp();
+    } else {
+        sensor_.shutDown();
+    }
+    return true;
+}
+
+uint32_t Max30102Driver::now_us() const {
+    return micros();
+}
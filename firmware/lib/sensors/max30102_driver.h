@@ -0,0 +1,32 @@
+#pragma once
+
+#include <MAX30105.h>
+
+#include "ppg_agc.h"
+#include "sensor_driver.h"
+
+// MAX30102 red/IR PPG at 100 Hz, Red + IR mode. A batch read takes as many
+// readings as fit from the FIFO registers in one burst (max30102_fifo.h);
+// the rest stay in the sensor's FIFO for the next call. kOff and kLowPower both use
+// the shutdown bit (FIFO and registers are retained).
+class Max30102Driver : public sensor_driver::Driver<Max30102Driver, sensor_driver::PpgReading> {
+public:
+    static constexpr int kSampleRateHz = 100;  // FIFO sample clock; beat timing counts on it
+
+    explicit Max30102Driver(const ppg_agc::Settings& initial) : agc_(initial) {}
+
+    // Push LED amplitude / pulse width from the AGC loop
+    void apply(const ppg_agc::Settings& agc);
+    void clear_fifo();
+
+private:
+    friend class sensor_driver::Driver<Max30102Driver, sensor_driver::PpgReading>;
+
+    bool do_begin();
+    size_t do_read_batch(sensor_driver::Span<sensor_driver::PpgReading> out, bool& ok);
+    bool do_power_mode(sensor_driver::PowerMode mode);
+    uint32_t now_us() const;
+
+    MAX30105 sensor_;
+    ppg_agc::Settings agc_;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sensor_driver.h"
+
+// MAX30102 FIFO read straight from the registers. The SparkFun library's
+// check() copies the FIFO into a 4-slot buffer and advances only its head,
+// so a drain that finds more than 4 samples keeps (count mod 4) of them;
+// at one drain per PPG_DRAIN_TICKS (5 samples) that loses about 80% of the
+// stream. Here the pointers are read, then only as many samples as the
+// caller has room for; the rest stay in the 32-deep hardware FIFO for the
+// next call.
+//
+// Bus is anything with bool read(uint8_t reg, uint8_t* buf, size_t n), one
+// burst register read (i2c_readN on the device, a register model in
+// test_sensor_drivers).
+namespace max30102_fifo {
+
+constexpr uint8_t kRegWritePtr = 0x04;  // FIFO_WR_PTR, OVF_COUNTER, FIFO_RD_PTR follow
+constexpr uint8_t kRegData = 0x07;      // FIFO_DATA; reading it advances FIFO_RD_PTR
+constexpr size_t kDepth = 32;
+constexpr size_t kBytesPerSample = 6;   // Red then IR, 3 bytes each (Red + IR mode)
+constexpr size_t kBurstSamples = 20;    // 120 bytes, inside the ESP32 Wire buffer
+constexpr uint32_t kSampleMask = 0x3FFFF;  // 18-bit ADC
+
+// Samples waiting, from the pointer registers. Equal pointers are an empty
+// FIFO unless the overflow counter says it filled (and then dropped samples).
+inline size_t pending(uint8_t write_ptr, uint8_t read_ptr, uint8_t overflow) {
+    const size_t n = static_cast<size_t>((write_ptr - read_ptr) & (kDepth - 1));
+    return n == 0 && overflow ? kDepth : n;
+}
+
+inline uint32_t decode(const uint8_t* p) {
+    return ((static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2]) & kSampleMask;
+}
+
+// Read up to out.size() samples; ok = false on a bus error (whatever was
+// read before it is still returned). `lost` gets the overflow counter.
+template <typename Bus>
+size_t read(Bus& bus, sensor_driver::Span<sensor_driver::PpgReading> out, bool& ok, uint8_t* lost = nullptr) {
+    uint8_t ptrs[3];
+    if (!bus.read(kRegWritePtr, ptrs, sizeof(ptrs))) {
+        ok = false;
+        return 0;
+    }
+    if (lost) *lost = ptrs[1];
+    size_t want = pending(ptrs[0], ptrs[2], ptrs[1]);
+    if (want > out.size()) want = out.size();
+
+    uint8_t burst[kBurstSamples * kBytesPerSample];
+    size_t n = 0;
+    while (n < want) {
+        const size_t chunk = want - n < kBurstSamples ? want - n : kBurstSamples;
+        if (!bus.read(kRegData, burst, chunk * kBytesPerSample)) {
+            ok = false;
+            break;
+        }
+        for (size_t i = 0; i < chunk; ++i) {
+            out[n + i].red = decode(&burst[i * kBytesPerSample]);
+            out[n + i].ir = decode(&burst[i * kBytesPerSample + 3]);
+        }
+        n += chunk;
+    }
+    return n;
+}
+
+}  // namespace max30102_fifo
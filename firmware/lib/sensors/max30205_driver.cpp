@@ -0,0 +1,41 @@
+#include "max30205_driver.h"
+
+#include <Arduino.h>
+
+#include "i2c_bus/i2c_bus.h"
+
+namespace {
+constexpr uint8_t kRegTemp = 0x00;
+constexpr uint8_t kRegConfig = 0x01;
+constexpr uint8_t kConfigShutdown = 0x01;
+}  // namespace
+
+bool Max30205Driver::do_begin() {
+    if (!i2c_ping(addr_)) {
+        // Serial.println("MAX30205: not found");
+        return false;
+    }
+    // Serial.println("MAX30205 ready");
+    return i2c_write8(addr_, kRegConfig, 0x00); // out of shutdown after a reinit
+}
+
+size_t Max30205Driver::do_read_batch(sensor_driver::Span<sensor_driver::TempReading> out, bool& ok) {
+    if (out.empty()) return 0;
+    uint8_t buf[2];
+    if (i2c_readN(addr_, kRegTemp, buf, 2) != 2) {
+        ok = false;
+        return 0;
+    }
+    const int16_t raw = (int16_t)((buf[0] << 8) | buf[1]);
+    out[0].celsius = raw / 256.0f;
+    return 1;
+}
+
+bool Max30205Driver::do_power_mode(sensor_driver::PowerMode mode) {
+    const uint8_t config = mode == sensor_driver::PowerMode::kNormal ? 0x00 : kConfigShutdown;
+    return i2c_write8(addr_, kRegConfig, config);
+}
+
+uint32_t Max30205Driver::now_us() const {
+    return micros();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "sensor_driver.h"
+
+// MAX30205 body temperature (one-shot register read, 1/256 C). Low power
+// and off both set CONFIG.SHUTDOWN.
+class Max30205Driver : public sensor_driver::Driver<Max30205Driver, sensor_driver::TempReading> {
+public:
+    explicit Max30205Driver(uint8_t addr = 0x48) : addr_(addr) {}
+
+private:
+    friend class sensor_driver::Driver<Max30205Driver, sensor_driver::TempReading>;
+
+    bool do_begin();
+    size_t do_read_batch(sensor_driver::Span<sensor_driver::TempReading> out, bool& ok);
+    bool do_power_mode(sensor_driver::PowerMode mode);
+    uint32_t now_us() const;
+
+    uint8_t addr_;
+};
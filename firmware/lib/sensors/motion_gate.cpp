@@ -0,0 +1,32 @@
+#include "motion_gate.h"
+
+namespace motion_gate {
+
+bool Gate::on_interrupt(bool any_motion, bool no_motion) {
+    // Motion wins if both latched between reads
+    Mode next = mode_;
+    if (any_motion) {
+        next = Mode::kActive;
+    } else if (no_motion) {
+        next = Mode::kStill;
+    }
+    if (next == mode_) return false;
+    mode_ = next;
+    ++transitions_;
+    return true;
+}
+
+uint8_t Gate::tick() {
+    if (elapsed_ < UINT8_MAX) ++elapsed_;
+    if (elapsed_ < stride()) return 0;
+    const uint8_t covered = elapsed_;
+    elapsed_ = 0;
+    return covered;
+}
+
+void Gate::carry(uint8_t periods) {
+    const uint16_t total = static_cast<uint16_t>(elapsed_) + periods;
+    elapsed_ = total > UINT8_MAX ? UINT8_MAX : static_cast<uint8_t>(total);
+}
+
+}  // namespace motion_gate
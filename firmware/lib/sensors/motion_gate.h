@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// IMU rate gating driven by the BMI270 any-motion / no-motion interrupts.
+// In kActive the IMU is read every base period (50 Hz); after a no-motion
+// interrupt it drops to kStill and is read every `still_stride` periods with
+// the accelerometer at a low ODR and the gyro off. Any-motion returns to
+// full rate on the next IMU tick.
+namespace motion_gate {
+
+enum class Mode : uint8_t { kActive, kStill };
+
+struct Config {
+    uint8_t active_stride = 1;  // base periods per read while moving (50 Hz)
+    uint8_t still_stride = 8;   // base periods per read while still (6.25 Hz)
+};
+
+class Gate {
+public:
+    explicit Gate(const Config& config = Config()) : config_(config) {}
+
+    // Feed the interrupt status bits read after an INT edge. Returns true if
+    // the mode changed (caller reconfigures the IMU ODR/power).
+    bool on_interrupt(bool any_motion, bool no_motion);
+
+    // Called once per base IMU period. Returns the stride (periods covered)
+    // when a read is due now, 0 otherwise.
+    uint8_t tick();
+
+    // The read for `periods` failed; fold them into the next sample.
+    void carry(uint8_t periods);
+
+    Mode mode() const { return mode_; }
+    uint8_t stride() const { return mode_ == Mode::kActive ? config_.active_stride : config_.still_stride; }
+    uint32_t transitions() const { return transitions_; }
+
+private:
+    Config config_;
+    Mode mode_ = Mode::kActive;
+    uint8_t elapsed_ = 0;  // base periods since the last pushed sample
+    uint32_t transitions_ = 0;
+};
+
+}  // namespace motion_gate
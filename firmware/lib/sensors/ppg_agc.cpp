@@ -0,0 +1,72 @@
+#include "ppg_agc.h"
+
+#include <algorithm>
+
+namespace ppg_agc {
+
+namespace {
+    // Largest single-step change in light output. Keeps one noisy window
+    // (motion, sensor lifted for a moment) from swinging the LEDs end to end.
+    constexpr double kMaxGainStep = 4.0;
+}
+
+Controller::Controller(const Config& config, Settings initial)
+    : config_(config), settings_(initial) {}
+
+bool Controller::update(uint32_t ir_dc, uint32_t elapsed_ms) {
+    // Charge drawn during the window that produced this reading
+    charge_uc_ += static_cast<double>(average_current_ua()) * elapsed_ms / 1000.0;
+
+    const bool saturated = ir_dc >= config_.saturation;
+    const bool in_window = ir_dc >= config_.target_low && ir_dc <= config_.target_high;
+    if (in_window) {
+        out_of_window_ = 0;
+        return false;
+    }
+    if (!saturated && ++out_of_window_ < config_.settle_updates) {
+        return false;
+    }
+    out_of_window_ = 0;
+    return retarget(ir_dc);
+}
+
+bool Controller::retarget(uint32_t ir_dc) {
+    const double target = (config_.target_low + config_.target_high) / 2.0;
+    double gain = ir_dc > 0 ? target / ir_dc : kMaxGainStep;
+    gain = std::max(1.0 / kMaxGainStep, std::min(gain, kMaxGainStep));
+
+    // Signal scales with amplitude * pulse width, so solve for that product
+    // and keep the current pulse width unless the amplitude runs out of range.
+    const double light = static_cast<double>(settings_.led_amplitude) *
+                         settings_.pulse_width_us() * gain;
+
+    uint8_t idx = settings_.pulse_width_idx;
+    double amp = light / kPulseWidthsUs[idx];
+    while (amp > config_.max_amplitude && idx + 1u < kPulseWidthCount) {
+        ++idx;
+        amp = light / kPulseWidthsUs[idx];
+    }
+    while (amp < config_.min_amplitude && idx > 0) {
+        --idx;
+        amp = light / kPulseWidthsUs[idx];
+    }
+    amp = std::max<double>(config_.min_amplitude, std::min<double>(amp + 0.5, config_.max_amplitude));
+
+    Settings next{static_cast<uint8_t>(amp), idx};
+    if (next.led_amplitude == settings_.led_amplitude &&
+        next.pulse_width_idx == settings_.pulse_width_idx) {
+        return false;
+    }
+    settings_ = next;
+    ++adjustments_;
+    return true;
+}
+
+uint32_t Controller::average_current_ua() const {
+    // I_avg = I_pulse * duty, duty = pulse width * pulses per second per LED
+    const double pulse_ma = settings_.led_amplitude * kLedMaPerLsb;
+    const double duty = settings_.pulse_width_us() * 1e-6 * config_.sample_rate_hz;
+    return static_cast<uint32_t>(pulse_ma * 1000.0 * duty * config_.active_leds + 0.5);
+}
+
+}  // namespace ppg_agc
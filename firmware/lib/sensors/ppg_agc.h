@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Automatic gain control for the MAX30102 LEDs.
+// Keeps the IR DC level inside a target ADC window by stepping the LED pulse
+// amplitude first and the pulse width only when the amplitude is pinned at a
+// limit. Also integrates the LED charge so the cost of the current setting can
+// be reported as a power metric.
+namespace ppg_agc {
+
+// MAX30102 LED pulse amplitude register: 0x00..0xFF, ~0.2 mA per LSB.
+constexpr float kLedMaPerLsb = 0.2f;
+
+// Pulse widths supported by the MAX30102 (us), shortest first.
+constexpr uint16_t kPulseWidthsUs[] = {69, 118, 215, 411};
+constexpr size_t kPulseWidthCount = sizeof(kPulseWidthsUs) / sizeof(kPulseWidthsUs[0]);
+
+// 18-bit ADC full scale.
+constexpr uint32_t kAdcFullScale = 262143;
+
+struct Settings {
+    uint8_t led_amplitude;    // LED pulse amplitude register value
+    uint8_t pulse_width_idx;  // index into kPulseWidthsUs
+
+    uint16_t pulse_width_us() const { return kPulseWidthsUs[pulse_width_idx]; }
+};
+
+struct Config {
+    uint32_t target_low = 70000;     // IR DC below this -> more light
+    uint32_t target_high = 170000;   // IR DC above this -> less light
+    uint32_t saturation = 240000;    // treat as clipped, correct immediately
+    uint8_t min_amplitude = 0x04;    // ~0.8 mA
+    uint8_t max_amplitude = 0x7F;    // ~25 mA, keeps worst-case current bounded
+    uint8_t settle_updates = 2;      // consecutive out-of-window updates before acting
+    uint16_t sample_rate_hz = 100;   // PPG sample rate (pulses per LED per second)
+    uint8_t active_leds = 2;         // RED + IR
+};
+
+class Controller {
+public:
+    explicit Controller(const Config& config = Config(),
+                        Settings initial = Settings{0x1F, kPulseWidthCount - 1});
+
+    // Feed the mean IR DC level observed over `elapsed_ms`. Returns true when
+    // the LED settings changed and must be written to the sensor.
+    bool update(uint32_t ir_dc, uint32_t elapsed_ms);
+
+    const Settings& settings() const { return settings_; }
+
+    // Average LED supply current (uA) at the current settings.
+    uint32_t average_current_ua() const;
+
+    // LED charge drawn so far (mA*s, i.e. millicoulombs).
+    uint32_t charge_mc() const { return static_cast<uint32_t>(charge_uc_ / 1000.0); }
+
+    uint32_t adjustments() const { return adjustments_; }
+
+private:
+    bool retarget(uint32_t ir_dc);
+
+    Config config_;
+    Settings settings_;
+    double charge_uc_ = 0.0;
+    uint32_t adjustments_ = 0;
+    uint8_t out_of_window_ = 0;
+};
+
+}  // namespace ppg_agc
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Static-dispatch sensor driver interface. A driver derives from
+// Driver<Self, Reading> and provides, privately (befriend the base):
+//
+//   bool do_begin();                                   probe + configure
+//   size_t do_read_batch(Span<Reading> out, bool& ok); fill up to out.size(),
+//                                                      ok = false on a bus error
+//   bool do_power_mode(PowerMode mode);
+//   uint32_t now_us() const;                           clock for read latency
+//
+// The base adds the common behaviour (presence, power state, per-read health)
+// without virtual calls, so the device drivers and the host fakes plug into
+// the same templated pipeline code (see acquisition.h) and compile to direct
+// calls.
+namespace sensor_driver {
+
+// Non-owning view of a contiguous buffer (std::span is C++20)
+template <typename T>
+class Span {
+public:
+    Span() : data_(nullptr), size_(0) {}
+    Span(T* data, size_t size) : data_(data), size_(size) {}
+    template <size_t N>
+    Span(T (&array)[N]) : data_(array), size_(N) {}
+
+    T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T& operator[](size_t i) const { return data_[i]; }
+    T* begin() const { return data_; }
+    T* end() const { return data_ + size_; }
+    Span first(size_t n) const { return Span(data_, n < size_ ? n : size_); }
+
+private:
+    T* data_;
+    size_t size_;
+};
+
+enum class PowerMode : uint8_t { kOff, kLowPower, kNormal };
+
+struct Health {
+    uint32_t reads = 0;
+    uint32_t failures = 0;
+    uint32_t consecutive_failures = 0;
+    uint32_t last_latency_us = 0;
+    uint32_t max_latency_us = 0;
+    bool last_ok = false;
+};
+
+struct ImuReading {
+    float ax, ay, az;  // g
+    float gx, gy, gz;  // dps
+    float temp_c;      // die temperature, NAN if unavailable
+};
+
+struct PpgReading {
+    uint32_t red;
+    uint32_t ir;
+};
+
+struct TempReading {
+    float celsius;
+};
+
+template <typename Derived, typename Reading>
+class Driver {
+public:
+    using reading_type = Reading;
+
+    bool begin() {
+        present_ = self().do_begin();
+        if (present_) mode_ = PowerMode::kNormal;
+        return present_;
+    }
+
+    // Reads whatever the device has ready, up to out.size(). Returns the
+    // number of readings written (0 on error or when nothing is new).
+    size_t read_batch(Span<Reading> out) {
+        bool ok = present_;
+        size_t n = 0;
+        const uint32_t start = self().now_us();
+        if (present_) n = self().do_read_batch(out, ok);
+        record(ok, self().now_us() - start);
+        return ok ? n : 0;
+    }
+
+    bool power_mode(PowerMode mode) {
+        if (!present_ || !self().do_power_mode(mode)) return false;
+        mode_ = mode;
+        return true;
+    }
+
+    bool present() const { return present_; }
+    PowerMode mode() const { return mode_; }
+    const Health& health() const { return health_; }
+
+protected:
+    Driver() = default;
+    ~Driver() = default;  // not deleted through a base pointer
+
+private:
+    Derived& self() { return static_cast<Derived&>(*this); }
+
+    void record(bool ok, uint32_t latency_us) {
+        ++health_.reads;
+        health_.last_ok = ok;
+        health_.last_latency_us = latency_us;
+        if (latency_us > health_.max_latency_us) health_.max_latency_us = latency_us;
+        if (ok) {
+            health_.consecutive_failures = 0;
+        } else {
+            ++health_.failures;
+            ++health_.consecutive_failures;
+        }
+    }
+
+    bool present_ = false;
+    PowerMode mode_ = PowerMode::kOff;
+    Health health_;
+};
+
+}  // namespace sensor_driver
@@ -1,6 +1,18 @@
 #pragma once
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
 #include "ringbuf/reg_buffer.h"
 
-void sensors_setup(reg_buffer::SampleRingBuffer* buffer);
+// IMU samples go to `buffer`; heart rate, body temperature and off-wrist
+// transitions to their own rings (joined in consolidate)
+void sensors_setup(reg_buffer::SampleRingBuffer* buffer, reg_buffer::ChannelRing* hr, reg_buffer::ChannelRing* temp,
+                   reg_buffer::ChannelRing* wear);
 void sensors_loop();
+
+// Sampling task, for stack high-water telemetry.
+TaskHandle_t sensors_task_handle();
+
+// Running total of the BMI270 step counter; false if it is not enabled.
+bool sensors_hw_step_total(uint32_t& total);
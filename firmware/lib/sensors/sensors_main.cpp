@@ -11,87 +11,127 @@
 #include <sys/time.h>
 #include "sensors.h"
 #include "app_config.h"
-#include <SparkFun_BMI270_Arduino_Library.h>
+#include "bmi270_driver.h"
 #undef I2C_BUFFER_LENGTH
-#include "MAX30105.h"
+#include "max30102_driver.h"
+#include "max30205_driver.h"
+#include "acquisition.h"
 #include "heartRate.h"
 #include "ringbuf/reg_buffer.h"
-
-// Addresses (adapted from sensors_demo.cpp)
-static constexpr uint8_t BMI270_ADDR      = 0x68;
-static constexpr uint8_t BMI270_ADDR_ALT  = 0x69;
-static constexpr uint8_t MAX30102_ADDR    = 0x57;
+#include "storage/sample_spill.h"
+#include "ppg_agc.h"
+#include "wear_detect.h"
+#include "motion_gate.h"
+#include "telemetry/telemetry.h"
+#include "telemetry/binlog.h"
+#include "i2c_bus/i2c_bus.h"
+#include "i2c_bus/i2c_health.h"
+#include "interval_stats.h"
+#include "tick_schedule.h"
+#include "uptime.h"
+#include "beat_timing.h"
+
+// --- Sensor drivers (static dispatch; see sensor_driver.h) ---
 static constexpr uint8_t MAX30205_ADDR    = 0x48; // single address variant used
-
-// --- Minimal I2C helpers (blocking; acceptable for demo) ---
-static bool i2c_write8(uint8_t addr, uint8_t reg, uint8_t val) {
-  Wire.beginTransmission(addr);
-  Wire.write(reg);
-  Wire.write(val);
-  return Wire.endTransmission() == 0;
-}
-static int i2c_read8(uint8_t addr, uint8_t reg) {
-  Wire.beginTransmission(addr);
-  Wire.write(reg);
-  if (Wire.endTransmission(false) != 0) return -1;
-  if (Wire.requestFrom((int)addr, 1) != 1) return -1;
-  return Wire.read();
+static Bmi270Driver g_imu;
+static ppg_agc::Controller g_ppgAgc;
+static Max30102Driver g_ppg(g_ppgAgc.settings());
+static Max30205Driver g_temp(MAX30205_ADDR);
+static acquisition::Pipeline<Bmi270Driver, Max30102Driver, Max30205Driver> g_pipeline(g_imu, g_ppg, g_temp);
+
+// --- BMI270 motion interrupts (any-motion / no-motion on BMI270_INT_PIN) ---
+static motion_gate::Config motionGateConfig() {
+  motion_gate::Config cfg;
+#if IMU_STEPS_ONLY
+  cfg.active_stride = cfg.still_stride; // steps come from the BMI270 counter
+#endif
+  return cfg;
 }
-static size_t i2c_readN(uint8_t addr, uint8_t reg, uint8_t *buf, size_t n) {
-  Wire.beginTransmission(addr);
-  Wire.write(reg);
-  if (Wire.endTransmission(false) != 0) return 0;
-  size_t got = Wire.requestFrom((int)addr, (int)n);
-  for (size_t i = 0; i < got; ++i) buf[i] = Wire.read();
-  return got;
+static motion_gate::Gate g_motionGate(motionGateConfig());
+static bool g_motionIntOk = false;
+
+static bool bmi270_configMotionInt() {
+#if BMI270_INT_PIN >= 0
+  if (!g_imu.present()) return false;
+  BMI270& imu = g_imu.device();
+  if (imu.enableFeature(BMI2_ANY_MOTION) != BMI2_OK) return false;
+  if (imu.enableFeature(BMI2_NO_MOTION) != BMI2_OK) return false;
+
+  // Thresholds in 0.49 mg LSB, durations in 20 ms feature-engine periods
+  bmi2_sens_config anyMotion;
+  anyMotion.type = BMI2_ANY_MOTION;
+  anyMotion.cfg.any_motion.duration = 4;     // 80 ms above threshold
+  anyMotion.cfg.any_motion.threshold = 80;   // ~39 mg
+  anyMotion.cfg.any_motion.select_x = BMI2_ENABLE;
+  anyMotion.cfg.any_motion.select_y = BMI2_ENABLE;
+  anyMotion.cfg.any_motion.select_z = BMI2_ENABLE;
+  if (imu.setConfig(anyMotion) != BMI2_OK) return false;
+
+  bmi2_sens_config noMotion;
+  noMotion.type = BMI2_NO_MOTION;
+  noMotion.cfg.no_motion.duration = 250;     // 5 s below threshold
+  noMotion.cfg.no_motion.threshold = 80;
+  noMotion.cfg.no_motion.select_x = BMI2_ENABLE;
+  noMotion.cfg.no_motion.select_y = BMI2_ENABLE;
+  noMotion.cfg.no_motion.select_z = BMI2_ENABLE;
+  if (imu.setConfig(noMotion) != BMI2_OK) return false;
+
+  bmi2_int_pin_config pinCfg;
+  pinCfg.pin_type = BMI2_INT1;
+  pinCfg.int_latch = BMI2_INT_NON_LATCH;
+  pinCfg.pin_cfg[0].lvl = BMI2_INT_ACTIVE_HIGH;
+  pinCfg.pin_cfg[0].od = BMI2_INT_PUSH_PULL;     // GPIO34 has no pull-up
+  pinCfg.pin_cfg[0].output_en = BMI2_INT_OUTPUT_ENABLE;
+  pinCfg.pin_cfg[0].input_en = BMI2_INT_INPUT_DISABLE;
+  if (imu.setInterruptPinConfig(pinCfg) != BMI2_OK) return false;
+  if (imu.mapInterruptToPin(BMI2_ANY_MOTION_INT, BMI2_INT1) != BMI2_OK) return false;
+  if (imu.mapInterruptToPin(BMI2_NO_MOTION_INT, BMI2_INT1) != BMI2_OK) return false;
+  return true;
+#else
+  return false;
+#endif
 }
-static bool i2c_ping(uint8_t addr) {
-  Wire.beginTransmission(addr);
-  return Wire.endTransmission() == 0;
+
+// The feature engine needs the accelerometer at >= 50 Hz, so still mode keeps
+// the ODR but switches the accel to its power-optimised filter and turns the
+// gyro off; the host reads at the gate's reduced rate.
+static void bmi270_applyMotionMode(motion_gate::Mode mode) {
+  (void)g_imu.power_mode(mode == motion_gate::Mode::kStill ? sensor_driver::PowerMode::kLowPower
+                                                           : sensor_driver::PowerMode::kNormal);
+  telemetry::set(telemetry::Stat::kImuStill, mode == motion_gate::Mode::kStill);
+  telemetry::set(telemetry::Stat::kImuModeChanges, g_motionGate.transitions());
 }
 
-// --- BMI270 ---
-static BMI270 g_imu;
-static bool   g_bmi_ok = false;
-static bool bmi270_begin() {
-  if (g_imu.beginI2C(BMI270_ADDR, Wire) != BMI2_OK) {
-    if (g_imu.beginI2C(BMI270_ADDR_ALT, Wire) != BMI2_OK) {
-      // Serial.println("BMI270: not found");
-      g_bmi_ok = false; return false;
-    }
-  }
-  int8_t rs;
-  rs = g_imu.setAccelODR(BMI2_ACC_ODR_50HZ);
-  if (rs != BMI2_OK) {
-    // Serial.printf("BMI270 accel ODR fail (%d)\n", rs);
-  }
-  rs = g_imu.setGyroODR(BMI2_GYR_ODR_50HZ);
-  if (rs != BMI2_OK) {
-    // Serial.printf("BMI270 gyro ODR fail (%d)\n", rs);
-  }
-  g_bmi_ok = true;
-  // Serial.println("BMI270 ready");
+// --- BMI270 hardware step counter (polled at 1 Hz, consumed per window) ---
+static bool g_hwStepsOk = false;
+static volatile uint32_t g_hwStepTotal = 0;
+
+static bool bmi270_enableStepCounter() {
+#if USE_BMI270_STEP_COUNTER
+  if (!g_imu.present()) return false;
+  if (g_imu.device().enableFeature(BMI2_STEP_COUNTER) != BMI2_OK) return false;
+  (void)g_imu.device().resetStepCount();
   return true;
-}
-struct ImuSample { float ax, ay, az; float gx, gy, gz; float tempC; bool ok; };
-static ImuSample bmi270_read() {
-  ImuSample s{0,0,0,0,0,0,NAN,false};
-  if (!g_bmi_ok) return s;
-  if (g_imu.getSensorData() != BMI2_OK) return s;
-  s.ax = g_imu.data.accelX; s.ay = g_imu.data.accelY; s.az = g_imu.data.accelZ;
-  s.gx = g_imu.data.gyroX;  s.gy = g_imu.data.gyroY;  s.gz = g_imu.data.gyroZ;
-  float t; if (g_imu.getTemperature(&t) == BMI2_OK) s.tempC = t; else s.tempC = NAN;
-  s.ok = true;
-  return s;
+#else
+  return false;
+#endif
 }
 
-// --- MAX30102 (using SparkFun Library) ---
-static MAX30105 particleSensor;
+static void bmi270_pollStepCounter() {
+  if (!g_hwStepsOk) return;
+  uint32_t steps = 0;
+  if (g_imu.device().getStepCount(&steps) == BMI2_OK) {
+    g_hwStepTotal = steps;
+    telemetry::set(telemetry::Stat::kStepsHwTotal, steps);
+  }
+}
 
+// --- Heart rate (beat detection on the IR stream) ---
 const byte RATE_SIZE = 4; //Increase this for more averaging. 4 is good.
 byte rates[RATE_SIZE]; //Array of heart rates
 byte rateSpot = 0;
-long lastBeat = 0; //Time at which the last beat occurred
+// Beat times from the PPG sample clock, not processing time
+static beat_timing::BeatClock g_beatClock(1000000UL / Max30102Driver::kSampleRateHz);
 
 float beatsPerMinute;
 int beatAvg;
@@ -104,49 +144,82 @@ static uint8_t hrBufferIdx = 0;
 static void pushHrValue(int val);
 static int getMedianHr();
 
-static bool max30102_begin() {
-  // Initialize sensor
-  if (!particleSensor.begin(Wire, I2C_SPEED_FAST)) { // Use default I2C port, 400kHz speed
-    // Serial.println("MAX30102: not found");
-    return false;
+// Run one AGC step on the mean IR level of the last window and publish the
+// LED power metrics.
+static void updatePpgAgc(double irAvg, uint32_t elapsedMs) {
+  if (!g_ppg.present() || isnan(irAvg)) return;
+  if (g_ppgAgc.update((uint32_t)irAvg, elapsedMs)) {
+    g_ppg.apply(g_ppgAgc.settings());
+    BINLOG("[AGC] IR=%.0f -> amp=0x%02X pw=%uus", irAvg,
+           g_ppgAgc.settings().led_amplitude, g_ppgAgc.settings().pulse_width_us());
   }
+  telemetry::set(telemetry::Stat::kLedChargeMc, g_ppgAgc.charge_mc());
+  telemetry::set(telemetry::Stat::kLedAvgCurrentUa, g_ppgAgc.average_current_ua());
+  telemetry::set(telemetry::Stat::kLedAmplitude, g_ppgAgc.settings().led_amplitude);
+  telemetry::set(telemetry::Stat::kLedPulseWidthUs, g_ppgAgc.settings().pulse_width_us());
+  telemetry::set(telemetry::Stat::kLedAdjustments, g_ppgAgc.adjustments());
+}
 
-  // Setup with optimal settings for heart rate
-  byte ledBrightness = 0x1F; // Options: 0=Off to 255=50mA. 0x1F (approx 6.4mA) is a good starting point
-  byte sampleAverage = 1;    // Options: 1, 2, 4, 8, 16, 32
-  byte ledMode = 3;          // Options: 1 = Red only, 2 = Red + DC, 3 = Red + IR
-  int sampleRate = 100;      // Options: 50, 100, 200, 400, 800, 1000, 1600, 3200
-  int pulseWidth = 411;      // Options: 69, 118, 215, 411
-  int adcRange = 4096;       // Options: 2048, 4096, 8192, 16384
-
-  particleSensor.setup(ledBrightness, sampleAverage, ledMode, sampleRate, pulseWidth, adcRange);
-  particleSensor.setPulseAmplitudeRed(ledBrightness);
-  particleSensor.setPulseAmplitudeGreen(0); // Turn off Green LED
-  
-  // Serial.println("MAX30102 ready");
-  return true;
+
+
+// --- I2C health (per-device failure tracking, reinit and bus recovery) ---
+static i2c_health::Monitor g_i2cHealth;
+static bool g_imuPresent = false;   // found at boot; only these are monitored
+static bool g_ppgPresent = false;
+static bool g_tempPresent = false;
+
+static void reinitImu() {
+  if (!g_imu.begin()) return;
+  g_hwStepsOk = bmi270_enableStepCounter();
+#if BMI270_INT_PIN >= 0
+  g_motionIntOk = bmi270_configMotionInt();
+#endif
+  bmi270_applyMotionMode(g_motionGate.mode());
 }
 
+static void reinitPpg() {
+  if (g_ppg.begin()) g_ppg.apply(g_ppgAgc.settings());
+}
 
+static void reinitTemp() {
+  (void)g_temp.begin();
+}
 
-// --- MAX30205 ---
-static bool max30205_ok = false;
-static bool max30205_begin() {
-  if (!i2c_ping(MAX30205_ADDR)) { 
-    // Serial.println("MAX30205: not found"); 
-    return false; 
+static void publishI2cHealth() {
+  uint32_t reinits = 0, recoveries = 0, outages = 0, outageMs = 0, longest = 0, maxUs = 0;
+  for (size_t i = 0; i < static_cast<size_t>(i2c_health::Device::kCount); ++i) {
+    const i2c_health::DeviceStats& st = g_i2cHealth.stats(static_cast<i2c_health::Device>(i));
+    reinits += st.reinits;
+    recoveries += st.bus_recoveries;
+    outages += st.outages;
+    outageMs += st.outage_ms_total;
+    if (st.longest_outage_ms > longest) longest = st.longest_outage_ms;
+    if (st.max_latency_us > maxUs) maxUs = st.max_latency_us;
   }
-  max30205_ok = true; 
-  // Serial.println("MAX30205 ready"); 
-  return true;
+  telemetry::set(telemetry::Stat::kI2cReinits, reinits);
+  telemetry::set(telemetry::Stat::kI2cBusRecoveries, recoveries);
+  telemetry::set(telemetry::Stat::kI2cOutages, outages);
+  telemetry::set(telemetry::Stat::kI2cOutageMs, outageMs);
+  telemetry::set(telemetry::Stat::kI2cLongestOutageMs, longest);
+  telemetry::set(telemetry::Stat::kI2cMaxReadUs, maxUs);
 }
-static bool max30205_readTemp(float &c) {
-  if (!max30205_ok) return false;
-  uint8_t buf[2];
-  if (i2c_readN(MAX30205_ADDR, 0x00, buf, 2) != 2) return false;
-  int16_t raw = (int16_t)((buf[0] << 8) | buf[1]);
-  c = raw / 256.0f;
-  return true;
+
+// Report one read and run whatever recovery the monitor asks for
+static void reportI2c(i2c_health::Device dev, bool ok, uint32_t latencyUs) {
+  const i2c_health::Action action = g_i2cHealth.report(dev, ok, latencyUs, millis());
+  if (action == i2c_health::Action::kNone) return;
+  if (action == i2c_health::Action::kRecoverBus) {
+    (void)i2c_bus_recover();
+  }
+  switch (dev) {
+    case i2c_health::Device::kImu:  reinitImu(); break;
+    case i2c_health::Device::kPpg:  reinitPpg(); break;
+    case i2c_health::Device::kTemp: reinitTemp(); break;
+    default: break;
+  }
+  publishI2cHealth();
+  BINLOG("[I2C] dev=%u action=%u streak=%u", (unsigned)dev, (unsigned)action,
+         g_i2cHealth.stats(dev).consecutive_failures);
 }
 
 // --- Timer handles ---
@@ -156,53 +229,82 @@ static TaskHandle_t g_sensorTaskHandle = nullptr;
 
 // --- ISR flags ---
 static const uint32_t EVT_TICK = (1 << 0);
-
-// --- Accumulators for 1s window ---
-static uint32_t imuCount = 0; static double axSum=0, aySum=0, azSum=0, gxSum=0, gySum=0, gzSum=0, imuTempSumF=0;
-static uint32_t ppgCount = 0; static double redSum=0, irSum=0;
-static uint32_t tempCount = 0; static double bodyTempCSum=0, bodyTempFSum=0;
-
-// --- Ring buffer target ---
-static reg_buffer::SampleRingBuffer* g_targetBuffer = nullptr;
+static const uint32_t EVT_IMU_INT = (1 << 1);
+
+// --- Tick accounting and sampling jitter ---
+// The ISR counts ticks so merged notifications don't lose time.
+static volatile uint32_t g_tickCount = 0;
+static tick_schedule::Schedule g_schedule;
+static interval_stats::Histogram g_ppgIntervals(10000 * PPG_DRAIN_TICKS);  // FIFO drains
+static interval_stats::Histogram g_imuIntervals(20000);     // 50 Hz base period
+static interval_stats::Histogram g_tempIntervals(1000000);  // 1 Hz
+static constexpr uint32_t kTimingWindowS = 60;              // stats cover the last minute
+static uint32_t g_timingWindowSeconds = 0;
+static uptime::Clock64 g_uptime;  // sample timestamps before the first time sync
+
+static void publishTiming() {
+  telemetry::set(telemetry::Stat::kPpgIntervalMinUs, g_ppgIntervals.min_us());
+  telemetry::set(telemetry::Stat::kPpgIntervalMaxUs, g_ppgIntervals.max_us());
+  telemetry::set(telemetry::Stat::kPpgIntervalP99Us, g_ppgIntervals.percentile_us(99));
+  telemetry::set(telemetry::Stat::kPpgMissed, g_ppgIntervals.missed());
+  telemetry::set(telemetry::Stat::kImuIntervalMinUs, g_imuIntervals.min_us());
+  telemetry::set(telemetry::Stat::kImuIntervalMaxUs, g_imuIntervals.max_us());
+  telemetry::set(telemetry::Stat::kImuIntervalP99Us, g_imuIntervals.percentile_us(99));
+  telemetry::set(telemetry::Stat::kImuMissed, g_imuIntervals.missed());
+  telemetry::set(telemetry::Stat::kTempIntervalMaxUs, g_tempIntervals.max_us());
+  telemetry::set(telemetry::Stat::kTempMissed, g_tempIntervals.missed());
+  telemetry::set(telemetry::Stat::kTicksMerged, g_schedule.merged_ticks());
+  telemetry::set(telemetry::Stat::kImuDecimation, g_pipeline.decimation().factor());
+  telemetry::set(telemetry::Stat::kImuReadsFolded, g_pipeline.decimation().folded());
+  telemetry::set(telemetry::Stat::kChannelDrops, g_pipeline.channel_drops());
+  if (++g_timingWindowSeconds >= kTimingWindowS) {
+    g_timingWindowSeconds = 0;
+    g_ppgIntervals.reset();
+    g_imuIntervals.reset();
+    g_tempIntervals.reset();
+  }
+}
 
 // --- Heart rate estimation state ---
-static void updateHeartRate(long irValue) {
-  if (checkForBeat(irValue) == true) {
-    //We sensed a beat!
-    long delta = millis() - lastBeat;
-    lastBeat = millis();
-
-    beatsPerMinute = 60 / (delta / 1000.0);
-
-    if (beatsPerMinute < 255 && beatsPerMinute > 20) {
-      // Push raw BPM to median buffer first
-      pushHrValue((int)beatsPerMinute);
-      
-      // Only update average once every 4 raw samples (when median buffer wraps)
-      if (hrBufferIdx == 0) {
-        // Get median of last 4 raw BPMs
-        int medianBpm = getMedianHr();
-
-        // Add median to average buffer
-        rates[rateSpot++] = (byte)medianBpm; 
-        rateSpot %= RATE_SIZE; 
-
-        //Take average of readings
-        beatAvg = 0;
-        for (byte x = 0; x < RATE_SIZE; x++)
-          beatAvg += rates[x];
-        beatAvg /= RATE_SIZE;
-      }
+// One beat interval from the sample clock
+static void updateHeartRate(uint32_t beatIntervalUs) {
+  beatsPerMinute = 60e6 / beatIntervalUs;
+
+  if (beatsPerMinute < 255 && beatsPerMinute > 20) {
+    // Push raw BPM to median buffer first
+    pushHrValue((int)beatsPerMinute);
+    
+    // Only update average once every 4 raw samples (when median buffer wraps)
+    if (hrBufferIdx == 0) {
+      // Get median of last 4 raw BPMs
+      int medianBpm = getMedianHr();
+
+      // Add median to average buffer
+      rates[rateSpot++] = (byte)medianBpm; 
+      rateSpot %= RATE_SIZE; 
+
+      //Take average of readings
+      beatAvg = 0;
+      for (byte x = 0; x < RATE_SIZE; x++)
+        beatAvg += rates[x];
+      beatAvg /= RATE_SIZE;
     }
   }
 }
 
 void IRAM_ATTR onTickTimer() { 
   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  g_tickCount = g_tickCount + 1;
   if (g_sensorTaskHandle) xTaskNotifyFromISR(g_sensorTaskHandle, EVT_TICK, eSetBits, &xHigherPriorityTaskWoken);
   if (xHigherPriorityTaskWoken) portYIELD_FROM_ISR();
 }
 
+void IRAM_ATTR onImuInt() {
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  if (g_sensorTaskHandle) xTaskNotifyFromISR(g_sensorTaskHandle, EVT_IMU_INT, eSetBits, &xHigherPriorityTaskWoken);
+  if (xHigherPriorityTaskWoken) portYIELD_FROM_ISR();
+}
+
 static hw_timer_t* setupTimer(uint8_t id, uint16_t divider, uint64_t periodUs, void (*isr)()) {
   hw_timer_t* t = timerBegin(id, divider, true);
   timerAttachInterrupt(t, isr, true);
@@ -213,27 +315,47 @@ static hw_timer_t* setupTimer(uint8_t id, uint16_t divider, uint64_t periodUs, v
 
 static void sensorsTask(void* arg);
 
-void sensors_setup(reg_buffer::SampleRingBuffer* buffer) {
-  g_targetBuffer = buffer;
+void sensors_setup(reg_buffer::SampleRingBuffer* buffer, reg_buffer::ChannelRing* hr, reg_buffer::ChannelRing* temp,
+                   reg_buffer::ChannelRing* wear) {
+  g_pipeline.set_ring(buffer);
+  g_pipeline.set_channels(hr, temp, wear);
+  g_pipeline.set_overflow({sample_spill::divert, sample_spill::add});
   // Serial.begin(115200);
   // delay(500);
   // Serial.println("\nTimed sensor sampling demo (Phase 2 - Optimized)");
-  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
-  Wire.setClock(I2C_CLOCK_HZ); // full speed for sensor throughput; adjust if bus stability issues
+  if (digitalRead(I2C_SDA_PIN) == LOW) (void)i2c_bus_recover(); // wedged across a reset
+  i2c_setup(); // full speed for sensor throughput; adjust if bus stability issues
   delay(10);
-  (void)bmi270_begin();
-  (void)max30102_begin();
-  (void)max30205_begin();
+  g_imuPresent = g_imu.begin();
+  g_ppgPresent = g_ppg.begin();
+  g_tempPresent = g_temp.begin();
+  // The BMI270 feature setup uses the bus without a lock, so it has to finish
+  // before the tick timer and the sensor task start reading
+  g_hwStepsOk = bmi270_enableStepCounter();
+
+#if BMI270_INT_PIN >= 0
+  g_motionIntOk = bmi270_configMotionInt();
+  if (g_motionIntOk) {
+    pinMode(BMI270_INT_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(BMI270_INT_PIN), onImuInt, RISING);  // no-op until the task exists
+  }
+#endif
+
   // Configure timers: APB 80MHz / divider 80 = 1MHz tick
   // Target 100 Hz = 10000 us
   tTick = setupTimer(0, 80, 10000, onTickTimer);   // 100 Hz base tick
   
-  xTaskCreatePinnedToCore(sensorsTask, "Sensors", 4096, NULL, 2, &g_sensorTaskHandle, 1);
+  xTaskCreatePinnedToCore(sensorsTask, "Sensors", SENSORS_TASK_STACK_BYTES, NULL, 2, &g_sensorTaskHandle, 1);
 }
 
-static float lastBodyTempC = 0.0f;
 static volatile int g_cachedMedianHr = 0;
 
+// --- Off-wrist state ---
+static wear_detect::Detector g_wear;
+static wear_detect::StillnessMeter g_stillness;
+static volatile bool g_offWrist = false;
+static bool g_lastWindowMoving = false;
+
 static int getMedianHr(); // Forward decl
 
 static void pushHrValue(int val) {
@@ -259,116 +381,197 @@ static int getMedianHr() {
     return median;
 }
 
-static void sampleImu() {
-  ImuSample s = bmi270_read();
-  if (!s.ok) return;
-  
-  // Push raw sample to ring buffer immediately
-  if (g_targetBuffer) {
-    reg_buffer::Sample rs{};
-    rs.ax = (reg_buffer::float16)s.ax;
-    rs.ay = (reg_buffer::float16)s.ay;
-    rs.az = (reg_buffer::float16)s.az;
-    rs.gx = (reg_buffer::float16)s.gx;
-    rs.gy = (reg_buffer::float16)s.gy;
-    rs.gz = (reg_buffer::float16)s.gz;
-    rs.hr_bpm = (reg_buffer::float16)g_cachedMedianHr;
-    rs.temp_c = (reg_buffer::float16)lastBodyTempC;
-    
-    const time_t t_now = time(nullptr);
-    if (t_now > 1000000000) {
-        rs.timestamp = (uint32_t)t_now;
-    } else {
-        rs.timestamp = (uint32_t)(millis() / 1000);
-    }
-    
-    if (!g_targetBuffer->push(rs)) {
-      // Serial.println("Ring buffer full; sample dropped");
-    }
-  }
-
-  axSum += s.ax; aySum += s.ay; azSum += s.az;
-  gxSum += s.gx; gySum += s.gy; gzSum += s.gz;
-  if (!isnan(s.tempC)) imuTempSumF += (s.tempC * 1.8 + 32.0);
-  imuCount++;
+// `stride`: base IMU periods this reading stands for (see motion_gate)
+static bool sampleImu(uint8_t stride) {
+  const uint32_t timestamp = uptime::sample_timestamp(time(nullptr), g_uptime.ms());
+  g_pipeline.set_hr((float)g_cachedMedianHr, timestamp);  // pushed only when it changed
+  g_pipeline.set_off_wrist(g_offWrist, timestamp);        // likewise
+  sensor_driver::ImuReading r;
+  const bool ok = g_pipeline.sample_imu(stride, timestamp, &r);
+  const sensor_driver::Health& health = g_imu.health();
+  if (g_imuPresent) reportI2c(i2c_health::Device::kImu, ok, health.last_latency_us);
+  if (!ok) return false;
+  // planned rate; a late read is a miss
+  g_imuIntervals.record(micros() - health.last_latency_us, g_motionGate.stride());
+  g_stillness.add(r.ax, r.ay, r.az);
+  return true;
 }
 
-static void samplePpg() {
-  particleSensor.check(); // Check the sensor, read up to 4 samples
+// FIFO checks and samples since the last PPG health report
+static uint32_t g_ppgChecksInSpan = 0;
+static uint32_t g_ppgSamplesInSpan = 0;
+static uint32_t g_ppgMaxLatencyUs = 0;
 
-  while (particleSensor.available()) {
-    uint32_t ir = particleSensor.getFIFOIR();
-    uint32_t red = particleSensor.getFIFORed();
-    
-    redSum += red; 
-    irSum += ir; 
-    ppgCount++;
-    
-    updateHeartRate(ir); // updates beatAvg internally
-    
-    particleSensor.nextSample(); // Move to next sample
+static void samplePpg() {
+  g_ppgChecksInSpan++;
+  const uint32_t readUs = micros();
+  g_ppgIntervals.record(readUs);
+  g_beatClock.begin_drain(readUs);
+  g_ppgSamplesInSpan += g_pipeline.sample_ppg([](const sensor_driver::PpgReading& r) {
+    g_beatClock.sample(checkForBeat(r.ir));
+  });
+  const size_t beats = g_beatClock.end_drain();
+  for (size_t i = 0; i < beats; ++i) {
+    if (g_beatClock.interval_us(i)) updateHeartRate(g_beatClock.interval_us(i)); // updates beatAvg internally
   }
+  const uint32_t latency = g_ppg.health().last_latency_us;
+  if (latency > g_ppgMaxLatencyUs) g_ppgMaxLatencyUs = latency;
 }
 
 static void sampleTemp() {
-  float c; if (!max30205_readTemp(c)) return; 
-  lastBodyTempC = c;
-  bodyTempCSum += c; bodyTempFSum += (c * 9.0/5.0 + 32.0); tempCount++; 
+  const uint32_t start = micros();
+  const bool ok = g_pipeline.sample_temp(uptime::sample_timestamp(time(nullptr), g_uptime.ms()));
+  if (g_tempPresent) reportI2c(i2c_health::Device::kTemp, ok, g_temp.health().last_latency_us);
+  if (!ok) return;
+  g_tempIntervals.record(start);
+}
+
+// --- Off-wrist detection ---
+// While off-wrist the MAX30102 and MAX30205 stay shut down; every few seconds
+// (sooner on motion) the MAX30102 is woken for a short IR probe.
+static constexpr uint8_t kProbeTicks = 5;  // ~50 ms of IR samples per probe
+static uint8_t g_probeTicksLeft = 0;
+static uint32_t g_probeIrSum = 0;
+static uint32_t g_probeCount = 0;
+static uint32_t g_offWristSinceMs = 0;
+
+static uint32_t normalisedIr(uint32_t ir) {
+  const ppg_agc::Settings& agc = g_ppgAgc.settings();
+  return wear_detect::normalise_ir(ir, agc.led_amplitude, agc.pulse_width_us());
+}
+
+static void enterOffWrist() {
+  (void)g_ppg.power_mode(sensor_driver::PowerMode::kOff);
+  (void)g_temp.power_mode(sensor_driver::PowerMode::kOff);
+  g_cachedMedianHr = 0;
+  g_offWristSinceMs = millis();
+  g_wear.mark_off(g_offWristSinceMs);
+  g_offWrist = true;
+  telemetry::add(telemetry::Stat::kOffWristEvents, 1);
+  BINLOG("[WEAR] Off-wrist, PPG/temp suspended");
+}
+
+static void resumeOnWrist() {
+  (void)g_temp.power_mode(sensor_driver::PowerMode::kNormal);
+  g_beatClock.reset(); // don't measure a beat interval across the gap
+  telemetry::add(telemetry::Stat::kOffWristSeconds, (millis() - g_offWristSinceMs) / 1000);
+  g_offWrist = false;
+  BINLOG("[WEAR] Back on wrist");
+}
+
+static void startProbe() {
+  (void)g_ppg.power_mode(sensor_driver::PowerMode::kNormal);
+  g_ppg.clear_fifo();
+  g_probeIrSum = 0;
+  g_probeCount = 0;
+  g_probeTicksLeft = kProbeTicks;
+}
+
+static void serviceProbe() {
+  sensor_driver::PpgReading batch[8];
+  size_t n;
+  while ((n = g_ppg.read_batch(sensor_driver::Span<sensor_driver::PpgReading>(batch))) > 0) {
+    for (size_t i = 0; i < n; ++i) g_probeIrSum += batch[i].ir;
+    g_probeCount += n;
+    if (n < 8) break;
+  }
+  if (--g_probeTicksLeft > 0) return;
+
+  const uint32_t ir = g_probeCount ? g_probeIrSum / g_probeCount : 0;
+  if (g_wear.probe(normalisedIr(ir), millis()) == wear_detect::State::kOnWrist) {
+    resumeOnWrist();
+  } else {
+    (void)g_ppg.power_mode(sensor_driver::PowerMode::kOff);
+  }
 }
 
 static void sensorsTask(void* arg) {
   uint32_t events;
-  uint32_t localTick = 0;
 
   while(true) {
     // Wait for notification bits
     xTaskNotifyWait(0, ULONG_MAX, &events, portMAX_DELAY);
+    telemetry::add(telemetry::Stat::kWakeups, 1);
+
+    if (events & EVT_IMU_INT) {
+      uint16_t status = 0;
+      if (g_imu.device().getInterruptStatus(&status) == BMI2_OK &&
+          g_motionGate.on_interrupt(status & BMI270_ANY_MOT_STATUS_MASK,
+                                    status & BMI270_NO_MOT_STATUS_MASK)) {
+        bmi270_applyMotionMode(g_motionGate.mode());
+      }
+    }
 
     if (events & EVT_TICK) {
-      // 1. PPG (100Hz) - Every tick
-      samplePpg();
+      g_uptime.update(millis());
+      const tick_schedule::Span span = g_schedule.advance(g_tickCount);
+      if (span.count == 0) continue;
+      // 1. PPG (100Hz) - FIFO drained every PPG_DRAIN_TICKS, or a proximity probe while off-wrist
+      if (!g_offWrist) {
+        if (span.hits(PPG_DRAIN_TICKS) &&
+            (!g_ppgPresent || g_i2cHealth.should_read(i2c_health::Device::kPpg, millis()))) samplePpg();
+        // The FIFO fills at 100 Hz, so a 100 ms span of checks with no samples is a failed read
+        if (g_ppgPresent && span.hits(10, 9) && g_ppgChecksInSpan) {
+          reportI2c(i2c_health::Device::kPpg, g_ppgSamplesInSpan > 0, g_ppgMaxLatencyUs);
+          g_ppgChecksInSpan = 0;
+          g_ppgSamplesInSpan = 0;
+          g_ppgMaxLatencyUs = 0;
+        }
+      } else if (g_probeTicksLeft) {
+        serviceProbe();
+      } else if (g_ppg.present() && g_wear.probe_due(millis(), g_lastWindowMoving)) {
+        startProbe();
+      }
 
-      // 2. IMU (50Hz) - Every 2 ticks
-      if (localTick % 2 == 0) {
-        sampleImu();
+      // 2. IMU (50Hz) - Every 2 ticks, every 16 while the BMI270 reports no motion.
+      // A late wake-up covers several periods; one read stands for all of them.
+      if (const uint32_t imuPeriods = span.hits(2)) {
+        uint32_t covered = 0;
+        for (uint32_t i = 0; i < imuPeriods; ++i) covered += g_motionGate.tick();
+        const uint8_t stride = covered > reg_buffer::kStridePeriods ? reg_buffer::kStridePeriods : (uint8_t)covered;
+        // While the IMU is down the skipped periods are a gap, not carried
+        if (stride && (!g_imuPresent || g_i2cHealth.should_read(i2c_health::Device::kImu, millis()))) {
+          if (!sampleImu(stride)) g_motionGate.carry(stride);
+        }
       }
 
       // 3. Temp (1Hz) - Every 100 ticks
-      if (localTick % 100 == 0) {
-        sampleTemp();
+      if (span.hits(100)) {
+        if (!g_offWrist && (!g_tempPresent || g_i2cHealth.should_read(i2c_health::Device::kTemp, millis()))) {
+          sampleTemp();
+        }
         
-        // Compute averages (triggered by 1Hz temp timer)
-        double axAvg = imuCount ? axSum / imuCount : NAN;
-        double ayAvg = imuCount ? aySum / imuCount : NAN;
-        double azAvg = imuCount ? azSum / imuCount : NAN;
-        double gxAvg = imuCount ? gxSum / imuCount : NAN;
-        double gyAvg = imuCount ? gySum / imuCount : NAN;
-        double gzAvg = imuCount ? gzSum / imuCount : NAN;
-        double imuTempFAvg = (imuCount && imuTempSumF>0) ? imuTempSumF / imuCount : NAN;
-        double redAvg = ppgCount ? redSum / ppgCount : NAN;
-        double irAvg  = ppgCount ? irSum  / ppgCount : NAN;
-      double bodyTCAvg = tempCount ? bodyTempCSum / tempCount : NAN;
-      double bodyTFAvg = tempCount ? bodyTempFSum / tempCount : NAN;
-
-      // Serial.printf("1s AVG IMU at sample rate %uHz (target 50) a[g]=[% .3f % .3f % .3f] g[dps]=[% .2f % .2f % .2f]", imuCount, axAvg, ayAvg, azAvg, gxAvg, gyAvg, gzAvg);
-      // if (!isnan(imuTempFAvg)) Serial.printf(" imuT=%.1fF", imuTempFAvg);
+        // Averages over the window (triggered by 1Hz temp timer)
+        const acquisition::WindowAverages avg = g_pipeline.finish_window();
+        const double irAvg = avg.ir;
+
+        bmi270_pollStepCounter();
+        publishTiming();
+
+        const bool still = g_stillness.finish_window();
+        g_lastWindowMoving = !still;
+        if (!g_offWrist && g_ppg.present() && !isnan(irAvg)) {
+          // Normalise against the settings that produced irAvg, before AGC moves them
+          if (g_wear.update(normalisedIr((uint32_t)irAvg), still, 1000) == wear_detect::State::kOffWrist) {
+            enterOffWrist();
+          } else {
+            updatePpgAgc(irAvg, 1000);
+          }
+        }
+
+      // Serial.printf("1s AVG IMU at sample rate %uHz (target 50) a[g]=[% .3f % .3f % .3f] g[dps]=[% .2f % .2f % .2f]", avg.imu_count, avg.ax, avg.ay, avg.az, avg.gx, avg.gy, avg.gz);
+      // if (!isnan(avg.imu_temp_f)) Serial.printf(" imuT=%.1fF", avg.imu_temp_f);
       // Serial.print("\n");
-      //   Serial.printf("1s AVG PPG at sample rate %uHz (target 100) RED=%.0f IR=%.0f\n", ppgCount, redAvg, irAvg);
+      //   Serial.printf("1s AVG PPG at sample rate %uHz (target 100) RED=%.0f IR=%.0f\n", avg.ppg_count, avg.red, avg.ir);
       //   Serial.printf("HR=%d BPM (Avg)\n", beatAvg);
       //   Serial.printf("HR=%.1f BPM (Recent)\n", beatsPerMinute);
-      //   if (!isnan(bodyTCAvg)) {
-      //     Serial.printf("1s AVG BodyTemp at sample rate %uHz: %.2fC (%.2fF)\n", tempCount, bodyTCAvg, bodyTFAvg);
+      //   if (!isnan(avg.body_c)) {
+      //     Serial.printf("1s AVG BodyTemp at sample rate %uHz: %.2fC (%.2fF)\n", avg.temp_count, avg.body_c, avg.body_f);
       //   } else {
       //     Serial.println("1s AVG BodyTemp: no samples");
       //   }
       //   Serial.println("---");
-        // Reset accumulators for next window
-        axSum=aySum=azSum=gxSum=gySum=gzSum=imuTempSumF=0; imuCount=0;
-        redSum=irSum=0; ppgCount=0;
-        bodyTempCSum=bodyTempFSum=0; tempCount=0;
       }
-      
-      localTick++;
     }
   }
 }
@@ -376,3 +579,13 @@ static void sensorsTask(void* arg) {
 void sensors_loop() {
   // Empty - logic moved to sensorsTask
 }
+
+TaskHandle_t sensors_task_handle() {
+  return g_sensorTaskHandle;
+}
+
+bool sensors_hw_step_total(uint32_t& total) {
+  if (!g_hwStepsOk) return false;
+  total = g_hwStepTotal;
+  return true;
+}
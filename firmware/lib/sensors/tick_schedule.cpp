@@ -0,0 +1,25 @@
+#include "tick_schedule.h"
+
+namespace tick_schedule {
+
+namespace {
+    // Ticks t < x with t % every == phase
+    uint32_t hits_below(uint32_t x, uint32_t every, uint32_t phase) {
+        return x > phase ? (x - phase - 1) / every + 1 : 0;
+    }
+}
+
+uint32_t Span::hits(uint32_t every, uint32_t phase) const {
+    if (every == 0) return 0;
+    phase %= every;
+    return hits_below(first + count, every, phase) - hits_below(first, every, phase);
+}
+
+Span Schedule::advance(uint32_t tick_count) {
+    Span span{seen_, tick_count - seen_};
+    if (span.count > 1) merged_ += span.count - 1;
+    seen_ = tick_count;
+    return span;
+}
+
+}  // namespace tick_schedule
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// Dispatch of the sensor task's 100 Hz base tick. The timer ISR counts ticks
+// and notifies the task; because task notifications merge, a task that was
+// held off (flash write, BLE burst) can wake once for several ticks. The
+// schedule hands back the whole span so rates stay exact: periodic work is
+// due if its tick fell anywhere in the span, and the IMU is told how many of
+// its periods elapsed.
+namespace tick_schedule {
+
+struct Span {
+    uint32_t first;  // first tick number covered
+    uint32_t count;  // ticks covered (> 1 when notifications merged)
+
+    // Ticks in the span with tick % every == phase
+    uint32_t hits(uint32_t every, uint32_t phase = 0) const;
+};
+
+class Schedule {
+public:
+    // `tick_count` is the ISR's running tick counter.
+    Span advance(uint32_t tick_count);
+
+    uint32_t ticks() const { return seen_; }
+    uint32_t merged_ticks() const { return merged_; }  // ticks that arrived with another one
+
+private:
+    uint32_t seen_ = 0;
+    uint32_t merged_ = 0;
+};
+
+}  // namespace tick_schedule
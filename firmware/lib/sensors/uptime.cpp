@@ -0,0 +1,20 @@
+#include "uptime.h"
+
+namespace uptime {
+
+namespace {
+constexpr time_t kSyncedEpoch = 1000000000;  // anything earlier means the RTC was never set
+}
+
+uint64_t Clock64::update(uint32_t now_ms) {
+    if (now_ms < last_ms_) ++wraps_;
+    last_ms_ = now_ms;
+    return ms();
+}
+
+uint32_t sample_timestamp(time_t wall, uint64_t uptime_ms) {
+    if (wall > kSyncedEpoch) return static_cast<uint32_t>(wall);
+    return static_cast<uint32_t>(uptime_ms / 1000);
+}
+
+}  // namespace uptime
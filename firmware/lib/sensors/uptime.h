@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+// 64-bit uptime from the 32-bit millis() counter, which wraps every ~49.7
+// days. update() must see every wrap, so call it at least once per wrap
+// period and from a single task (the sensor task calls it every tick).
+namespace uptime {
+
+class Clock64 {
+public:
+    uint64_t update(uint32_t now_ms);
+    uint64_t ms() const { return (static_cast<uint64_t>(wraps_) << 32) | last_ms_; }
+
+private:
+    uint32_t last_ms_ = 0;
+    uint32_t wraps_ = 0;
+};
+
+// Sample timestamp: wall-clock epoch once the time has been synced, otherwise
+// seconds since boot (still monotonic across millis() wraps)
+uint32_t sample_timestamp(time_t wall, uint64_t uptime_ms);
+
+}  // namespace uptime
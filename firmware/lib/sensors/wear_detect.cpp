@@ -0,0 +1,70 @@
+#include "wear_detect.h"
+
+#include <cmath>
+
+namespace wear_detect {
+
+namespace {
+    constexpr uint32_t kReferenceLight = 0x1F * 411;
+}
+
+void StillnessMeter::add(float ax, float ay, float az) {
+    const double m = std::sqrt(static_cast<double>(ax) * ax + static_cast<double>(ay) * ay +
+                               static_cast<double>(az) * az);
+    sum_ += m;
+    sum_sq_ += m * m;
+    ++count_;
+}
+
+bool StillnessMeter::finish_window(float threshold_g) {
+    bool still = false;
+    if (count_ > 1) {
+        const double mean = sum_ / count_;
+        const double var = sum_sq_ / count_ - mean * mean;
+        still = var < static_cast<double>(threshold_g) * threshold_g;
+    }
+    sum_ = sum_sq_ = 0.0;
+    count_ = 0;
+    return still;
+}
+
+State Detector::update(uint32_t ir_norm, bool still, uint32_t elapsed_ms) {
+    if (state_ == State::kOffWrist) return state_;
+
+    if (ir_norm < config_.off_ir_threshold) {
+        low_ms_ += elapsed_ms;
+        low_still_ms_ = still ? low_still_ms_ + elapsed_ms : 0;
+    } else {
+        low_ms_ = 0;
+        low_still_ms_ = 0;
+    }
+
+    if (low_still_ms_ >= config_.off_confirm_ms || low_ms_ >= config_.off_without_stillness_ms) {
+        state_ = State::kOffWrist;
+        low_ms_ = 0;
+        low_still_ms_ = 0;
+    }
+    return state_;
+}
+
+bool Detector::probe_due(uint32_t now_ms, bool moving) const {
+    if (state_ != State::kOffWrist) return false;
+    const uint32_t since = now_ms - last_probe_ms_;
+    return since >= config_.probe_interval_ms || (moving && since >= config_.min_probe_gap_ms);
+}
+
+State Detector::probe(uint32_t ir_norm, uint32_t now_ms) {
+    last_probe_ms_ = now_ms;
+    if (ir_norm >= config_.on_ir_threshold) {
+        state_ = State::kOnWrist;
+    }
+    return state_;
+}
+
+uint32_t normalise_ir(uint32_t ir_dc, uint8_t amplitude, uint16_t pulse_width_us) {
+    const uint32_t light = static_cast<uint32_t>(amplitude) * pulse_width_us;
+    if (light == 0) return 0;
+    return static_cast<uint32_t>(static_cast<uint64_t>(ir_dc) * kReferenceLight / light);
+}
+
+}  // namespace wear_detect
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+// Off-wrist detection from the MAX30102 IR level and IMU stillness.
+// While worn, the sensor task feeds one update per second. Once off-wrist the
+// PPG and temperature sensors are powered down and the detector asks for a
+// short IR probe every `probe_interval_ms` (or immediately on motion); a probe
+// that sees skin again switches straight back to on-wrist.
+namespace wear_detect {
+
+enum class State : uint8_t { kOnWrist, kOffWrist };
+
+struct Config {
+    // IR DC thresholds, normalised to the 0x1F @ 411 us LED setting so AGC
+    // changes do not move them. Skin sits well above 50k; air/desk well below.
+    uint32_t off_ir_threshold = 25000;
+    uint32_t on_ir_threshold = 40000;      // hysteresis for the probe
+    uint32_t off_confirm_ms = 5000;        // low IR + still this long -> off
+    uint32_t off_without_stillness_ms = 30000;  // low IR alone this long -> off
+    uint32_t probe_interval_ms = 2000;     // bounds resume latency while off
+    uint32_t min_probe_gap_ms = 500;       // rate limit for motion-triggered probes
+};
+
+// Accelerometer magnitude variance over a window.
+class StillnessMeter {
+public:
+    void add(float ax, float ay, float az);
+    // True when the window's magnitude stddev is below `threshold_g`. Resets the window.
+    bool finish_window(float threshold_g = 0.01f);
+
+private:
+    double sum_ = 0.0;
+    double sum_sq_ = 0.0;
+    uint32_t count_ = 0;
+};
+
+class Detector {
+public:
+    explicit Detector(const Config& config = Config()) : config_(config) {}
+
+    // Periodic update while on-wrist. `ir_norm` is the normalised IR DC over
+    // the last `elapsed_ms`; `still` comes from StillnessMeter.
+    State update(uint32_t ir_norm, bool still, uint32_t elapsed_ms);
+
+    // While off-wrist: true when a proximity probe should run now.
+    bool probe_due(uint32_t now_ms, bool moving) const;
+
+    // Result of a proximity probe taken at `now_ms`.
+    State probe(uint32_t ir_norm, uint32_t now_ms);
+
+    // Record when the device went off-wrist (start of the probe schedule).
+    void mark_off(uint32_t now_ms) { last_probe_ms_ = now_ms; }
+
+    State state() const { return state_; }
+    bool off_wrist() const { return state_ == State::kOffWrist; }
+
+private:
+    Config config_;
+    State state_ = State::kOnWrist;
+    uint32_t low_ms_ = 0;        // consecutive time with low IR
+    uint32_t low_still_ms_ = 0;  // consecutive time with low IR and no motion
+    uint32_t last_probe_ms_ = 0;
+};
+
+// Scale an IR DC reading taken at `amplitude`/`pulse_width_us` to the
+// reference LED setting used by the thresholds.
+uint32_t normalise_ir(uint32_t ir_dc, uint8_t amplitude, uint16_t pulse_width_us);
+
+}  // namespace wear_detect
@@ -1,9 +1,10 @@
 #include "fs_store.h"
-#include <Arduino.h>
 #include <LittleFS.h>
 #include <ctime>
 
 #include "app_config.h"
+#include "telemetry/binlog.h"
+#include "telemetry/telemetry.h"
 
 
 
@@ -13,6 +14,8 @@ const char* partition_name = "littlefs";
 static constexpr const char* kDataFilePath = kFsDataPath;
 // Partition base address (flash offset) as defined in partitions_3m_fs.csv
 static const size_t PARTITION_BASE_ADDR = 0x200000;
+// LittleFS block (flash sector) size
+static constexpr size_t kBlockSize = 4096;
 
 bool begin(bool formatOnFail) {
   
@@ -37,14 +40,34 @@ bool begin(bool formatOnFail) {
 
 }
 
+// A short write (partition full, failed commit) leaves a partial record at
+// the end. record_count() and for_each_record() stop before it, and the next
+// append writes over it from the last whole-record boundary, so later
+// records stay aligned without copying or truncating the file.
 bool append(const consolidate::ConsolidatedRecord& record){
-  File fp = LittleFS.open(kDataFilePath, "a");
+  File fp = LittleFS.open(kDataFilePath, "r+");
+  if (!fp) fp = LittleFS.open(kDataFilePath, "w");  // erased since begin()
   if (!fp) return false;
+  const size_t bytes = fp.size();
+  const size_t before = bytes - bytes % sizeof(record);
+  if (!fp.seek(before)) {
+    fp.close();
+    return false;
+  }
   size_t written = fp.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record));
   fp.close();
+  count_flash_write(before, written);
   return written == sizeof(record);
 }
 
+void count_flash_write(size_t offset, size_t written) {
+  // Data bytes only; metadata commits are in the model's per-byte cost
+  telemetry::add(telemetry::Stat::kFlashBytesWritten, written);
+  if (written == 0) return;
+  const size_t blocks = (offset + written - 1) / kBlockSize - offset / kBlockSize + 1;
+  telemetry::add(telemetry::Stat::kFlashBytesErased, blocks * kBlockSize);
+}
+
 // print data in filesystem
 void printData() {
   File fp = LittleFS.open(kDataFilePath, "r");
@@ -107,29 +130,50 @@ bool erase() {
   return true; // File doesn't exist, consider it "erased"
 } 
 
+size_t pre_erase(size_t pool, size_t max_erases) {
+#ifdef LITTLEFS_HAS_PRE_ERASE
+  const size_t erased = LittleFS.preErase(pool, max_erases);
+  telemetry::add(telemetry::Stat::kStorePreErased, erased);
+  return erased;
+#else
+  (void)pool;
+  (void)max_erases;
+  return 0;
+#endif
+}
+
 size_t record_count() {
   const size_t file_size = size();
   return file_size / sizeof(consolidate::ConsolidatedRecord);
 }
 
 void for_each_record(const std::function<bool(const consolidate::ConsolidatedRecord&, size_t)>& callback) {
+  for_each_record_from(0, callback);
+}
+
+void for_each_record_from(size_t first,
+                          const std::function<bool(const consolidate::ConsolidatedRecord&, size_t)>& callback) {
   if (!callback) {
     return;
   }
 
   File fp = LittleFS.open(kDataFilePath, "r");
   if (!fp) {
-    // Serial.println("[FS_STORE] Failed to open data file for iteration");
+    BINLOG("[FS_STORE] Failed to open data file for iteration");
     return;
   }
 
-  size_t index = 0;
+  size_t index = first;
+  if (first > 0 && !fp.seek(first * sizeof(consolidate::ConsolidatedRecord))) {
+    fp.close();
+    return;
+  }
   while (fp.available()) {
     consolidate::ConsolidatedRecord record{};
     size_t read_bytes = fp.read(reinterpret_cast<uint8_t*>(&record), sizeof(record));
     
     if (read_bytes != sizeof(record)) {
-      // Serial.printf("[FS_STORE] Incomplete record at index %u\n", static_cast<unsigned>(index));
+      BINLOG("[FS_STORE] Incomplete record at index %u", static_cast<unsigned>(index));
       break;
     }
 
@@ -21,10 +21,28 @@ bool append(const consolidate::ConsolidatedRecord& record);  // Append binary da
 
 // Iterate through all records with a callback.
 void for_each_record(const std::function<bool(const consolidate::ConsolidatedRecord&, size_t)>& callback);
+// Same from record `first` on (seeks past the ones before it); the callback
+// still gets absolute indices.
+void for_each_record_from(size_t first,
+                          const std::function<bool(const consolidate::ConsolidatedRecord&, size_t)>& callback);
 
 void printData();  // print data stored in filesystem
 
+// Energy telemetry for `written` bytes written at `offset` of a file just
+// opened (kFlashBytesWritten / kFlashBytesErased). LittleFS does not append
+// in place after a reopen: it copies the partly filled block at `offset`
+// into a freshly erased one, so every block the write touches costs an
+// erase, at least one per write.
+void count_flash_write(size_t offset, size_t written);
+
 bool erase(); // Remove the consolidated file.
 
+// Erase free sectors ahead of the filesystem's allocator while idle, so the
+// next appends skip the ~45 ms inline sector erase. Keeps up to `pool`
+// sectors ahead erased, doing at most `max_erases` erases per call. Returns
+// the erases done; always 0 with a LittleFS driver that has no pre-erase
+// hook (the stock esp_littlefs keeps its lfs_t private).
+size_t pre_erase(size_t pool, size_t max_erases);
+
 
 }  // namespace fs_store
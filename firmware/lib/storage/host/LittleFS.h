@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "flash_emu.h"
+
+// Host stand-in for the Arduino-ESP32 LittleFS class (native env only): the
+// File/FS calls the storage code makes, backed by the littlefs core on a
+// flash_emu::Flash. Geometry and cache sizes follow esp_littlefs' defaults so
+// block and metadata traffic match the device. attach() a flash before
+// begin(); end() + begin() is a reboot.
+//
+// Beyond the Arduino API: preErase() erases free blocks ahead of littlefs'
+// allocator so appends skip the inline sector erase.
+#define LITTLEFS_HAS_PRE_ERASE 1
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File {
+public:
+    File() {}
+    operator bool() const { return static_cast<bool>(impl_); }
+
+    size_t write(const uint8_t* data, size_t len);
+    size_t read(uint8_t* out, size_t len);
+    int available();
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void flush();
+    void close();
+
+private:
+    friend class LittleFSFS;
+    struct Impl;
+    std::shared_ptr<Impl> impl_;
+};
+
+class LittleFSFS {
+public:
+    LittleFSFS();
+    ~LittleFSFS();
+
+    void attach(flash_emu::Flash* flash);
+
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs",
+               uint8_t maxOpenFiles = 10, const char* partitionLabel = "spiffs");
+    void end();
+    bool format();
+
+    File open(const char* path, const char* mode = "r");
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+    size_t totalBytes();
+    size_t usedBytes();
+
+    // Make sure the next `pool` free blocks littlefs will allocate are
+    // erased, doing at most `maxErases` erases now. Returns erases done.
+    size_t preErase(size_t pool, size_t maxErases);
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+}  // namespace fs
+
+using fs::File;
+
+extern fs::LittleFSFS LittleFS;
@@ -0,0 +1,67 @@
+#include "flash_emu.h"
+
+#include <cstring>
+
+namespace flash_emu {
+
+Flash::Flash(size_t sector_count, const Timing& timing)
+    : timing_(timing), data_(sector_count * kSectorSize, 0xFF), erase_counts_(sector_count, 0) {}
+
+Result Flash::read(size_t addr, void* out, size_t n) {
+    if (!powered_) return Result::kPowerLost;
+    if (!in_range(addr, n)) return Result::kOutOfRange;
+    memcpy(out, &data_[addr], n);
+    busy_us_ += timing_.command_us + n * timing_.bus_us_per_byte;
+    bytes_read_ += n;
+    return Result::kOk;
+}
+
+Result Flash::program(size_t addr, const void* data, size_t n) {
+    if (!powered_) return Result::kPowerLost;
+    if (!in_range(addr, n)) return Result::kOutOfRange;
+
+    size_t landed = n;
+    if (programs_until_cut_ > 0 && --programs_until_cut_ == 0) {
+        landed = n / 2;
+        powered_ = false;
+    }
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < landed; ++i) {
+        if (src[i] & ~data_[addr + i]) ++violations_;
+        data_[addr + i] &= src[i];  // NOR: program only clears bits
+    }
+    const size_t pages = n ? (addr + n - 1) / kPageSize - addr / kPageSize + 1 : 0;
+    busy_us_ += timing_.command_us + pages * timing_.page_program_us + n * timing_.bus_us_per_byte;
+    bytes_programmed_ += landed;
+    return powered_ ? Result::kOk : Result::kPowerLost;
+}
+
+Result Flash::erase_sector(size_t sector) {
+    if (!powered_) return Result::kPowerLost;
+    if (sector >= sector_count()) return Result::kOutOfRange;
+    memset(&data_[sector * kSectorSize], 0xFF, kSectorSize);
+    busy_us_ += timing_.command_us + timing_.sector_erase_us;
+    ++erase_counts_[sector];
+    ++total_erases_;
+    return Result::kOk;
+}
+
+void Flash::cut_power_after(uint32_t programs) {
+    programs_until_cut_ = programs;
+}
+
+void Flash::power_on() {
+    powered_ = true;
+    programs_until_cut_ = 0;
+}
+
+uint32_t Flash::max_erase_count() const {
+    uint32_t m = 0;
+    for (uint32_t c : erase_counts_) {
+        if (c > m) m = c;
+    }
+    return m;
+}
+
+}  // namespace flash_emu
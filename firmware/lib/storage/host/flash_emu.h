@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Emulated NOR flash for host runs of the storage stack (native env only).
+// Same rules as the ESP32's SPI flash: 4 KB sectors erase to 0xFF, programs
+// can only clear bits, and every operation costs modelled busy time. Keeps a
+// virtual clock of flash busy time and per-sector erase counts, and can cut
+// power mid-program to test recovery.
+namespace flash_emu {
+
+constexpr size_t kSectorSize = 4096;
+constexpr size_t kPageSize = 256;
+
+// Typical figures for the 4 MB GD25Q32/W25Q32 parts on ESP32 modules at
+// 40 MHz DIO. Worst-case erase is ~10x typical.
+struct Timing {
+    uint32_t sector_erase_us = 45000;
+    uint32_t page_program_us = 700;    // per 256-byte page touched
+    float bus_us_per_byte = 0.1f;      // ~10 MB/s on the SPI bus
+    uint32_t command_us = 2;           // opcode, address, CS turnaround
+};
+
+enum class Result : uint8_t { kOk, kOutOfRange, kPowerLost };
+
+class Flash {
+public:
+    explicit Flash(size_t sector_count, const Timing& timing = Timing());
+
+    size_t sector_count() const { return erase_counts_.size(); }
+    size_t size() const { return data_.size(); }
+
+    Result read(size_t addr, void* out, size_t n);
+    Result program(size_t addr, const void* data, size_t n);
+    Result erase_sector(size_t sector);
+
+    // Power fails during the `programs`-th program from now (0 = never):
+    // half of it lands, then every operation fails until power_on().
+    void cut_power_after(uint32_t programs);
+    void power_on();
+    bool powered() const { return powered_; }
+
+    uint64_t busy_us() const { return static_cast<uint64_t>(busy_us_); }
+    uint64_t bytes_read() const { return bytes_read_; }
+    uint64_t bytes_programmed() const { return bytes_programmed_; }
+    uint64_t total_erases() const { return total_erases_; }
+    uint32_t erase_count(size_t sector) const { return erase_counts_[sector]; }
+    uint32_t max_erase_count() const;
+    // Programs that tried to set a 0 bit back to 1 (corruption on real flash)
+    uint32_t program_violations() const { return violations_; }
+
+private:
+    bool in_range(size_t addr, size_t n) const { return addr <= data_.size() && n <= data_.size() - addr; }
+
+    Timing timing_;
+    std::vector<uint8_t> data_;
+    std::vector<uint32_t> erase_counts_;
+    double busy_us_ = 0;
+    uint64_t bytes_read_ = 0;
+    uint64_t bytes_programmed_ = 0;
+    uint64_t total_erases_ = 0;
+    uint32_t violations_ = 0;
+    uint32_t programs_until_cut_ = 0;
+    bool powered_ = true;
+};
+
+}  // namespace flash_emu
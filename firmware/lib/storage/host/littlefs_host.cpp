@@ -0,0 +1,259 @@
+#include "LittleFS.h"
+
+#include <cstring>
+#include <vector>
+
+#include <lfs.h>
+
+fs::LittleFSFS LittleFS;
+
+namespace fs {
+
+namespace {
+
+// esp_littlefs defaults (CONFIG_LITTLEFS_*)
+constexpr lfs_size_t kReadSize = 128;
+constexpr lfs_size_t kProgSize = 128;
+constexpr lfs_size_t kCacheSize = 512;
+constexpr lfs_size_t kLookaheadSize = 128;
+constexpr int32_t kBlockCycles = 512;
+
+// Block device context: the flash plus which blocks are known to be erased.
+// An erase littlefs asks for on a block preErase() already erased is skipped,
+// so pre-erasing moves erase time off the append path without adding wear.
+struct Device {
+    flash_emu::Flash* flash = nullptr;
+    std::vector<bool> erased;
+};
+
+Device& device_of(const lfs_config* c) {
+    return *static_cast<Device*>(c->context);
+}
+
+flash_emu::Flash* flash_of(const lfs_config* c) {
+    return device_of(c).flash;
+}
+
+struct UsedBlocks {
+    std::vector<bool>* used;
+};
+
+int mark_used(void* data, lfs_block_t block) {
+    std::vector<bool>& used = *static_cast<UsedBlocks*>(data)->used;
+    if (block < used.size()) used[block] = true;
+    return LFS_ERR_OK;
+}
+
+int to_lfs(flash_emu::Result r) {
+    return r == flash_emu::Result::kOk ? LFS_ERR_OK : LFS_ERR_IO;
+}
+
+int bd_read(const lfs_config* c, lfs_block_t block, lfs_off_t off, void* buffer, lfs_size_t size) {
+    return to_lfs(flash_of(c)->read(block * c->block_size + off, buffer, size));
+}
+
+int bd_prog(const lfs_config* c, lfs_block_t block, lfs_off_t off, const void* buffer, lfs_size_t size) {
+    device_of(c).erased[block] = false;
+    return to_lfs(flash_of(c)->program(block * c->block_size + off, buffer, size));
+}
+
+int bd_erase(const lfs_config* c, lfs_block_t block) {
+    Device& dev = device_of(c);
+    if (dev.erased[block]) return LFS_ERR_OK;
+    return to_lfs(dev.flash->erase_sector(block));
+}
+
+int bd_sync(const lfs_config*) {
+    return LFS_ERR_OK;
+}
+
+// fopen-style mode string -> lfs open flags
+int open_flags(const char* mode) {
+    const bool plus = strchr(mode, '+') != nullptr;
+    switch (mode[0]) {
+        case 'w': return (plus ? LFS_O_RDWR : LFS_O_WRONLY) | LFS_O_CREAT | LFS_O_TRUNC;
+        case 'a': return (plus ? LFS_O_RDWR : LFS_O_WRONLY) | LFS_O_CREAT | LFS_O_APPEND;
+        default:  return plus ? LFS_O_RDWR : LFS_O_RDONLY;
+    }
+}
+
+}  // namespace
+
+struct LittleFSFS::State {
+    flash_emu::Flash* flash = nullptr;
+    Device device;
+    lfs_config cfg;
+    lfs_t lfs;
+    bool mounted = false;
+};
+
+struct File::Impl {
+    lfs_t* lfs = nullptr;
+    lfs_file_t file;
+
+    ~Impl() {
+        if (lfs) lfs_file_close(lfs, &file);
+    }
+};
+
+size_t File::write(const uint8_t* data, size_t len) {
+    if (!impl_) return 0;
+    const lfs_ssize_t n = lfs_file_write(impl_->lfs, &impl_->file, data, len);
+    return n < 0 ? 0 : static_cast<size_t>(n);
+}
+
+size_t File::read(uint8_t* out, size_t len) {
+    if (!impl_) return 0;
+    const lfs_ssize_t n = lfs_file_read(impl_->lfs, &impl_->file, out, len);
+    return n < 0 ? 0 : static_cast<size_t>(n);
+}
+
+int File::available() {
+    if (!impl_) return 0;
+    return static_cast<int>(size() - position());
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!impl_) return false;
+    const int whence = mode == SeekCur ? LFS_SEEK_CUR : mode == SeekEnd ? LFS_SEEK_END : LFS_SEEK_SET;
+    return lfs_file_seek(impl_->lfs, &impl_->file, static_cast<lfs_soff_t>(pos), whence) >= 0;
+}
+
+size_t File::position() const {
+    if (!impl_) return 0;
+    const lfs_soff_t pos = lfs_file_tell(impl_->lfs, &impl_->file);
+    return pos < 0 ? 0 : static_cast<size_t>(pos);
+}
+
+size_t File::size() const {
+    if (!impl_) return 0;
+    const lfs_soff_t size = lfs_file_size(impl_->lfs, &impl_->file);
+    return size < 0 ? 0 : static_cast<size_t>(size);
+}
+
+void File::flush() {
+    if (impl_) lfs_file_sync(impl_->lfs, &impl_->file);
+}
+
+void File::close() {
+    impl_.reset();
+}
+
+LittleFSFS::LittleFSFS() : state_(new State()) {}
+
+LittleFSFS::~LittleFSFS() {
+    end();
+}
+
+void LittleFSFS::attach(flash_emu::Flash* flash) {
+    end();
+    state_->flash = flash;
+    state_->device.flash = flash;
+    state_->device.erased.assign(flash ? flash->sector_count() : 0, false);
+
+    lfs_config& cfg = state_->cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.context = &state_->device;
+    cfg.read = bd_read;
+    cfg.prog = bd_prog;
+    cfg.erase = bd_erase;
+    cfg.sync = bd_sync;
+    cfg.read_size = kReadSize;
+    cfg.prog_size = kProgSize;
+    cfg.block_size = flash_emu::kSectorSize;
+    cfg.block_count = flash ? static_cast<lfs_size_t>(flash->sector_count()) : 0;
+    cfg.block_cycles = kBlockCycles;
+    cfg.cache_size = kCacheSize;
+    cfg.lookahead_size = kLookaheadSize;
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char*, uint8_t, const char*) {
+    if (state_->mounted) return true;
+    if (!state_->flash) return false;
+    // Erased state is RAM only: after a reboot nothing is known to be erased
+    state_->device.erased.assign(state_->flash->sector_count(), false);
+    if (lfs_mount(&state_->lfs, &state_->cfg) != LFS_ERR_OK) {
+        if (!formatOnFail) return false;
+        if (lfs_format(&state_->lfs, &state_->cfg) != LFS_ERR_OK) return false;
+        if (lfs_mount(&state_->lfs, &state_->cfg) != LFS_ERR_OK) return false;
+    }
+    state_->mounted = true;
+    return true;
+}
+
+void LittleFSFS::end() {
+    if (!state_->mounted) return;
+    lfs_unmount(&state_->lfs);
+    state_->mounted = false;
+}
+
+bool LittleFSFS::format() {
+    end();
+    return state_->flash && lfs_format(&state_->lfs, &state_->cfg) == LFS_ERR_OK;
+}
+
+File LittleFSFS::open(const char* path, const char* mode) {
+    File f;
+    if (!state_->mounted) return f;
+    std::shared_ptr<File::Impl> impl(new File::Impl());
+    if (lfs_file_open(&state_->lfs, &impl->file, path, open_flags(mode)) != LFS_ERR_OK) return f;
+    impl->lfs = &state_->lfs;
+    f.impl_ = impl;
+    return f;
+}
+
+bool LittleFSFS::exists(const char* path) {
+    lfs_info info;
+    return state_->mounted && lfs_stat(&state_->lfs, path, &info) == LFS_ERR_OK;
+}
+
+bool LittleFSFS::remove(const char* path) {
+    return state_->mounted && lfs_remove(&state_->lfs, path) == LFS_ERR_OK;
+}
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    return state_->mounted && lfs_rename(&state_->lfs, from, to) == LFS_ERR_OK;
+}
+
+size_t LittleFSFS::totalBytes() {
+    return static_cast<size_t>(state_->cfg.block_count) * state_->cfg.block_size;
+}
+
+size_t LittleFSFS::usedBytes() {
+    if (!state_->mounted) return 0;
+    const lfs_ssize_t blocks = lfs_fs_size(&state_->lfs);
+    return blocks < 0 ? 0 : static_cast<size_t>(blocks) * state_->cfg.block_size;
+}
+
+size_t LittleFSFS::preErase(size_t pool, size_t maxErases) {
+    if (!state_->mounted) return 0;
+    lfs_t& lfs = state_->lfs;
+    const lfs_size_t count = state_->cfg.block_count;
+
+    std::vector<bool> used(count, false);
+    UsedBlocks ctx{&used};
+    if (lfs_fs_traverse(&lfs, mark_used, &ctx) != LFS_ERR_OK) return 0;
+
+    // littlefs allocates the free blocks after free.off + free.i in order,
+    // skipping those its lookahead window still marks used
+    const lfs_block_t start = lfs.free.off + lfs.free.i;
+    std::vector<bool>& erased = state_->device.erased;
+    size_t ahead = 0;
+    size_t erases = 0;
+    for (lfs_block_t n = 0; n < count && ahead < pool; ++n) {
+        const lfs_block_t pos = lfs.free.i + n;
+        const lfs_block_t block = (start + n) % count;
+        const bool in_window = pos < lfs.free.size;
+        if (used[block] || (in_window && (lfs.free.buffer[pos / 32] & (1U << (pos % 32))))) continue;
+        if (!erased[block]) {
+            if (erases == maxErases) break;
+            if (state_->flash->erase_sector(block) != flash_emu::Result::kOk) break;
+            erased[block] = true;
+            ++erases;
+        }
+        ++ahead;
+    }
+    return erases;
+}
+
+}  // namespace fs
@@ -0,0 +1,304 @@
+#include "sample_spill.h"
+
+#include <LittleFS.h>
+
+#include <atomic>
+#include <cstring>
+
+#include "app_config.h"
+#include "compute/snapshot.h"
+#include "fs_store.h"
+#include "telemetry/binlog.h"
+#include "telemetry/telemetry.h"
+
+namespace sample_spill {
+
+namespace {
+
+constexpr uint8_t kBlockMagic = 0xB5;
+constexpr size_t kHalves = 6;  // IMU axes ahead of the timestamp in Sample
+constexpr uint8_t kTimeEscape = 0xFF;
+
+#pragma pack(push, 1)
+struct BlockHeader {
+    uint8_t magic;
+    uint8_t count;
+    uint16_t bytes;  // payload after the header
+    uint32_t crc;    // snapshot::crc32 of the payload
+};
+#pragma pack(pop)
+static_assert(sizeof(BlockHeader) == 8, "kMaxBlockBytes counts an 8-byte header");
+
+struct Block {
+    reg_buffer::Sample samples[kBlockSamples];
+    uint8_t strides[kBlockSamples];
+};
+
+void (*g_onSealed)() = nullptr;
+
+// Sensor task
+Block g_blocks[2];
+size_t g_filling = 0;  // block add() writes to
+size_t g_fill = 0;
+std::atomic<bool> g_active(false);
+
+// Handed from the sensor task to the writer: index of the full block, -1 if none
+std::atomic<int> g_sealed(-1);
+size_t g_sealedCount = 0;
+
+// Spilled bytes as running offsets; the file holds [g_fileBase, g_written).
+// The writer restarts the file whenever everything on it has been replayed.
+std::atomic<uint32_t> g_written(0);   // writer task
+std::atomic<uint32_t> g_fileBase(0);  // writer task
+std::atomic<uint32_t> g_read(0);      // loop task
+// Loop task asks the sensor task to leave the spill: g_written it saw + 1
+std::atomic<uint32_t> g_resumeAt(0);
+
+// Writer task scratch (too big for its stack)
+uint8_t g_encoded[kMaxBlockBytes];
+// Loop task scratch
+uint8_t g_readBuf[kMaxBlockBytes];
+Block g_decoded;
+
+const uint8_t* halves(const reg_buffer::Sample& s) {
+    return reinterpret_cast<const uint8_t*>(&s);
+}
+
+uint8_t* halves(reg_buffer::Sample& s) {
+    return reinterpret_cast<uint8_t*>(&s);
+}
+
+bool seal() {
+    if (g_sealed.load(std::memory_order_acquire) >= 0) return false;
+    g_sealedCount = g_fill;
+    g_sealed.store(static_cast<int>(g_filling), std::memory_order_release);
+    g_filling ^= 1;
+    g_fill = 0;
+    return true;
+}
+
+// A block that fails its header or CRC ends the readable part of the file
+// (a short write when the partition filled, already counted as dropped);
+// skip to the end of it.
+void skip_rest(uint32_t read, uint32_t written) {
+    BINLOG("[SPILL] Bad block at %u, skipping %u bytes", read, written - read);
+    g_read.store(written, std::memory_order_release);
+}
+
+// Load the next spilled block into `replay`; false if there was none or no room
+bool load_block(reg_buffer::SampleRingBuffer& replay) {
+    const uint32_t written = g_written.load(std::memory_order_acquire);
+    const uint32_t read = g_read.load(std::memory_order_relaxed);
+    if (read == written || reg_buffer::SampleRingBuffer::kCapacity - replay.size() < kBlockSamples) return false;
+
+    File fp = LittleFS.open(kFsSpillPath, "r");
+    BlockHeader h;
+    bool ok = fp && fp.seek(read - g_fileBase.load(std::memory_order_acquire)) &&
+              fp.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) == sizeof(h) &&
+              h.magic == kBlockMagic && h.bytes <= sizeof(g_readBuf) &&
+              read + sizeof(h) + h.bytes <= written &&
+              fp.read(g_readBuf, h.bytes) == h.bytes && snapshot::crc32(g_readBuf, h.bytes) == h.crc;
+    if (fp) fp.close();
+    const size_t n = ok ? decode(g_readBuf, h.bytes, g_decoded.samples, g_decoded.strides, kBlockSamples) : 0;
+    if (n == 0 || n != h.count) {
+        skip_rest(read, written);
+        return false;
+    }
+
+    const size_t room = replay.reserve_n(n);
+    for (size_t i = 0; i < room; ++i) replay.reserved(i, g_decoded.strides[i]) = g_decoded.samples[i];
+    replay.commit(room);
+    g_read.store(read + sizeof(h) + h.bytes, std::memory_order_release);
+    return true;
+}
+
+}  // namespace
+
+void begin(void (*on_sealed)()) {
+    g_onSealed = on_sealed;
+    g_filling = 0;
+    g_fill = 0;
+    g_active.store(false);
+    g_sealed.store(-1);
+    g_written.store(0);
+    g_fileBase.store(0);
+    g_read.store(0);
+    g_resumeAt.store(0);
+    if (LittleFS.exists(kFsSpillPath)) LittleFS.remove(kFsSpillPath);
+}
+
+bool divert(reg_buffer::SampleRingBuffer& ring) {
+    if (!g_active.load(std::memory_order_relaxed)) {
+        if (ring.size() < kSpillRingWatermark) return false;
+        g_active.store(true, std::memory_order_release);
+        telemetry::add(telemetry::Stat::kSpillSessions, 1);
+        BINLOG("[SPILL] Ring at %u, spilling to flash", static_cast<unsigned>(ring.size()));
+        return true;
+    }
+
+    // The loop asked to resume having replayed up to g_written; valid only if
+    // no block was sealed or written since
+    const uint32_t resume_at = g_resumeAt.exchange(0, std::memory_order_acquire);
+    if (resume_at == 0 || g_sealed.load(std::memory_order_acquire) >= 0 ||
+        g_written.load(std::memory_order_acquire) + 1 != resume_at) {
+        return true;
+    }
+    const size_t n = ring.reserve_n(g_fill);
+    if (n < g_fill) return true;  // loop has not drained the ring yet; stay on the spill
+    const Block& b = g_blocks[g_filling];
+    for (size_t i = 0; i < n; ++i) ring.reserved(i, b.strides[i]) = b.samples[i];
+    ring.commit(n);
+    g_fill = 0;
+    g_active.store(false, std::memory_order_release);
+    BINLOG("[SPILL] Caught up, back on the ring");
+    return false;
+}
+
+bool add(const reg_buffer::Sample& sample, uint8_t stride) {
+    if (g_fill == kBlockSamples) {
+        // Block filled while the writer still had the other one
+        if (!seal()) {
+            telemetry::add(telemetry::Stat::kSpillDropped, 1);
+            if (g_onSealed) g_onSealed();
+            return false;
+        }
+        if (g_onSealed) g_onSealed();
+    }
+    Block& b = g_blocks[g_filling];
+    b.samples[g_fill] = sample;
+    b.strides[g_fill] = stride == 0 ? 1 : stride;
+    ++g_fill;
+    telemetry::add(telemetry::Stat::kSpillSamples, 1);
+    if (g_fill == kBlockSamples && seal() && g_onSealed) g_onSealed();
+    return true;
+}
+
+size_t write_sealed() {
+    const int index = g_sealed.load(std::memory_order_acquire);
+    if (index < 0) return 0;
+    const Block& b = g_blocks[index];
+
+    BlockHeader h;
+    h.magic = kBlockMagic;
+    h.count = static_cast<uint8_t>(g_sealedCount);
+    const size_t payload = encode(b.samples, b.strides, g_sealedCount, g_encoded + sizeof(h));
+    h.bytes = static_cast<uint16_t>(payload);
+    h.crc = snapshot::crc32(g_encoded + sizeof(h), payload);
+    memcpy(g_encoded, &h, sizeof(h));
+    const size_t len = sizeof(h) + payload;
+
+    // Everything on the file has been replayed: start it over
+    const uint32_t written = g_written.load(std::memory_order_relaxed);
+    const bool restart = g_read.load(std::memory_order_acquire) == written;
+    if (restart) g_fileBase.store(written, std::memory_order_release);
+    File fp = LittleFS.open(kFsSpillPath, restart ? "w" : "a");
+    const size_t offset = fp ? fp.size() : 0;
+    const size_t n = fp ? fp.write(g_encoded, len) : 0;
+    if (fp) fp.close();
+    fs_store::count_flash_write(offset, n);
+    if (n != len) {
+        telemetry::add(telemetry::Stat::kSpillDropped, g_sealedCount);
+        BINLOG("[SPILL] Block write failed (%u of %u bytes)", static_cast<unsigned>(n), static_cast<unsigned>(len));
+    }
+    // Partial bytes still count: replay finds the bad block and skips past it
+    g_written.store(written + static_cast<uint32_t>(n), std::memory_order_release);
+    g_sealed.store(-1, std::memory_order_release);
+    return n;
+}
+
+void replay(reg_buffer::SampleRingBuffer& ring, reg_buffer::SampleRingBuffer& replay) {
+    if (!g_active.load(std::memory_order_acquire) && bytes_pending() == 0) return;
+
+    // Consolidation takes `replay` before `ring`, so moving samples across keeps their order
+    reg_buffer::Sample s;
+    uint8_t stride;
+    while (!replay.full() && ring.pop(s, &stride)) replay.push(s, stride);
+    if (!ring.empty()) return;  // spilled blocks are newer than what is left
+
+    while (load_block(replay)) {
+    }
+    if (g_active.load(std::memory_order_acquire) && bytes_pending() == 0 &&
+        g_sealed.load(std::memory_order_acquire) < 0) {
+        g_resumeAt.store(g_written.load(std::memory_order_acquire) + 1, std::memory_order_release);
+    }
+}
+
+void discard() {
+    g_read.store(g_written.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+bool active() {
+    return g_active.load(std::memory_order_acquire);
+}
+
+size_t bytes_pending() {
+    return g_written.load(std::memory_order_acquire) - g_read.load(std::memory_order_acquire);
+}
+
+size_t encode(const reg_buffer::Sample* samples, const uint8_t* strides, size_t n, uint8_t* out) {
+    uint8_t* p = out;
+    reg_buffer::Sample prev{};
+    for (size_t i = 0; i < n; ++i) {
+        const reg_buffer::Sample& s = samples[i];
+        *p++ = strides ? strides[i] : 1;
+
+        const uint32_t delta = s.timestamp - prev.timestamp;
+        if (i > 0 && delta < kTimeEscape) {
+            *p++ = static_cast<uint8_t>(delta);
+        } else {
+            *p++ = kTimeEscape;
+            memcpy(p, &s.timestamp, 4);
+            p += 4;
+        }
+
+        uint16_t mask = 0;
+        uint8_t* mask_at = p;
+        p += 2;
+        for (size_t k = 0; k < kHalves * 2; ++k) {
+            const uint8_t x = halves(s)[k] ^ halves(prev)[k];
+            if (x) {
+                mask |= static_cast<uint16_t>(1u << k);
+                *p++ = x;
+            }
+        }
+        memcpy(mask_at, &mask, 2);
+        prev = s;
+    }
+    return static_cast<size_t>(p - out);
+}
+
+size_t decode(const uint8_t* in, size_t len, reg_buffer::Sample* samples, uint8_t* strides, size_t max) {
+    const uint8_t* p = in;
+    const uint8_t* end = in + len;
+    reg_buffer::Sample prev{};
+    size_t n = 0;
+    while (p < end) {
+        if (n == max || end - p < 4) return 0;
+        reg_buffer::Sample s = prev;
+        const uint8_t stride = *p++;
+        const uint8_t delta = *p++;
+        if (delta == kTimeEscape) {
+            if (end - p < 4) return 0;
+            memcpy(&s.timestamp, p, 4);
+            p += 4;
+        } else {
+            s.timestamp = prev.timestamp + delta;
+        }
+        if (end - p < 2) return 0;
+        uint16_t mask;
+        memcpy(&mask, p, 2);
+        p += 2;
+        for (size_t k = 0; k < kHalves * 2; ++k) {
+            if (!(mask & (1u << k))) continue;
+            if (p == end) return 0;
+            halves(s)[k] ^= *p++;
+        }
+        samples[n] = s;
+        if (strides) strides[n] = stride;
+        prev = s;
+        ++n;
+    }
+    return n;
+}
+
+}  // namespace sample_spill
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ringbuf/reg_buffer.h"
+
+// Overflow path for the sample ring. When the loop task stops draining the
+// ring (a long SEND holds it in stream_all_records()), the sensor task stops
+// pushing at a high watermark and fills RAM blocks instead; the storage
+// writer task compresses each full block and appends it to a spill file.
+// Once the loop is back, replay() feeds the spilled blocks, in order, into a
+// second ring that consolidation drains ahead of the live one, and the
+// sensor task returns to the live ring when the file is used up. Nothing is
+// dropped unless the writer falls a whole block behind.
+//
+// Threads: divert()/add() on the sensor task, write_sealed() on the storage
+// writer, replay()/discard() on the loop task. Spilled samples are not in
+// the RTC snapshot; a reset loses them and begin() removes the stale file.
+namespace sample_spill {
+
+// Samples per RAM block (two blocks: one filling, one being written)
+constexpr size_t kBlockSamples = 64;
+// Worst-case encoded size of one sample and of one block on flash
+constexpr size_t kMaxEncodedSample = 20;
+constexpr size_t kMaxBlockBytes = 8 + kBlockSamples * kMaxEncodedSample;
+
+// Remove a spill file left by a previous boot and reset state. `on_sealed`
+// runs on the sensor task when a block is ready for write_sealed() (it
+// should only queue the work).
+void begin(void (*on_sealed)());
+
+// Sensor task: true if the next sample must go to add() instead of the
+// ring. Starts a spill at the ring's high watermark and ends it (pushing the
+// last partial block to the ring) once replay() has caught up.
+bool divert(reg_buffer::SampleRingBuffer& ring);
+// Sensor task: false if the sample was dropped (writer a block behind)
+bool add(const reg_buffer::Sample& sample, uint8_t stride);
+
+// Storage writer task: compress and append the sealed block, if any.
+// Returns the bytes written.
+size_t write_sealed();
+
+// Loop task, before consolidating from `replay` then `ring`: moves samples
+// taken before the spill into `replay`, then loads spilled blocks behind
+// them as room allows.
+void replay(reg_buffer::SampleRingBuffer& ring, reg_buffer::SampleRingBuffer& replay);
+// Loop task: forget everything spilled so far (ERASE)
+void discard();
+
+bool active();
+size_t bytes_pending();  // spilled and not yet replayed
+
+// Block payload codec: each sample's halves XORed with the previous
+// sample's, zero bytes dropped behind a 16-bit mask (12 bits used); the
+// timestamp as a one-byte delta (0xFF escapes a full value); the stride as
+// one byte.
+size_t encode(const reg_buffer::Sample* samples, const uint8_t* strides, size_t n, uint8_t* out);
+// Returns samples decoded, 0 if `in` is malformed
+size_t decode(const uint8_t* in, size_t len, reg_buffer::Sample* samples, uint8_t* strides, size_t max);
+
+}  // namespace sample_spill
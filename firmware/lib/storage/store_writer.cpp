@@ -0,0 +1,182 @@
+#include "store_writer.h"
+
+#include <Arduino.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <LittleFS.h>  // LITTLEFS_HAS_PRE_ERASE
+
+#include "app_config.h"
+#include "fs_store.h"
+#include "sample_spill.h"
+#include "telemetry/binlog.h"
+#include "telemetry/telemetry.h"
+
+namespace store_writer {
+
+namespace {
+
+enum class Op : uint8_t { kAppend, kErase, kBarrier, kPreErase, kSpill };
+
+struct Command {
+    Op op;
+    uint32_t seq;
+    consolidate::ConsolidatedRecord record;
+};
+
+constexpr size_t kHighWatermark = kStoreQueueDepth * 3 / 4;
+
+QueueHandle_t g_queue = nullptr;
+TaskHandle_t g_task = nullptr;
+SemaphoreHandle_t g_submitLock = nullptr;  // keeps seq order == queue order across producers
+
+// Barriers wait on sequence numbers rather than a semaphore the writer
+// signals, so a caller that timed out leaves nothing behind to misfire later
+uint32_t g_submittedSeq = 0;          // under g_submitLock
+volatile uint32_t g_completedSeq = 0; // written by the writer task only
+volatile bool g_lastEraseOk = true;
+volatile bool g_spillQueued = false;
+
+void note_append_latency(uint32_t us) {
+    if (us > telemetry::get(telemetry::Stat::kStoreAppendMaxUs)) {
+        telemetry::set(telemetry::Stat::kStoreAppendMaxUs, us);
+    }
+}
+
+void writerTask(void*) {
+    Command cmd;
+    for (;;) {
+        if (xQueueReceive(g_queue, &cmd, portMAX_DELAY) != pdTRUE) continue;
+        switch (cmd.op) {
+            case Op::kAppend: {
+                const uint32_t start = micros();
+                if (!fs_store::append(cmd.record)) {
+                    telemetry::add(telemetry::Stat::kStoreAppendFailures, 1);
+                    BINLOG("[STORE] Failed to append interval record");
+                }
+                note_append_latency(micros() - start);
+                break;
+            }
+            case Op::kErase:
+                g_lastEraseOk = fs_store::erase();
+                break;
+            case Op::kBarrier:
+                break;
+            case Op::kPreErase:
+                fs_store::pre_erase(kPreErasePoolSectors, 1);
+                break;
+            case Op::kSpill:
+                g_spillQueued = false;  // a block sealed from here on needs another request
+                sample_spill::write_sealed();
+                break;
+        }
+        g_completedSeq = cmd.seq;
+    }
+}
+
+// Returns the command's sequence number, 0 if it could not be queued
+uint32_t enqueue(Op op, const consolidate::ConsolidatedRecord* record, TickType_t wait) {
+    Command cmd;
+    cmd.op = op;
+    if (record) cmd.record = *record;
+
+    // `wait` bounds the lock too: a barrier waiting for queue space holds it
+    if (xSemaphoreTake(g_submitLock, wait) != pdTRUE) return 0;
+    cmd.seq = g_submittedSeq + 1;
+    if (cmd.seq == 0) cmd.seq = 1;  // 0 means "not queued"
+    const bool queued = xQueueSend(g_queue, &cmd, wait) == pdTRUE;
+    if (queued) g_submittedSeq = cmd.seq;
+    xSemaphoreGive(g_submitLock);
+    return queued ? cmd.seq : 0;
+}
+
+// Wrap-safe: true once the writer has completed `seq`
+bool completed(uint32_t seq) {
+    return static_cast<int32_t>(g_completedSeq - seq) >= 0;
+}
+
+bool wait_for(uint32_t seq, uint32_t timeout_ms) {
+    const uint32_t start = millis();
+    while (!completed(seq)) {
+        if (millis() - start >= timeout_ms) return false;
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+}  // namespace
+
+bool begin() {
+    if (g_queue) return true;
+    if (!g_submitLock) g_submitLock = xSemaphoreCreateMutex();
+    if (!g_submitLock) return false;
+    g_queue = xQueueCreate(kStoreQueueDepth, sizeof(Command));
+    if (!g_queue) return false;
+    // Core 0 beside the NimBLE host; below it and the sensor task in priority
+    if (xTaskCreatePinnedToCore(writerTask, "StoreWriter", STORE_WRITER_STACK_BYTES, nullptr, 1, &g_task, 0) != pdPASS) {
+        vQueueDelete(g_queue);
+        g_queue = nullptr;
+        return false;
+    }
+    return true;
+}
+
+Submit submit(const consolidate::ConsolidatedRecord& record) {
+    if (!g_queue) {
+        if (!fs_store::append(record)) telemetry::add(telemetry::Stat::kStoreAppendFailures, 1);
+        return Submit::kQueued;
+    }
+    if (!enqueue(Op::kAppend, &record, 0)) {
+        telemetry::add(telemetry::Stat::kStoreQueueFull, 1);
+        return Submit::kFull;
+    }
+    const size_t depth = uxQueueMessagesWaiting(g_queue);
+    if (depth > telemetry::get(telemetry::Stat::kStoreQueueMax)) {
+        telemetry::set(telemetry::Stat::kStoreQueueMax, depth);
+    }
+    return depth >= kHighWatermark ? Submit::kCongested : Submit::kQueued;
+}
+
+bool flush(uint32_t timeout_ms) {
+    if (!g_queue) return true;
+    const uint32_t seq = enqueue(Op::kBarrier, nullptr, pdMS_TO_TICKS(timeout_ms));
+    return seq && wait_for(seq, timeout_ms);
+}
+
+bool erase(uint32_t timeout_ms) {
+    if (!g_queue) return fs_store::erase();
+    const uint32_t seq = enqueue(Op::kErase, nullptr, pdMS_TO_TICKS(timeout_ms));
+    return seq && wait_for(seq, timeout_ms) && g_lastEraseOk;
+}
+
+bool pre_erase() {
+#ifndef LITTLEFS_HAS_PRE_ERASE
+    return false;  // fs_store::pre_erase() would do nothing; don't wake the writer
+#else
+    // Inline fallback would put the erase on the caller's task
+    if (!g_queue || uxQueueMessagesWaiting(g_queue) != 0) return false;
+    return enqueue(Op::kPreErase, nullptr, 0) != 0;
+#endif
+}
+
+bool spill() {
+    if (!g_queue) return sample_spill::write_sealed() != 0;
+    if (g_spillQueued) return true;
+    g_spillQueued = true;
+    if (enqueue(Op::kSpill, nullptr, 0)) return true;
+    g_spillQueued = false;
+    return false;
+}
+
+size_t pending() {
+    return g_queue ? uxQueueMessagesWaiting(g_queue) : 0;
+}
+
+size_t capacity() {
+    return kStoreQueueDepth;
+}
+
+TaskHandle_t task_handle() {
+    return g_task;
+}
+
+}  // namespace store_writer
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "compute/consolidate.h"
+
+// Record appends off the loop task. submit() queues a record for a
+// low-priority writer task and never blocks, so a LittleFS block erase
+// (tens of ms) stalls only the writer, not ring draining or BLE handling.
+// flush() and erase() are barriers: they wait until everything submitted
+// before them has reached flash. Until begin() succeeds every call falls
+// through to fs_store synchronously.
+namespace store_writer {
+
+enum class Submit : uint8_t {
+    kQueued,     // accepted
+    kCongested,  // accepted, queue above its high watermark: defer optional flash work
+    kFull,       // rejected: keep the record and resubmit later
+};
+
+bool begin();
+
+Submit submit(const consolidate::ConsolidatedRecord& record);
+
+// Wait until every record submitted so far is on flash (ahead of a transfer)
+bool flush(uint32_t timeout_ms);
+
+// Erase the record file after the queued appends; false on timeout or if
+// fs_store::erase() failed
+bool erase(uint32_t timeout_ms);
+
+// Queue one sector of idle-time pre-erase (fs_store::pre_erase) if the
+// writer has nothing else to do. False if skipped, always without a
+// LittleFS driver that has the pre-erase hook (LITTLEFS_HAS_PRE_ERASE).
+bool pre_erase();
+
+// Queue sample_spill::write_sealed() (called from the sensor task when a
+// spill block fills). Non-blocking; a request already queued covers it.
+bool spill();
+
+size_t pending();
+size_t capacity();
+
+TaskHandle_t task_handle();
+
+}  // namespace store_writer
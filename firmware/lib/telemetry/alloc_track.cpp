@@ -0,0 +1,109 @@
+#include "alloc_track.h"
+
+#if defined(ALLOC_TRACKING) && ALLOC_TRACKING
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace alloc_track {
+
+namespace {
+    StageStats g_stages[kMaxStages];
+    size_t g_stage_count = 0;
+    int g_current = -1;
+    size_t g_live = 0;
+    size_t g_peak = 0;
+
+    // Live bytes at entry of every open stage, so nested peaks are tracked too
+    size_t g_entry_live[kMaxStages];
+    bool g_open[kMaxStages];
+
+    int index_of(const char* name) {
+        for (size_t i = 0; i < g_stage_count; ++i) {
+            if (std::strcmp(g_stages[i].name, name) == 0) return static_cast<int>(i);
+        }
+        if (g_stage_count == kMaxStages) return -1;
+        g_stages[g_stage_count] = StageStats{name, 0, 0, 0, 0};
+        return static_cast<int>(g_stage_count++);
+    }
+
+    void on_alloc(size_t size) {
+        g_live += size;
+        if (g_live > g_peak) g_peak = g_live;
+        for (size_t i = 0; i < g_stage_count; ++i) {
+            if (!g_open[i] || g_live < g_entry_live[i]) continue;
+            const size_t used = g_live - g_entry_live[i];
+            if (used > g_stages[i].peak_bytes) g_stages[i].peak_bytes = used;
+        }
+        if (g_current >= 0) {
+            ++g_stages[g_current].allocations;
+            g_stages[g_current].bytes += size;
+        }
+    }
+
+    // Size header in front of each block; 16 keeps malloc's alignment
+    constexpr size_t kHeader = 16;
+
+    void* tracked_alloc(size_t size) {
+        void* raw = std::malloc(size + kHeader);
+        if (!raw) throw std::bad_alloc();
+        std::memcpy(raw, &size, sizeof(size));
+        on_alloc(size);
+        return static_cast<char*>(raw) + kHeader;
+    }
+
+    void tracked_free(void* p) {
+        if (!p) return;
+        void* raw = static_cast<char*>(p) - kHeader;
+        size_t size;
+        std::memcpy(&size, raw, sizeof(size));
+        g_live -= size;
+        std::free(raw);
+    }
+}
+
+Stage::Stage(const char* name) : index_(index_of(name)), parent_(g_current), live_at_entry_(g_live) {
+    if (index_ < 0) return;
+    ++g_stages[index_].entries;
+    g_entry_live[index_] = live_at_entry_;
+    g_open[index_] = true;
+    g_current = index_;
+}
+
+Stage::~Stage() {
+    if (index_ < 0) return;
+    g_open[index_] = false;
+    g_current = parent_;
+}
+
+void reset() {
+    g_stage_count = 0;
+    g_current = -1;
+    g_peak = g_live;
+    for (size_t i = 0; i < kMaxStages; ++i) g_open[i] = false;
+}
+
+size_t stage_count() { return g_stage_count; }
+const StageStats& stage(size_t i) { return g_stages[i]; }
+
+const StageStats* find(const char* name) {
+    for (size_t i = 0; i < g_stage_count; ++i) {
+        if (std::strcmp(g_stages[i].name, name) == 0) return &g_stages[i];
+    }
+    return nullptr;
+}
+
+size_t live_bytes() { return g_live; }
+size_t peak_bytes() { return g_peak; }
+
+}  // namespace alloc_track
+
+void* operator new(size_t size) { return alloc_track::tracked_alloc(size); }
+void* operator new[](size_t size) { return alloc_track::tracked_alloc(size); }
+void operator delete(void* p) noexcept { alloc_track::tracked_free(p); }
+void operator delete[](void* p) noexcept { alloc_track::tracked_free(p); }
+void operator delete(void* p, size_t) noexcept { alloc_track::tracked_free(p); }
+void operator delete[](void* p, size_t) noexcept { alloc_track::tracked_free(p); }
+
+#endif  // ALLOC_TRACKING
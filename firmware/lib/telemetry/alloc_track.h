@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Host-only heap accounting per pipeline stage. With ALLOC_TRACKING defined
+// (the native test env) global operator new/delete are replaced and every
+// allocation is charged to the innermost open stage; on the device the
+// ALLOC_STAGE() markers compile to nothing.
+//
+//   void consolidate_window() {
+//       ALLOC_STAGE("consolidate");
+//       ...
+//   }
+namespace alloc_track {
+
+struct StageStats {
+    const char* name;
+    uint32_t entries;       // times the stage ran
+    uint32_t allocations;   // operator new calls while the stage was innermost
+    size_t bytes;           // total bytes requested
+    size_t peak_bytes;      // most bytes live at once, counted from stage entry
+};
+
+constexpr size_t kMaxStages = 16;
+
+class Stage {
+public:
+    explicit Stage(const char* name);
+    ~Stage();
+    Stage(const Stage&) = delete;
+    Stage& operator=(const Stage&) = delete;
+
+private:
+    int index_;
+    int parent_;
+    size_t live_at_entry_;
+};
+
+void reset();
+size_t stage_count();
+const StageStats& stage(size_t i);
+const StageStats* find(const char* name);  // nullptr if the stage never ran
+
+size_t live_bytes();   // outstanding heap bytes (tracked allocations only)
+size_t peak_bytes();   // high-water mark of live_bytes() since reset()
+
+}  // namespace alloc_track
+
+#if defined(ALLOC_TRACKING) && ALLOC_TRACKING
+#define ALLOC_STAGE_CAT2(a, b) a##b
+#define ALLOC_STAGE_CAT(a, b) ALLOC_STAGE_CAT2(a, b)
+#define ALLOC_STAGE(name) ::alloc_track::Stage ALLOC_STAGE_CAT(alloc_stage_, __LINE__)(name)
+#else
+#define ALLOC_STAGE(name) ((void)0)
+#endif
@@ -0,0 +1,108 @@
+#include "binlog.h"
+
+#include <atomic>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+namespace binlog {
+
+namespace {
+
+// Each slot carries the ticket it holds (+1, 0 while being written) so a
+// reader can tell a finished entry from one in progress or already lapped
+struct Slot {
+    std::atomic<uint32_t> seq;
+    uint32_t id;
+    uint32_t time_us;
+    uint8_t argc;
+    uint32_t args[kMaxArgs];
+};
+
+std::atomic<uint32_t> g_head(0);
+Slot g_slots[kEntries];
+
+uint32_t now_us() {
+#ifdef ARDUINO
+    return micros();
+#else
+    using namespace std::chrono;
+    return static_cast<uint32_t>(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+}  // namespace
+
+void write(uint32_t id, const uint32_t* args, uint8_t argc) {
+    const uint32_t ticket = g_head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = g_slots[ticket & (kEntries - 1)];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.id = id;
+    slot.time_us = now_us();
+    slot.argc = argc;
+    for (uint8_t i = 0; i < argc; ++i) slot.args[i] = args[i];
+    slot.seq.store(ticket + 1, std::memory_order_release);
+}
+
+uint32_t written() {
+    return g_head.load(std::memory_order_acquire);
+}
+
+uint32_t oldest() {
+    const uint32_t head = written();
+    return head > kEntries ? head - kEntries : 0;
+}
+
+size_t read(uint32_t& cursor, uint8_t* out, size_t cap, uint32_t* lost) {
+    const uint32_t head = written();
+    if (head - cursor > kEntries) {
+        if (lost) *lost += head - cursor - kEntries;
+        cursor = head - kEntries;
+    }
+
+    size_t used = 0;
+    while (cursor != head) {
+        const Slot& slot = g_slots[cursor & (kEntries - 1)];
+        const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq == 0 || static_cast<int32_t>(seq - (cursor + 1)) < 0) break;  // still being written
+        if (seq != cursor + 1) {  // lapped by a newer entry
+            if (lost) ++*lost;
+            ++cursor;
+            continue;
+        }
+
+        uint32_t id = slot.id;
+        uint32_t time_us = slot.time_us;
+        uint8_t argc = slot.argc < kMaxArgs ? slot.argc : static_cast<uint8_t>(kMaxArgs);
+        uint32_t args[kMaxArgs];
+        for (uint8_t i = 0; i < argc; ++i) args[i] = slot.args[i];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) {  // overwritten while copying
+            if (lost) ++*lost;
+            ++cursor;
+            continue;
+        }
+
+        const size_t bytes = kEntryHeaderBytes + 4u * argc;
+        if (cap - used < bytes) break;
+        uint8_t* p = out + used;
+        memcpy(p, &id, 4);
+        memcpy(p + 4, &time_us, 4);
+        p[8] = argc;
+        memcpy(p + kEntryHeaderBytes, args, 4u * argc);
+        used += bytes;
+        ++cursor;
+    }
+    return used;
+}
+
+void clear() {
+    for (Slot& slot : g_slots) slot.seq.store(0, std::memory_order_relaxed);
+    g_head.store(0, std::memory_order_release);
+}
+
+}  // namespace binlog
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Deferred-format binary log. A BINLOG() call stores a 32-bit id of its
+// format string (FNV-1a, computed at compile time) plus its raw arguments
+// in a lock-free RAM ring; no formatting happens on the device. The BLE
+// `LOG` command streams the ring out and scripts/binlog_decode.py formats it
+// on the host, finding the strings by hashing every BINLOG() format in the
+// source tree. Cheap enough for the sensor task and ISR-free hot paths:
+// one atomic increment plus a handful of stores.
+//
+//   BINLOG("[I2C] reinit sensor=%u after %u failures", sensor, failures);
+//
+// Arguments are integers, enums, bools or floats (sent as float), at most
+// kMaxArgs; the format is still printf-checked at compile time. No strings.
+// Oldest entries are overwritten when the ring is full.
+#ifndef BINLOG_ENABLED
+#define BINLOG_ENABLED 1
+#endif
+
+// Ring size in entries, power of two (32 bytes each)
+#ifndef BINLOG_ENTRIES
+#define BINLOG_ENTRIES 128
+#endif
+
+namespace binlog {
+
+constexpr size_t kMaxArgs = 4;
+constexpr size_t kEntries = BINLOG_ENTRIES;
+static_assert((kEntries & (kEntries - 1)) == 0, "BINLOG_ENTRIES must be a power of two");
+
+// Wire form of one entry: [id u32][time_us u32][argc u8][args u32 x argc], LE
+constexpr size_t kEntryHeaderBytes = 9;
+constexpr size_t kMaxEntryBytes = kEntryHeaderBytes + 4 * kMaxArgs;
+
+constexpr uint32_t fnv1a(const char* s, uint32_t h = 2166136261u) {
+    return *s ? fnv1a(s + 1, (h ^ static_cast<uint8_t>(*s)) * 16777619u) : h;
+}
+
+inline uint32_t arg_word(float v) {
+    uint32_t w;
+    memcpy(&w, &v, sizeof(w));
+    return w;
+}
+inline uint32_t arg_word(double v) { return arg_word(static_cast<float>(v)); }
+template <typename T>
+inline uint32_t arg_word(T v) {
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                  "BINLOG arguments must be integers, enums or floats");
+    return static_cast<uint32_t>(v);
+}
+
+void write(uint32_t id, const uint32_t* args, uint8_t argc);
+
+inline void log(uint32_t id) {
+    write(id, nullptr, 0);
+}
+
+template <typename... Args>
+inline void log(uint32_t id, Args... args) {
+    static_assert(sizeof...(Args) <= kMaxArgs, "too many BINLOG arguments");
+    const uint32_t words[] = {arg_word(args)...};
+    write(id, words, static_cast<uint8_t>(sizeof...(Args)));
+}
+
+// Never called; lets the compiler check format strings against arguments
+void check_format(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// Entries written since boot (the ring keeps the last kEntries of them)
+uint32_t written();
+
+// Cursor of the oldest entry still in the ring
+uint32_t oldest();
+
+// Serialize entries from `cursor` in wire form into `out`, whole entries
+// only, advancing `cursor`. Entries overwritten before they were read are
+// skipped and added to `*lost`. Stops at an entry still being written.
+// Returns bytes written to `out`.
+size_t read(uint32_t& cursor, uint8_t* out, size_t cap, uint32_t* lost = nullptr);
+
+// Drop everything logged so far (host tests)
+void clear();
+
+}  // namespace binlog
+
+#if BINLOG_ENABLED
+#define BINLOG(fmt, ...)                                                                  \
+    do {                                                                                  \
+        (void)sizeof(::binlog::check_format("" fmt, ##__VA_ARGS__), 0);                   \
+        ::binlog::log(std::integral_constant<uint32_t, ::binlog::fnv1a(fmt)>::value,      \
+                      ##__VA_ARGS__);                                                     \
+    } while (0)
+#else
+// Still type-checked, nothing evaluated
+#define BINLOG(fmt, ...) \
+    do { (void)sizeof(::binlog::check_format("" fmt, ##__VA_ARGS__), 0); } while (0)
+#endif
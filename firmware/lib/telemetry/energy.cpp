@@ -0,0 +1,87 @@
+#include "energy.h"
+
+namespace energy {
+
+namespace {
+
+constexpr double kUcPerMah = 3600000.0;  // 1 mAh = 3.6 C
+constexpr double kSecondsPerDay = 86400.0;
+
+void charge(const Counters& c, const Model& m, double* out_uc) {
+    const double seconds = c.elapsed_ms / 1000.0;
+    out_uc[static_cast<size_t>(Subsystem::kBaseline)] = m.baseline_ua * seconds;
+    out_uc[static_cast<size_t>(Subsystem::kLed)] = c.led_charge_mc * 1000.0 * m.led_scale;
+    out_uc[static_cast<size_t>(Subsystem::kI2c)] = c.i2c_bytes * (double)m.i2c_nc_per_byte / 1000.0;
+    out_uc[static_cast<size_t>(Subsystem::kCpu)] = c.wakeups * (double)m.wakeup_nc / 1000.0;
+    out_uc[static_cast<size_t>(Subsystem::kRadio)] =
+        (c.radio_tx_packets * (double)m.radio_nc_per_packet + c.radio_tx_bytes * (double)m.radio_nc_per_byte) / 1000.0;
+    out_uc[static_cast<size_t>(Subsystem::kFlash)] =
+        (c.flash_bytes_written * (double)m.flash_nc_per_byte_written +
+         c.flash_bytes_erased * (double)m.flash_nc_per_byte_erased) / 1000.0;
+}
+
+Breakdown to_per_day(const double* charge_uc, double elapsed_s) {
+    Breakdown b{};
+    if (elapsed_s <= 0) return b;
+    const double scale = kSecondsPerDay / elapsed_s / kUcPerMah;
+    for (size_t i = 0; i < kSubsystemCount; ++i) {
+        b.mah_per_day[i] = static_cast<float>(charge_uc[i] * scale);
+        b.total_mah_per_day += b.mah_per_day[i];
+    }
+    return b;
+}
+
+}  // namespace
+
+const char* subsystem_name(Subsystem s) {
+    switch (s) {
+        case Subsystem::kBaseline: return "baseline";
+        case Subsystem::kLed:      return "led";
+        case Subsystem::kI2c:      return "i2c";
+        case Subsystem::kCpu:      return "cpu";
+        case Subsystem::kRadio:    return "radio";
+        case Subsystem::kFlash:    return "flash";
+        default:                   return "?";
+    }
+}
+
+Counters delta(const Counters& now, const Counters& before) {
+    Counters d;
+    d.elapsed_ms = now.elapsed_ms - before.elapsed_ms;
+    d.led_charge_mc = now.led_charge_mc - before.led_charge_mc;
+    d.i2c_bytes = now.i2c_bytes - before.i2c_bytes;
+    d.wakeups = now.wakeups - before.wakeups;
+    d.radio_tx_packets = now.radio_tx_packets - before.radio_tx_packets;
+    d.radio_tx_bytes = now.radio_tx_bytes - before.radio_tx_bytes;
+    d.flash_bytes_written = now.flash_bytes_written - before.flash_bytes_written;
+    d.flash_bytes_erased = now.flash_bytes_erased - before.flash_bytes_erased;
+    return d;
+}
+
+float Breakdown::battery_days(float capacity_mah) const {
+    return total_mah_per_day > 0 ? capacity_mah / total_mah_per_day : 0.0f;
+}
+
+Breakdown estimate(const Counters& counters, const Model& model) {
+    double uc[kSubsystemCount];
+    charge(counters, model, uc);
+    return to_per_day(uc, counters.elapsed_ms / 1000.0);
+}
+
+void Budget::add(const Counters& d) {
+    double uc[kSubsystemCount];
+    charge(d, model_, uc);
+    for (size_t i = 0; i < kSubsystemCount; ++i) charge_uc_[i] += uc[i];
+    elapsed_s_ += d.elapsed_ms / 1000.0;
+}
+
+Breakdown Budget::per_day() const {
+    return to_per_day(charge_uc_, elapsed_s_);
+}
+
+void Budget::reset() {
+    for (size_t i = 0; i < kSubsystemCount; ++i) charge_uc_[i] = 0;
+    elapsed_s_ = 0;
+}
+
+}  // namespace energy
@@ -0,0 +1,29 @@
+#include "mem_stats.h"
+
+#include <esp_heap_caps.h>
+
+#include "telemetry.h"
+
+namespace mem_stats {
+
+namespace {
+    // Free stack bytes at the task's deepest point so far (ESP-IDF counts in bytes)
+    uint32_t stack_free(TaskHandle_t task) {
+        return task ? static_cast<uint32_t>(uxTaskGetStackHighWaterMark(task)) : 0;
+    }
+}
+
+void collect(TaskHandle_t sensors_task) {
+    telemetry::set(telemetry::Stat::kStackFreeLoop, stack_free(xTaskGetCurrentTaskHandle()));
+    telemetry::set(telemetry::Stat::kStackFreeSensors, stack_free(sensors_task));
+#if INCLUDE_xTaskGetHandle
+    telemetry::set(telemetry::Stat::kStackFreeBle, stack_free(xTaskGetHandle("nimble_host")));
+    telemetry::set(telemetry::Stat::kStackFreeWriter, stack_free(xTaskGetHandle("StoreWriter")));
+#endif
+
+    telemetry::set(telemetry::Stat::kHeapFree, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    telemetry::set(telemetry::Stat::kHeapMinFree, heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    telemetry::set(telemetry::Stat::kHeapLargestBlock, heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
+
+}  // namespace mem_stats
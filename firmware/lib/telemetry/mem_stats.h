@@ -0,0 +1,13 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Stack high-water marks and heap figures, published through telemetry.
+// Call about once a second from loop(); each call walks a handful of tasks
+// and the heap allocator's summary, so it costs tens of microseconds.
+namespace mem_stats {
+
+void collect(TaskHandle_t sensors_task);
+
+}  // namespace mem_stats
@@ -0,0 +1,26 @@
+#include "telemetry.h"
+
+#include <atomic>
+
+namespace telemetry {
+
+namespace {
+    std::atomic<uint32_t> g_values[static_cast<size_t>(Stat::kCount)];
+}
+
+void set(Stat id, uint32_t value) {
+    if (id >= Stat::kCount) return;
+    g_values[static_cast<size_t>(id)].store(value, std::memory_order_relaxed);
+}
+
+void add(Stat id, uint32_t delta) {
+    if (id >= Stat::kCount) return;
+    g_values[static_cast<size_t>(id)].fetch_add(delta, std::memory_order_relaxed);
+}
+
+uint32_t get(Stat id) {
+    if (id >= Stat::kCount) return 0;
+    return g_values[static_cast<size_t>(id)].load(std::memory_order_relaxed);
+}
+
+}  // namespace telemetry
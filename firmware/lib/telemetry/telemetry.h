@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Device statistics published over the BLE `STATS` command.
+// Each stat is a 32-bit counter/gauge addressed by a stable numeric id so the
+// client can ignore ids it does not know about. Safe to update from any task.
+namespace telemetry {
+
+enum class Stat : uint8_t {
+    kLedChargeMc = 0,      // LED charge since boot (mA*s)
+    kLedAvgCurrentUa,      // average LED current at current settings (uA)
+    kLedAmplitude,         // MAX30102 LED pulse amplitude register
+    kLedPulseWidthUs,      // MAX30102 LED pulse width (us)
+    kLedAdjustments,       // number of AGC setting changes
+    kOffWristEvents,       // on -> off wrist transitions
+    kOffWristSeconds,      // time spent off-wrist (completed periods)
+    kImuStill,             // 1 while the IMU runs at the no-motion rate
+    kImuModeChanges,       // active <-> still transitions
+    kStepsHwTotal,         // BMI270 step counter reading
+    kStepDisagreements,    // hw/sw step count checks that failed
+    kSnapshotUs,           // duration of the last pipeline snapshot
+    kSnapshotBytes,        // bytes written by the last pipeline snapshot
+    kSnapshotRestores,     // boots that resumed from a snapshot
+    kI2cReinits,           // sensor re-initialisations after read failures
+    kI2cBusRecoveries,     // SDA-stuck recoveries run
+    kI2cOutages,           // failure streaks that took a sensor offline
+    kI2cOutageMs,          // total time sensors were offline (completed outages)
+    kI2cLongestOutageMs,   // longest single outage
+    kI2cMaxReadUs,         // slowest sensor read seen
+    kStackFreeLoop,        // loop task stack high-water mark (bytes never used)
+    kStackFreeSensors,     // sensor task stack high-water mark
+    kStackFreeBle,         // NimBLE host task stack high-water mark
+    kHeapFree,             // current free heap (bytes)
+    kHeapMinFree,          // lowest free heap since boot
+    kHeapLargestBlock,     // largest allocatable block (fragmentation)
+    kPpgIntervalMinUs,     // PPG FIFO check interval over the last minute: min
+    kPpgIntervalMaxUs,     //   max
+    kPpgIntervalP99Us,     //   99th percentile
+    kPpgMissed,            //   checks more than half a period late
+    kImuIntervalMinUs,     // IMU read interval per base period: min
+    kImuIntervalMaxUs,     //   max
+    kImuIntervalP99Us,     //   99th percentile
+    kImuMissed,            //   reads more than half a period late
+    kTempIntervalMaxUs,    // temperature read interval: max
+    kTempMissed,           //   reads more than half a period late
+    kTicksMerged,          // base ticks that arrived merged with another (since boot)
+    kI2cBytes,             // I2C bytes on the wire incl. address/register (since boot, wraps)
+    kWakeups,              // sensor task + loop wakeups (since boot, wraps)
+    kRadioTxPackets,       // BLE notifications sent
+    kRadioTxBytes,         // BLE notification payload bytes
+    kFlashBytesWritten,    // record bytes appended to LittleFS
+    kFlashBytesErased,     // flash bytes erased (blocks each append copies or takes)
+    kPowerBaselineUahDay,  // estimated consumption by subsystem (uAh/day, see energy.h): idle floor
+    kPowerLedUahDay,       //   MAX30102 LEDs
+    kPowerI2cUahDay,       //   I2C traffic
+    kPowerCpuUahDay,       //   CPU wakeups
+    kPowerRadioUahDay,     //   BLE notifications
+    kPowerFlashUahDay,     //   flash program/erase
+    kPowerTotalUahDay,     //   sum
+    kStoreQueueMax,        // deepest the storage writer queue has been
+    kStoreQueueFull,       // submits rejected because the queue was full
+    kStoreRecordsDropped,  // records lost after the writer stayed blocked for a whole interval
+    kStoreAppendMaxUs,     // slowest fs_store::append() in the writer task
+    kStoreAppendFailures,  // appends the writer could not complete
+    kStackFreeWriter,      // storage writer task stack high-water mark
+    kStorePreErased,       // flash sectors erased ahead of the allocator while idle
+    kSpillSessions,        // times the sample ring hit its watermark and spilled to flash
+    kSpillSamples,         // samples that went through the spill file
+    kSpillDropped,         // spilled samples lost (writer a block behind, bad block)
+    kImuDecimation,        // IMU samples averaged per ring entry under backpressure (1, 2, 4)
+    kImuReadsFolded,       // IMU reads averaged into a later ring entry
+    kBleCommandsDropped,   // control writes lost because the command queue was full
+    kChannelDrops,         // HR/temperature readings overwritten on a full channel ring
+    kSnapshotSamplesDropped,  // ring samples the last pipeline snapshot had no room for
+    kCount
+};
+
+void set(Stat id, uint32_t value);
+void add(Stat id, uint32_t delta);
+uint32_t get(Stat id);
+
+constexpr size_t count() { return static_cast<size_t>(Stat::kCount); }
+
+}  // namespace telemetry
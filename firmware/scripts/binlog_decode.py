@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Decode a BINLOG dump from the device (see lib/telemetry/binlog.h).
+
+The firmware logs a 32-bit FNV-1a hash of each format string plus raw
+argument words; this script rebuilds the id -> format table by scanning the
+sources for BINLOG("...") calls and formats the entries.
+
+Input is either the raw entry stream or, with --packets, the BLE `LOG`
+notifications one per line as hex (0x05 chunks and the 0x06 end packet).
+
+    scripts/binlog_decode.py --packets log_notifications.txt
+"""
+
+import argparse
+import codecs
+import pathlib
+import re
+import struct
+import sys
+
+ROOT = pathlib.Path(__file__).resolve().parent.parent
+CALL = re.compile(r'\bBINLOG\(\s*"((?:[^"\\]|\\.)*)"')
+SPEC = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diouxXcfFeEgG%])')
+LOG_MARKER = 0x05
+LOG_END_MARKER = 0x06
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def load_formats(dirs):
+    formats = {}
+    for d in dirs:
+        for path in sorted(pathlib.Path(d).rglob("*")):
+            if path.suffix not in (".cpp", ".h", ".hpp", ".c"):
+                continue
+            for literal in CALL.findall(path.read_text(errors="replace")):
+                fmt = codecs.decode(literal, "unicode_escape")
+                fid = fnv1a(fmt.encode("latin-1"))
+                if fid in formats and formats[fid] != fmt:
+                    print(f"warning: id 0x{fid:08x} collides: {formats[fid]!r} / {fmt!r}", file=sys.stderr)
+                formats[fid] = fmt
+    return formats
+
+
+def render(fmt, words):
+    out = []
+    pos = 0
+    args = iter(words)
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, _, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        word = next(args, 0)
+        if conv in "di":
+            value = struct.unpack("<i", struct.pack("<I", word))[0]
+        elif conv in "fFeEgG":
+            value = struct.unpack("<f", struct.pack("<I", word))[0]
+        elif conv == "c":
+            value = chr(word & 0xFF)
+        else:
+            value = word
+        out.append(("%" + flags + conv) % value)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def parse_stream(data):
+    pos = 0
+    while pos + 9 <= len(data):
+        fid, time_us, argc = struct.unpack_from("<IIB", data, pos)
+        pos += 9
+        if pos + 4 * argc > len(data):
+            break
+        yield fid, time_us, struct.unpack_from(f"<{argc}I", data, pos)
+        pos += 4 * argc
+    if pos != len(data):
+        print(f"warning: {len(data) - pos} trailing bytes", file=sys.stderr)
+
+
+def read_packets(path):
+    stream = bytearray()
+    for line in pathlib.Path(path).read_text().split("\n"):
+        packet = bytes.fromhex(line.replace(":", "").replace(" ", "").strip())
+        if not packet:
+            continue
+        if packet[0] == LOG_MARKER:
+            stream += packet[1:]
+        elif packet[0] == LOG_END_MARKER and len(packet) >= 9:
+            sent, written = struct.unpack_from("<II", packet, 1)
+            print(f"# {sent} entries sent, {written} logged since boot", file=sys.stderr)
+    return bytes(stream)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="raw entry stream, or hex packets with --packets")
+    parser.add_argument("--packets", action="store_true", help="input is BLE LOG notifications, one hex packet per line")
+    parser.add_argument("--src", action="append", help="source dirs to scan (default: src, lib, include)")
+    args = parser.parse_args()
+
+    dirs = args.src or [ROOT / "src", ROOT / "lib", ROOT / "include"]
+    formats = load_formats(dirs)
+    data = read_packets(args.input) if args.packets else pathlib.Path(args.input).read_bytes()
+
+    first = None
+    elapsed = 0
+    for fid, time_us, words in parse_stream(data):
+        # micros() wraps every ~71.6 minutes; entries are in log order, but two
+        # tasks can stamp and commit theirs out of order by a few us, so read
+        # the step as signed and never let it run the clock backwards
+        if first is not None:
+            step = (time_us - first) & 0xFFFFFFFF
+            if step >= 0x80000000:
+                step -= 0x100000000
+            elapsed += max(step, 0)
+        first = time_us
+        fmt = formats.get(fid)
+        text = render(fmt, words) if fmt is not None else f"<unknown 0x{fid:08x}> {' '.join(f'0x{w:08x}' for w in words)}"
+        print(f"{elapsed / 1e6:12.6f}  {text}")
+
+
+if __name__ == "__main__":
+    main()
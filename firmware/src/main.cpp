@@ -3,49 +3,213 @@
 #include <string>
 #include <vector>
 #include <sys/time.h>
+#include <esp_system.h>
+#include <LittleFS.h>  // LITTLEFS_HAS_PRE_ERASE
 
 #include "app_config.h"
 #include "wifi/wifi_mgr.h"
 #include "ringbuf/reg_buffer.h"
 #include "compute/consolidate.h"
+#include "compute/snapshot.h"
+#include "compute/step_reconcile.h"
 #include "storage/fs_store.h"
+#include "storage/sample_spill.h"
+#include "storage/store_writer.h"
 // #include "compute/mockdata.h"
 #include "ble/ble_service.h"
 #include "sensors.h"
+#include "telemetry/binlog.h"
+#include "telemetry/telemetry.h"
+#include "telemetry/mem_stats.h"
+#include "telemetry/energy.h"
 
 namespace {
 
 volatile uint32_t gFallbackBaseMillis = 0;
-volatile bool gResetRingRequested = false;
 reg_buffer::SampleRingBuffer gRing;
+// Samples replayed from the spill file (and those they follow), consolidated before gRing
+reg_buffer::SampleRingBuffer gReplay;
+// Heart rate (on change) and body temperature (1 Hz), joined to the IMU
+// samples by timestamp during consolidation
+reg_buffer::ChannelRing gHrChannel;
+reg_buffer::ChannelRing gTempChannel;
+reg_buffer::ChannelRing gWearChannel;
 static consolidate::IntervalAccumulator gAccumulator;
+static step_reconcile::Reconciler gStepReconciler;
+
+// Warm-restart snapshot. RTC slow memory is kept across every reset except
+// power-on; the image's CRC rejects anything a brownout left half-written.
+RTC_NOINIT_ATTR uint32_t gSnapshotMem[(sizeof(snapshot::Image) + 3) / 4];
+uint32_t gLastSnapshotMs = 0;
+uint32_t gLastMemStatsMs = 0;
+uint32_t gLastEnergyMs = 0;
+#ifdef LITTLEFS_HAS_PRE_ERASE
+uint32_t gLastPreEraseMs = 0;
+#endif
+
+// Interval record the writer queue had no room for, resubmitted next pass
+consolidate::ConsolidatedRecord gHeldRecord{};
+bool gHaveHeldRecord = false;
+// Records handed to the writer that a reset could still lose, kept in the snapshot
+snapshot::PendingRecords gPendingRecords;
+static_assert(snapshot::kMaxPending >= kStoreQueueDepth + 1, "snapshot must cover the writer queue and held record");
+
+snapshot::Image& rtc_snapshot() {
+  return *reinterpret_cast<snapshot::Image*>(gSnapshotMem);
+}
+
+void save_snapshot() {
+  const uint32_t start = micros();
+  const size_t bytes = snapshot::capture(rtc_snapshot(), gReplay, gRing, gAccumulator, gPendingRecords);
+  telemetry::set(telemetry::Stat::kSnapshotUs, micros() - start);
+  telemetry::set(telemetry::Stat::kSnapshotBytes, bytes);
+  telemetry::set(telemetry::Stat::kSnapshotSamplesDropped, rtc_snapshot().dropped_samples);
+  gLastSnapshotMs = millis();
+}
+
+energy::Model energy_model() {
+  energy::Model model;
+  model.baseline_ua = ENERGY_BASELINE_UA;
+  return model;
+}
+
+energy::Budget gEnergyBudget(energy_model());
+energy::Counters gEnergyLast;
+
+energy::Counters read_energy_counters() {
+  energy::Counters c;
+  c.elapsed_ms = millis();
+  c.led_charge_mc = telemetry::get(telemetry::Stat::kLedChargeMc);
+  c.i2c_bytes = telemetry::get(telemetry::Stat::kI2cBytes);
+  c.wakeups = telemetry::get(telemetry::Stat::kWakeups);
+  c.radio_tx_packets = telemetry::get(telemetry::Stat::kRadioTxPackets);
+  c.radio_tx_bytes = telemetry::get(telemetry::Stat::kRadioTxBytes);
+  c.flash_bytes_written = telemetry::get(telemetry::Stat::kFlashBytesWritten);
+  c.flash_bytes_erased = telemetry::get(telemetry::Stat::kFlashBytesErased);
+  return c;
+}
+
+// Fold the counters since the last call into the budget and publish the
+// per-subsystem estimate (uAh/day)
+void update_energy() {
+  const energy::Counters now = read_energy_counters();
+  gEnergyBudget.add(energy::delta(now, gEnergyLast));
+  gEnergyLast = now;
+  gLastEnergyMs = now.elapsed_ms;
+
+  const energy::Breakdown b = gEnergyBudget.per_day();
+  // kPower*UahDay follow energy::Subsystem order
+  static_assert(static_cast<size_t>(telemetry::Stat::kPowerTotalUahDay) -
+                static_cast<size_t>(telemetry::Stat::kPowerBaselineUahDay) == energy::kSubsystemCount,
+                "power stats out of step with energy::Subsystem");
+  const telemetry::Stat first = telemetry::Stat::kPowerBaselineUahDay;
+  for (size_t i = 0; i < energy::kSubsystemCount; ++i) {
+    telemetry::set(static_cast<telemetry::Stat>(static_cast<size_t>(first) + i),
+                   static_cast<uint32_t>(b.mah_per_day[i] * 1000.0f));
+  }
+  telemetry::set(telemetry::Stat::kPowerTotalUahDay, static_cast<uint32_t>(b.total_mah_per_day * 1000.0f));
+}
+
+void submit_held_record() {
+  if (gHaveHeldRecord && store_writer::submit(gHeldRecord) != store_writer::Submit::kFull) {
+    gHaveHeldRecord = false;
+  }
+}
+
+// Hand a record to the storage writer task. A full queue holds the record for
+// the next pass; if the writer is still stuck when the next interval closes,
+// the older record is dropped so the loop never waits on flash.
+void store_record(const consolidate::ConsolidatedRecord& record) {
+  submit_held_record();
+  if (gHaveHeldRecord) {
+    telemetry::add(telemetry::Stat::kStoreRecordsDropped, 1);
+    gHeldRecord = record;
+    gPendingRecords.replace_last(record);
+    return;
+  }
+  gPendingRecords.push(record);
+  if (store_writer::submit(record) == store_writer::Submit::kFull) {
+    gHeldRecord = record;
+    gHaveHeldRecord = true;
+  }
+}
+
+// The snapshot's pending records that never reached flash go back to the
+// writer; those the file already ends with are skipped
+void resubmit_pending(const snapshot::Image& image) {
+  consolidate::ConsolidatedRecord tail[snapshot::kMaxPending];
+  const size_t records = fs_store::record_count();
+  const size_t first = records > snapshot::kMaxPending ? records - snapshot::kMaxPending : 0;
+  size_t n = 0;
+  fs_store::for_each_record_from(first, [&](const consolidate::ConsolidatedRecord& record, size_t) {
+    tail[n++] = record;
+    return n < snapshot::kMaxPending;
+  });
+  for (size_t i = snapshot::first_unsaved(image.pending, image.pending_count, tail, n); i < image.pending_count; ++i) {
+    store_record(image.pending[i]);
+  }
+}
+
+// Runs before the sensor task starts filling the ring
+void restore_snapshot() {
+  const esp_reset_reason_t reason = esp_reset_reason();
+  if (reason == ESP_RST_POWERON || reason == ESP_RST_UNKNOWN) {
+    snapshot::invalidate(rtc_snapshot());  // RTC contents are random
+    return;
+  }
+  if (snapshot::restore(rtc_snapshot(), gReplay, gRing, gAccumulator)) {
+    telemetry::add(telemetry::Stat::kSnapshotRestores, 1);
+    resubmit_pending(rtc_snapshot());
+    BINLOG("[MAIN] Restored pipeline snapshot (%u samples, %u lost before it)",
+           static_cast<unsigned>(gReplay.size() + gRing.size()),
+           static_cast<unsigned>(rtc_snapshot().dropped_samples));
+  }
+}
 
 void reset_fallback_clock() {
   gFallbackBaseMillis = millis();
 }
 
+// BLE command handlers run on this task from bleServer.update()
 void handle_ble_erase() {
   // Serial.println("[BLE] Erase command received");
-  if (fs_store::erase()) {
-    // Serial.println("[BLE] Filesystem data cleared");
+  // Queued records predate the erase and go with it
+  gHaveHeldRecord = false;
+  gPendingRecords.clear();
+  if (store_writer::erase(kStoreBarrierTimeoutMs)) {
+    BINLOG("[BLE] Filesystem data cleared");
   } else {
-    // Serial.println("[BLE] Filesystem erase failed");
+    BINLOG("[BLE] Filesystem erase failed");
   }
   reset_fallback_clock();
-  gResetRingRequested = true;
+  snapshot::invalidate(rtc_snapshot());
+  gRing.clear();
+  gReplay.clear();
+  gHrChannel.clear();
+  gTempChannel.clear();
+  // gWearChannel is kept: a transition still pending applies to the samples
+  // taken after the erase
+  sample_spill::discard();
 }
 
 void handle_ble_time_sync(time_t epoch) {
-  // Serial.printf("[BLE] Time sync epoch=%lld\n", static_cast<long long>(epoch));
+  BINLOG("[BLE] Time sync epoch=%u", static_cast<unsigned>(epoch));
+  const bool backward = epoch < time(nullptr);
   struct timeval tv;
   tv.tv_sec = epoch;
   tv.tv_usec = 0;
   settimeofday(&tv, nullptr);
   reset_fallback_clock();
+  if (backward) consolidate::clock_stepped_back();
 }
 
 void handle_transfer_start() {
   // Serial.println("[BLE] Transfer starting");
+  // Everything consolidated so far goes out in this transfer
+  submit_held_record();
+  if (!store_writer::flush(kStoreBarrierTimeoutMs)) {
+    BINLOG("[BLE] Storage writer did not drain before transfer");
+  }
 }
 
 void handle_transfer_complete() {
@@ -73,6 +237,10 @@ void setup() {
   else {
     // Serial.println("[MAIN] Filesystem initialized successfully.");
   }
+  if (!store_writer::begin()) {
+    BINLOG("[MAIN] Storage writer task failed; appending inline.");
+  }
+  sample_spill::begin([] { store_writer::spill(); });
 
   reset_fallback_clock();
 
@@ -84,11 +252,16 @@ void setup() {
   bleServer.onTransferComplete = handle_transfer_complete;
   // Serial.println("[MAIN] BLE server initialized");
 
-  sensors_setup(&gRing);
+  restore_snapshot();
+  consolidate::attach_channels(&gHrChannel, &gTempChannel, &gWearChannel);
+  sensors_setup(&gRing, &gHrChannel, &gTempChannel, &gWearChannel);
+  gEnergyLast = read_energy_counters();
+  gLastEnergyMs = gEnergyLast.elapsed_ms;
 }
 
 void loop() {
   sensors_loop();
+  telemetry::add(telemetry::Stat::kWakeups, 1);
   
   // const uint32_t now = millis();
   // if (now - gLastProcess >= kLoopIntervalMs) {
@@ -105,11 +278,6 @@ void loop() {
   // else {
   //   Serial.println("WiFi not connected, retrying...");
   //   delay(5000);  // Retry every 5 seconds if not connected
-  if (gResetRingRequested) {
-    gRing.clear();
-    gResetRingRequested = false;
-  }
-
   // reg_buffer::Sample sample{}; // initialize cycle reading struct
 
 
@@ -142,22 +310,47 @@ void loop() {
   // }
 
 
+  // After a stall (e.g. a long SEND) the spilled samples come back here
+  sample_spill::replay(gRing, gReplay);
   consolidate::ConsolidatedRecord record{};
-  if (consolidate::consolidate_from_ring(gRing, record)) {
+  if (consolidate::consolidate_from_ring(gReplay, gRing, record)) {
+    uint32_t hwSteps = 0;
+    const bool hwStepsOk = sensors_hw_step_total(hwSteps);
+    record.step_count = gStepReconciler.reconcile(record.step_count, !IMU_STEPS_ONLY, hwSteps, hwStepsOk);
+    if (gStepReconciler.last_source() == step_reconcile::Source::kHardware) {
+      record.flags |= consolidate::kFlagHwSteps;
+    }
+    telemetry::set(telemetry::Stat::kStepDisagreements, gStepReconciler.disagreements());
     consolidate::ConsolidatedRecord intervalRecord{};
     if (gAccumulator.add(record, intervalRecord)) {
-      // Serial.printf("[MAIN] 15s Interval accumulated: Steps=%u HR=%.1f Temp=%.2f\n", 
-      //     intervalRecord.step_count, 
-      //     intervalRecord.avg_hr_x10/10.0, 
-      //     intervalRecord.avg_temp_x100/100.0);
-
-      if (fs_store::append(intervalRecord)) {
-        // Serial.println("[STORE] Interval record appended");
-      } else {
-        // Serial.println("[STORE] Failed to append interval record");
-      }
+      BINLOG("[MAIN] 15s Interval accumulated: Steps=%u HR=%.1f Temp=%.2f", intervalRecord.step_count,
+             intervalRecord.avg_hr_x10 / 10.0f, intervalRecord.avg_temp_x100 / 100.0f);
+
+      store_record(intervalRecord);
+      // An image from before this hand-off would emit the interval again
+      save_snapshot();
     }
   }
+  submit_held_record();
+#ifdef LITTLEFS_HAS_PRE_ERASE
+  // Transfers run inside bleServer.update() on this task and flush the writer
+  // first, so a pre-erase never overlaps one. Without the driver hook there is
+  // nothing to erase, so the writer is not woken for it.
+  if (millis() - gLastPreEraseMs >= kPreEraseIntervalMs && gRing.size() < kPreEraseRingWatermark) {
+    gLastPreEraseMs = millis();
+    store_writer::pre_erase();
+  }
+#endif
+  if (millis() - gLastSnapshotMs >= kSnapshotIntervalMs) {
+    save_snapshot();
+  }
+  if (millis() - gLastMemStatsMs >= kMemStatsIntervalMs) {
+    gLastMemStatsMs = millis();
+    mem_stats::collect(sensors_task_handle());
+  }
+  if (millis() - gLastEnergyMs >= kEnergyIntervalMs) {
+    update_energy();
+  }
   bleServer.update();
   delay(5);
 
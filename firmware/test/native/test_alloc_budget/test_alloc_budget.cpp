@@ -0,0 +1,94 @@
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "compute/consolidate.h"
+#include "compute/snapshot.h"
+#include "compute/step_reconcile.h"
+#include "telemetry/alloc_track.h"
+
+// Per-stage heap accounting for the consolidation pipeline (native env builds
+// with ALLOC_TRACKING). Runs ten minutes of 50 Hz samples through the same
+// stages as loop() and prints a table of allocations per stage; the steady
+// state must not touch the heap.
+
+namespace {
+
+constexpr float kPi = 3.14159265f;
+
+reg_buffer::Sample sample_at(size_t i) {
+    const float t = i / 50.0f;
+    reg_buffer::Sample s{};
+    s.ax = reg_buffer::float16(1.0f + 0.3f * std::sin(2 * kPi * 1.8f * t));
+    s.timestamp = 1700000000u + static_cast<uint32_t>(i / 50);
+    return s;
+}
+
+void run_pipeline(size_t seconds) {
+    static reg_buffer::SampleRingBuffer ring;
+    static consolidate::IntervalAccumulator accumulator;
+    static step_reconcile::Reconciler reconciler;
+    static reg_buffer::SampleRingBuffer replay;
+    static snapshot::PendingRecords pending;
+    static snapshot::Image image;
+    for (size_t i = 0; i < seconds * 50; ++i) {
+        ring.push(sample_at(i));
+        consolidate::ConsolidatedRecord rec{};
+        if (consolidate::consolidate_from_ring(ring, rec)) {
+            rec.step_count = reconciler.reconcile(rec.step_count, true, 0, false);
+            consolidate::ConsolidatedRecord out{};
+            accumulator.add(rec, out);
+        }
+        if (i % 50 == 0) snapshot::capture(image, replay, ring, accumulator, pending);
+    }
+}
+
+}  // namespace
+
+void setUp() { alloc_track::reset(); }
+void tearDown() {}
+
+void test_tracker_counts_stage_allocations() {
+    {
+        ALLOC_STAGE("outer");
+        std::vector<int> a(100);
+        {
+            ALLOC_STAGE("inner");
+            std::vector<int> b(50);
+        }
+    }
+    const alloc_track::StageStats* outer = alloc_track::find("outer");
+    const alloc_track::StageStats* inner = alloc_track::find("inner");
+    TEST_ASSERT_NOT_NULL(outer);
+    TEST_ASSERT_NOT_NULL(inner);
+    TEST_ASSERT_EQUAL_UINT32(1, outer->allocations);
+    TEST_ASSERT_EQUAL_UINT32(1, inner->allocations);
+    TEST_ASSERT_EQUAL(400u + 200u, outer->peak_bytes);  // nested allocations count towards the parent
+    TEST_ASSERT_EQUAL(200u, inner->peak_bytes);
+}
+
+void test_pipeline_steady_state_does_not_allocate() {
+    run_pipeline(600);
+
+    std::printf("%-16s %8s %8s %10s %10s\n", "stage", "entries", "allocs", "bytes", "peak");
+    for (size_t i = 0; i < alloc_track::stage_count(); ++i) {
+        const alloc_track::StageStats& s = alloc_track::stage(i);
+        std::printf("%-16s %8u %8u %10u %10u\n", s.name, static_cast<unsigned>(s.entries),
+                    static_cast<unsigned>(s.allocations), static_cast<unsigned>(s.bytes),
+                    static_cast<unsigned>(s.peak_bytes));
+        TEST_ASSERT_EQUAL_UINT32(0, s.allocations);
+    }
+    TEST_ASSERT_NOT_NULL(alloc_track::find("consolidate"));
+    TEST_ASSERT_NOT_NULL(alloc_track::find("interval"));
+    TEST_ASSERT_NOT_NULL(alloc_track::find("snapshot"));
+    TEST_ASSERT_NOT_NULL(alloc_track::find("step_reconcile"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_tracker_counts_stage_allocations);
+    RUN_TEST(test_pipeline_steady_state_does_not_allocate);
+    return UNITY_END();
+}
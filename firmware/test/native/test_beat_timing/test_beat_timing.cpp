@@ -0,0 +1,198 @@
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "sensors/beat_timing.h"
+
+// Beat intervals from the PPG sample clock against synthetic pulse trains:
+// a 100 Hz sample stream (optionally with oscillator skew) carrying beats at
+// a varying heart rate, drained from a 32-sample FIFO at different periods
+// with read jitter, stalls and FIFO overflow. Each run also times the beats
+// the old way (processing time of the drain) for comparison.
+
+namespace {
+
+constexpr uint32_t kPeriodUs = 10000;  // configured 100 Hz
+constexpr size_t kFifoDepth = 32;
+
+struct Scenario {
+    uint32_t drain_us = 50000;
+    double skew = 0.0;              // sensor oscillator error (+: slow)
+    uint32_t jitter_us = 2000;      // read time after the drain tick
+    uint32_t stall_at_s = 0;        // one long stall (0: none)
+    uint32_t stall_us = 0;
+    uint32_t seconds = 120;
+    uint32_t warmup_s = 10;         // intervals before this are not scored
+};
+
+struct Errors {
+    size_t intervals = 0;
+    double sum_abs_us = 0;
+    double max_abs_us = 0;
+    double max_rel = 0;
+
+    void add(double measured_us, double truth_us) {
+        const double e = std::fabs(measured_us - truth_us);
+        ++intervals;
+        sum_abs_us += e;
+        if (e > max_abs_us) max_abs_us = e;
+        if (e / truth_us > max_rel) max_rel = e / truth_us;
+    }
+    double mean_us() const { return intervals ? sum_abs_us / intervals : 0; }
+};
+
+struct Result {
+    Errors sample_clock;
+    Errors processing_time;
+    uint32_t lost_samples = 0;
+    uint32_t reanchors = 0;
+    float period_us = 0;
+};
+
+Result run(const Scenario& sc) {
+    const double true_period = kPeriodUs * (1.0 + sc.skew);
+    const uint64_t end_us = static_cast<uint64_t>(sc.seconds) * 1000000u;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<uint32_t> jitter(0, sc.jitter_us);
+
+    // Beats at 60-90 bpm varying slowly; each lands on the first sample after it
+    std::vector<bool> is_beat(static_cast<size_t>(end_us / true_period) + 2, false);
+    for (double t = 500000; t < end_us;) {
+        is_beat[static_cast<size_t>(std::ceil(t / true_period))] = true;
+        const double bpm = 75 + 15 * std::sin(t / 20e6);
+        t += 60e6 / bpm;
+    }
+
+    beat_timing::BeatClock clock(kPeriodUs);
+    Result result;
+    std::deque<size_t> fifo;
+    size_t next_sample = 0;
+    bool have_truth = false, have_legacy = false;
+    double last_truth_us = 0, last_legacy_us = 0;
+
+    for (uint64_t tick = sc.drain_us; tick < end_us; tick += sc.drain_us) {
+        uint64_t read_us = tick + jitter(rng);
+        if (sc.stall_at_s && tick / 1000000u == sc.stall_at_s && tick % 1000000u < sc.drain_us) read_us += sc.stall_us;
+        if (read_us >= end_us) break;
+        // The FIFO rolls over: a sample arriving when it is full replaces the oldest
+        while (next_sample * true_period <= read_us) {
+            if (fifo.size() == kFifoDepth) {
+                fifo.pop_front();
+                ++result.lost_samples;
+            }
+            fifo.push_back(next_sample++);
+        }
+
+        clock.begin_drain(static_cast<uint32_t>(read_us));
+        std::vector<size_t> beats;
+        for (size_t k : fifo) {
+            clock.sample(is_beat[k]);
+            if (is_beat[k]) beats.push_back(k);
+        }
+        fifo.clear();
+        const size_t n = clock.end_drain();
+        if (n != beats.size()) {
+            result.sample_clock.intervals = 0;  // flagged by the caller
+            return result;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            const double truth_us = beats[i] * true_period;
+            const bool scored = truth_us >= sc.warmup_s * 1e6;
+            if (have_truth && scored) {
+                result.sample_clock.add(clock.interval_us(i), truth_us - last_truth_us);
+                result.processing_time.add(have_legacy ? (read_us / 1000) * 1000.0 - last_legacy_us : 0,
+                                           truth_us - last_truth_us);
+            }
+            last_truth_us = truth_us;
+            have_truth = true;
+            last_legacy_us = (read_us / 1000) * 1000.0;  // millis() at processing
+            have_legacy = true;
+        }
+    }
+    result.reanchors = clock.reanchors();
+    result.period_us = clock.period_us();
+    return result;
+}
+
+void print_row(const char* label, const Result& r) {
+    printf("  %-22s sample clock: mean %6.0f us, max %6.0f us (%4.1f%%) | processing time: mean %7.0f us, max %7.0f us (%5.1f%%)\n",
+           label, r.sample_clock.mean_us(), r.sample_clock.max_abs_us, r.sample_clock.max_rel * 100,
+           r.processing_time.mean_us(), r.processing_time.max_abs_us, r.processing_time.max_rel * 100);
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+// Beat interval error does not depend on how many samples a drain carries
+void test_batch_sizes() {
+    printf("\n[beat interval error by FIFO drain period, 100 Hz, 60-90 bpm]\n");
+    for (uint32_t drain_ms : {10u, 50u, 100u, 200u, 300u}) {
+        Scenario sc;
+        sc.drain_us = drain_ms * 1000;
+        const Result r = run(sc);
+        char label[32];
+        snprintf(label, sizeof(label), "drain %3u ms (%2u/batch)", drain_ms, drain_ms * 1000 / kPeriodUs);
+        print_row(label, r);
+
+        TEST_ASSERT_TRUE(r.sample_clock.intervals > 100);
+        TEST_ASSERT_EQUAL_UINT32(0, r.lost_samples);
+        TEST_ASSERT_EQUAL_UINT32(0, r.reanchors);
+        // Within a fraction of one sample period regardless of batch size
+        TEST_ASSERT_TRUE(r.sample_clock.max_abs_us < kPeriodUs / 2);
+        TEST_ASSERT_TRUE(r.sample_clock.max_rel < 0.01);
+        if (drain_ms >= 100) TEST_ASSERT_TRUE(r.processing_time.max_abs_us > 5 * r.sample_clock.max_abs_us);
+    }
+}
+
+// A 600 ms stall overflows the 32-sample FIFO: the gap is measured, not
+// squeezed out of the interval that spans it
+void test_fifo_overflow_gap() {
+    Scenario sc;
+    sc.drain_us = 100000;
+    sc.stall_at_s = 30;
+    sc.stall_us = 600000;
+    const Result r = run(sc);
+    printf("\n[FIFO overflow] %u samples lost, %u re-anchors\n", r.lost_samples, r.reanchors);
+    print_row("drain 100 ms + stall", r);
+
+    TEST_ASSERT_TRUE(r.lost_samples > 0);
+    TEST_ASSERT_EQUAL_UINT32(1, r.reanchors);
+    // Every interval, including the one across the gap, within a few sample periods
+    TEST_ASSERT_TRUE(r.sample_clock.max_abs_us < 3 * kPeriodUs);
+    TEST_ASSERT_TRUE(r.sample_clock.mean_us() < kPeriodUs / 2);
+}
+
+// The MAX30102 runs on its own oscillator; the period calibrates to it
+void test_oscillator_skew() {
+    printf("\n[sensor oscillator skew, drain 100 ms]\n");
+    for (double skew : {-0.03, 0.02}) {
+        Scenario sc;
+        sc.drain_us = 100000;
+        sc.skew = skew;
+        sc.warmup_s = 30;
+        const Result r = run(sc);
+        char label[32];
+        snprintf(label, sizeof(label), "skew %+.0f%% (%.0f us)", skew * 100, r.period_us);
+        print_row(label, r);
+
+        const double true_period = kPeriodUs * (1.0 + skew);
+        TEST_ASSERT_TRUE(std::fabs(r.period_us - true_period) < true_period * 0.002);
+        TEST_ASSERT_TRUE(r.sample_clock.max_rel < 0.01);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_sizes);
+    RUN_TEST(test_fifo_overflow_gap);
+    RUN_TEST(test_oscillator_skew);
+    return UNITY_END();
+}
@@ -0,0 +1,181 @@
+#include <unity.h>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "telemetry/binlog.h"
+
+// Binary log ring: compile-time format ids, wire encoding, overwrite of the
+// oldest entries, partial reads, and torn-entry safety with concurrent
+// producers and a reader.
+
+namespace {
+
+struct Entry {
+    uint32_t id;
+    uint32_t time_us;
+    std::vector<uint32_t> args;
+};
+
+// Parse a wire stream; false if it does not end on an entry boundary
+bool parse(const uint8_t* data, size_t len, std::vector<Entry>& out) {
+    size_t pos = 0;
+    while (pos < len) {
+        if (len - pos < binlog::kEntryHeaderBytes) return false;
+        Entry e;
+        memcpy(&e.id, data + pos, 4);
+        memcpy(&e.time_us, data + pos + 4, 4);
+        const uint8_t argc = data[pos + 8];
+        pos += binlog::kEntryHeaderBytes;
+        if (argc > binlog::kMaxArgs || len - pos < 4u * argc) return false;
+        e.args.resize(argc);
+        memcpy(e.args.data(), data + pos, 4u * argc);
+        pos += 4u * argc;
+        out.push_back(e);
+    }
+    return true;
+}
+
+std::vector<Entry> read_all(uint32_t& cursor, uint32_t* lost = nullptr) {
+    std::vector<Entry> entries;
+    uint8_t buf[256];
+    for (;;) {
+        const size_t n = binlog::read(cursor, buf, sizeof(buf), lost);
+        if (n == 0 || !parse(buf, n, entries)) break;
+    }
+    return entries;
+}
+
+}  // namespace
+
+void setUp() {
+    binlog::clear();
+}
+
+void tearDown() {}
+
+void test_format_id_is_fnv1a() {
+    static_assert(binlog::fnv1a("") == 0x811c9dc5u, "FNV-1a offset basis");
+    static_assert(binlog::fnv1a("a") == 0xe40c292cu, "FNV-1a of \"a\"");
+    static_assert(binlog::fnv1a("foobar") == 0xbf9cf968u, "FNV-1a of \"foobar\"");
+    TEST_ASSERT_NOT_EQUAL(binlog::fnv1a("[BLE] Connected"), binlog::fnv1a("[BLE] Disconnected"));
+}
+
+void test_round_trip() {
+    BINLOG("no args");
+    BINLOG("int %d unsigned %u", -5, 7u);
+    BINLOG("float %.2f byte 0x%02X bool %d", 36.75f, static_cast<uint8_t>(0xAB), true);
+
+    uint32_t cursor = binlog::oldest();
+    const std::vector<Entry> entries = read_all(cursor);
+    TEST_ASSERT_EQUAL_size_t(3, entries.size());
+    TEST_ASSERT_EQUAL_UINT32(binlog::written(), cursor);
+
+    TEST_ASSERT_EQUAL_UINT32(binlog::fnv1a("no args"), entries[0].id);
+    TEST_ASSERT_EQUAL_size_t(0, entries[0].args.size());
+
+    TEST_ASSERT_EQUAL_UINT32(binlog::fnv1a("int %d unsigned %u"), entries[1].id);
+    TEST_ASSERT_EQUAL_size_t(2, entries[1].args.size());
+    TEST_ASSERT_EQUAL_INT32(-5, static_cast<int32_t>(entries[1].args[0]));
+    TEST_ASSERT_EQUAL_UINT32(7, entries[1].args[1]);
+
+    float f;
+    memcpy(&f, &entries[2].args[0], 4);
+    TEST_ASSERT_EQUAL_FLOAT(36.75f, f);
+    TEST_ASSERT_EQUAL_UINT32(0xAB, entries[2].args[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, entries[2].args[2]);
+
+    TEST_ASSERT_TRUE(entries[1].time_us - entries[0].time_us < 1000000u);
+}
+
+// A full ring keeps the newest kEntries; a reader left behind is told how many it missed
+void test_overwrites_oldest() {
+    const uint32_t extra = 10;
+    for (uint32_t i = 0; i < binlog::kEntries + extra; ++i) BINLOG("seq %u", i);
+
+    uint32_t from_start = 0;
+    uint32_t lost = 0;
+    const std::vector<Entry> entries = read_all(from_start, &lost);
+    TEST_ASSERT_EQUAL_UINT32(extra, lost);
+    TEST_ASSERT_EQUAL_size_t(binlog::kEntries, entries.size());
+    TEST_ASSERT_EQUAL_UINT32(extra, entries.front().args[0]);
+    TEST_ASSERT_EQUAL_UINT32(binlog::kEntries + extra - 1, entries.back().args[0]);
+    TEST_ASSERT_EQUAL_UINT32(extra, binlog::oldest());
+}
+
+// Reads return whole entries only and resume where they stopped
+void test_partial_reads() {
+    for (uint32_t i = 0; i < 20; ++i) BINLOG("a=%u b=%u", i, i * 2);
+    const size_t entry_bytes = binlog::kEntryHeaderBytes + 8;
+
+    uint32_t cursor = binlog::oldest();
+    std::vector<Entry> entries;
+    uint8_t buf[2 * entry_bytes + entry_bytes / 2];
+    size_t n;
+    while ((n = binlog::read(cursor, buf, sizeof(buf))) != 0) {
+        TEST_ASSERT_EQUAL_size_t(0, n % entry_bytes);
+        TEST_ASSERT_TRUE(parse(buf, n, entries));
+    }
+    TEST_ASSERT_EQUAL_size_t(20, entries.size());
+    for (uint32_t i = 0; i < 20; ++i) TEST_ASSERT_EQUAL_UINT32(i * 2, entries[i].args[1]);
+    TEST_ASSERT_EQUAL_size_t(0, binlog::read(cursor, buf, binlog::kEntryHeaderBytes));
+}
+
+// Producers on several threads while a reader drains: every entry read is
+// one a producer wrote in full, and each producer's entries stay in order
+void test_concurrent_producers() {
+    constexpr uint32_t kThreads = 4;
+    constexpr uint32_t kPerThread = 20000;
+    std::atomic<bool> done(false);
+    std::vector<Entry> entries;
+    uint32_t lost = 0;
+
+    std::thread reader([&] {
+        uint32_t cursor = 0;
+        uint8_t buf[512];
+        while (!done.load() || cursor != binlog::written()) {
+            const size_t n = binlog::read(cursor, buf, sizeof(buf), &lost);
+            if (!parse(buf, n, entries)) return;
+        }
+    });
+    std::vector<std::thread> producers;
+    for (uint32_t t = 0; t < kThreads; ++t) {
+        producers.emplace_back([t] {
+            for (uint32_t i = 0; i < kPerThread; ++i) BINLOG("t=%u i=%u check=%u", t, i, t * 1000003u + i);
+        });
+    }
+    for (std::thread& p : producers) p.join();
+    done = true;
+    reader.join();
+
+    size_t torn = 0;
+    size_t out_of_order = 0;
+    uint32_t last[kThreads] = {0};
+    bool seen[kThreads] = {false};
+    for (const Entry& e : entries) {
+        if (e.args.size() != 3 || e.args[0] >= kThreads || e.args[2] != e.args[0] * 1000003u + e.args[1]) {
+            ++torn;
+            continue;
+        }
+        const uint32_t t = e.args[0];
+        if (seen[t] && e.args[1] <= last[t]) ++out_of_order;
+        seen[t] = true;
+        last[t] = e.args[1];
+    }
+
+    TEST_ASSERT_EQUAL_size_t(0, torn);
+    TEST_ASSERT_EQUAL_size_t(0, out_of_order);
+    TEST_ASSERT_EQUAL_UINT32(kThreads * kPerThread, entries.size() + lost);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_format_id_is_fnv1a);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_overwrites_oldest);
+    RUN_TEST(test_partial_reads);
+    RUN_TEST(test_concurrent_producers);
+    return UNITY_END();
+}
@@ -0,0 +1,480 @@
+#include <unity.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "ble/transfer.h"
+
+// SEND throughput harness: runs transfer::stream against a simulated BLE
+// link and reports records/s, bytes on air per record and completion time
+// for a day, a week and a month of 15 s records.
+//
+// Link model: notifications queue in the host stack (NimBLE's mbuf pool,
+// `tx_queue` deep) and leave in connection events every `interval_ms`, at
+// most `pdus_per_event` link-layer PDUs per event. Each notification is
+// ATT header (3) + L2CAP header (4) + value, fragmented into LL payloads of
+// 27 bytes (251 with data length extension); every PDU adds 10 bytes of
+// preamble, access address, header and CRC. A lost PDU is retried by the
+// link layer in the next slot, so loss costs airtime, not data. A value
+// longer than MTU - 3 or a full queue is refused, and transfer::stream does
+// not retry refused records.
+//
+// The same link also serves the L2CAP CoC bulk channel (`coc_mtu` > 0: the
+// central opened it). An SDU gets a 2-byte length and is cut into K-frames
+// of MPS bytes (one LL payload minus the 4-byte L2CAP header), each one
+// PDU that needs a credit from the central; credits come back at the
+// central's next connection event. A full stack queue refuses the SDU and
+// stream_bulk retries it.
+
+namespace {
+
+constexpr uint32_t kRecordPeriodS = 15;
+constexpr size_t kRecordsPerDay = 24 * 3600 / kRecordPeriodS;
+constexpr uint32_t kAttHeader = 3;
+constexpr uint32_t kL2capHeader = 4;
+constexpr uint32_t kPduOverhead = 1 + 4 + 2 + 3;
+
+struct LinkParams {
+    const char* name = "";
+    uint16_t att_mtu = 23;
+    float interval_ms = 30.0f;
+    uint32_t pdus_per_event = 4;
+    float pdu_loss = 0.0f;
+    bool dle = false;             // data length extension (251-byte LL payload)
+    uint32_t tx_queue = 12;
+    uint16_t coc_mtu = 0;         // central's CoC MTU; 0: no bulk channel
+    uint32_t coc_credits = 16;    // K-frames the central lets us have in flight
+};
+
+class SimLink : public transfer::Link, public transfer::Channel {
+public:
+    explicit SimLink(const LinkParams& p, uint32_t seed = 1) : p_(p), rng_(seed), credits_(p.coc_credits) {}
+
+    bool connected() const override { return connected_; }
+
+    bool notify(const uint8_t* data, size_t length) override {
+        if (!connected_) return false;
+        if (length + kAttHeader > p_.att_mtu || queue_.size() >= p_.tx_queue) {
+            ++refused_;
+            return false;
+        }
+        queue_.push_back(Pending{std::vector<uint8_t>(data, data + length), pdus_for(length), false});
+        ++notifications_;
+        if (disconnect_after_ > 0 && notifications_ >= disconnect_after_) connected_ = false;
+        return true;
+    }
+
+    size_t sdu_bytes() const override { return p_.coc_mtu; }
+
+    bool send(const uint8_t* data, size_t length) override {
+        if (!connected_ || p_.coc_mtu == 0 || length > p_.coc_mtu) {
+            ++refused_;
+            return false;
+        }
+        if (queue_.size() >= p_.tx_queue) {
+            ++sdu_retries_;
+            return false;
+        }
+        const uint32_t kframes = (static_cast<uint32_t>(length) + 2 + mps() - 1) / mps();
+        queue_.push_back(Pending{std::vector<uint8_t>(data, data + length), kframes, true});
+        ++notifications_;
+        if (disconnect_after_ > 0 && notifications_ >= disconnect_after_) connected_ = false;
+        return true;
+    }
+
+    void delay_ms(uint32_t ms) override { run_until(now_us_ + static_cast<uint64_t>(ms) * 1000); }
+
+    // Let the queue empty after the last notify (or give up once nothing
+    // has been delivered for a minute: a central granting no credits)
+    void drain() {
+        const uint64_t start_us = now_us_;
+        while (!queue_.empty() && connected_ && next_event_us_ < std::max(start_us, last_delivery_us_) + 60000000u) {
+            run_until(next_event_us_);
+        }
+    }
+
+    void disconnect_after(uint32_t notifications) { disconnect_after_ = notifications; }
+
+    uint64_t now_us() const { return now_us_; }
+    uint64_t last_delivery_us() const { return last_delivery_us_; }
+    uint64_t air_bytes() const { return air_bytes_; }
+    uint32_t refused() const { return refused_; }
+    uint32_t sdu_retries() const { return sdu_retries_; }
+    const std::vector<std::vector<uint8_t>>& received() const { return received_; }
+
+private:
+    struct Pending {
+        std::vector<uint8_t> value;
+        uint32_t pdus_left;
+        bool sdu;   // CoC SDU (K-frames) rather than a notification
+    };
+
+    uint32_t ll_payload() const { return p_.dle ? 251 : 27; }
+    uint32_t mps() const { return ll_payload() - kL2capHeader; }
+
+    uint32_t pdus_for(size_t length) const {
+        const uint32_t bytes = static_cast<uint32_t>(length) + kAttHeader + kL2capHeader;
+        return (bytes + ll_payload() - 1) / ll_payload();
+    }
+
+    bool lost() {
+        rng_ = rng_ * 1664525u + 1013904223u;
+        return static_cast<float>(rng_ >> 8) / 16777216.0f < p_.pdu_loss;
+    }
+
+    void run_until(uint64_t t_us) {
+        while (next_event_us_ <= t_us) {
+            now_us_ = next_event_us_;
+            connection_event();
+            next_event_us_ += static_cast<uint64_t>(p_.interval_ms * 1000.0f);
+        }
+        now_us_ = t_us;
+    }
+
+    void connection_event() {
+        credits_ += credits_returning_;
+        credits_returning_ = 0;
+        for (uint32_t slot = 0; slot < p_.pdus_per_event && !queue_.empty(); ++slot) {
+            Pending& head = queue_.front();
+            if (head.sdu) {
+                if (credits_ == 0) break;  // the central has not granted more K-frames yet
+                const uint32_t payload = static_cast<uint32_t>(head.value.size()) + 2;
+                const uint32_t kframes = (payload + mps() - 1) / mps();
+                const uint32_t sent = (kframes - head.pdus_left) * mps();
+                const uint32_t chunk = payload - sent < mps() ? payload - sent : mps();
+                air_bytes_ += kPduOverhead + kL2capHeader + chunk;
+                if (lost()) continue;
+                --credits_;
+                ++credits_returning_;
+            } else {
+                const uint32_t total = static_cast<uint32_t>(head.value.size()) + kAttHeader + kL2capHeader;
+                const uint32_t sent = (pdus_for(head.value.size()) - head.pdus_left) * ll_payload();
+                const uint32_t chunk = total - sent < ll_payload() ? total - sent : ll_payload();
+                air_bytes_ += kPduOverhead + chunk;
+                if (lost()) continue;
+            }
+            if (--head.pdus_left == 0) {
+                received_.push_back(head.value);
+                last_delivery_us_ = now_us_;
+                queue_.pop_front();
+            }
+        }
+    }
+
+    LinkParams p_;
+    uint32_t rng_;
+    bool connected_ = true;
+    uint32_t disconnect_after_ = 0;
+    uint64_t now_us_ = 0;
+    uint64_t next_event_us_ = 0;
+    uint64_t last_delivery_us_ = 0;
+    uint64_t air_bytes_ = 0;
+    uint32_t notifications_ = 0;
+    uint32_t refused_ = 0;
+    uint32_t sdu_retries_ = 0;
+    uint32_t credits_ = 0;
+    uint32_t credits_returning_ = 0;
+    std::deque<Pending> queue_;
+    std::vector<std::vector<uint8_t>> received_;
+};
+
+std::vector<consolidate::ConsolidatedRecord> make_records(size_t n) {
+    std::vector<consolidate::ConsolidatedRecord> records(n);
+    for (size_t i = 0; i < n; ++i) {
+        records[i].avg_hr_x10 = static_cast<uint16_t>(600 + i % 400);
+        records[i].avg_temp_x100 = static_cast<int16_t>(3300 + i % 200);
+        records[i].step_count = static_cast<uint16_t>(i % 50);
+        records[i].timestamp = static_cast<uint32_t>(1700000000u + i * kRecordPeriodS);
+        records[i].flags = 0;
+    }
+    return records;
+}
+
+transfer::RecordSource source_of(const std::vector<consolidate::ConsolidatedRecord>& records) {
+    return [&records](const transfer::RecordCallback& cb) {
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (!cb(records[i], i)) return;
+        }
+    };
+}
+
+struct Run {
+    transfer::Result result;
+    double seconds = 0;
+    double records_per_s = 0;
+    double air_bytes_per_record = 0;
+    size_t delivered = 0;   // data packets the central received
+};
+
+Run run(const LinkParams& params, size_t n, const transfer::Pacing& pacing = transfer::Pacing()) {
+    const std::vector<consolidate::ConsolidatedRecord> records = make_records(n);
+    SimLink link(params);
+    Run r;
+    r.result = transfer::stream(link, n, source_of(records), pacing);
+    link.drain();
+    for (const std::vector<uint8_t>& v : link.received()) {
+        if (!v.empty() && v[0] == transfer::kDataMarker) ++r.delivered;
+    }
+    r.seconds = static_cast<double>(link.last_delivery_us()) / 1e6;
+    r.records_per_s = r.seconds > 0 ? r.delivered / r.seconds : 0;
+    r.air_bytes_per_record = r.delivered ? static_cast<double>(link.air_bytes()) / r.delivered : 0;
+    return r;
+}
+
+// Same over the bulk channel; counts records in the SDUs the central received
+Run run_bulk(const LinkParams& params, size_t n, const transfer::BulkPacing& pacing = transfer::BulkPacing()) {
+    const std::vector<consolidate::ConsolidatedRecord> records = make_records(n);
+    SimLink link(params);
+    Run r;
+    r.result = transfer::stream_bulk(link, n, source_of(records), pacing);
+    link.drain();
+    for (const std::vector<uint8_t>& v : link.received()) {
+        if (!v.empty() && v[0] == transfer::kBulkMarker) r.delivered += (v.size() - 1) / sizeof(records[0]);
+    }
+    r.seconds = static_cast<double>(link.last_delivery_us()) / 1e6;
+    r.records_per_s = r.seconds > 0 ? r.delivered / r.seconds : 0;
+    r.air_bytes_per_record = r.delivered ? static_cast<double>(link.air_bytes()) / r.delivered : 0;
+    return r;
+}
+
+LinkParams with_coc(LinkParams p, const char* name) {
+    p.name = name;
+    p.coc_mtu = 512;
+    return p;
+}
+
+LinkParams fast_link() {
+    LinkParams p;
+    p.name = "7.5ms x4";
+    p.interval_ms = 7.5f;
+    p.pdus_per_event = 4;
+    return p;
+}
+
+LinkParams slow_link() {
+    LinkParams p;
+    p.name = "50ms x1";
+    p.interval_ms = 50.0f;
+    p.pdus_per_event = 1;
+    return p;
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+// The central must be able to rebuild the store byte for byte
+void test_framing_round_trip() {
+    const std::vector<consolidate::ConsolidatedRecord> records = make_records(100);
+    SimLink link(fast_link());
+    const transfer::Result result = transfer::stream(link, records.size(), source_of(records));
+    link.drain();
+
+    TEST_ASSERT_TRUE(result.completed);
+    TEST_ASSERT_EQUAL_UINT32(100, result.sent);
+    TEST_ASSERT_EQUAL_UINT32(0, result.dropped);
+
+    const std::vector<std::vector<uint8_t>>& rx = link.received();
+    TEST_ASSERT_EQUAL_UINT32(102, rx.size());
+    TEST_ASSERT_EQUAL_UINT32(transfer::kStartPacketBytes, rx.front().size());
+    TEST_ASSERT_EQUAL_UINT8(transfer::kStartMarker, rx.front()[0]);
+    uint32_t announced = 0;
+    memcpy(&announced, &rx.front()[1], 4);
+    TEST_ASSERT_EQUAL_UINT32(100, announced);
+    for (size_t i = 0; i < records.size(); ++i) {
+        const std::vector<uint8_t>& pkt = rx[1 + i];
+        TEST_ASSERT_EQUAL_UINT32(transfer::kDataPacketBytes, pkt.size());
+        TEST_ASSERT_EQUAL_UINT8(transfer::kDataMarker, pkt[0]);
+        TEST_ASSERT_EQUAL_MEMORY(&records[i], &pkt[1], sizeof(records[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, rx.back().size());
+    TEST_ASSERT_EQUAL_UINT8(transfer::kEndMarker, rx.back()[0]);
+}
+
+// On a link that drains faster than the pacing, the 15 ms per-record delay
+// is the throughput limit (~66 records/s)
+void test_fast_link_is_pacing_bound() {
+    const Run r = run(fast_link(), kRecordsPerDay);
+    TEST_ASSERT_EQUAL_UINT32(kRecordsPerDay, r.delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, r.result.dropped);
+    const double expected_s = 0.050 + kRecordsPerDay * 0.015;
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, static_cast<float>(expected_s), static_cast<float>(r.seconds));
+    // One 12-byte notification is a single 19-byte LL payload: 29 bytes on air
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 29.0f, static_cast<float>(r.air_bytes_per_record));
+}
+
+// Link-layer loss is retried: everything arrives, at the cost of airtime
+void test_pdu_loss_costs_airtime_not_records() {
+    LinkParams lossy = fast_link();
+    lossy.pdu_loss = 0.2f;
+    const Run clean = run(fast_link(), 2000);
+    const Run r = run(lossy, 2000);
+    TEST_ASSERT_EQUAL_UINT32(2000, r.delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, r.result.dropped);
+    TEST_ASSERT_TRUE(r.air_bytes_per_record > clean.air_bytes_per_record * 1.15);
+}
+
+// A central that grants one PDU per 50 ms event drains 20 packets/s; the
+// 15 ms pacing produces ~66/s, so the stack queue fills and records are
+// refused. The stream reports them rather than silently losing count.
+void test_slow_link_drops_are_reported() {
+    const size_t n = 2000;
+    const Run r = run(slow_link(), n);
+    TEST_ASSERT_TRUE(r.result.dropped > 0);
+    TEST_ASSERT_EQUAL_UINT32(n, r.result.sent + r.result.dropped);
+    TEST_ASSERT_EQUAL_UINT32(r.result.sent, r.delivered);
+    TEST_ASSERT_TRUE(r.records_per_s < 21.0);
+
+    // Pacing to the link's drain rate loses nothing
+    transfer::Pacing slow;
+    slow.per_record_ms = 50;
+    const Run paced = run(slow_link(), n, slow);
+    TEST_ASSERT_EQUAL_UINT32(0, paced.result.dropped);
+    TEST_ASSERT_EQUAL_UINT32(n, paced.delivered);
+}
+
+void test_disconnect_stops_stream() {
+    const std::vector<consolidate::ConsolidatedRecord> records = make_records(500);
+    SimLink link(fast_link());
+    link.disconnect_after(1 + 200);
+    const transfer::Result result = transfer::stream(link, records.size(), source_of(records));
+    TEST_ASSERT_FALSE(result.completed);
+    TEST_ASSERT_EQUAL_UINT32(200, result.sent);
+    TEST_ASSERT_EQUAL_UINT32(0, result.dropped);
+}
+
+// Bulk SDUs carry the same start/end framing and rebuild the store exactly
+void test_bulk_round_trip() {
+    const std::vector<consolidate::ConsolidatedRecord> records = make_records(1000);
+    SimLink link(with_coc(fast_link(), "coc"));
+    const transfer::Result result = transfer::stream_bulk(link, records.size(), source_of(records));
+    link.drain();
+
+    TEST_ASSERT_TRUE(result.completed);
+    TEST_ASSERT_EQUAL_UINT32(1000, result.sent);
+    TEST_ASSERT_EQUAL_UINT32(0, result.dropped);
+
+    const std::vector<std::vector<uint8_t>>& rx = link.received();
+    const size_t sdus = (1000 + transfer::kMaxBulkRecords - 1) / transfer::kMaxBulkRecords;
+    TEST_ASSERT_EQUAL_UINT32(1 + sdus + 1, rx.size());
+    TEST_ASSERT_EQUAL_UINT8(transfer::kStartMarker, rx.front()[0]);
+    uint32_t announced = 0;
+    memcpy(&announced, &rx.front()[1], 4);
+    TEST_ASSERT_EQUAL_UINT32(1000, announced);
+    std::vector<uint8_t> bytes;
+    for (size_t i = 1; i <= sdus; ++i) {
+        TEST_ASSERT_EQUAL_UINT8(transfer::kBulkMarker, rx[i][0]);
+        TEST_ASSERT_TRUE(rx[i].size() <= transfer::kMaxBulkSduBytes);
+        bytes.insert(bytes.end(), rx[i].begin() + 1, rx[i].end());
+    }
+    TEST_ASSERT_EQUAL_UINT32(records.size() * sizeof(records[0]), bytes.size());
+    TEST_ASSERT_EQUAL_MEMORY(records.data(), bytes.data(), bytes.size());
+    TEST_ASSERT_EQUAL_UINT8(transfer::kEndMarker, rx.back()[0]);
+
+    // A central with a small CoC MTU gets smaller SDUs, nothing else changes
+    LinkParams small = with_coc(fast_link(), "coc 64");
+    small.coc_mtu = 64;
+    const Run r = run_bulk(small, 1000);
+    TEST_ASSERT_EQUAL_UINT32(1000, r.delivered);
+    TEST_ASSERT_TRUE(r.result.completed);
+}
+
+// No per-record pacing and no per-record ATT header: link-bound instead of
+// pacing-bound, and fewer bytes on air per record
+void test_bulk_outruns_notifications() {
+    LinkParams phone;
+    phone.name = "30ms x4 MTU185 DLE";
+    phone.att_mtu = 185;
+    phone.dle = true;
+    const LinkParams links[] = {fast_link(), phone, slow_link()};
+    for (const LinkParams& link : links) {
+        const Run gatt = run(link, kRecordsPerDay);
+        const Run bulk = run_bulk(with_coc(link, link.name), kRecordsPerDay);
+        printf("\n[%s, one day] notify %.0f rec/s %.1f B/rec, %zu dropped | L2CAP %.0f rec/s %.1f B/rec, %zu dropped",
+               link.name, gatt.records_per_s, gatt.air_bytes_per_record, gatt.result.dropped,
+               bulk.records_per_s, bulk.air_bytes_per_record, bulk.result.dropped);
+        TEST_ASSERT_EQUAL_UINT32(kRecordsPerDay, bulk.delivered);
+        TEST_ASSERT_EQUAL_UINT32(0, bulk.result.dropped);
+        // Pacing-bound notifications fall an order of magnitude behind; on a
+        // one-PDU-per-event link both are link-bound
+        TEST_ASSERT_TRUE(bulk.records_per_s > gatt.records_per_s * (gatt.result.dropped ? 1.8 : 10.0));
+        TEST_ASSERT_TRUE(bulk.air_bytes_per_record < gatt.air_bytes_per_record * 0.75);
+    }
+    printf("\n");
+}
+
+// Credits pace the stream: a central granting one K-frame per event slows
+// it down without losing anything; one granting none ends it at the timeout
+void test_bulk_credit_flow_control() {
+    LinkParams stingy = with_coc(fast_link(), "1 credit");
+    stingy.coc_credits = 1;
+    const Run open = run_bulk(with_coc(fast_link(), "16 credits"), 2000);
+    const Run slow = run_bulk(stingy, 2000);
+    TEST_ASSERT_EQUAL_UINT32(2000, slow.delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, slow.result.dropped);
+    TEST_ASSERT_TRUE(slow.records_per_s < open.records_per_s / 2);
+
+    LinkParams stuck = with_coc(fast_link(), "0 credits");
+    stuck.coc_credits = 0;
+    transfer::BulkPacing pacing;
+    pacing.stall_timeout_ms = 500;
+    const Run r = run_bulk(stuck, 2000, pacing);
+    TEST_ASSERT_FALSE(r.result.completed);
+    TEST_ASSERT_EQUAL_UINT32(0, r.delivered);
+    TEST_ASSERT_EQUAL_UINT32(transfer::kMaxBulkRecords, r.result.dropped);
+    TEST_ASSERT_TRUE(r.result.sent + r.result.dropped < 2000);
+}
+
+// Not a pass/fail check: the table CI logs for comparing pacing and link changes
+void test_report() {
+    LinkParams lossy = fast_link();
+    lossy.name = "7.5ms x4 10% loss";
+    lossy.pdu_loss = 0.1f;
+    LinkParams phone;
+    phone.name = "30ms x4 MTU185 DLE";
+    phone.att_mtu = 185;
+    phone.dle = true;
+    const LinkParams links[] = {fast_link(), lossy, phone, slow_link()};
+    const LinkParams bulk_links[] = {with_coc(fast_link(), "7.5ms x4 L2CAP"), with_coc(phone, "30ms x4 DLE L2CAP"),
+                                     with_coc(slow_link(), "50ms x1 L2CAP")};
+    const struct { const char* name; size_t days; } spans[] = {{"day", 1}, {"week", 7}, {"month", 30}};
+
+    printf("\n%-20s %-6s %9s %9s %9s %9s %10s\n",
+           "link", "span", "records", "dropped", "rec/s", "air B/rec", "time");
+    for (const LinkParams& link : links) {
+        for (const auto& span : spans) {
+            const size_t n = kRecordsPerDay * span.days;
+            const Run r = run(link, n);
+            printf("%-20s %-6s %9zu %9zu %9.1f %9.1f %7.1f min\n", link.name, span.name, n,
+                   r.result.dropped, r.records_per_s, r.air_bytes_per_record, r.seconds / 60.0);
+            TEST_ASSERT_EQUAL_UINT32(n, r.result.sent + r.result.dropped);
+        }
+    }
+    for (const LinkParams& link : bulk_links) {
+        for (const auto& span : spans) {
+            const size_t n = kRecordsPerDay * span.days;
+            const Run r = run_bulk(link, n);
+            printf("%-20s %-6s %9zu %9zu %9.1f %9.1f %7.1f min\n", link.name, span.name, n,
+                   r.result.dropped, r.records_per_s, r.air_bytes_per_record, r.seconds / 60.0);
+            TEST_ASSERT_EQUAL_UINT32(n, r.result.sent + r.result.dropped);
+        }
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_framing_round_trip);
+    RUN_TEST(test_fast_link_is_pacing_bound);
+    RUN_TEST(test_pdu_loss_costs_airtime_not_records);
+    RUN_TEST(test_slow_link_drops_are_reported);
+    RUN_TEST(test_disconnect_stops_stream);
+    RUN_TEST(test_bulk_round_trip);
+    RUN_TEST(test_bulk_outruns_notifications);
+    RUN_TEST(test_bulk_credit_flow_control);
+    RUN_TEST(test_report);
+    return UNITY_END();
+}
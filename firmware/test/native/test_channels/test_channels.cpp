@@ -0,0 +1,323 @@
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "compute/consolidate.h"
+#include "ringbuf/reg_buffer.h"
+
+// Heart rate and body temperature in their own rings, joined to the IMU
+// samples by timestamp during consolidation. The records must match what the
+// old layout (both values copied into every IMU sample) produced, a reading
+// must hold until the next one, and the bytes buffered per second must drop.
+// A loop stall longer than the channel rings hold, and the clock being set
+// back, must not freeze HR or temperature. Wear state joins the same way,
+// so windows replayed after a stall keep the state they were recorded in.
+
+namespace {
+
+constexpr uint32_t kImuHz = 50;
+constexpr uint32_t kEpoch = 1700000000u;
+
+// HR the sensor task would report at second `t`: a slow ramp with a step,
+// so the median changes every few seconds rather than every sample
+float hr_at(uint32_t t) {
+    return t < 30 ? 62.0f + static_cast<float>(t / 4) : 95.0f;
+}
+
+float temp_at(uint32_t t) {
+    return 33.0f + 0.25f * static_cast<float>(t / 10);
+}
+
+struct Run {
+    uint32_t records = 0;
+    uint32_t hr_mismatches = 0;    // |avg_hr_x10| off by more than 1
+    uint32_t temp_mismatches = 0;  // |avg_temp_x100| off by more than 1
+    uint32_t hr_pushes = 0;
+    uint32_t temp_pushes = 0;
+};
+
+// Feed `seconds` of 50 Hz samples through the channels and compare each
+// record's averages with the per-sample replication they replace
+void run(uint32_t seconds, Run& out) {
+    consolidate::restore_detector_state(consolidate::kInitialDetectorState);
+    reg_buffer::SampleRingBuffer ring;
+    reg_buffer::ChannelRing hr, temp;
+    consolidate::attach_channels(&hr, &temp);
+
+    reg_buffer::float16 last_hr;
+    bool hr_sent = false;
+    double hr_sum = 0, temp_sum = 0;
+    uint32_t n = 0;
+
+    for (uint32_t p = 0; p < seconds * kImuHz; ++p) {
+        const uint32_t t = p / kImuHz;
+        const uint32_t ts = kEpoch + t;
+        // As acquisition does: HR only when it changes, temperature at 1 Hz
+        const reg_buffer::float16 h(hr_at(t));
+        if (!hr_sent || h.bits != last_hr.bits) {
+            TEST_ASSERT_TRUE(hr.push(reg_buffer::ChannelSample{h, ts}));
+            last_hr = h;
+            hr_sent = true;
+            ++out.hr_pushes;
+        }
+        if (p % kImuHz == 0) {
+            TEST_ASSERT_TRUE(temp.push(reg_buffer::ChannelSample{reg_buffer::float16(temp_at(t)), ts}));
+            ++out.temp_pushes;
+        }
+
+        reg_buffer::Sample s{};
+        s.az = reg_buffer::float16(1.0f);
+        s.timestamp = ts;
+        TEST_ASSERT_TRUE(ring.push(s));
+        hr_sum += static_cast<float>(h);
+        temp_sum += static_cast<float>(reg_buffer::float16(temp_at(t)));
+        ++n;
+
+        consolidate::ConsolidatedRecord rec{};
+        if (consolidate::consolidate_from_ring(ring, rec)) {
+            ++out.records;
+            const int hr_x10 = static_cast<int>(hr_sum / n * 10.0);
+            const int temp_x100 = static_cast<int>(temp_sum / n * 100.0);
+            if (std::abs(hr_x10 - rec.avg_hr_x10) > 1) ++out.hr_mismatches;
+            if (std::abs(temp_x100 - rec.avg_temp_x100) > 1) ++out.temp_mismatches;
+            hr_sum = temp_sum = 0;
+            n = 0;
+        }
+    }
+    consolidate::attach_channels(nullptr, nullptr);
+}
+
+}  // namespace
+
+void setUp() {
+    consolidate::restore_detector_state(consolidate::kInitialDetectorState);
+}
+
+void tearDown() {
+    consolidate::attach_channels(nullptr, nullptr);
+}
+
+// The timestamp join gives the records the replicated layout gave
+void test_join_matches_replication() {
+    Run r;
+    run(60, r);
+    printf("\n[60 s at 50 Hz] %u records, %u HR readings, %u temperature readings\n", r.records, r.hr_pushes,
+           r.temp_pushes);
+    TEST_ASSERT_EQUAL_UINT32(60 * kImuHz / consolidate::kSamplesPerWindow, r.records);
+    TEST_ASSERT_EQUAL_UINT32(0, r.hr_mismatches);
+    TEST_ASSERT_EQUAL_UINT32(0, r.temp_mismatches);
+}
+
+// A reading holds until the next one, across windows and a snapshot restore
+void test_reading_holds_across_windows() {
+    reg_buffer::SampleRingBuffer ring;
+    reg_buffer::ChannelRing hr;
+    consolidate::attach_channels(&hr, nullptr);
+    hr.push(reg_buffer::ChannelSample{reg_buffer::float16(80.0f), kEpoch});
+    // A reading stamped after the window is left for the next one
+    hr.push(reg_buffer::ChannelSample{reg_buffer::float16(90.0f), kEpoch + 10});
+
+    for (uint32_t i = 0; i < 2 * consolidate::kSamplesPerWindow; ++i) {
+        reg_buffer::Sample s{};
+        s.timestamp = kEpoch + i / kImuHz;
+        TEST_ASSERT_TRUE(ring.push(s));
+    }
+    consolidate::ConsolidatedRecord rec{};
+    TEST_ASSERT_TRUE(consolidate::consolidate_from_ring(ring, rec));
+    TEST_ASSERT_EQUAL_UINT16(800, rec.avg_hr_x10);
+    TEST_ASSERT_EQUAL_UINT32(1, hr.size());
+
+    // Reset between windows: the held value comes back with the snapshot
+    const consolidate::DetectorState state = consolidate::detector_state();
+    consolidate::restore_detector_state(consolidate::kInitialDetectorState);
+    consolidate::restore_detector_state(state);
+    TEST_ASSERT_TRUE(consolidate::consolidate_from_ring(ring, rec));
+    TEST_ASSERT_EQUAL_UINT16(800, rec.avg_hr_x10);
+    TEST_ASSERT_EQUAL_INT16(0, rec.avg_temp_x100);  // no temperature channel
+}
+
+// The loop stalls for 100 s (the IMU samples wait in the spill): the HR
+// ring fills after 64 readings and then keeps the newest, so the records
+// after the stall follow the live HR instead of the 64th reading
+void test_stall_longer_than_channel_ring() {
+    constexpr uint32_t kStall = 100;
+    reg_buffer::ChannelRing hr;
+    consolidate::attach_channels(&hr, nullptr);
+    std::vector<reg_buffer::Sample> spilled;
+    uint32_t overwritten = 0;
+    for (uint32_t t = 0; t < kStall; ++t) {
+        // A new median every second
+        if (!hr.push(reg_buffer::ChannelSample{reg_buffer::float16(60.0f + t), kEpoch + t})) ++overwritten;
+        for (uint32_t i = 0; i < kImuHz; ++i) {
+            reg_buffer::Sample s{};
+            s.timestamp = kEpoch + t;
+            spilled.push_back(s);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(kStall - reg_buffer::ChannelRing::kCapacity, overwritten);
+    TEST_ASSERT_EQUAL_UINT32(reg_buffer::ChannelRing::kCapacity, hr.size());
+
+    // Replay the stall, then the HR holds at 159 for a few live windows
+    reg_buffer::SampleRingBuffer ring;
+    std::vector<consolidate::ConsolidatedRecord> records;
+    auto drain = [&] {
+        consolidate::ConsolidatedRecord rec{};
+        while (consolidate::consolidate_from_ring(ring, rec)) records.push_back(rec);
+    };
+    for (const reg_buffer::Sample& s : spilled) {
+        ring.push(s);
+        drain();
+    }
+    for (uint32_t t = kStall; t < kStall + 10; ++t) {
+        for (uint32_t i = 0; i < kImuHz; ++i) {
+            reg_buffer::Sample s{};
+            s.timestamp = kEpoch + t;
+            ring.push(s);
+            drain();
+        }
+    }
+    // The window ending at second 95 averages seconds 92.5..95 of the ramp
+    const consolidate::ConsolidatedRecord& late = records[kStall * kImuHz / consolidate::kSamplesPerWindow - 2];
+    printf("\n[100 s stall, 64-entry ring] %u readings overwritten, HR at 95 s %.1f, after %.1f\n", overwritten,
+           late.avg_hr_x10 / 10.0, records.back().avg_hr_x10 / 10.0);
+    TEST_ASSERT_TRUE(late.avg_hr_x10 > 1500);
+    TEST_ASSERT_EQUAL_UINT16(1590, records.back().avg_hr_x10);
+}
+
+// TIME sets the clock back an hour while readings stamped before it are
+// still queued: they are taken at once, and readings stamped after it join
+// the samples stamped after it
+void test_backward_time_sync() {
+    reg_buffer::ChannelRing hr;
+    consolidate::attach_channels(&hr, nullptr);
+    reg_buffer::SampleRingBuffer ring;
+    consolidate::ConsolidatedRecord rec{};
+
+    const uint32_t before = kEpoch + 3600;
+    hr.push(reg_buffer::ChannelSample{reg_buffer::float16(70.0f), before});
+    hr.push(reg_buffer::ChannelSample{reg_buffer::float16(72.0f), before + 1});
+    consolidate::clock_stepped_back();
+    TEST_ASSERT_TRUE(hr.empty());
+
+    hr.push(reg_buffer::ChannelSample{reg_buffer::float16(90.0f), kEpoch + 3});
+    for (uint32_t i = 0; i < 2 * consolidate::kSamplesPerWindow; ++i) {
+        reg_buffer::Sample s{};
+        s.timestamp = kEpoch + i / kImuHz;
+        ring.push(s);
+    }
+    TEST_ASSERT_TRUE(consolidate::consolidate_from_ring(ring, rec));
+    TEST_ASSERT_EQUAL_UINT16(720, rec.avg_hr_x10);  // 72 held until 90 arrives
+    TEST_ASSERT_TRUE(consolidate::consolidate_from_ring(ring, rec));
+    TEST_ASSERT_EQUAL_UINT16((25 * 720 + 100 * 900) / 125, rec.avg_hr_x10);  // 90 from second 3
+    TEST_ASSERT_TRUE(hr.empty());
+
+    // Without it the pre-sync readings sit at the head and nothing moves
+    consolidate::restore_detector_state(consolidate::kInitialDetectorState);
+    hr.push(reg_buffer::ChannelSample{reg_buffer::float16(70.0f), before});
+    hr.push(reg_buffer::ChannelSample{reg_buffer::float16(90.0f), kEpoch + 3});
+    for (uint32_t i = 0; i < consolidate::kSamplesPerWindow; ++i) {
+        reg_buffer::Sample s{};
+        s.timestamp = kEpoch + 5 + i / kImuHz;
+        ring.push(s);
+    }
+    TEST_ASSERT_TRUE(consolidate::consolidate_from_ring(ring, rec));
+    TEST_ASSERT_EQUAL_UINT16(0, rec.avg_hr_x10);
+    TEST_ASSERT_EQUAL_UINT32(2, hr.size());
+}
+
+// The watch comes off at 11 s and goes back on at 31 s while the loop is
+// stalled (the IMU samples wait in the spill). Replayed after the stall,
+// with the wearer long back on the wrist, each window keeps the state its
+// samples were taken in: the windows wholly off-wrist are flagged, the two
+// straddling a transition average over their on-wrist samples only, and no
+// record carries the HR of 0 pushed on the way off.
+void test_wear_replayed_across_transition() {
+    constexpr uint32_t kStall = 40;
+    constexpr uint32_t kOff = 11;
+    constexpr uint32_t kOn = 31;
+    consolidate::restore_detector_state(consolidate::kInitialDetectorState);
+    reg_buffer::ChannelRing hr, temp, wear;
+    consolidate::attach_channels(&hr, &temp, &wear);
+    const reg_buffer::float16 on(consolidate::kWearOn), off(consolidate::kWearOff);
+
+    std::vector<reg_buffer::Sample> spilled;
+    wear.push(reg_buffer::ChannelSample{on, kEpoch});
+    hr.push(reg_buffer::ChannelSample{reg_buffer::float16(70.0f), kEpoch});
+    for (uint32_t t = 0; t < kStall; ++t) {
+        if (t == kOff) {
+            wear.push(reg_buffer::ChannelSample{off, kEpoch + t});
+            hr.push(reg_buffer::ChannelSample{reg_buffer::float16(0.0f), kEpoch + t});  // median cleared
+        } else if (t == kOn) {
+            wear.push(reg_buffer::ChannelSample{on, kEpoch + t});
+            hr.push(reg_buffer::ChannelSample{reg_buffer::float16(70.0f), kEpoch + t});
+        }
+        // The temperature sensor is shut down while off-wrist
+        if (t < kOff || t >= kOn) temp.push(reg_buffer::ChannelSample{reg_buffer::float16(33.5f), kEpoch + t});
+        for (uint32_t i = 0; i < kImuHz; ++i) {
+            reg_buffer::Sample s{};
+            s.timestamp = kEpoch + t;
+            spilled.push_back(s);
+        }
+    }
+
+    reg_buffer::SampleRingBuffer ring;
+    std::vector<consolidate::ConsolidatedRecord> records;
+    for (const reg_buffer::Sample& s : spilled) {
+        ring.push(s);
+        consolidate::ConsolidatedRecord rec{};
+        while (consolidate::consolidate_from_ring(ring, rec)) records.push_back(rec);
+    }
+    TEST_ASSERT_EQUAL_UINT32(kStall * kImuHz / consolidate::kSamplesPerWindow, records.size());
+
+    // Window i covers seconds [2.5 i, 2.5 i + 2.5): 5..11 lie inside [11, 31)
+    for (size_t i = 0; i < records.size(); ++i) {
+        const bool wholly_off = i >= 5 && i <= 11;
+        TEST_ASSERT_EQUAL_UINT8(wholly_off ? consolidate::kFlagOffWrist : 0, records[i].flags);
+        if (wholly_off) continue;
+        TEST_ASSERT_EQUAL_UINT16(700, records[i].avg_hr_x10);
+        TEST_ASSERT_EQUAL_INT16(3350, records[i].avg_temp_x100);
+    }
+
+    // The held state is part of the snapshot: restored off-wrist, the next
+    // window is off-wrist until the wear ring says otherwise
+    consolidate::DetectorState state = consolidate::kInitialDetectorState;
+    state.off_wrist = 1;
+    consolidate::restore_detector_state(state);
+    for (uint32_t i = 0; i < consolidate::kSamplesPerWindow; ++i) {
+        reg_buffer::Sample s{};
+        s.timestamp = kEpoch + kStall + i / kImuHz;
+        ring.push(s);
+    }
+    consolidate::ConsolidatedRecord rec{};
+    TEST_ASSERT_TRUE(consolidate::consolidate_from_ring(ring, rec));
+    TEST_ASSERT_EQUAL_UINT8(consolidate::kFlagOffWrist, rec.flags);
+    TEST_ASSERT_EQUAL_UINT8(1, consolidate::detector_state().off_wrist);
+    consolidate::restore_detector_state(consolidate::kInitialDetectorState);
+    consolidate::attach_channels(nullptr, nullptr);
+}
+
+// Bytes the sensor task hands the loop per second of 50 Hz sampling
+void test_bytes_per_second() {
+    Run r;
+    run(60, r);
+    const double imu = static_cast<double>(kImuHz) * sizeof(reg_buffer::Sample);
+    const double channels = static_cast<double>(r.hr_pushes + r.temp_pushes) * sizeof(reg_buffer::ChannelSample) / 60;
+    const double replicated = static_cast<double>(kImuHz) * (sizeof(reg_buffer::Sample) + 2 * sizeof(uint16_t));
+    printf("\n[bytes/s at 50 Hz] replicated %.0f | IMU %.0f + channels %.1f = %.1f (%.0f%% less)\n", replicated,
+           imu, channels, imu + channels, 100.0 * (1.0 - (imu + channels) / replicated));
+    TEST_ASSERT_EQUAL_UINT32(16, sizeof(reg_buffer::Sample));
+    TEST_ASSERT_TRUE(imu + channels < 0.85 * replicated);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_join_matches_replication);
+    RUN_TEST(test_reading_holds_across_windows);
+    RUN_TEST(test_stall_longer_than_channel_ring);
+    RUN_TEST(test_backward_time_sync);
+    RUN_TEST(test_wear_replayed_across_transition);
+    RUN_TEST(test_bytes_per_second);
+    return UNITY_END();
+}
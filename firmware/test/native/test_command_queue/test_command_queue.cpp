@@ -0,0 +1,129 @@
+#include <unity.h>
+
+#include <cstring>
+#include <thread>
+
+#include "ble/command_queue.h"
+#include "ble/sync_tree.h"
+
+// Control writes parsed on the NimBLE host task and executed by the loop:
+// parsing of every command, FIFO order and drop-on-full, and a host-task /
+// loop-task thread pair passing commands without loss or reordering.
+
+namespace {
+
+bool parse(const char* text, command_queue::Command& out) {
+    return command_queue::parse(text, strlen(text), out);
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_parse() {
+    command_queue::Command c;
+    TEST_ASSERT_TRUE(parse("SEND", c));
+    TEST_ASSERT_TRUE(c.op == command_queue::Op::kSend);
+    TEST_ASSERT_TRUE(parse("ERASE", c));
+    TEST_ASSERT_TRUE(c.op == command_queue::Op::kErase);
+    TEST_ASSERT_TRUE(parse("STATS", c));
+    TEST_ASSERT_TRUE(c.op == command_queue::Op::kStats);
+    TEST_ASSERT_TRUE(parse("LOG", c));
+    TEST_ASSERT_TRUE(c.op == command_queue::Op::kLog);
+
+    TEST_ASSERT_TRUE(parse("TIME:1700000000", c));
+    TEST_ASSERT_TRUE(c.op == command_queue::Op::kTime);
+    TEST_ASSERT_TRUE(c.arg == 1700000000LL);
+
+    TEST_ASSERT_TRUE(parse("TREE", c));
+    TEST_ASSERT_TRUE(c.op == command_queue::Op::kTree);
+    TEST_ASSERT_EQUAL_UINT32(sync_tree::kTopLevel, c.arg2);
+    TEST_ASSERT_TRUE(parse("TREE:2:17", c));
+    TEST_ASSERT_TRUE(c.op == command_queue::Op::kTree);
+    TEST_ASSERT_EQUAL_UINT32(2, c.arg2);
+    TEST_ASSERT_TRUE(c.arg == 17);
+    TEST_ASSERT_TRUE(parse("RANGE:4096:32", c));
+    TEST_ASSERT_TRUE(c.op == command_queue::Op::kRange);
+    TEST_ASSERT_TRUE(c.arg == 4096);
+    TEST_ASSERT_EQUAL_UINT32(32, c.arg2);
+
+    TEST_ASSERT_FALSE(parse("TREE:", c));
+    TEST_ASSERT_FALSE(parse("TREE:2", c));
+    TEST_ASSERT_FALSE(parse("TREE:2:", c));
+    TEST_ASSERT_FALSE(parse("TREE:9:0", c));  // past kMaxLevels
+    TEST_ASSERT_FALSE(parse("TREE:1:2:3", c));
+    TEST_ASSERT_FALSE(parse("RANGE:10:0", c));
+    TEST_ASSERT_FALSE(parse("RANGE:-1:5", c));
+    TEST_ASSERT_FALSE(parse("RANGE:4294967296:1", c));
+    TEST_ASSERT_FALSE(parse("TIME:", c));
+    TEST_ASSERT_FALSE(parse("TIME:0", c));
+    TEST_ASSERT_FALSE(parse("TIME:-5", c));
+    TEST_ASSERT_FALSE(parse("TIME:99999999999999999999999999999999", c));
+    TEST_ASSERT_FALSE(parse("SENDX", c));
+    TEST_ASSERT_FALSE(parse("SEN", c));
+    TEST_ASSERT_FALSE(parse("LIST", c));
+    // Writes are not NUL-terminated: only `length` bytes count
+    TEST_ASSERT_TRUE(command_queue::parse("SEND garbage", 4, c));
+    TEST_ASSERT_TRUE(c.op == command_queue::Op::kSend);
+    TEST_ASSERT_TRUE(command_queue::parse("TIME:12345678", 9, c));
+    TEST_ASSERT_TRUE(c.arg == 1234);
+}
+
+void test_fifo_and_full() {
+    command_queue::Queue q;
+    command_queue::Command c = {command_queue::Op::kTime, 0, 0};
+    for (size_t i = 0; i < command_queue::Queue::kDepth; ++i) {
+        c.arg = static_cast<int64_t>(i);
+        TEST_ASSERT_TRUE(q.push(c));
+    }
+    TEST_ASSERT_FALSE(q.push(c));
+    TEST_ASSERT_EQUAL_UINT32(command_queue::Queue::kDepth, q.size());
+
+    for (size_t i = 0; i < command_queue::Queue::kDepth; ++i) {
+        TEST_ASSERT_TRUE(q.pop(c));
+        TEST_ASSERT_TRUE(c.arg == static_cast<int64_t>(i));
+    }
+    TEST_ASSERT_FALSE(q.pop(c));
+    TEST_ASSERT_TRUE(q.empty());
+}
+
+// The host task retries on full here only to check ordering across wraps;
+// onWrite() drops instead
+void test_host_to_loop_threads() {
+    command_queue::Queue q;
+    const int64_t n = 200000;
+    std::thread host([&] {
+        for (int64_t i = 1; i <= n;) {
+            if (q.push(command_queue::Command{command_queue::Op::kTime, i, 0})) {
+                ++i;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int64_t expected = 1;
+    size_t out_of_order = 0;
+    command_queue::Command c;
+    while (expected <= n) {
+        if (!q.pop(c)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (c.arg != expected) ++out_of_order;
+        expected = c.arg + 1;
+    }
+    host.join();
+    TEST_ASSERT_EQUAL_UINT32(0, out_of_order);
+    TEST_ASSERT_TRUE(q.empty());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse);
+    RUN_TEST(test_fifo_and_full);
+    RUN_TEST(test_host_to_loop_threads);
+    return UNITY_END();
+}
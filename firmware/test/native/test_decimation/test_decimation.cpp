@@ -0,0 +1,180 @@
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+
+#include "compute/consolidate.h"
+#include "ringbuf/reg_buffer.h"
+#include "sensors/decimator.h"
+
+// IMU decimation under backpressure: factor hysteresis on ring occupancy,
+// the box-car average against plain sample dropping (aliasing), and an
+// overloaded consumer with and without decimation: records must keep their
+// 2.5 s cadence and step count, flagged as decimated.
+
+namespace {
+
+constexpr float kPi = 3.14159265f;
+constexpr uint32_t kImuHz = 50;
+
+sensor_driver::ImuReading reading(float az) {
+    sensor_driver::ImuReading r{};
+    r.az = az;
+    return r;
+}
+
+struct Overload {
+    uint32_t records = 0;
+    uint32_t steps = 0;
+    uint32_t decimated_records = 0;
+    uint32_t ring_drops = 0;
+};
+
+// Walk at 2 steps/s for `seconds` while the consumer can only take
+// `consumer_share` of the full-rate sample stream (cost per sample popped)
+Overload run_overloaded(bool decimate, float consumer_share, uint32_t seconds) {
+    consolidate::restore_detector_state(consolidate::kInitialDetectorState);
+    reg_buffer::SampleRingBuffer ring;
+    decimator::Decimator dec;
+    Overload out;
+    float credit = 0;
+
+    for (uint32_t p = 0; p < seconds * kImuHz; ++p) {
+        const float t = p / static_cast<float>(kImuHz);
+        const sensor_driver::ImuReading r = reading(1.0f + 0.3f * std::sin(2.0f * kPi * 2.0f * t));
+
+        sensor_driver::ImuReading d = r;
+        uint8_t stride = 1;
+        bool due = true;
+        if (decimate) {
+            dec.update(ring.size());
+            due = dec.add(r, 1, d, stride);
+        }
+        if (due) {
+            reg_buffer::Sample s{};
+            s.az = reg_buffer::float16(d.az);
+            s.timestamp = 1700000000u + p / kImuHz;
+            if (!ring.push(s, stride)) ++out.ring_drops;
+        }
+
+        credit += consumer_share;
+        if (credit < 0) continue;
+        const size_t before = ring.size();
+        consolidate::ConsolidatedRecord rec{};
+        if (consolidate::consolidate_from_ring(ring, rec)) {
+            ++out.records;
+            out.steps += rec.step_count;
+            if (rec.flags & consolidate::kFlagDecimated) ++out.decimated_records;
+            credit -= static_cast<float>(before - ring.size());
+        }
+    }
+    return out;
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_factor_hysteresis() {
+    decimator::Decimator dec;
+    TEST_ASSERT_EQUAL_UINT8(1, dec.update(125));  // a normal full window
+    TEST_ASSERT_EQUAL_UINT8(1, dec.update(159));
+    TEST_ASSERT_EQUAL_UINT8(2, dec.update(160));
+    TEST_ASSERT_EQUAL_UINT8(2, dec.update(130));  // held down to x2_off
+    TEST_ASSERT_EQUAL_UINT8(1, dec.update(127));
+    TEST_ASSERT_EQUAL_UINT8(4, dec.update(200));
+    TEST_ASSERT_EQUAL_UINT8(4, dec.update(170));
+    TEST_ASSERT_EQUAL_UINT8(2, dec.update(159));
+    TEST_ASSERT_EQUAL_UINT8(2, dec.update(191));
+    TEST_ASSERT_EQUAL_UINT8(4, dec.update(192));
+    TEST_ASSERT_EQUAL_UINT8(1, dec.update(0));
+}
+
+// Averages are stride-weighted, flagged, and never overflow the stride byte
+void test_average_and_strides() {
+    decimator::Decimator dec;
+    sensor_driver::ImuReading out;
+    uint8_t stride = 0;
+
+    TEST_ASSERT_TRUE(dec.add(reading(1.0f), 1, out, stride));
+    TEST_ASSERT_EQUAL_UINT8(1, stride);  // factor 1: passes straight through
+
+    dec.update(200);
+    TEST_ASSERT_FALSE(dec.add(reading(1.0f), 1, out, stride));
+    TEST_ASSERT_FALSE(dec.add(reading(2.0f), 1, out, stride));
+    TEST_ASSERT_FALSE(dec.add(reading(3.0f), 2, out, stride));
+    TEST_ASSERT_TRUE(dec.add(reading(4.0f), 1, out, stride));
+    TEST_ASSERT_EQUAL_UINT8(5 | reg_buffer::kStrideDecimated, stride);
+    TEST_ASSERT_EQUAL_UINT8(5, reg_buffer::stride_periods(stride));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, (1 + 2 + 3 * 2 + 4) / 5.0f, out.az);
+    TEST_ASSERT_EQUAL_UINT32(3, dec.folded());
+
+    // Still-mode strides: emitted early rather than past 127 periods
+    TEST_ASSERT_FALSE(dec.add(reading(1.0f), 40, out, stride));
+    TEST_ASSERT_TRUE(dec.add(reading(1.0f), 40, out, stride));
+    TEST_ASSERT_EQUAL_UINT8(80, reg_buffer::stride_periods(stride));
+
+    // Back to full rate: the partial average goes out with the next read
+    dec.update(200);
+    TEST_ASSERT_FALSE(dec.add(reading(1.0f), 1, out, stride));
+    dec.update(0);
+    TEST_ASSERT_TRUE(dec.add(reading(3.0f), 1, out, stride));
+    TEST_ASSERT_EQUAL_UINT8(2 | reg_buffer::kStrideDecimated, stride);
+    TEST_ASSERT_TRUE(dec.add(reading(3.0f), 1, out, stride));
+    TEST_ASSERT_EQUAL_UINT8(1, stride);
+}
+
+// Arm swing at 20 Hz sampled at 50 Hz: keeping every 4th read aliases it to
+// 5 Hz at full amplitude; the x4 average passes about a quarter of it
+void test_average_attenuates_alias() {
+    decimator::Decimator dec;
+    dec.update(255);
+    double picked_sq = 0, averaged_sq = 0;
+    uint32_t n = 0;
+    for (uint32_t p = 0; p < 50 * 20; ++p) {
+        const float v = std::sin(2.0f * kPi * 20.0f * p / 50.0f + 0.3f);
+        sensor_driver::ImuReading out;
+        uint8_t stride;
+        if (dec.add(reading(v), 1, out, stride)) {
+            picked_sq += v * v;
+            averaged_sq += out.az * out.az;
+            ++n;
+        }
+    }
+    const double picked = std::sqrt(picked_sq / n), averaged = std::sqrt(averaged_sq / n);
+    printf("\n[20 Hz at 50 Hz, x4] rms every 4th read %.3f, box-car average %.3f\n", picked, averaged);
+    TEST_ASSERT_TRUE(averaged < picked * 0.35);
+}
+
+// Consumer at 60% of the full-rate stream for 2 min of walking
+void test_overload_keeps_records() {
+    const uint32_t seconds = 120;
+    const Overload plain = run_overloaded(false, 0.6f, seconds);
+    const Overload dec = run_overloaded(true, 0.6f, seconds);
+    const Overload ideal = run_overloaded(false, 10.0f, seconds);
+    printf("\n[walking 2 steps/s, consumer at 60%%, %u s]\n", seconds);
+    printf("  %-16s records %3u, steps %3u, ring drops %4u, decimated records %u\n", "unloaded",
+           ideal.records, ideal.steps, ideal.ring_drops, ideal.decimated_records);
+    printf("  %-16s records %3u, steps %3u, ring drops %4u, decimated records %u\n", "drop when full",
+           plain.records, plain.steps, plain.ring_drops, plain.decimated_records);
+    printf("  %-16s records %3u, steps %3u, ring drops %4u, decimated records %u\n", "decimate",
+           dec.records, dec.steps, dec.ring_drops, dec.decimated_records);
+
+    TEST_ASSERT_TRUE(plain.ring_drops > 1000);
+    TEST_ASSERT_TRUE(plain.records < ideal.records * 3 / 4);
+    TEST_ASSERT_EQUAL_UINT32(0, dec.ring_drops);
+    TEST_ASSERT_UINT32_WITHIN(2, ideal.records, dec.records);
+    TEST_ASSERT_TRUE(dec.decimated_records > dec.records / 2);
+    TEST_ASSERT_UINT32_WITHIN(ideal.steps / 10, ideal.steps, dec.steps);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_factor_hysteresis);
+    RUN_TEST(test_average_and_strides);
+    RUN_TEST(test_average_attenuates_alias);
+    RUN_TEST(test_overload_keeps_records);
+    return UNITY_END();
+}
@@ -0,0 +1,231 @@
+#include <unity.h>
+
+#include <cstdio>
+
+#include "sensors/ppg_agc.h"
+#include "telemetry/energy.h"
+
+// Simulated day through the energy model. Event counts follow the firmware's
+// cadences: PPG FIFO checked at 100 Hz (pointer reads + one 6-byte sample),
+// IMU at 50 Hz or the 6.25 Hz still rate (20 bytes per read), temperature at
+// 1 Hz, a 15 s record appended to flash, and one BLE sync a day that streams
+// every record (12-byte notifications) plus a STATS dump. LED charge comes
+// from the real AGC controller run at a mid-window IR level.
+
+namespace {
+
+struct DayProfile {
+    uint32_t worn_hours = 16;
+    uint32_t still_percent = 60;   // share of worn time the IMU runs at the still rate
+    uint32_t syncs = 1;
+    uint32_t ir_dc = 120000;       // settled IR level the AGC sees
+};
+
+constexpr uint32_t kPpgCheckBytes = 8 + 3 + 6;
+constexpr uint32_t kImuReadBytes = 20;
+constexpr uint32_t kTempReadBytes = 5;
+constexpr uint32_t kWakeupsPerSecond = 100 + 200;  // sensor tick + 5 ms loop
+constexpr uint32_t kRecordBytes = 11;
+constexpr uint32_t kRecordPeriodS = 15;
+constexpr uint32_t kBlockBytes = 4096;
+constexpr uint32_t kStatsCount = 50;
+
+// Counters are cumulative like the telemetry stats; `base` offsets them so
+// the run crosses the 32-bit wrap.
+class Day {
+public:
+    explicit Day(const DayProfile& p, uint32_t base = 0) : p_(p) {
+        now_.elapsed_ms = base;
+        now_.i2c_bytes = base;
+        now_.wakeups = base;
+        now_.radio_tx_packets = base;
+        now_.radio_tx_bytes = base;
+        now_.flash_bytes_written = base;
+        now_.flash_bytes_erased = base;
+        led_base_ = base;
+        now_.led_charge_mc = base;
+    }
+
+    const energy::Counters& counters() const { return now_; }
+
+    void step(uint32_t second) {
+        const bool worn = second < p_.worn_hours * 3600;
+        now_.elapsed_ms += 1000;
+        now_.wakeups += kWakeupsPerSecond;
+        if (worn) {
+            now_.i2c_bytes += 100 * kPpgCheckBytes + kTempReadBytes;
+            const bool still = (second % 100) < p_.still_percent;
+            now_.i2c_bytes += (still ? 6 : 50) * kImuReadBytes;
+            agc_.update(p_.ir_dc, 1000);
+            now_.led_charge_mc = led_base_ + agc_.charge_mc();
+        } else {
+            now_.i2c_bytes += 6 * kImuReadBytes;  // off-wrist: PPG/temp shut down, IMU still
+        }
+        if ((second + 1) % kRecordPeriodS == 0) append_record();
+        if (p_.syncs && (second + 1) % (86400 / p_.syncs) == 0) sync();
+    }
+
+    uint32_t records() const { return records_; }
+
+private:
+    void append_record() {
+        const uint32_t before = file_bytes_;
+        file_bytes_ += kRecordBytes;
+        now_.flash_bytes_written += kRecordBytes;
+        // As fs_store::count_flash_write: every block the append touches
+        now_.flash_bytes_erased += ((file_bytes_ - 1) / kBlockBytes - before / kBlockBytes + 1) * kBlockBytes;
+        ++records_;
+    }
+
+    void sync() {
+        now_.radio_tx_packets += kStatsCount + 2 + (file_bytes_ / kRecordBytes);
+        now_.radio_tx_bytes += kStatsCount * 6 + 5 + 1 + (file_bytes_ / kRecordBytes) * (1 + kRecordBytes);
+        file_bytes_ = 0;  // ERASE after the transfer
+    }
+
+    DayProfile p_;
+    energy::Counters now_;
+    ppg_agc::Controller agc_;
+    uint32_t led_base_ = 0;
+    uint32_t file_bytes_ = 0;
+    uint32_t records_ = 0;
+};
+
+energy::Counters run_day(const DayProfile& p) {
+    Day day(p);
+    for (uint32_t s = 0; s < 86400; ++s) day.step(s);
+    return day.counters();
+}
+
+void print_breakdown(const char* title, const energy::Breakdown& b) {
+    char msg[160];
+    std::snprintf(msg, sizeof(msg), "%s: %.1f mAh/day (%.1f days on 300 mAh)", title, b.total_mah_per_day,
+                  b.battery_days(300.0f));
+    TEST_MESSAGE(msg);
+    for (size_t i = 0; i < energy::kSubsystemCount; ++i) {
+        const energy::Subsystem s = static_cast<energy::Subsystem>(i);
+        std::snprintf(msg, sizeof(msg), "  %-8s %8.2f mAh/day %5.1f%%", energy::subsystem_name(s), b.of(s),
+                      100.0f * b.of(s) / b.total_mah_per_day);
+        TEST_MESSAGE(msg);
+    }
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_idle_is_baseline_only() {
+    energy::Counters c;
+    c.elapsed_ms = 3600 * 1000;
+    energy::Model m;
+    m.baseline_ua = 1000.0f;  // 1 mA -> 24 mAh/day
+    const energy::Breakdown b = energy::estimate(c, m);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 24.0f, b.of(energy::Subsystem::kBaseline));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 24.0f, b.total_mah_per_day);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, b.of(energy::Subsystem::kLed));
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 12.5f, b.battery_days(300.0f));
+}
+
+void test_event_costs_follow_model() {
+    energy::Counters c;
+    c.elapsed_ms = 86400u * 1000u;
+    c.led_charge_mc = 3600;          // 1 mAh
+    c.i2c_bytes = 1000000;
+    c.wakeups = 100000;
+    c.radio_tx_packets = 1000;
+    c.radio_tx_bytes = 12000;
+    c.flash_bytes_written = 4096;
+    c.flash_bytes_erased = 4096;
+    energy::Model m;
+    m.baseline_ua = 0.0f;
+    const energy::Breakdown b = energy::estimate(c, m);
+
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, b.of(energy::Subsystem::kLed));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1e6f * m.i2c_nc_per_byte / 3.6e9f, b.of(energy::Subsystem::kI2c));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1e5f * m.wakeup_nc / 3.6e9f, b.of(energy::Subsystem::kCpu));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, (1000 * m.radio_nc_per_packet + 12000 * m.radio_nc_per_byte) / 3.6e9f,
+                             b.of(energy::Subsystem::kRadio));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 4096 * (m.flash_nc_per_byte_written + m.flash_nc_per_byte_erased) / 3.6e9f,
+                             b.of(energy::Subsystem::kFlash));
+
+    // Same counts over half the time is twice the daily rate
+    c.elapsed_ms /= 2;
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.0f, energy::estimate(c, m).of(energy::Subsystem::kLed));
+}
+
+void test_budget_matches_one_shot_across_counter_wrap() {
+    DayProfile p;
+    Day day(p, 0xFFFF0000u);  // every counter wraps during the first hour
+    energy::Budget budget;
+    energy::Counters last = day.counters();
+    for (uint32_t s = 0; s < 86400; ++s) {
+        day.step(s);
+        if ((s + 1) % 10 == 0) {  // device folds in every kEnergyIntervalMs
+            budget.add(energy::delta(day.counters(), last));
+            last = day.counters();
+        }
+    }
+    const energy::Breakdown folded = budget.per_day();
+    const energy::Breakdown whole = energy::estimate(run_day(p));
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 86400.0f, static_cast<float>(budget.elapsed_s()));
+    for (size_t i = 0; i < energy::kSubsystemCount; ++i) {
+        TEST_ASSERT_FLOAT_WITHIN(whole.mah_per_day[i] * 1e-3f + 1e-4f, whole.mah_per_day[i], folded.mah_per_day[i]);
+    }
+}
+
+void test_simulated_day_breakdown() {
+    DayProfile p;
+    const energy::Counters c = run_day(p);
+    const energy::Breakdown b = energy::estimate(c);
+    print_breakdown("default day", b);
+
+    float sum = 0;
+    for (size_t i = 0; i < energy::kSubsystemCount; ++i) {
+        TEST_ASSERT_TRUE(b.mah_per_day[i] >= 0.0f);
+        sum += b.mah_per_day[i];
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f * sum, sum, b.total_mah_per_day);
+
+    // LED share is the AGC's own average current over the worn hours
+    ppg_agc::Controller agc;
+    for (int i = 0; i < 10; ++i) agc.update(p.ir_dc, 1000);
+    const float led_mah = agc.average_current_ua() / 1000.0f * p.worn_hours;
+    TEST_ASSERT_FLOAT_WITHIN(led_mah * 0.05f, led_mah, b.of(energy::Subsystem::kLed));
+
+    // A day of records: 5760 appends, each copying the file's last block into
+    // a fresh one, plus 14 that straddle a block boundary (the 11th lands on it)
+    TEST_ASSERT_EQUAL_UINT32(5760 * kRecordBytes, c.flash_bytes_written);
+    TEST_ASSERT_EQUAL_UINT32((5760 + 14) * kBlockBytes, c.flash_bytes_erased);
+    TEST_ASSERT_TRUE(b.of(energy::Subsystem::kRadio) > 0.0f);
+    // Without light sleep the idle floor dominates everything event-driven
+    TEST_ASSERT_TRUE(b.of(energy::Subsystem::kBaseline) > b.total_mah_per_day / 2);
+}
+
+void test_light_sleep_profile_shifts_budget_to_events() {
+    DayProfile p;
+    energy::Model m;
+    m.baseline_ua = 1500.0f;  // ENABLE_LIGHT_SLEEP
+    const energy::Breakdown b = energy::estimate(run_day(p), m);
+    print_breakdown("light sleep", b);
+    TEST_ASSERT_TRUE(b.of(energy::Subsystem::kBaseline) < b.total_mah_per_day * 0.75f);
+    // ...and the 5 ms loop polling becomes the largest event-driven cost, ahead of the LEDs
+    TEST_ASSERT_TRUE(b.of(energy::Subsystem::kCpu) > b.of(energy::Subsystem::kLed));
+
+    // Keeping the sensors quiet off-wrist pays: fewer worn hours, less LED and I2C
+    DayProfile off = p;
+    off.worn_hours = 8;
+    const energy::Breakdown less = energy::estimate(run_day(off), m);
+    TEST_ASSERT_TRUE(less.of(energy::Subsystem::kLed) < b.of(energy::Subsystem::kLed) * 0.6f);
+    TEST_ASSERT_TRUE(less.of(energy::Subsystem::kI2c) < b.of(energy::Subsystem::kI2c));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_is_baseline_only);
+    RUN_TEST(test_event_costs_follow_model);
+    RUN_TEST(test_budget_matches_one_shot_across_counter_wrap);
+    RUN_TEST(test_simulated_day_breakdown);
+    RUN_TEST(test_light_sleep_profile_shifts_budget_to_events);
+    return UNITY_END();
+}
@@ -0,0 +1,220 @@
+#include <unity.h>
+
+#include <cstdio>
+
+#include "i2c_bus/bus_recovery.h"
+#include "i2c_bus/i2c_health.h"
+
+// Host simulation of the I2C health monitor against a fault-injecting bus.
+// The fake bus models a slave that can wedge SDA low mid-byte (only cleared
+// by clocking SCL), a slave that loses its configuration (reads fail until
+// re-initialised) and a shorted SCL (unrecoverable). The IMU is read at
+// 50 Hz as on the device; a failed read on a wedged bus costs the Wire timeout.
+
+namespace {
+
+using i2c_health::Action;
+using i2c_health::Device;
+
+constexpr uint32_t kWireTimeoutUs = 50000;
+constexpr uint32_t kReadUs = 250;
+
+struct FakeBus {
+    int stuck_bits = 0;      // clocks until the wedged slave releases SDA
+    bool scl_shorted = false;
+    bool device_lost = false;  // needs reinit before reads succeed
+    bool dead = false;         // never answers
+    bool master_sda_low = false;
+    bool master_scl_low = false;
+    int reinits = 0;
+    int recoveries = 0;
+
+    bool wedged() const { return stuck_bits > 0 || scl_shorted; }
+
+    bool read(uint32_t& latency_us) {
+        if (wedged()) { latency_us = kWireTimeoutUs; return false; }
+        latency_us = kReadUs;
+        return !device_lost && !dead;
+    }
+
+    bool reinit() {
+        ++reinits;
+        if (wedged() || dead) return false;
+        device_lost = false;
+        return true;
+    }
+};
+
+// Open-drain line access for clock_out_stuck_slave()
+struct FakePins {
+    FakeBus& bus;
+    bool sda() const { return !bus.master_sda_low && bus.stuck_bits == 0; }
+    bool scl() const { return !bus.master_scl_low && !bus.scl_shorted; }
+    void sda_low() { bus.master_sda_low = true; }
+    void sda_release() { bus.master_sda_low = false; }
+    void scl_low() {
+        if (!bus.master_scl_low && bus.stuck_bits > 0) --bus.stuck_bits;  // falling edge
+        bus.master_scl_low = true;
+    }
+    void scl_release() { bus.master_scl_low = false; }
+    void wait() {}
+};
+
+bool recover(FakeBus& bus) {
+    ++bus.recoveries;
+    FakePins pins{bus};
+    return i2c_bus::clock_out_stuck_slave(pins);
+}
+
+struct RunResult {
+    uint32_t samples;
+    uint32_t longest_gap_ms;
+};
+
+// 50 Hz IMU reads for `seconds`; `fault` is injected at `fault_ms`
+template <typename Fault>
+RunResult run(FakeBus& bus, i2c_health::Monitor* monitor, uint32_t seconds, uint32_t fault_ms, Fault fault) {
+    RunResult r{0, 0};
+    uint32_t last_sample_ms = 0;
+    uint32_t now_us = 0;
+    for (uint32_t tick = 0; tick < seconds * 50; ++tick) {
+        const uint32_t tick_ms = tick * 20;
+        if (now_us < tick_ms * 1000) now_us = tick_ms * 1000;  // a slow read delays the next tick
+        const uint32_t now_ms = now_us / 1000;
+        if (tick_ms == fault_ms) fault(bus);
+        if (monitor && !monitor->should_read(Device::kImu, now_ms)) continue;
+
+        uint32_t latency = 0;
+        const bool ok = bus.read(latency);
+        now_us += latency;
+        if (ok) {
+            ++r.samples;
+            if (r.samples > 1 && now_ms - last_sample_ms > r.longest_gap_ms) {
+                r.longest_gap_ms = now_ms - last_sample_ms;
+            }
+            last_sample_ms = now_ms;
+        }
+        if (!monitor) continue;
+        const Action action = monitor->report(Device::kImu, ok, latency, now_us / 1000);
+        if (action == Action::kRecoverBus) recover(bus);
+        if (action != Action::kNone) bus.reinit();
+    }
+    if (now_us / 1000 - last_sample_ms > r.longest_gap_ms) r.longest_gap_ms = now_us / 1000 - last_sample_ms;
+    return r;
+}
+
+void wedge_sda(FakeBus& bus) { bus.stuck_bits = 7; bus.device_lost = true; }
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_clock_out_frees_stuck_sda() {
+    FakeBus bus;
+    bus.stuck_bits = 9;
+    FakePins pins{bus};
+    TEST_ASSERT_TRUE(i2c_bus::clock_out_stuck_slave(pins));
+    TEST_ASSERT_EQUAL(0, bus.stuck_bits);
+    TEST_ASSERT_FALSE(bus.master_sda_low);
+    TEST_ASSERT_FALSE(bus.master_scl_low);
+}
+
+void test_clock_out_gives_up_on_shorted_scl() {
+    FakeBus bus;
+    bus.scl_shorted = true;
+    FakePins pins{bus};
+    TEST_ASSERT_FALSE(i2c_bus::clock_out_stuck_slave(pins));
+}
+
+void test_single_glitch_needs_no_action() {
+    i2c_health::Monitor m;
+    TEST_ASSERT_TRUE(m.report(Device::kImu, false, 300, 0) == Action::kNone);
+    TEST_ASSERT_TRUE(m.report(Device::kImu, true, 300, 20) == Action::kNone);
+    TEST_ASSERT_EQUAL_UINT32(0, m.stats(Device::kImu).outages);
+    TEST_ASSERT_FALSE(m.down(Device::kImu));
+}
+
+void test_escalation_and_backoff() {
+    i2c_health::Config cfg;
+    i2c_health::Monitor m(cfg);
+    uint32_t t = 0;
+    TEST_ASSERT_TRUE(m.report(Device::kPpg, false, 100, t) == Action::kNone);
+    TEST_ASSERT_TRUE(m.report(Device::kPpg, false, 100, t += 10) == Action::kNone);
+    TEST_ASSERT_TRUE(m.report(Device::kPpg, false, 100, t += 10) == Action::kReinit);
+    TEST_ASSERT_TRUE(m.down(Device::kPpg));
+    TEST_ASSERT_TRUE(m.should_read(Device::kPpg, t));
+
+    // Rate-limited retries, each failure recovers the bus, intervals double to the cap
+    TEST_ASSERT_TRUE(m.report(Device::kPpg, false, 100, t += 10) == Action::kRecoverBus);
+    uint32_t expected_gap = cfg.retry_interval_ms;
+    for (int i = 0; i < 10; ++i) {
+        TEST_ASSERT_FALSE(m.should_read(Device::kPpg, t + expected_gap - 1));
+        TEST_ASSERT_TRUE(m.should_read(Device::kPpg, t + expected_gap));
+        t += expected_gap;
+        TEST_ASSERT_TRUE(m.report(Device::kPpg, false, 100, t) == Action::kRecoverBus);
+        expected_gap = expected_gap * 2 > cfg.max_retry_interval_ms ? cfg.max_retry_interval_ms
+                                                                     : expected_gap * 2;
+    }
+    TEST_ASSERT_TRUE(m.should_read(Device::kPpg, t + cfg.max_retry_interval_ms));
+
+    // Other devices are unaffected
+    TEST_ASSERT_TRUE(m.should_read(Device::kImu, t));
+}
+
+void test_wedged_bus_recovers_within_a_second() {
+    FakeBus bus;
+    i2c_health::Monitor monitor;
+    const RunResult r = run(bus, &monitor, 60, 10000, wedge_sda);
+
+    const i2c_health::DeviceStats& st = monitor.stats(Device::kImu);
+    char msg[128];
+    std::snprintf(msg, sizeof(msg), "outage %u ms, %u recoveries, %u reinits, %u/%u samples",
+                  static_cast<unsigned>(st.longest_outage_ms), static_cast<unsigned>(st.bus_recoveries),
+                  static_cast<unsigned>(st.reinits), static_cast<unsigned>(r.samples), 60u * 50u);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_EQUAL_UINT32(1, st.outages);
+    TEST_ASSERT_LESS_THAN(1000, st.longest_outage_ms);
+    TEST_ASSERT_LESS_THAN(1000, r.longest_gap_ms);
+    TEST_ASSERT_GREATER_THAN(60 * 50 - 60, r.samples);
+    TEST_ASSERT_FALSE(monitor.down(Device::kImu));
+}
+
+void test_without_monitor_samples_stop_until_reboot() {
+    FakeBus bus;
+    const RunResult r = run(bus, nullptr, 60, 10000, wedge_sda);
+    TEST_ASSERT_EQUAL_UINT32(10 * 50, r.samples);
+}
+
+void test_lost_configuration_fixed_by_reinit() {
+    FakeBus bus;
+    i2c_health::Monitor monitor;
+    run(bus, &monitor, 20, 5000, [](FakeBus& b) { b.device_lost = true; });
+    TEST_ASSERT_EQUAL(0, bus.recoveries);
+    TEST_ASSERT_EQUAL(1, bus.reinits);
+    TEST_ASSERT_LESS_THAN(100, monitor.stats(Device::kImu).longest_outage_ms);
+}
+
+void test_dead_device_costs_little_bus_time() {
+    FakeBus bus;
+    i2c_health::Monitor monitor;
+    run(bus, &monitor, 120, 1000, [](FakeBus& b) { b.dead = true; });
+    // 119 s down: backoff keeps the attempts to a few dozen, not 6000
+    TEST_ASSERT_LESS_THAN(40, monitor.stats(Device::kImu).reads - 50);
+    TEST_ASSERT_TRUE(monitor.down(Device::kImu));
+    TEST_ASSERT_GREATER_THAN(100000, monitor.current_outage_ms(Device::kImu, 120000));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_clock_out_frees_stuck_sda);
+    RUN_TEST(test_clock_out_gives_up_on_shorted_scl);
+    RUN_TEST(test_single_glitch_needs_no_action);
+    RUN_TEST(test_escalation_and_backoff);
+    RUN_TEST(test_wedged_bus_recovers_within_a_second);
+    RUN_TEST(test_without_monitor_samples_stop_until_reboot);
+    RUN_TEST(test_lost_configuration_fixed_by_reinit);
+    RUN_TEST(test_dead_device_costs_little_bus_time);
+    return UNITY_END();
+}
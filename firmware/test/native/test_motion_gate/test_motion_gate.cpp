@@ -0,0 +1,103 @@
+#include <unity.h>
+
+#include <cmath>
+
+#include "compute/consolidate.h"
+#include "ringbuf/reg_buffer.h"
+#include "sensors/motion_gate.h"
+
+using motion_gate::Gate;
+using motion_gate::Mode;
+
+void setUp() {}
+void tearDown() {}
+
+void test_gate_mode_transitions() {
+    Gate g;
+    TEST_ASSERT_TRUE(g.mode() == Mode::kActive);
+    TEST_ASSERT_EQUAL_UINT8(1, g.tick());
+
+    TEST_ASSERT_TRUE(g.on_interrupt(false, true));
+    TEST_ASSERT_TRUE(g.mode() == Mode::kStill);
+    for (int i = 0; i < 7; ++i) TEST_ASSERT_EQUAL_UINT8(0, g.tick());
+    TEST_ASSERT_EQUAL_UINT8(8, g.tick());
+
+    // Repeated no-motion is not a transition
+    TEST_ASSERT_FALSE(g.on_interrupt(false, true));
+
+    // Any-motion mid-stride: the next read happens immediately and covers
+    // the periods already elapsed
+    g.tick();
+    g.tick();
+    TEST_ASSERT_TRUE(g.on_interrupt(true, false));
+    TEST_ASSERT_EQUAL_UINT8(3, g.tick());
+    TEST_ASSERT_EQUAL_UINT8(1, g.tick());
+
+    // Both bits latched together: motion wins
+    g.on_interrupt(false, true);
+    TEST_ASSERT_TRUE(g.on_interrupt(true, true));
+    TEST_ASSERT_TRUE(g.mode() == Mode::kActive);
+    TEST_ASSERT_EQUAL_UINT32(4, g.transitions());
+}
+
+void test_gate_failed_read_carries_periods() {
+    Gate g;
+    uint8_t stride = g.tick();
+    g.carry(stride);  // read failed
+    TEST_ASSERT_EQUAL_UINT8(2, g.tick());
+}
+
+// Drive the ring and consolidation with the gate's variable-rate output:
+// walk 20 s, stand still 20 s, walk 20 s. Records must keep a 2.5 s cadence
+// and no steps may be invented while still.
+void test_consolidation_handles_variable_rate() {
+    Gate g;
+    reg_buffer::SampleRingBuffer ring;
+    reg_buffer::ChannelRing hr;
+    hr.push(reg_buffer::ChannelSample{reg_buffer::float16(70.0f), 1700000000u});
+    consolidate::attach_channels(&hr, nullptr);
+    uint32_t records = 0;
+    uint32_t walk_steps = 0;
+    uint32_t still_steps = 0;
+
+    const uint32_t kPeriods = 60 * 50;  // 50 Hz base periods
+    for (uint32_t p = 0; p < kPeriods; ++p) {
+        const float t = p / 50.0f;
+        const bool walking = t < 20.0f || t >= 40.0f;
+        if (p == 20 * 50 + 250) g.on_interrupt(false, true);  // no-motion after 5 s
+        if (p == 40 * 50) g.on_interrupt(true, false);
+
+        const uint8_t stride = g.tick();
+        if (!stride) continue;
+
+        reg_buffer::Sample s{};
+        const float bounce = walking ? 0.3f * std::sin(2.0f * 3.14159265f * 2.0f * t) : 0.0f;
+        s.ax = reg_buffer::float16(0.0f);
+        s.ay = reg_buffer::float16(0.0f);
+        s.az = reg_buffer::float16(1.0f + bounce);
+        s.timestamp = 1700000000u + p / 50;
+        TEST_ASSERT_TRUE(ring.push(s, stride));
+
+        consolidate::ConsolidatedRecord rec{};
+        while (consolidate::consolidate_from_ring(ring, rec)) {
+            ++records;
+            TEST_ASSERT_UINT32_WITHIN(1, 700, rec.avg_hr_x10);
+            const bool still_window = rec.timestamp >= 1700000000u + 26 && rec.timestamp < 1700000000u + 40;
+            (still_window ? still_steps : walk_steps) += rec.step_count;
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(kPeriods / consolidate::kSamplesPerWindow, records);
+    TEST_ASSERT_EQUAL_UINT32(0, still_steps);
+    // 2 steps/s for 40 s of walking; window edges and the streak backfill cost a few
+    TEST_ASSERT_UINT32_WITHIN(12, 80, walk_steps);
+    consolidate::attach_channels(nullptr, nullptr);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_gate_mode_transitions);
+    RUN_TEST(test_gate_failed_read_carries_periods);
+    RUN_TEST(test_consolidation_handles_variable_rate);
+    return UNITY_END();
+}
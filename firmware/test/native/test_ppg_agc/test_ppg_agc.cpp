@@ -0,0 +1,123 @@
+#include <unity.h>
+
+#include <algorithm>
+#include <cstdio>
+
+#include "sensors/ppg_agc.h"
+
+// Host simulation of the PPG AGC loop. Each wrist is described by the IR DC
+// level it produces at the old fixed settings (0x1F @ 411 us), one entry per
+// second; the sensor model scales that level with amplitude * pulse width and
+// clips at the ADC full scale. Replace the traces with captured levels to
+// replay a real session.
+
+namespace {
+
+constexpr ppg_agc::Settings kBaseline{0x1F, ppg_agc::kPulseWidthCount - 1};
+
+uint32_t sensor_model(uint32_t baseline_dc, const ppg_agc::Settings& s) {
+    const double light = static_cast<double>(s.led_amplitude) * s.pulse_width_us();
+    const double base = static_cast<double>(kBaseline.led_amplitude) * kBaseline.pulse_width_us();
+    const double dc = baseline_dc * light / base;
+    return static_cast<uint32_t>(std::min<double>(dc, ppg_agc::kAdcFullScale));
+}
+
+struct SimResult {
+    uint32_t final_dc;
+    uint32_t seconds_to_window;  // first second the reading was in window
+    uint32_t charge_mc;
+};
+
+SimResult simulate(const uint32_t* trace, size_t seconds) {
+    ppg_agc::Controller agc;
+    ppg_agc::Config cfg;
+    SimResult r{0, UINT32_MAX, 0};
+    for (size_t t = 0; t < seconds; ++t) {
+        const uint32_t dc = sensor_model(trace[t], agc.settings());
+        if (r.seconds_to_window == UINT32_MAX && dc >= cfg.target_low && dc <= cfg.target_high) {
+            r.seconds_to_window = t;
+        }
+        agc.update(dc, 1000);
+        r.final_dc = dc;
+    }
+    r.charge_mc = agc.charge_mc();
+    return r;
+}
+
+// Constant-level wrists, 60 s each
+void fill(uint32_t* trace, size_t n, uint32_t level) {
+    for (size_t i = 0; i < n; ++i) trace[i] = level;
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_pale_wrist_backs_off_from_saturation() {
+    uint32_t trace[60];
+    fill(trace, 60, 400000);  // would clip at the fixed settings
+    SimResult r = simulate(trace, 60);
+    TEST_ASSERT_LESS_THAN(10, r.seconds_to_window);
+    TEST_ASSERT_LESS_THAN(240000, r.final_dc);
+
+    // Fixed settings burn the baseline charge regardless of the wrist
+    ppg_agc::Controller fixed;
+    for (int i = 0; i < 60; ++i) fixed.update(100000, 1000);  // in window, never adjusts
+    TEST_ASSERT_LESS_THAN(fixed.charge_mc(), r.charge_mc);
+}
+
+void test_dark_wrist_raises_light() {
+    uint32_t trace[60];
+    fill(trace, 60, 30000);
+    SimResult r = simulate(trace, 60);
+    TEST_ASSERT_LESS_THAN(15, r.seconds_to_window);
+    TEST_ASSERT_GREATER_OR_EQUAL(70000, r.final_dc);
+}
+
+void test_amplitude_capped_when_window_unreachable() {
+    uint32_t trace[60];
+    fill(trace, 60, 5000);
+    ppg_agc::Controller agc;
+    ppg_agc::Config cfg;
+    for (size_t t = 0; t < 60; ++t) agc.update(sensor_model(trace[t], agc.settings()), 1000);
+    TEST_ASSERT_EQUAL_UINT8(cfg.max_amplitude, agc.settings().led_amplitude);
+    TEST_ASSERT_EQUAL_UINT8(ppg_agc::kPulseWidthCount - 1, agc.settings().pulse_width_idx);
+}
+
+void test_short_pulse_width_used_when_amplitude_bottoms_out() {
+    uint32_t trace[60];
+    fill(trace, 60, 2000000);  // extremely reflective / thin tissue
+    ppg_agc::Controller agc;
+    for (size_t t = 0; t < 60; ++t) agc.update(sensor_model(trace[t], agc.settings()), 1000);
+    TEST_ASSERT_LESS_THAN(ppg_agc::kPulseWidthCount - 1, agc.settings().pulse_width_idx);
+    const uint32_t dc = sensor_model(trace[59], agc.settings());
+    TEST_ASSERT_LESS_OR_EQUAL(170000, dc);
+}
+
+void test_single_noisy_window_is_ignored() {
+    ppg_agc::Controller agc;
+    agc.update(120000, 1000);
+    TEST_ASSERT_FALSE(agc.update(40000, 1000));  // one low window (motion)
+    TEST_ASSERT_FALSE(agc.update(120000, 1000));
+    TEST_ASSERT_EQUAL_UINT32(0, agc.adjustments());
+}
+
+void test_charge_accounting() {
+    // 0x1F = 6.2 mA, 411 us, 100 Hz, 2 LEDs -> 6.2 * 0.0411 * 2 = 509.6 uA
+    ppg_agc::Controller agc;
+    TEST_ASSERT_UINT32_WITHIN(2, 510, agc.average_current_ua());
+    for (int i = 0; i < 3600; ++i) agc.update(120000, 1000);
+    TEST_ASSERT_UINT32_WITHIN(10, 1836, agc.charge_mc());  // 510 uA for one hour
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pale_wrist_backs_off_from_saturation);
+    RUN_TEST(test_dark_wrist_raises_light);
+    RUN_TEST(test_amplitude_capped_when_window_unreachable);
+    RUN_TEST(test_short_pulse_width_used_when_amplitude_bottoms_out);
+    RUN_TEST(test_single_noisy_window_is_ignored);
+    RUN_TEST(test_charge_accounting);
+    return UNITY_END();
+}
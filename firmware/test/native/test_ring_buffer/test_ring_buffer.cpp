@@ -0,0 +1,177 @@
+#include <unity.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "ringbuf/reg_buffer.h"
+
+// Sample ring: in-place reserve/commit, bursts, wrap-around, stride ticks,
+// and a producer thread against a consumer thread (no torn or reordered
+// samples). Also times push() against reserve()/commit() per sample.
+
+namespace {
+
+reg_buffer::Sample make(uint32_t i) {
+    reg_buffer::Sample s{};
+    s.ax = reg_buffer::float16(static_cast<float>(i % 1000));
+    s.gz = reg_buffer::float16(60.0f + static_cast<float>(i % 100));
+    s.timestamp = i;
+    return s;
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+// Nothing reserved is visible until commit(); an uncommitted reservation is dropped
+void test_reserve_commit() {
+    reg_buffer::SampleRingBuffer ring;
+    reg_buffer::Sample* s = ring.reserve(3);
+    TEST_ASSERT_NOT_NULL(s);
+    s->timestamp = 42;
+    TEST_ASSERT_EQUAL_size_t(0, ring.size());
+    TEST_ASSERT_EQUAL_size_t(0, ring.ticks());
+    ring.commit();
+    TEST_ASSERT_EQUAL_size_t(1, ring.size());
+    TEST_ASSERT_EQUAL_size_t(3, ring.ticks());
+
+    s = ring.reserve();
+    s->timestamp = 43;
+    s = ring.reserve();  // replaces the one never committed
+    s->timestamp = 44;
+    ring.commit();
+
+    reg_buffer::Sample out;
+    uint8_t stride = 0;
+    TEST_ASSERT_TRUE(ring.pop(out, &stride));
+    TEST_ASSERT_EQUAL_UINT32(42, out.timestamp);
+    TEST_ASSERT_EQUAL_UINT8(3, stride);
+    TEST_ASSERT_TRUE(ring.pop(out, &stride));
+    TEST_ASSERT_EQUAL_UINT32(44, out.timestamp);
+    TEST_ASSERT_FALSE(ring.pop(out));
+    TEST_ASSERT_EQUAL_size_t(0, ring.ticks());
+}
+
+// A burst is clamped to the free space, wraps the end of storage and may be committed in part
+void test_burst_wraps() {
+    reg_buffer::SampleRingBuffer ring;
+    const size_t cap = reg_buffer::SampleRingBuffer::kCapacity;
+    for (uint32_t i = 0; i < cap - 10; ++i) TEST_ASSERT_TRUE(ring.push(make(i)));
+    reg_buffer::Sample out;
+    for (uint32_t i = 0; i < cap - 20; ++i) TEST_ASSERT_TRUE(ring.pop(out));
+
+    TEST_ASSERT_EQUAL_size_t(cap - 10, ring.reserve_n(1000));
+    const size_t n = ring.reserve_n(32);
+    TEST_ASSERT_EQUAL_size_t(32, n);
+    for (size_t i = 0; i < n; ++i) ring.reserved(i, 2) = make(static_cast<uint32_t>(cap - 10 + i));
+    ring.commit(30);
+    TEST_ASSERT_EQUAL_size_t(40, ring.size());
+    TEST_ASSERT_EQUAL_size_t(10 + 60, ring.ticks());
+
+    for (uint32_t i = 0; i < 40; ++i) {
+        uint8_t stride = 0;
+        TEST_ASSERT_TRUE(ring.peek(i, out, &stride));
+        TEST_ASSERT_EQUAL_UINT32(cap - 20 + i, out.timestamp);
+        TEST_ASSERT_EQUAL_UINT8(i < 10 ? 1 : 2, stride);
+    }
+
+    ring.clear();
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_EQUAL_size_t(0, ring.ticks());
+    for (uint32_t i = 0; i < cap; ++i) TEST_ASSERT_TRUE(ring.push(make(i)));
+    TEST_ASSERT_TRUE(ring.full());
+    TEST_ASSERT_NULL(ring.reserve());
+    TEST_ASSERT_EQUAL_size_t(0, ring.reserve_n(4));
+}
+
+// Sensor task vs main loop: bursts of in-place samples against pops
+void test_producer_consumer() {
+    static reg_buffer::SampleRingBuffer ring;
+    constexpr uint32_t kTotal = 2000000;
+    std::atomic<bool> bad(false);
+
+    std::thread consumer([&] {
+        uint32_t expect = 0;
+        reg_buffer::Sample out;
+        uint8_t stride;
+        while (expect < kTotal) {
+            if (ring.ticks() > ring.size() * 3) bad = true;
+            if (!ring.pop(out, &stride)) continue;
+            const reg_buffer::Sample want = make(expect);
+            if (out.timestamp != expect || out.ax.bits != want.ax.bits || out.gz.bits != want.gz.bits ||
+                stride != 1 + expect % 3) {
+                bad = true;
+                break;
+            }
+            ++expect;
+        }
+    });
+
+    uint32_t next = 0;
+    while (next < kTotal) {
+        size_t n = ring.reserve_n(1 + next % 7);
+        if (n > kTotal - next) n = kTotal - next;
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t v = next + static_cast<uint32_t>(i);
+            ring.reserved(i, static_cast<uint8_t>(1 + v % 3)) = make(v);
+        }
+        ring.commit(n);
+        next += static_cast<uint32_t>(n);
+    }
+    consumer.join();
+
+    TEST_ASSERT_FALSE(bad.load());
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_EQUAL_size_t(0, ring.ticks());
+}
+
+// Per-sample cost of copying a built sample in vs building it in the slot
+void test_push_vs_reserve_cost() {
+    constexpr uint32_t kRounds = 20000;
+    reg_buffer::SampleRingBuffer ring;
+    reg_buffer::Sample out;
+    volatile float src = 1.5f;
+    const size_t cap = reg_buffer::SampleRingBuffer::kCapacity;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < kRounds; ++r) {
+        for (uint32_t i = 0; i < cap; ++i) {
+            reg_buffer::Sample s{};
+            s.ax = s.ay = s.az = reg_buffer::float16(src);
+            s.gx = s.gy = s.gz = reg_buffer::float16(src);
+            s.timestamp = i;
+            ring.push(s);
+        }
+        ring.clear();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < kRounds; ++r) {
+        for (uint32_t i = 0; i < cap; ++i) {
+            reg_buffer::Sample* s = ring.reserve();
+            s->ax = s->ay = s->az = reg_buffer::float16(src);
+            s->gx = s->gy = s->gz = reg_buffer::float16(src);
+            s->timestamp = i;
+            ring.commit();
+        }
+        ring.clear();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    const double samples = static_cast<double>(kRounds) * cap;
+    printf("\n[ring producer, %.0f samples] push(copy) %.1f ns/sample, reserve/commit %.1f ns/sample\n", samples,
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / samples,
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / samples);
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_FALSE(ring.pop(out));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_reserve_commit);
+    RUN_TEST(test_burst_wraps);
+    RUN_TEST(test_producer_consumer);
+    RUN_TEST(test_push_vs_reserve_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,321 @@
+#include <unity.h>
+
+#include <LittleFS.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "app_config.h"
+#include "sensors/acquisition.h"
+#include "storage/sample_spill.h"
+#include "telemetry/telemetry.h"
+
+// Sample spill: the block codec, and the sensor task / storage writer / loop
+// hand-off simulated tick by tick at 50 Hz across a long loop stall (a SEND)
+// on littlefs over emulated flash. Every sample must reach consolidation in
+// order with no gaps unless the writer itself falls a block behind, and
+// the decimator must not average the spilled samples down.
+
+namespace {
+
+constexpr size_t kSectors = 128;  // 512 KB of emulated flash
+constexpr uint32_t kImuHz = 50;
+constexpr size_t kWindowTicks = 125;  // consolidation window (2.5 s)
+
+// IMU-like sample `i`: slowly varying accel/gyro with noise, HR and
+// temperature that rarely change. gz carries the low 16 bits of `i` so the
+// consumer can check order exactly.
+reg_buffer::Sample make(uint32_t i, std::mt19937& rng) {
+    std::normal_distribution<float> noise(0.0f, 0.02f);
+    const float t = i / static_cast<float>(kImuHz);
+    reg_buffer::Sample s{};
+    s.ax = reg_buffer::float16(0.1f * std::sin(t) + noise(rng));
+    s.ay = reg_buffer::float16(0.05f * std::cos(t * 0.7f) + noise(rng));
+    s.az = reg_buffer::float16(0.98f + noise(rng));
+    s.gx = reg_buffer::float16(2.0f * std::sin(t * 1.3f) + noise(rng) * 10);
+    s.gy = reg_buffer::float16(noise(rng) * 10);
+    s.gz.bits = static_cast<uint16_t>(i);
+    s.timestamp = 1700000000u + i / kImuHz;
+    return s;
+}
+
+bool g_sealed = false;
+void on_sealed() { g_sealed = true; }
+
+struct Sim {
+    bool use_spill = true;
+    uint32_t seconds = 300;
+    uint32_t stall_from_s = 60;         // loop task stuck in a transfer
+    uint32_t stall_s = 120;
+    uint32_t stall_every_s = 0;         // repeat the stall this often (0: once)
+    uint32_t writer_stall_from_s = 0;   // storage writer stuck too (0: never)
+    uint32_t writer_stall_s = 0;
+};
+
+struct Outcome {
+    uint32_t produced = 0;
+    uint32_t consumed = 0;
+    uint32_t producer_drops = 0;  // ring full, or spill a block behind
+    uint32_t missing = 0;         // samples the consumer never saw
+    uint32_t out_of_order = 0;
+    uint32_t sessions = 0;
+    uint32_t spilled = 0;
+    uint32_t spill_dropped = 0;
+    uint64_t spill_bytes = 0;
+    bool back_on_ring = false;
+};
+
+uint32_t stat(telemetry::Stat id) { return telemetry::get(id); }
+
+Outcome simulate(const Sim& sim) {
+    flash_emu::Flash flash(kSectors);
+    LittleFS.attach(&flash);
+    LittleFS.begin(true);
+    sample_spill::begin(on_sealed);
+    g_sealed = false;
+
+    static reg_buffer::SampleRingBuffer ring;
+    static reg_buffer::SampleRingBuffer replay;
+    ring.clear();
+    replay.clear();
+
+    const uint32_t sessions0 = stat(telemetry::Stat::kSpillSessions);
+    const uint32_t spilled0 = stat(telemetry::Stat::kSpillSamples);
+    const uint32_t dropped0 = stat(telemetry::Stat::kSpillDropped);
+    const uint64_t programmed0 = flash.bytes_programmed();
+
+    std::mt19937 rng(11);
+    Outcome out;
+    uint16_t expect = 0;
+    const uint32_t ticks = sim.seconds * kImuHz;
+    for (uint32_t tick = 0; tick < ticks; ++tick) {
+        const uint32_t s = tick / kImuHz;
+
+        // Sensor task
+        const reg_buffer::Sample sample = make(tick, rng);
+        ++out.produced;
+        if (sim.use_spill && sample_spill::divert(ring)) {
+            if (!sample_spill::add(sample, 1)) ++out.producer_drops;
+        } else if (!ring.push(sample)) {
+            ++out.producer_drops;
+        }
+
+        // Storage writer task
+        const bool writer_stalled = sim.writer_stall_s && s >= sim.writer_stall_from_s &&
+                                    s < sim.writer_stall_from_s + sim.writer_stall_s;
+        if (g_sealed && !writer_stalled) {
+            g_sealed = false;
+            sample_spill::write_sealed();
+        }
+
+        // Loop task, a few 5 ms passes per IMU tick, one window per pass
+        if (s >= sim.stall_from_s) {
+            const uint32_t into = s - sim.stall_from_s;
+            if ((sim.stall_every_s ? into % sim.stall_every_s : into) < sim.stall_s) continue;
+        }
+        for (int pass = 0; pass < 4; ++pass) {
+            if (sim.use_spill) sample_spill::replay(ring, replay);
+            if (replay.ticks() + ring.ticks() < kWindowTicks) break;
+            reg_buffer::Sample got;
+            for (size_t n = 0; n < kWindowTicks && (replay.pop(got) || ring.pop(got)); ++n) {
+                const uint16_t skipped = static_cast<uint16_t>(got.gz.bits - expect);
+                if (skipped >= 0x8000) {
+                    ++out.out_of_order;
+                } else {
+                    out.missing += skipped;
+                    expect = static_cast<uint16_t>(got.gz.bits + 1);
+                }
+                ++out.consumed;
+            }
+        }
+    }
+    out.sessions = stat(telemetry::Stat::kSpillSessions) - sessions0;
+    out.spilled = stat(telemetry::Stat::kSpillSamples) - spilled0;
+    out.spill_dropped = stat(telemetry::Stat::kSpillDropped) - dropped0;
+    out.spill_bytes = flash.bytes_programmed() - programmed0;
+    out.back_on_ring = !sample_spill::active() && sample_spill::bytes_pending() == 0;
+    LittleFS.end();
+    return out;
+}
+
+// IMU for acquisition::Pipeline: one reading per call, ax counting reads
+struct CountingImu {
+    uint32_t reads = 0;
+    size_t read_batch(sensor_driver::Span<sensor_driver::ImuReading> out) {
+        out[0] = sensor_driver::ImuReading{static_cast<float>(reads++ % 1000), 0, 1, 0, 0, 0, NAN};
+        return 1;
+    }
+};
+struct NoSensor {};
+
+void print_outcome(const char* label, const Outcome& o) {
+    printf("  %-26s produced %6u, consumed %6u, dropped %5u, missing %5u | %u spill(s), %u samples spilled, %.1f KB programmed\n",
+           label, o.produced, o.consumed, o.producer_drops, o.missing, o.sessions, o.spilled, o.spill_bytes / 1024.0);
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+// Lossless round trip; realistic IMU blocks compress below 17 bytes a sample
+void test_codec_round_trip() {
+    std::mt19937 rng(3);
+    reg_buffer::Sample in[sample_spill::kBlockSamples];
+    uint8_t strides[sample_spill::kBlockSamples];
+    for (uint32_t i = 0; i < sample_spill::kBlockSamples; ++i) {
+        in[i] = make(1000 + i, rng);
+        strides[i] = static_cast<uint8_t>(1 + (i / 20) % 3);
+    }
+    in[40].timestamp += 100000;  // time sync mid-block: escaped full timestamp
+
+    uint8_t encoded[sample_spill::kMaxBlockBytes];
+    const size_t bytes = sample_spill::encode(in, strides, sample_spill::kBlockSamples, encoded);
+    reg_buffer::Sample out[sample_spill::kBlockSamples];
+    uint8_t out_strides[sample_spill::kBlockSamples];
+    TEST_ASSERT_EQUAL_size_t(sample_spill::kBlockSamples,
+                             sample_spill::decode(encoded, bytes, out, out_strides, sample_spill::kBlockSamples));
+    TEST_ASSERT_EQUAL_MEMORY(in, out, sizeof(in));
+    TEST_ASSERT_EQUAL_MEMORY(strides, out_strides, sizeof(strides));
+
+    const size_t raw = sample_spill::kBlockSamples * (sizeof(reg_buffer::Sample) + 1);
+    printf("\n[spill codec] %zu samples: %zu bytes raw, %zu encoded (%.1f bytes/sample)\n",
+           sample_spill::kBlockSamples, raw, bytes, static_cast<double>(bytes) / sample_spill::kBlockSamples);
+    TEST_ASSERT_TRUE(bytes < raw * 7 / 8);
+    TEST_ASSERT_TRUE(bytes <= sample_spill::kMaxBlockBytes - 8);
+
+    // Truncated or overlong input is rejected, not half-decoded
+    TEST_ASSERT_EQUAL_size_t(0, sample_spill::decode(encoded, bytes - 1, out, out_strides, sample_spill::kBlockSamples));
+    TEST_ASSERT_EQUAL_size_t(0, sample_spill::decode(encoded, bytes, out, out_strides, sample_spill::kBlockSamples - 1));
+}
+
+// A 2 min loop stall: without the spill the ring overflows within seconds;
+// with it every sample is consolidated, in order, and the sensor task is
+// back on the ring afterwards
+void test_stall_no_gaps() {
+    printf("\n[loop stalled 120 s at 50 Hz, 256-sample ring]\n");
+    Sim sim;
+    sim.use_spill = false;
+    const Outcome without = simulate(sim);
+    print_outcome("ring only", without);
+    sim.use_spill = true;
+    const Outcome with = simulate(sim);
+    print_outcome("ring + spill", with);
+
+    TEST_ASSERT_TRUE(without.missing > 100 * kImuHz);
+    TEST_ASSERT_EQUAL_UINT32(1, with.sessions);
+    TEST_ASSERT_EQUAL_UINT32(0, with.producer_drops);
+    TEST_ASSERT_EQUAL_UINT32(0, with.spill_dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, with.missing);
+    TEST_ASSERT_EQUAL_UINT32(0, with.out_of_order);
+    TEST_ASSERT_TRUE(with.spilled > 110 * kImuHz);
+    TEST_ASSERT_TRUE(with.back_on_ring);
+    TEST_ASSERT_TRUE(with.produced - with.consumed < 2 * kWindowTicks);
+}
+
+// The writer stuck as well: a block's worth of samples is dropped (and
+// counted) while it is, the rest still arrives in order
+void test_writer_behind() {
+    Sim sim;
+    sim.writer_stall_from_s = 80;
+    sim.writer_stall_s = 10;
+    const Outcome o = simulate(sim);
+    printf("\n[loop stalled 120 s, writer stalled 10 s]\n");
+    print_outcome("ring + spill", o);
+
+    TEST_ASSERT_TRUE(o.spill_dropped > 0);
+    TEST_ASSERT_EQUAL_UINT32(o.spill_dropped, o.producer_drops);
+    TEST_ASSERT_EQUAL_UINT32(o.producer_drops, o.missing);
+    TEST_ASSERT_TRUE(o.missing < 10 * kImuHz);
+    TEST_ASSERT_EQUAL_UINT32(0, o.out_of_order);
+    TEST_ASSERT_TRUE(o.back_on_ring);
+}
+
+// Stall after stall: the file restarts each time it has been fully
+// replayed, so it stays one stall long
+void test_repeated_stalls() {
+    Sim sim;
+    sim.seconds = 900;
+    sim.stall_from_s = 30;
+    sim.stall_s = 40;
+    sim.stall_every_s = 150;
+    const Outcome o = simulate(sim);
+    printf("\n[40 s loop stall every 150 s, 15 min]\n");
+    print_outcome("ring + spill", o);
+
+    TEST_ASSERT_EQUAL_UINT32(6, o.sessions);
+    TEST_ASSERT_EQUAL_UINT32(0, o.missing);
+    TEST_ASSERT_EQUAL_UINT32(0, o.out_of_order);
+    TEST_ASSERT_TRUE(o.back_on_ring);
+}
+
+// The same stall with the sensor task's pipeline in front of the ring: the
+// decimator engages while the ring rises to the spill watermark, but the
+// spilled samples stay at 50 Hz rather than x4 for the whole stall
+void test_stall_with_decimator() {
+    flash_emu::Flash flash(kSectors);
+    LittleFS.attach(&flash);
+    LittleFS.begin(true);
+    sample_spill::begin(on_sealed);
+    g_sealed = false;
+    static reg_buffer::SampleRingBuffer ring;
+    static reg_buffer::SampleRingBuffer replay;
+    ring.clear();
+    replay.clear();
+
+    CountingImu imu;
+    NoSensor none;
+    acquisition::Pipeline<CountingImu, NoSensor, NoSensor> pipeline(imu, none, none);
+    pipeline.set_ring(&ring);
+    pipeline.set_overflow({sample_spill::divert, sample_spill::add});
+
+    constexpr uint32_t kSeconds = 300;
+    constexpr uint32_t kStallFrom = 60;
+    constexpr uint32_t kStall = 120;
+    uint32_t periods = 0;
+    uint32_t decimated_periods = 0;
+    for (uint32_t tick = 0; tick < kSeconds * kImuHz; ++tick) {
+        const uint32_t s = tick / kImuHz;
+        TEST_ASSERT_TRUE(pipeline.sample_imu(1, 1700000000u + s));
+        if (g_sealed) {
+            g_sealed = false;
+            sample_spill::write_sealed();
+        }
+        if (s >= kStallFrom && s < kStallFrom + kStall) continue;
+        for (int pass = 0; pass < 4; ++pass) {
+            sample_spill::replay(ring, replay);
+            if (replay.ticks() + ring.ticks() < kWindowTicks) break;
+            reg_buffer::Sample got;
+            uint8_t stride = 0;
+            for (size_t n = 0; n < kWindowTicks && (replay.pop(got, &stride) || ring.pop(got, &stride));) {
+                const uint8_t p = reg_buffer::stride_periods(stride);
+                periods += p;
+                if (stride & reg_buffer::kStrideDecimated) decimated_periods += p;
+                n += p;
+            }
+        }
+    }
+    LittleFS.end();
+    printf("\n[loop stalled %u s, decimator + spill] %u periods consumed, %u of them decimated, %u reads folded\n",
+           kStall, periods, decimated_periods, pipeline.decimation().folded());
+
+    TEST_ASSERT_EQUAL_UINT32(0, pipeline.ring_drops());
+    TEST_ASSERT_TRUE(kSeconds * kImuHz - periods < 2 * kWindowTicks);
+    // Only the climb from x2_on to the watermark, not the 6000-period stall
+    TEST_ASSERT_TRUE(decimated_periods < 2 * kSpillRingWatermark);
+    TEST_ASSERT_TRUE(!sample_spill::active());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_codec_round_trip);
+    RUN_TEST(test_stall_no_gaps);
+    RUN_TEST(test_writer_behind);
+    RUN_TEST(test_repeated_stalls);
+    RUN_TEST(test_stall_with_decimator);
+    return UNITY_END();
+}
@@ -0,0 +1,234 @@
+#include <unity.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "sensors/interval_stats.h"
+#include "sensors/tick_schedule.h"
+
+// Host run of the sensor task's tick dispatch against a simulated clock.
+// The 100 Hz timer ISR counts ticks; the task wakes after a short latency,
+// performs its I2C reads (each takes bus time) and can be held off by
+// interference on its core: short ISR bursts from BLE connection events and
+// long stalls while LittleFS programs or erases flash (cache disabled).
+// Interval histograms are fed exactly as on the device.
+
+namespace {
+
+constexpr uint64_t kTickUs = 10000;
+constexpr uint64_t kPpgReadUs = 350;   // FIFO pointer read + up to 4 samples
+constexpr uint64_t kImuReadUs = 400;   // 12-byte burst + temperature
+constexpr uint64_t kTempReadUs = 250;
+constexpr uint64_t kWakeLatencyUs = 30;
+
+struct Stall { uint64_t start; uint64_t end; };
+
+struct Load {
+    uint64_t ble_interval_us = 0;  // 0: no BLE traffic
+    uint64_t ble_burst_us = 0;     // worst-case ISR time per connection event
+    uint64_t flash_every_us = 0;   // 0: no flash writes
+    uint64_t flash_stall_us = 0;
+};
+
+std::vector<Stall> make_stalls(const Load& load, uint64_t duration_us, uint32_t seed) {
+    std::vector<Stall> stalls;
+    std::mt19937 rng(seed);
+    if (load.ble_interval_us) {
+        // Connection events drift against the sensor timer (separate clocks)
+        std::uniform_int_distribution<uint64_t> burst(load.ble_burst_us / 4, load.ble_burst_us);
+        std::uniform_int_distribution<uint64_t> drift(0, 997);
+        for (uint64_t t = 1234; t < duration_us; t += load.ble_interval_us + drift(rng)) {
+            stalls.push_back({t, t + burst(rng)});
+        }
+    }
+    if (load.flash_every_us) {
+        for (uint64_t t = load.flash_every_us / 2; t < duration_us; t += load.flash_every_us) {
+            stalls.push_back({t, t + load.flash_stall_us});
+        }
+    }
+    std::sort(stalls.begin(), stalls.end(), [](const Stall& a, const Stall& b) { return a.start < b.start; });
+    return stalls;
+}
+
+// Core time: `cost` of work starting at `t`, stretched by any stall it overlaps
+uint64_t run_for(uint64_t t, uint64_t cost, const std::vector<Stall>& stalls) {
+    uint64_t end = t + cost;
+    for (const Stall& s : stalls) {
+        if (s.start >= end) break;
+        if (s.end <= t) continue;
+        if (s.start <= t) { end += s.end - t; t = s.end; } else { end += s.end - s.start; }
+    }
+    return end;
+}
+
+struct SimResult {
+    interval_stats::Histogram ppg{10000};
+    interval_stats::Histogram imu{20000};
+    interval_stats::Histogram temp{1000000};
+    uint32_t imu_periods = 0;    // sum of strides handed to the IMU
+    uint32_t merged = 0;
+};
+
+// `count_ticks` false models the old dispatch: every wake-up is one tick.
+void simulate(SimResult& r, const Load& load, uint32_t seconds, bool count_ticks = true) {
+    const uint64_t duration = static_cast<uint64_t>(seconds) * 1000000;
+    const std::vector<Stall> stalls = make_stalls(load, duration, 7);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<uint64_t> isr_jitter(0, 40);
+
+    tick_schedule::Schedule schedule;
+    uint32_t legacy_tick = 0;
+    uint64_t task_free = 0;
+    uint64_t next_fire = 0;
+    uint32_t fired = 0;
+
+    while (next_fire < duration) {
+        // Wake for the next tick unless still busy; stalls hold off the wake-up too
+        const uint64_t wake = run_for(std::max(next_fire + kWakeLatencyUs, task_free), 0, stalls);
+        while (next_fire <= wake) {
+            ++fired;
+            next_fire = fired * kTickUs + isr_jitter(rng);
+        }
+
+        tick_schedule::Span span;
+        if (count_ticks) {
+            span = schedule.advance(fired);
+        } else {
+            span = tick_schedule::Span{legacy_tick++, 1};
+        }
+
+        uint64_t t = wake;
+        r.ppg.record(static_cast<uint32_t>(t));
+        t = run_for(t, kPpgReadUs, stalls);
+        if (const uint32_t periods = span.hits(2)) {
+            r.imu.record(static_cast<uint32_t>(t));  // planned rate is every period
+            r.imu_periods += periods;
+            t = run_for(t, kImuReadUs, stalls);
+        }
+        if (span.hits(100)) {
+            r.temp.record(static_cast<uint32_t>(t));
+            t = run_for(t, kTempReadUs, stalls);
+        }
+        task_free = t;
+    }
+    r.merged = schedule.merged_ticks();
+}
+
+void print(const char* label, const SimResult& r) {
+    std::printf("%-10s ppg min/p99/max %5u/%5u/%5u us missed %3u | imu min/p99/max %5u/%5u/%5u us missed %3u | merged %u\n",
+                label, r.ppg.min_us(), r.ppg.percentile_us(99), r.ppg.max_us(), r.ppg.missed(),
+                r.imu.min_us(), r.imu.percentile_us(99), r.imu.max_us(), r.imu.missed(), r.merged);
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_histogram_steady_rate() {
+    interval_stats::Histogram h(10000);
+    for (uint32_t i = 0; i <= 100; ++i) h.record(i * 10000);
+    TEST_ASSERT_EQUAL_UINT32(100, h.count());
+    TEST_ASSERT_EQUAL_UINT32(10000, h.min_us());
+    TEST_ASSERT_EQUAL_UINT32(10000, h.max_us());
+    TEST_ASSERT_EQUAL_UINT32(10000, h.percentile_us(99));
+    TEST_ASSERT_EQUAL_UINT32(0, h.missed());
+}
+
+void test_histogram_late_and_strided_samples() {
+    interval_stats::Histogram h(20000);
+    h.record(0);
+    h.record(20000);
+    h.record(60000);            // one period skipped
+    h.record(60000 + 160000, 8);  // reduced-rate read covering 8 periods, on time
+    TEST_ASSERT_EQUAL_UINT32(1, h.missed());
+    TEST_ASSERT_EQUAL_UINT32(1, h.skipped_periods());
+    TEST_ASSERT_EQUAL_UINT32(40000, h.max_us());
+    TEST_ASSERT_EQUAL_UINT32(20000, h.min_us());
+
+    // Wraps with micros()
+    interval_stats::Histogram w(10000);
+    w.record(0xFFFFF000u);
+    w.record(0xFFFFF000u + 10000);
+    TEST_ASSERT_EQUAL_UINT32(10000, w.max_us());
+
+    h.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, h.count());
+    h.record(60000 + 160000 + 20000);
+    TEST_ASSERT_EQUAL_UINT32(20000, h.max_us());  // measured from the last sample before reset
+}
+
+void test_span_hits() {
+    tick_schedule::Schedule s;
+    tick_schedule::Span a = s.advance(1);  // tick 0
+    TEST_ASSERT_EQUAL_UINT32(1, a.hits(2));
+    TEST_ASSERT_EQUAL_UINT32(1, a.hits(100));
+    tick_schedule::Span b = s.advance(2);  // tick 1
+    TEST_ASSERT_EQUAL_UINT32(0, b.hits(2));
+    tick_schedule::Span c = s.advance(9);  // ticks 2..8 merged
+    TEST_ASSERT_EQUAL_UINT32(4, c.hits(2));  // 2, 4, 6, 8
+    TEST_ASSERT_EQUAL_UINT32(0, c.hits(10, 9));
+    tick_schedule::Span d = s.advance(10);  // tick 9
+    TEST_ASSERT_EQUAL_UINT32(1, d.hits(10, 9));
+    TEST_ASSERT_EQUAL_UINT32(6, s.merged_ticks());
+    TEST_ASSERT_EQUAL_UINT32(0, s.advance(10).count);
+}
+
+void test_idle_meets_rates() {
+    static SimResult r;
+    simulate(r, Load{}, 60);
+    print("idle", r);
+    TEST_ASSERT_LESS_OR_EQUAL(10500, r.ppg.percentile_us(99));
+    TEST_ASSERT_LESS_OR_EQUAL(20500, r.imu.percentile_us(99));
+    TEST_ASSERT_EQUAL_UINT32(0, r.ppg.missed());
+    TEST_ASSERT_EQUAL_UINT32(0, r.imu.missed());
+    TEST_ASSERT_UINT32_WITHIN(2, 60 * 100, r.ppg.count());
+    TEST_ASSERT_UINT32_WITHIN(2, 60, r.temp.count());
+}
+
+void test_ble_load_jitter_bound() {
+    static SimResult r;
+    Load load;
+    load.ble_interval_us = 7500;  // fastest connection interval
+    load.ble_burst_us = 600;
+    simulate(r, load, 60);
+    print("ble", r);
+    TEST_ASSERT_LESS_OR_EQUAL(11000, r.ppg.percentile_us(99));
+    TEST_ASSERT_LESS_OR_EQUAL(21000, r.imu.percentile_us(99));
+    TEST_ASSERT_EQUAL_UINT32(0, r.imu.missed());
+}
+
+void test_flash_stalls_do_not_lose_time() {
+    Load load;
+    load.ble_interval_us = 7500;
+    load.ble_burst_us = 600;
+    load.flash_every_us = 15000000;  // one interval record every 15 s
+    load.flash_stall_us = 45000;     // sector erase
+    static SimResult counted;
+    static SimResult legacy;
+    simulate(counted, load, 120, true);
+    simulate(legacy, load, 120, false);
+    print("flash", counted);
+    print("legacy", legacy);
+
+    // Stalls show up as missed deadlines ...
+    TEST_ASSERT_GREATER_THAN(0, counted.imu.missed());
+    TEST_ASSERT_GREATER_THAN(0, counted.merged);
+    // ... but every IMU period is still accounted for, so windows stay 2.5 s
+    TEST_ASSERT_UINT32_WITHIN(1, 120 * 50, counted.imu_periods);
+    // Treating each wake-up as one tick drops the merged ones
+    TEST_ASSERT_LESS_THAN(counted.imu_periods - 10, legacy.imu_periods);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_histogram_steady_rate);
+    RUN_TEST(test_histogram_late_and_strided_samples);
+    RUN_TEST(test_span_hits);
+    RUN_TEST(test_idle_meets_rates);
+    RUN_TEST(test_ble_load_jitter_bound);
+    RUN_TEST(test_flash_stalls_do_not_lose_time);
+    return UNITY_END();
+}
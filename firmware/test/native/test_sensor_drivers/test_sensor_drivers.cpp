@@ -0,0 +1,466 @@
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <type_traits>
+
+#include "ringbuf/reg_buffer.h"
+#include "sensors/acquisition.h"
+#include "sensors/max30102_fifo.h"
+#include "sensors/sensor_driver.h"
+
+// Host fakes for the three sensor drivers, plugged into the same
+// acquisition::Pipeline the sensor task uses. The fakes only implement the
+// do_* hooks; presence, power state and health come from the shared base.
+// The MAX30102 FIFO is also modelled at register level (32 deep, pointers
+// and overflow counter) to compare the driver's burst read with the
+// SparkFun library's 4-slot check() buffer.
+
+namespace {
+
+using sensor_driver::ImuReading;
+using sensor_driver::PowerMode;
+using sensor_driver::PpgReading;
+using sensor_driver::Span;
+using sensor_driver::TempReading;
+
+uint32_t g_now_us = 0;
+constexpr uint32_t kTransferUs = 90;  // per I2C transaction
+constexpr uint32_t kPerReadingUs = 60;
+
+class FakeImu : public sensor_driver::Driver<FakeImu, ImuReading> {
+public:
+    bool attached = true;
+    bool fail_reads = false;
+    int transactions = 0;
+    ImuReading next{0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 30.0f};
+
+private:
+    friend class sensor_driver::Driver<FakeImu, ImuReading>;
+    bool do_begin() { return attached; }
+    size_t do_read_batch(Span<ImuReading> out, bool& ok) {
+        ++transactions;
+        g_now_us += kTransferUs;
+        if (fail_reads || out.empty()) { ok = !fail_reads; return 0; }
+        out[0] = next;
+        return 1;
+    }
+    bool do_power_mode(PowerMode) { return true; }
+    uint32_t now_us() const { return g_now_us; }
+};
+
+// FIFO-backed like the MAX30102: one transaction drains up to out.size()
+class FakePpg : public sensor_driver::Driver<FakePpg, PpgReading> {
+public:
+    std::deque<PpgReading> fifo;
+    int transactions = 0;
+
+    void produce(size_t n, uint32_t ir) {
+        for (size_t i = 0; i < n; ++i) fifo.push_back(PpgReading{ir / 2, ir});
+    }
+
+private:
+    friend class sensor_driver::Driver<FakePpg, PpgReading>;
+    bool do_begin() { return true; }
+    size_t do_read_batch(Span<PpgReading> out, bool&) {
+        ++transactions;
+        g_now_us += kTransferUs;
+        size_t n = 0;
+        while (n < out.size() && !fifo.empty()) {
+            out[n++] = fifo.front();
+            fifo.pop_front();
+            g_now_us += kPerReadingUs;
+        }
+        return n;
+    }
+    bool do_power_mode(PowerMode mode) {
+        if (mode != PowerMode::kNormal) fifo.clear();
+        return true;
+    }
+    uint32_t now_us() const { return g_now_us; }
+};
+
+class FakeTemp : public sensor_driver::Driver<FakeTemp, TempReading> {
+public:
+    float celsius = 36.5f;
+
+private:
+    friend class sensor_driver::Driver<FakeTemp, TempReading>;
+    bool do_begin() { return true; }
+    size_t do_read_batch(Span<TempReading> out, bool&) {
+        g_now_us += kTransferUs;
+        out[0].celsius = celsius;
+        return 1;
+    }
+    bool do_power_mode(PowerMode) { return true; }
+    uint32_t now_us() const { return g_now_us; }
+};
+
+using FakePipeline = acquisition::Pipeline<FakeImu, FakePpg, FakeTemp>;
+
+// MAX30102 FIFO registers: samples arrive at 100 Hz into 32 slots; a full
+// FIFO (rollover off) drops new samples and counts them in OVF_COUNTER.
+// Sample k reads back as red = k, ir = k + 1.
+class Max30102Registers {
+public:
+    bool fail = false;
+    int transactions = 0;
+    uint32_t produced = 0;
+
+    void produce(size_t n) {
+        for (size_t i = 0; i < n; ++i, ++produced) {
+            if (count_ == max30102_fifo::kDepth) {
+                if (ovf_ < 0x1F) ++ovf_;
+                continue;
+            }
+            slots_[wr_] = produced;
+            wr_ = (wr_ + 1) & 0x1F;
+            ++count_;
+        }
+    }
+
+    // One burst register read, as i2c_readN does it
+    bool read(uint8_t reg, uint8_t* buf, size_t n) {
+        ++transactions;
+        g_now_us += kTransferUs;
+        if (fail) return false;
+        if (reg == max30102_fifo::kRegWritePtr && n == 3) {
+            buf[0] = wr_;
+            buf[1] = ovf_;
+            buf[2] = rd_;
+            return true;
+        }
+        if (reg != max30102_fifo::kRegData || n % max30102_fifo::kBytesPerSample) return false;
+        for (size_t i = 0; i < n; i += max30102_fifo::kBytesPerSample) {
+            const uint32_t k = count_ ? slots_[rd_] : 0;
+            if (count_) {
+                rd_ = (rd_ + 1) & 0x1F;
+                --count_;
+                ovf_ = 0;
+            }
+            put(&buf[i], k);
+            put(&buf[i + 3], k + 1);
+        }
+        return true;
+    }
+
+private:
+    static void put(uint8_t* p, uint32_t v) {
+        p[0] = static_cast<uint8_t>(v >> 16) & 0x03;
+        p[1] = static_cast<uint8_t>(v >> 8);
+        p[2] = static_cast<uint8_t>(v);
+    }
+
+    uint32_t slots_[max30102_fifo::kDepth] = {};
+    uint8_t wr_ = 0, rd_ = 0, ovf_ = 0;
+    size_t count_ = 0;
+};
+
+// The device driver's read path over the register model
+class RegisterPpg : public sensor_driver::Driver<RegisterPpg, PpgReading> {
+public:
+    explicit RegisterPpg(Max30102Registers& regs) : regs_(regs) {}
+
+private:
+    friend class sensor_driver::Driver<RegisterPpg, PpgReading>;
+    bool do_begin() { return true; }
+    size_t do_read_batch(Span<PpgReading> out, bool& ok) { return max30102_fifo::read(regs_, out, ok); }
+    bool do_power_mode(PowerMode) { return true; }
+    uint32_t now_us() const { return g_now_us; }
+
+    Max30102Registers& regs_;
+};
+
+// The read path the driver used before: SparkFun MAX30105::check() copies
+// every pending sample into a 4-slot buffer, advancing head modulo 4 and
+// never tail; available() is (head - tail) mod 4
+class LibraryPpg : public sensor_driver::Driver<LibraryPpg, PpgReading> {
+public:
+    explicit LibraryPpg(Max30102Registers& regs) : regs_(regs) {}
+
+private:
+    friend class sensor_driver::Driver<LibraryPpg, PpgReading>;
+    static constexpr uint8_t kStorage = 4;
+
+    void check() {
+        uint8_t ptrs[3];
+        if (!regs_.read(max30102_fifo::kRegWritePtr, ptrs, 3)) return;
+        const size_t n = max30102_fifo::pending(ptrs[0], ptrs[2], ptrs[1]);
+        for (size_t i = 0; i < n; ++i) {
+            uint8_t raw[max30102_fifo::kBytesPerSample];
+            regs_.read(max30102_fifo::kRegData, raw, sizeof(raw));
+            head_ = (head_ + 1) % kStorage;
+            sense_[head_].red = max30102_fifo::decode(raw);
+            sense_[head_].ir = max30102_fifo::decode(raw + 3);
+        }
+    }
+    uint8_t available() const { return static_cast<uint8_t>((head_ + kStorage - tail_) % kStorage); }
+
+    bool do_begin() { return true; }
+    size_t do_read_batch(Span<PpgReading> out, bool&) {
+        if (!available()) check();
+        size_t n = 0;
+        while (n < out.size() && available()) {
+            out[n++] = sense_[tail_];
+            tail_ = (tail_ + 1) % kStorage;
+        }
+        return n;
+    }
+    bool do_power_mode(PowerMode) { return true; }
+    uint32_t now_us() const { return g_now_us; }
+
+    Max30102Registers& regs_;
+    PpgReading sense_[kStorage] = {};
+    uint8_t head_ = 0, tail_ = 0;
+};
+
+// Static dispatch only: no vtables anywhere in the driver stack
+static_assert(!std::is_polymorphic<FakeImu>::value, "drivers must not be virtual");
+static_assert(!std::is_polymorphic<FakePpg>::value, "drivers must not be virtual");
+static_assert(!std::is_polymorphic<sensor_driver::Driver<FakeTemp, TempReading>>::value,
+              "driver base must not be virtual");
+static_assert(!std::is_polymorphic<FakePipeline>::value, "pipeline must not be virtual");
+
+}  // namespace
+
+void setUp(void) { g_now_us = 0; }
+void tearDown(void) {}
+
+static void test_begin_sets_presence_and_power_mode() {
+    FakeImu imu;
+    TEST_ASSERT_FALSE(imu.present());
+    TEST_ASSERT_FALSE(imu.power_mode(PowerMode::kLowPower));  // not begun yet
+    TEST_ASSERT_TRUE(imu.begin());
+    TEST_ASSERT_TRUE(imu.mode() == PowerMode::kNormal);
+    TEST_ASSERT_TRUE(imu.power_mode(PowerMode::kLowPower));
+    TEST_ASSERT_TRUE(imu.mode() == PowerMode::kLowPower);
+
+    FakeImu missing;
+    missing.attached = false;
+    TEST_ASSERT_FALSE(missing.begin());
+    ImuReading r;
+    TEST_ASSERT_EQUAL_UINT32(0, missing.read_batch(Span<ImuReading>(&r, 1)));
+    TEST_ASSERT_EQUAL_INT(0, missing.transactions);  // absent device never touches the bus
+    TEST_ASSERT_EQUAL_UINT32(1, missing.health().failures);
+}
+
+static void test_health_tracks_failures_and_latency() {
+    FakeImu imu;
+    imu.begin();
+    ImuReading r;
+    for (int i = 0; i < 3; ++i) imu.read_batch(Span<ImuReading>(&r, 1));
+    imu.fail_reads = true;
+    for (int i = 0; i < 2; ++i) TEST_ASSERT_EQUAL_UINT32(0, imu.read_batch(Span<ImuReading>(&r, 1)));
+
+    const sensor_driver::Health& h = imu.health();
+    TEST_ASSERT_EQUAL_UINT32(5, h.reads);
+    TEST_ASSERT_EQUAL_UINT32(2, h.failures);
+    TEST_ASSERT_EQUAL_UINT32(2, h.consecutive_failures);
+    TEST_ASSERT_FALSE(h.last_ok);
+    TEST_ASSERT_EQUAL_UINT32(kTransferUs, h.last_latency_us);
+
+    imu.fail_reads = false;
+    imu.read_batch(Span<ImuReading>(&r, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, imu.health().consecutive_failures);
+    TEST_ASSERT_TRUE(imu.health().last_ok);
+}
+
+static void test_ppg_drained_in_batches() {
+    FakeImu imu;
+    FakePpg ppg;
+    FakeTemp temp;
+    imu.begin(); ppg.begin(); temp.begin();
+    FakePipeline pipeline(imu, ppg, temp);
+
+    // A tick that ran 190 ms late finds 19 readings queued
+    ppg.produce(19, 50000);
+    uint32_t callbacks = 0;
+    const size_t n = pipeline.sample_ppg([&](const PpgReading& r) {
+        TEST_ASSERT_EQUAL_UINT32(50000, r.ir);
+        ++callbacks;
+    });
+    TEST_ASSERT_EQUAL_UINT32(19, n);
+    TEST_ASSERT_EQUAL_UINT32(19, callbacks);
+    TEST_ASSERT_EQUAL_INT(3, ppg.transactions);  // 8 + 8 + 3, not one per reading
+    TEST_ASSERT_TRUE(ppg.fifo.empty());
+
+    // Usual case: one reading per 10 ms tick is a single transaction
+    ppg.produce(1, 50000);
+    pipeline.sample_ppg([](const PpgReading&) {});
+    TEST_ASSERT_EQUAL_INT(4, ppg.transactions);
+    TEST_ASSERT_EQUAL_UINT32(kTransferUs + kPerReadingUs, ppg.health().last_latency_us);
+}
+
+// 10 s of 100 Hz PPG drained every 5 ticks with a few late drains (8 and
+// 19 samples waiting): the register read delivers every sample in order,
+// where the library's 4-slot buffer keeps about one in five
+static void test_ppg_fifo_drain_keeps_every_sample() {
+    FakeImu imu;
+    FakeTemp temp;
+    imu.begin(); temp.begin();
+    Max30102Registers regs, lib_regs;
+    RegisterPpg ppg(regs);
+    LibraryPpg lib(lib_regs);
+    ppg.begin(); lib.begin();
+    acquisition::Pipeline<FakeImu, RegisterPpg, FakeTemp> pipeline(imu, ppg, temp);
+    acquisition::Pipeline<FakeImu, LibraryPpg, FakeTemp> lib_pipeline(imu, lib, temp);
+
+    uint32_t expect = 0, out_of_order = 0, lib_delivered = 0;
+    for (uint32_t drain = 0; drain < 200; ++drain) {
+        const size_t fresh = drain % 50 == 7 ? 19 : drain % 20 == 3 ? 8 : 5;
+        regs.produce(fresh);
+        lib_regs.produce(fresh);
+        pipeline.sample_ppg([&](const PpgReading& r) {
+            if (r.red != expect || r.ir != expect + 1) ++out_of_order;
+            ++expect;
+        });
+        lib_delivered += static_cast<uint32_t>(lib_pipeline.sample_ppg([](const PpgReading&) {}));
+    }
+    printf("\n[PPG drains every 5 ticks, %u samples] register read %u, library check() %u\n", regs.produced,
+           expect, lib_delivered);
+    TEST_ASSERT_EQUAL_UINT32(regs.produced, expect);
+    TEST_ASSERT_EQUAL_UINT32(0, out_of_order);
+    TEST_ASSERT_TRUE(lib_delivered < regs.produced / 3);
+
+    // A stall past 320 ms overflows the FIFO: 32 samples are read, the rest were lost
+    regs.produce(45);
+    TEST_ASSERT_EQUAL_UINT32(32, pipeline.sample_ppg([](const PpgReading&) {}));
+
+    // Bus errors reach the health counters
+    regs.produce(5);
+    regs.fail = true;
+    TEST_ASSERT_EQUAL_UINT32(0, pipeline.sample_ppg([](const PpgReading&) {}));
+    TEST_ASSERT_FALSE(ppg.health().last_ok);
+    TEST_ASSERT_EQUAL_UINT32(1, ppg.health().failures);
+    regs.fail = false;
+    TEST_ASSERT_EQUAL_UINT32(5, pipeline.sample_ppg([](const PpgReading&) {}));
+}
+
+static void test_imu_samples_reach_ring_with_context() {
+    FakeImu imu;
+    FakePpg ppg;
+    FakeTemp temp;
+    imu.begin(); ppg.begin(); temp.begin();
+    FakePipeline pipeline(imu, ppg, temp);
+    reg_buffer::SampleRingBuffer ring;
+    reg_buffer::ChannelRing hr, body, wear;
+    pipeline.set_ring(&ring);
+    pipeline.set_channels(&hr, &body, &wear);
+
+    temp.celsius = 36.75f;
+    TEST_ASSERT_TRUE(pipeline.sample_temp(1700000000u));
+    imu.next.ax = 0.5f;
+    pipeline.set_hr(72.0f, 1700000000u);
+    TEST_ASSERT_TRUE(pipeline.sample_imu(1, 1700000000u));
+    pipeline.set_hr(72.0f, 1700000001u);  // unchanged: not pushed again
+    TEST_ASSERT_TRUE(pipeline.sample_imu(8, 1700000001u));
+
+    TEST_ASSERT_EQUAL_UINT32(2, ring.size());
+    TEST_ASSERT_EQUAL_UINT32(9, ring.ticks());
+    reg_buffer::Sample s;
+    uint8_t stride = 0;
+    TEST_ASSERT_TRUE(ring.pop(s, &stride));
+    TEST_ASSERT_EQUAL_UINT8(1, stride);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.5f, (float)s.ax);
+    TEST_ASSERT_EQUAL_UINT32(1700000000u, s.timestamp);
+
+    // HR and temperature travel at their own rate, stamped like the IMU
+    reg_buffer::ChannelSample c;
+    TEST_ASSERT_EQUAL_UINT32(1, hr.size());
+    TEST_ASSERT_TRUE(hr.pop(c));
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 72.0f, (float)c.value);
+    TEST_ASSERT_EQUAL_UINT32(1700000000u, c.timestamp);
+    TEST_ASSERT_TRUE(body.pop(c));
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 36.75f, (float)c.value);
+    pipeline.set_hr(75.0f, 1700000002u);
+    TEST_ASSERT_EQUAL_UINT32(1, hr.size());
+
+    // Wear state: the first report, then only changes
+    pipeline.set_off_wrist(false, 1700000000u);
+    pipeline.set_off_wrist(false, 1700000001u);
+    pipeline.set_off_wrist(true, 1700000002u);
+    TEST_ASSERT_EQUAL_UINT32(2, wear.size());
+    TEST_ASSERT_TRUE(wear.pop(c));
+    TEST_ASSERT_EQUAL_FLOAT(consolidate::kWearOn, (float)c.value);
+    TEST_ASSERT_TRUE(wear.pop(c));
+    TEST_ASSERT_EQUAL_FLOAT(consolidate::kWearOff, (float)c.value);
+    TEST_ASSERT_EQUAL_UINT32(1700000002u, c.timestamp);
+
+    imu.fail_reads = true;
+    TEST_ASSERT_FALSE(pipeline.sample_imu(1, 1700000002u));
+    TEST_ASSERT_EQUAL_UINT32(1, ring.size());  // failed read pushes nothing
+}
+
+// A full channel ring overwrites its oldest reading and counts it
+static void test_full_channel_overwrites_oldest() {
+    FakeImu imu;
+    FakePpg ppg;
+    FakeTemp temp;
+    imu.begin(); ppg.begin(); temp.begin();
+    FakePipeline pipeline(imu, ppg, temp);
+    reg_buffer::ChannelRing hr, body;
+    pipeline.set_channels(&hr, &body);
+
+    for (size_t i = 0; i < reg_buffer::ChannelRing::kCapacity; ++i) pipeline.set_hr(60.0f + i, i);
+    TEST_ASSERT_EQUAL_UINT32(0, pipeline.channel_drops());
+    pipeline.set_hr(200.0f, 100);
+    TEST_ASSERT_EQUAL_UINT32(1, pipeline.channel_drops());
+    TEST_ASSERT_EQUAL_UINT32(reg_buffer::ChannelRing::kCapacity, hr.size());
+
+    reg_buffer::ChannelSample c;
+    TEST_ASSERT_TRUE(hr.front(c));
+    TEST_ASSERT_EQUAL_UINT32(1, c.timestamp);  // 60 bpm at t=0 went
+    pipeline.set_hr(200.0f, 101);              // unchanged: not pushed again
+    TEST_ASSERT_EQUAL_UINT32(1, pipeline.channel_drops());
+
+    for (size_t i = 0; i < reg_buffer::ChannelRing::kCapacity; ++i) body.push(c);
+    TEST_ASSERT_TRUE(pipeline.sample_temp(102));
+    TEST_ASSERT_EQUAL_UINT32(2, pipeline.channel_drops());
+    reg_buffer::ChannelSample newest{};
+    while (body.pop(c)) newest = c;
+    TEST_ASSERT_EQUAL_UINT32(102, newest.timestamp);
+}
+
+static void test_window_averages_and_reset() {
+    FakeImu imu;
+    FakePpg ppg;
+    FakeTemp temp;
+    imu.begin(); ppg.begin(); temp.begin();
+    FakePipeline pipeline(imu, ppg, temp);
+
+    for (int i = 0; i < 50; ++i) pipeline.sample_imu(1, 0);
+    ppg.produce(50, 40000);
+    ppg.produce(50, 60000);
+    pipeline.sample_ppg([](const PpgReading&) {});
+    pipeline.sample_temp(0);
+
+    acquisition::WindowAverages w = pipeline.finish_window();
+    TEST_ASSERT_EQUAL_UINT32(50, w.imu_count);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0, w.az);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 86.0, w.imu_temp_f);
+    TEST_ASSERT_EQUAL_UINT32(100, w.ppg_count);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 50000.0, w.ir);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 25000.0, w.red);
+    TEST_ASSERT_EQUAL_UINT32(1, w.temp_count);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 97.7, w.body_f);
+
+    // Nothing sampled: NAN, not zero, so AGC and wear detection skip the window
+    w = pipeline.finish_window();
+    TEST_ASSERT_EQUAL_UINT32(0, w.ppg_count);
+    TEST_ASSERT_TRUE(std::isnan(w.ir));
+    TEST_ASSERT_TRUE(std::isnan(w.ax));
+    TEST_ASSERT_TRUE(std::isnan(w.body_c));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_sets_presence_and_power_mode);
+    RUN_TEST(test_health_tracks_failures_and_latency);
+    RUN_TEST(test_ppg_drained_in_batches);
+    RUN_TEST(test_ppg_fifo_drain_keeps_every_sample);
+    RUN_TEST(test_imu_samples_reach_ring_with_context);
+    RUN_TEST(test_full_channel_overwrites_oldest);
+    RUN_TEST(test_window_averages_and_reset);
+    return UNITY_END();
+}
@@ -0,0 +1,304 @@
+#include <unity.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "compute/snapshot.h"
+
+// Warm-restart simulation: a walking session is fed through the ring and
+// consolidation pipeline, the device "resets" part-way through a window and
+// an interval, and the run is resumed from the snapshot image. The records
+// must match an uninterrupted run. Records handed to the storage writer but
+// not yet on flash come back from the image; those already stored do not.
+
+namespace {
+
+constexpr float kPi = 3.14159265f;
+constexpr size_t kSamples = 50 * 120;   // 2 minutes at 50 Hz
+constexpr size_t kChunk = 5;            // sensor task pushes ~100 ms at a time
+
+reg_buffer::Sample walking_sample(size_t i) {
+    const float t = i / 50.0f;
+    reg_buffer::Sample s{};
+    s.ax = reg_buffer::float16(1.0f + 0.3f * std::sin(2 * kPi * 1.8f * t));
+    s.ay = reg_buffer::float16(0.0f);
+    s.az = reg_buffer::float16(0.0f);
+    s.timestamp = 1700000000u + static_cast<uint32_t>(i / 50);
+    return s;
+}
+
+struct Pipeline {
+    reg_buffer::SampleRingBuffer replay;
+    reg_buffer::SampleRingBuffer ring;
+    consolidate::IntervalAccumulator accumulator;
+    snapshot::PendingRecords pending;
+    std::vector<consolidate::ConsolidatedRecord> records;
+
+    Pipeline() {
+        accumulator.reset();
+        consolidate::restore_detector_state(consolidate::kInitialDetectorState);
+    }
+
+    void feed(size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+            ring.push(walking_sample(i));
+            if ((i + 1) % kChunk == 0) drain();
+        }
+    }
+
+    void drain() {
+        consolidate::ConsolidatedRecord rec{};
+        while (consolidate::consolidate_from_ring(ring, rec)) {
+            consolidate::ConsolidatedRecord out{};
+            if (accumulator.add(rec, out)) {
+                records.push_back(out);
+                pending.push(out);
+            }
+        }
+    }
+
+    size_t capture(snapshot::Image& image) const {
+        return snapshot::capture(image, replay, ring, accumulator, pending);
+    }
+
+    bool restore(const snapshot::Image& image) {
+        return snapshot::restore(image, replay, ring, accumulator);
+    }
+};
+
+// Image as it would sit in RTC memory across the reset
+std::vector<uint8_t> rtc_copy(const snapshot::Image& image) {
+    std::vector<uint8_t> mem(sizeof(snapshot::Image));
+    std::memcpy(mem.data(), &image, sizeof(image));
+    return mem;
+}
+
+uint32_t total_steps(const std::vector<consolidate::ConsolidatedRecord>& records) {
+    uint32_t steps = 0;
+    for (const auto& r : records) steps += r.step_count;
+    return steps;
+}
+
+// Mid-window (60 samples into a 125-sample window) and mid-interval
+constexpr size_t kResetAt = 125 * 15 + 60;
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_restart_is_continuous() {
+    Pipeline reference;
+    reference.feed(0, kSamples);
+
+    Pipeline before;
+    before.feed(0, kResetAt);
+    static snapshot::Image image;
+    const size_t bytes = before.capture(image);
+    const std::vector<uint8_t> mem = rtc_copy(image);
+
+    Pipeline after;  // fresh boot state
+    after.records = before.records;
+    TEST_ASSERT_TRUE(after.restore(*reinterpret_cast<const snapshot::Image*>(mem.data())));
+    after.feed(kResetAt, kSamples);
+
+    TEST_ASSERT_EQUAL(reference.records.size(), after.records.size());
+    for (size_t i = 0; i < reference.records.size(); ++i) {
+        TEST_ASSERT_EQUAL_MEMORY(&reference.records[i], &after.records[i],
+                                 sizeof(consolidate::ConsolidatedRecord));
+    }
+    TEST_ASSERT_GREATER_THAN(0u, total_steps(reference.records));
+
+    char msg[64];
+    std::snprintf(msg, sizeof(msg), "snapshot covers %u bytes", static_cast<unsigned>(bytes));
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_THAN(sizeof(snapshot::Image) + 1, bytes);
+}
+
+void test_restart_without_snapshot_loses_steps() {
+    Pipeline reference;
+    reference.feed(0, kSamples);
+
+    Pipeline before;
+    before.feed(0, kResetAt);
+    Pipeline after;
+    after.records = before.records;
+    after.feed(kResetAt, kSamples);
+
+    TEST_ASSERT_LESS_THAN(total_steps(reference.records), total_steps(after.records));
+}
+
+void test_corrupt_image_rejected() {
+    Pipeline p;
+    p.feed(0, kResetAt);
+    static snapshot::Image image;
+    p.capture(image);
+    TEST_ASSERT_TRUE(snapshot::valid(image));
+
+    image.samples[3].timestamp ^= 1;
+    Pipeline fresh;
+    TEST_ASSERT_FALSE(fresh.restore(image));
+    TEST_ASSERT_TRUE(fresh.ring.empty());
+
+    p.capture(image);
+    snapshot::invalidate(image);
+    TEST_ASSERT_FALSE(snapshot::valid(image));
+}
+
+void test_sequence_increments() {
+    Pipeline p;
+    static snapshot::Image image;
+    snapshot::invalidate(image);
+    p.capture(image);
+    TEST_ASSERT_EQUAL_UINT32(1, image.sequence);
+    p.capture(image);
+    TEST_ASSERT_EQUAL_UINT32(2, image.sequence);
+}
+
+// Reset after an interval was handed to the writer: with the image taken at
+// the hand-off the interval is emitted once, from an older image twice
+void test_snapshot_at_emit_avoids_duplicate() {
+    Pipeline reference;
+    reference.feed(0, kSamples);
+
+    // Run to the first emitted interval past kResetAt, snapshotting every
+    // second and right after each emit as the loop does
+    Pipeline before;
+    static snapshot::Image periodic, at_emit;
+    size_t periodic_at = 0;
+    size_t i = 0;
+    for (; i < kSamples; ++i) {
+        const size_t emitted = before.records.size();
+        before.feed(i, i + 1);
+        if (i % 50 == 0) {
+            before.capture(periodic);
+            periodic_at = i;
+        }
+        if (before.records.size() != emitted) {
+            before.capture(at_emit);
+            if (i >= kResetAt) break;
+        }
+    }
+    const size_t resume = i + 1;
+
+    Pipeline from_emit;
+    from_emit.records = before.records;
+    TEST_ASSERT_TRUE(from_emit.restore(at_emit));
+    from_emit.feed(resume, kSamples);
+    TEST_ASSERT_EQUAL(reference.records.size(), from_emit.records.size());
+    for (size_t r = 0; r < reference.records.size(); ++r) {
+        TEST_ASSERT_EQUAL_MEMORY(&reference.records[r], &from_emit.records[r],
+                                 sizeof(consolidate::ConsolidatedRecord));
+    }
+
+    // The periodic image predates the hand-off: even with every sample after
+    // it delivered again, its interval comes out a second time
+    Pipeline from_periodic;
+    from_periodic.records = before.records;
+    TEST_ASSERT_TRUE(from_periodic.restore(periodic));
+    from_periodic.feed(periodic_at + 1, kSamples);
+    TEST_ASSERT_EQUAL(reference.records.size() + 1, from_periodic.records.size());
+}
+
+// Records still in the writer queue at the reset are resubmitted from the
+// image; those the file already ends with are not
+void test_pending_records_resubmitted_once() {
+    Pipeline p;
+    p.feed(0, kSamples);  // 8 intervals
+    TEST_ASSERT_EQUAL(8, p.pending.size());
+    static snapshot::Image image;
+    p.capture(image);
+
+    // The writer appended 5 of them before the reset; the file holds older
+    // records in front
+    std::vector<consolidate::ConsolidatedRecord> file(3, consolidate::ConsolidatedRecord{});
+    file.insert(file.end(), p.records.begin(), p.records.begin() + 5);
+    TEST_ASSERT_EQUAL(5, snapshot::first_unsaved(image.pending, image.pending_count, file.data(), file.size()));
+
+    // Nothing appended, or everything
+    TEST_ASSERT_EQUAL(0, snapshot::first_unsaved(image.pending, image.pending_count, file.data(), 3));
+    TEST_ASSERT_EQUAL(8, snapshot::first_unsaved(image.pending, image.pending_count, p.records.data(), 8));
+    TEST_ASSERT_EQUAL(0, snapshot::first_unsaved(image.pending, image.pending_count, nullptr, 0));
+}
+
+// Only the newest kMaxPending records are kept; a dropped record is replaced
+void test_pending_records_bounded() {
+    snapshot::PendingRecords pending;
+    consolidate::ConsolidatedRecord r{};
+    for (uint32_t t = 0; t < snapshot::kMaxPending + 5; ++t) {
+        r.timestamp = t;
+        pending.push(r);
+    }
+    TEST_ASSERT_EQUAL(snapshot::kMaxPending, pending.size());
+    TEST_ASSERT_EQUAL_UINT32(5, pending.data()[0].timestamp);
+    r.timestamp = 1000;
+    pending.replace_last(r);
+    TEST_ASSERT_EQUAL(snapshot::kMaxPending, pending.size());
+    TEST_ASSERT_EQUAL_UINT32(1000, pending.data()[snapshot::kMaxPending - 1].timestamp);
+}
+
+// Replayed samples go back to the replay ring, ahead of the live ones; what
+// does not fit is counted
+void test_replay_ring_captured() {
+    Pipeline p;
+    for (size_t i = 0; i < 40; ++i) p.replay.push(walking_sample(i));
+    for (size_t i = 40; i < 60; ++i) p.ring.push(walking_sample(i));
+    static snapshot::Image image;
+    p.capture(image);
+    TEST_ASSERT_EQUAL(40, image.replay_count);
+    TEST_ASSERT_EQUAL(60, image.sample_count);
+    TEST_ASSERT_EQUAL_UINT32(0, image.dropped_samples);
+
+    Pipeline after;
+    TEST_ASSERT_TRUE(after.restore(image));
+    TEST_ASSERT_EQUAL(40, after.replay.size());
+    TEST_ASSERT_EQUAL(20, after.ring.size());
+    reg_buffer::Sample s{};
+    TEST_ASSERT_TRUE(after.ring.peek(0, s));
+    TEST_ASSERT_EQUAL_UINT32(walking_sample(40).timestamp, s.timestamp);
+
+    for (size_t i = 60; i < 60 + snapshot::kMaxSamples; ++i) p.ring.push(walking_sample(i));
+    p.capture(image);
+    TEST_ASSERT_EQUAL(snapshot::kMaxSamples, image.sample_count);
+    TEST_ASSERT_EQUAL_UINT32(60, image.dropped_samples);
+}
+
+void test_crc32_check_value() {
+    const char* s = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, snapshot::crc32(reinterpret_cast<const uint8_t*>(s), 9));
+}
+
+void test_capture_cost() {
+    Pipeline p;
+    p.feed(0, 124);  // just short of a window: the largest ring a snapshot sees
+    static snapshot::Image image;
+    const auto start = std::chrono::steady_clock::now();
+    constexpr int kRuns = 1000;
+    size_t bytes = 0;
+    for (int i = 0; i < kRuns; ++i) bytes = p.capture(image);
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    char msg[96];
+    std::snprintf(msg, sizeof(msg), "full-window capture: %u bytes, %.2f us on host",
+                  static_cast<unsigned>(bytes), static_cast<double>(us) / kRuns);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL(124u, image.sample_count);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_restart_is_continuous);
+    RUN_TEST(test_restart_without_snapshot_loses_steps);
+    RUN_TEST(test_corrupt_image_rejected);
+    RUN_TEST(test_sequence_increments);
+    RUN_TEST(test_snapshot_at_emit_avoids_duplicate);
+    RUN_TEST(test_pending_records_resubmitted_once);
+    RUN_TEST(test_pending_records_bounded);
+    RUN_TEST(test_replay_ring_captured);
+    RUN_TEST(test_crc32_check_value);
+    RUN_TEST(test_capture_cost);
+    return UNITY_END();
+}
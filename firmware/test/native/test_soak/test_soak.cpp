@@ -0,0 +1,284 @@
+#include <unity.h>
+
+#include <LittleFS.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "app_config.h"
+#include "compute/consolidate.h"
+#include "compute/step_reconcile.h"
+#include "ringbuf/reg_buffer.h"
+#include "sensors/uptime.h"
+#include "storage/fs_store.h"
+#include "telemetry/alloc_track.h"
+
+// Accelerated soak: months of device time through the real pipeline (ring ->
+// consolidation -> step reconciliation -> 15 s intervals -> fs_store on the
+// emulated flash) against a virtual clock, with a daily SEND + ERASE. The
+// 32-bit millis() counter starts an hour before its wrap and wraps again
+// ~49.7 days later; wall-clock time is only synced on day 60, so the first
+// two months run on uptime timestamps. Checks that timestamps never go
+// backwards, every record reaches a sync, and heap use stays flat.
+//
+// SOAK_DAYS sets the length (e.g. PLATFORMIO_BUILD_FLAGS=-DSOAK_DAYS=365).
+
+#ifndef SOAK_DAYS
+#define SOAK_DAYS 90
+#endif
+
+namespace {
+
+constexpr uint32_t kMillisStart = 0xFFFFFFFFu - 3600u * 1000u;
+constexpr uint32_t kImuPeriodMs = 20;
+constexpr uint8_t kStillStride = 8;           // no-motion rate (6.25 Hz)
+constexpr uint32_t kWalkStartS = 8 * 3600;    // one hour of walking a day
+constexpr uint32_t kWalkEndS = 9 * 3600;
+constexpr uint32_t kSyncS = 20 * 3600;        // daily SEND + ERASE
+constexpr uint32_t kTimeSyncDay = 60;
+constexpr time_t kSyncedEpoch = 1700000000;
+constexpr size_t kPartitionSectors = 0x200000 / flash_emu::kSectorSize;
+
+reg_buffer::Sample make_sample(bool walking, uint64_t t_ms, uint32_t timestamp) {
+    reg_buffer::Sample s{};
+    const float phase = static_cast<float>(t_ms % 500) / 500.0f;  // 2 steps/s
+    s.ax = reg_buffer::float16(0.02f);
+    s.ay = reg_buffer::float16(0.01f);
+    s.az = reg_buffer::float16(walking ? 1.0f + 0.35f * std::sin(6.2831853f * phase) : 1.0f);
+    s.timestamp = timestamp;
+    return s;
+}
+
+struct SoakResult {
+    uint64_t samples = 0;
+    uint64_t records = 0;
+    uint64_t records_synced = 0;
+    uint64_t steps_recorded = 0;
+    uint64_t steps_walked = 0;
+    uint32_t ring_overruns = 0;
+    uint32_t append_failures = 0;
+    uint32_t sync_mismatches = 0;     // sync saw a different count than was appended
+    uint32_t timestamp_regressions = 0;
+    uint32_t millis_wraps = 0;
+    size_t heap_day1 = 0;
+    size_t heap_max = 0;
+    double wall_s = 0;
+};
+
+class Soak {
+public:
+    SoakResult run(uint32_t days) {
+        const auto wall0 = std::chrono::steady_clock::now();
+        for (uint32_t day = 0; day < days; ++day) {
+            run_day(day);
+            const size_t heap = alloc_track::live_bytes();
+            if (day == 0) r_.heap_day1 = heap;
+            if (heap > r_.heap_max) r_.heap_max = heap;
+        }
+        sync();
+        r_.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+        return r_;
+    }
+
+private:
+    void run_day(uint32_t day) {
+        const uint64_t day_end_ms = (static_cast<uint64_t>(day) + 1) * 86400000ull;
+        bool synced_today = false;
+        while (t_ms_ < day_end_ms) {
+            const uint32_t second_of_day = static_cast<uint32_t>((t_ms_ / 1000) % 86400);
+            const bool walking = second_of_day >= kWalkStartS && second_of_day < kWalkEndS;
+            const uint8_t stride = walking ? 1 : kStillStride;
+
+            const uint32_t now32 = static_cast<uint32_t>(kMillisStart + t_ms_);
+            if (now32 < last_millis_) ++r_.millis_wraps;
+            last_millis_ = now32;
+            const uint64_t up_ms = clock_.update(now32);
+
+            const time_t wall = day >= kTimeSyncDay ? kSyncedEpoch + static_cast<time_t>(t_ms_ / 1000)
+                                                    : static_cast<time_t>(t_ms_ / 1000);
+            if (!ring_.push(make_sample(walking, t_ms_, uptime::sample_timestamp(wall, up_ms)), stride)) {
+                ++r_.ring_overruns;
+            }
+            ++r_.samples;
+            t_ms_ += static_cast<uint64_t>(stride) * kImuPeriodMs;
+            if (walking) walk_ms_ += static_cast<uint64_t>(stride) * kImuPeriodMs;
+
+            consolidate_ready();
+
+            if (!synced_today && second_of_day >= kSyncS) {
+                sync();
+                synced_today = true;
+            }
+        }
+    }
+
+    void consolidate_ready() {
+        consolidate::ConsolidatedRecord record{};
+        while (consolidate::consolidate_from_ring(ring_, record)) {
+            // BMI270 counter: the walked steps so far (2 per second of walking)
+            const uint32_t walked = static_cast<uint32_t>(walk_ms_ / 500);
+            r_.steps_walked = walked;
+            record.step_count = reconciler_.reconcile(record.step_count, true, walked, true);
+
+            consolidate::ConsolidatedRecord interval{};
+            if (!accumulator_.add(record, interval)) continue;
+            ++r_.records;
+            r_.steps_recorded += interval.step_count;
+            if (interval.timestamp < last_timestamp_) ++r_.timestamp_regressions;
+            last_timestamp_ = interval.timestamp;
+            if (fs_store::append(interval)) {
+                ++pending_;
+            } else {
+                ++r_.append_failures;
+            }
+        }
+    }
+
+    // SEND then ERASE, as the phone app does
+    void sync() {
+        size_t seen = 0;
+        uint32_t last = 0;
+        fs_store::for_each_record([&](const consolidate::ConsolidatedRecord& rec, size_t) {
+            if (rec.timestamp < last) ++r_.timestamp_regressions;
+            last = rec.timestamp;
+            ++seen;
+            return true;
+        });
+        if (seen != pending_ || fs_store::record_count() != pending_) ++r_.sync_mismatches;
+        r_.records_synced += seen;
+        pending_ = 0;
+        fs_store::erase();
+    }
+
+    reg_buffer::SampleRingBuffer ring_;
+    consolidate::IntervalAccumulator accumulator_;
+    step_reconcile::Reconciler reconciler_;
+    uptime::Clock64 clock_{};
+    SoakResult r_;
+    uint64_t t_ms_ = 0;
+    uint64_t walk_ms_ = 0;
+    uint32_t last_millis_ = kMillisStart;
+    uint32_t last_timestamp_ = 0;
+    size_t pending_ = 0;
+};
+
+}  // namespace
+
+void setUp() {
+    consolidate::restore_detector_state(consolidate::kInitialDetectorState);
+}
+
+void tearDown() {
+    LittleFS.end();
+}
+
+void test_uptime_survives_millis_wrap() {
+    uptime::Clock64 clock;
+    TEST_ASSERT_EQUAL_UINT64(0xFFFFFF00ull, clock.update(0xFFFFFF00u));
+    TEST_ASSERT_EQUAL_UINT64(0x100000010ull, clock.update(0x10u));
+    clock.update(0xFFFFFFF0u);
+    TEST_ASSERT_EQUAL_UINT64(0x200000005ull, clock.update(0x5u));
+
+    // Unsynced timestamps are uptime seconds past the 32-bit millis range
+    TEST_ASSERT_EQUAL_UINT32(4294967u + 3600u, uptime::sample_timestamp(0, 0xFFFFFFFFull + 3600000ull));
+    TEST_ASSERT_EQUAL_UINT32(1700000000u, uptime::sample_timestamp(1700000000, 5));
+}
+
+// A still period longer than the counter range must not wrap the debounce
+// counter back below the step threshold
+void test_step_debounce_counter_saturates() {
+    consolidate::DetectorState state = consolidate::kInitialDetectorState;
+    state.samples_since_step = 0xFFFFFFF0u;
+    consolidate::restore_detector_state(state);
+
+    reg_buffer::Sample still[consolidate::kSamplesPerWindow];
+    for (size_t i = 0; i < consolidate::kSamplesPerWindow; ++i) still[i] = make_sample(false, i * 20, 0);
+    consolidate::ConsolidatedRecord rec{};
+    TEST_ASSERT_TRUE(consolidate::consolidate(still, consolidate::kSamplesPerWindow, rec));
+    TEST_ASSERT_TRUE(consolidate::detector_state().samples_since_step >= 50);
+    TEST_ASSERT_TRUE(consolidate::detector_state().samples_since_step <= 1000);
+}
+
+void test_interval_steps_saturate() {
+    consolidate::IntervalAccumulator acc;
+    consolidate::ConsolidatedRecord in{};
+    consolidate::ConsolidatedRecord out{};
+    in.step_count = 20000;
+    bool done = false;
+    for (int i = 0; i < 6; ++i) done = acc.add(in, out);
+    TEST_ASSERT_TRUE(done);
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, out.step_count);
+}
+
+// A partial record at the end of the file (short write) is skipped by
+// record_count() and written over by the next append, so later records stay
+// aligned
+void test_partial_record_is_overwritten() {
+    flash_emu::Flash flash(kPartitionSectors);
+    LittleFS.attach(&flash);
+    TEST_ASSERT_TRUE(fs_store::begin(true));
+    consolidate::ConsolidatedRecord rec{};
+    for (uint32_t i = 0; i < 10; ++i) {
+        rec.timestamp = i;
+        TEST_ASSERT_TRUE(fs_store::append(rec));
+    }
+    File f = LittleFS.open(kFsDataPath, "a");
+    const uint8_t torn[5] = {1, 2, 3, 4, 5};
+    TEST_ASSERT_EQUAL_size_t(5, f.write(torn, sizeof(torn)));
+    f.close();
+
+    TEST_ASSERT_TRUE(fs_store::begin(true));
+    TEST_ASSERT_EQUAL_size_t(10, fs_store::record_count());
+    rec.timestamp = 10;
+    TEST_ASSERT_TRUE(fs_store::append(rec));
+    TEST_ASSERT_EQUAL_size_t(11 * sizeof(rec), fs_store::size());
+    uint32_t seen = 0;
+    bool aligned = true;
+    fs_store::for_each_record([&](const consolidate::ConsolidatedRecord& r, size_t) {
+        aligned = aligned && r.timestamp == seen++;
+        return true;
+    });
+    TEST_ASSERT_TRUE(aligned);
+    TEST_ASSERT_EQUAL_UINT32(11, seen);
+}
+
+void test_soak() {
+    flash_emu::Flash flash(kPartitionSectors);
+    LittleFS.attach(&flash);
+    TEST_ASSERT_TRUE(fs_store::begin(true));
+
+    Soak soak;
+    const SoakResult r = soak.run(SOAK_DAYS);
+    const double simulated_s = SOAK_DAYS * 86400.0;
+
+    printf("\n[soak, %u days] %llu samples -> %llu records, %llu synced; millis wraps %u\n",
+           SOAK_DAYS, static_cast<unsigned long long>(r.samples), static_cast<unsigned long long>(r.records),
+           static_cast<unsigned long long>(r.records_synced), r.millis_wraps);
+    printf("  steps recorded %llu / walked %llu; heap day 1 %zu B, max %zu B; flash erases max %u per sector\n",
+           static_cast<unsigned long long>(r.steps_recorded), static_cast<unsigned long long>(r.steps_walked),
+           r.heap_day1, r.heap_max, flash.max_erase_count());
+    printf("  %.1f s wall: %.0fx real time, %.2f M samples/s\n",
+           r.wall_s, simulated_s / r.wall_s, r.samples / r.wall_s / 1e6);
+
+    TEST_ASSERT_EQUAL_UINT64(static_cast<uint64_t>(SOAK_DAYS) * 5760, r.records);
+    TEST_ASSERT_EQUAL_UINT64(r.records, r.records_synced);
+    TEST_ASSERT_EQUAL_UINT32(0, r.append_failures);
+    TEST_ASSERT_EQUAL_UINT32(0, r.sync_mismatches);
+    TEST_ASSERT_EQUAL_UINT32(0, r.ring_overruns);
+    TEST_ASSERT_EQUAL_UINT32(0, r.timestamp_regressions);
+    TEST_ASSERT_TRUE(r.millis_wraps >= (SOAK_DAYS > 50 ? 2u : 1u));
+    TEST_ASSERT_TRUE(r.heap_max <= r.heap_day1 + 1024);
+    TEST_ASSERT_TRUE(r.steps_recorded > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_uptime_survives_millis_wrap);
+    RUN_TEST(test_step_debounce_counter_saturates);
+    RUN_TEST(test_interval_steps_saturate);
+    RUN_TEST(test_partial_record_is_overwritten);
+    RUN_TEST(test_soak);
+    return UNITY_END();
+}
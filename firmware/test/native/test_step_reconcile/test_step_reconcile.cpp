@@ -0,0 +1,89 @@
+#include <unity.h>
+
+#include "compute/step_reconcile.h"
+
+// Host tests for the hardware/software step reconciliation. The hardware
+// counter is fed as a running total, one reading per 2.5 s window.
+
+using step_reconcile::Reconciler;
+using step_reconcile::Source;
+
+void setUp() {}
+void tearDown() {}
+
+void test_first_reading_sets_baseline() {
+    Reconciler r;
+    TEST_ASSERT_EQUAL_UINT16(0, r.reconcile(0, true, 1234, true));
+    TEST_ASSERT_EQUAL_UINT16(5, r.reconcile(5, true, 1239, true));
+    TEST_ASSERT_TRUE(r.last_source() == Source::kHardware);
+}
+
+void test_hardware_unavailable_uses_software() {
+    Reconciler r;
+    TEST_ASSERT_EQUAL_UINT16(4, r.reconcile(4, true, 0, false));
+    TEST_ASSERT_TRUE(r.last_source() == Source::kSoftware);
+}
+
+void test_counter_reset_counts_from_zero() {
+    Reconciler r;
+    r.reconcile(0, true, 500, true);
+    TEST_ASSERT_EQUAL_UINT16(3, r.reconcile(3, true, 3, true));
+    TEST_ASSERT_EQUAL_UINT32(1, r.hardware_resets());
+}
+
+void test_steps_only_mode_trusts_hardware() {
+    Reconciler r;
+    r.reconcile(0, false, 100, true);
+    TEST_ASSERT_EQUAL_UINT16(7, r.reconcile(0, false, 107, true));
+    TEST_ASSERT_TRUE(r.last_source() == Source::kHardware);
+}
+
+void test_persistent_disagreement_falls_back_to_software() {
+    step_reconcile::Config cfg;
+    Reconciler r(cfg);
+    uint32_t hw = 0;
+    r.reconcile(0, true, hw, true);
+
+    // Hardware reports double the software count for three check periods
+    for (int check = 0; check < cfg.fallback_after; ++check) {
+        for (int w = 0; w < cfg.windows_per_check; ++w) {
+            hw += 10;
+            r.reconcile(5, true, hw, true);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(cfg.fallback_after, r.disagreements());
+    TEST_ASSERT_TRUE(r.last_source() == Source::kSoftware);
+    hw += 10;
+    TEST_ASSERT_EQUAL_UINT16(5, r.reconcile(5, true, hw, true));
+
+    // One agreeing period restores the hardware count
+    for (int w = 0; w < cfg.windows_per_check; ++w) {
+        hw += 5;
+        r.reconcile(5, true, hw, true);
+    }
+    TEST_ASSERT_TRUE(r.last_source() == Source::kHardware);
+}
+
+void test_small_lag_within_tolerance() {
+    step_reconcile::Config cfg;
+    Reconciler r(cfg);
+    uint32_t hw = 0;
+    r.reconcile(0, true, hw, true);
+    // Hardware lags by a window at the start of a walk; totals still agree
+    for (int w = 0; w < cfg.windows_per_check; ++w) {
+        if (w > 0) hw += 4;
+        r.reconcile(4, true, hw, true);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, r.disagreements());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_reading_sets_baseline);
+    RUN_TEST(test_hardware_unavailable_uses_software);
+    RUN_TEST(test_counter_reset_counts_from_zero);
+    RUN_TEST(test_steps_only_mode_trusts_hardware);
+    RUN_TEST(test_persistent_disagreement_falls_back_to_software);
+    RUN_TEST(test_small_lag_within_tolerance);
+    return UNITY_END();
+}
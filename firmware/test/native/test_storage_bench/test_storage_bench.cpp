@@ -0,0 +1,269 @@
+#include <unity.h>
+
+#include <LittleFS.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "app_config.h"
+#include "storage/fs_store.h"
+#include "telemetry/telemetry.h"
+
+// Record store benchmarks: fs_store on the littlefs core over an emulated
+// NOR flash sized like the `littlefs` partition (partitions_3m_fs.csv).
+// Latency is flash busy time from the emulator's timing model (ESP32 SPI
+// flash typicals), not host CPU time. Reports append p50/p99/max, scan
+// throughput, mount/recovery time, write amplification, erase wear and the
+// effect of idle-time pre-erase.
+
+namespace {
+
+constexpr size_t kPartitionBytes = 0x200000;
+constexpr size_t kPartitionSectors = kPartitionBytes / flash_emu::kSectorSize;
+constexpr uint32_t kRecordPeriodS = 15;
+constexpr size_t kRecordsPerDay = 24 * 3600 / kRecordPeriodS;
+constexpr size_t kRecordBytes = sizeof(consolidate::ConsolidatedRecord);
+
+consolidate::ConsolidatedRecord record_at(size_t i) {
+    consolidate::ConsolidatedRecord r{};
+    r.avg_hr_x10 = static_cast<uint16_t>(550 + (i * 7) % 500);
+    r.avg_temp_x100 = static_cast<int16_t>(3300 + (i * 3) % 250);
+    r.step_count = static_cast<uint16_t>((i * 13) % 40);
+    r.timestamp = static_cast<uint32_t>(1700000000u + i * kRecordPeriodS);
+    r.flags = static_cast<uint8_t>(i & 1);
+    return r;
+}
+
+bool same(const consolidate::ConsolidatedRecord& a, const consolidate::ConsolidatedRecord& b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+struct Latency {
+    std::vector<uint32_t> us;
+
+    uint32_t percentile(double p) const {
+        if (us.empty()) return 0;
+        std::vector<uint32_t> sorted(us);
+        std::sort(sorted.begin(), sorted.end());
+        size_t idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[idx];
+    }
+    uint32_t max() const { return us.empty() ? 0 : *std::max_element(us.begin(), us.end()); }
+};
+
+// Append `n` records starting at index `first`; stops at the first failure.
+// Returns the number appended.
+size_t append_records(flash_emu::Flash& flash, size_t first, size_t n, Latency* latency = nullptr) {
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t t0 = flash.busy_us();
+        if (!fs_store::append(record_at(first + i))) return i;
+        if (latency) latency->us.push_back(static_cast<uint32_t>(flash.busy_us() - t0));
+    }
+    return n;
+}
+
+// Every stored record must match what was appended, in order
+bool verify(size_t expected) {
+    size_t seen = 0;
+    bool ok = true;
+    fs_store::for_each_record([&](const consolidate::ConsolidatedRecord& r, size_t i) {
+        ok = ok && i == seen && same(r, record_at(i));
+        ++seen;
+        return ok;
+    });
+    return ok && seen == expected;
+}
+
+void mount(flash_emu::Flash& flash) {
+    LittleFS.attach(&flash);
+    TEST_ASSERT_TRUE(fs_store::begin(true));
+}
+
+void print_wear(const flash_emu::Flash& flash, size_t payload_bytes) {
+    printf("  erases %llu total, max %u per sector (mean %.1f); programmed %.1f MB, write amplification %.0fx\n",
+           static_cast<unsigned long long>(flash.total_erases()), flash.max_erase_count(),
+           static_cast<double>(flash.total_erases()) / flash.sector_count(),
+           flash.bytes_programmed() / 1e6,
+           payload_bytes ? static_cast<double>(flash.bytes_programmed()) / payload_bytes : 0.0);
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {
+    LittleFS.end();
+}
+
+// One record every 15 s for 30 days (or until the partition fills)
+void test_append_month() {
+    flash_emu::Flash flash(kPartitionSectors);
+    mount(flash);
+
+    const uint32_t erased_estimate0 = telemetry::get(telemetry::Stat::kFlashBytesErased);
+    const uint64_t erases0 = flash.total_erases();
+    Latency latency;
+    latency.us.reserve(kRecordsPerDay * 30);
+    const size_t stored = append_records(flash, 0, kRecordsPerDay * 30, &latency);
+
+    printf("\n[append, 1 record / 15 s, 30 days] stored %zu records (%.1f days), %zu KB of %zu KB used\n",
+           stored, static_cast<double>(stored) / kRecordsPerDay,
+           LittleFS.usedBytes() / 1024, LittleFS.totalBytes() / 1024);
+    printf("  append latency p50 %u us, p99 %u us, max %u us\n",
+           latency.percentile(0.50), latency.percentile(0.99), latency.max());
+    print_wear(flash, stored * kRecordBytes);
+    // The energy model's erase figure must track the flash: mostly the block
+    // each append copies, plus metadata compactions it does not count
+    const double estimated = telemetry::get(telemetry::Stat::kFlashBytesErased) - erased_estimate0;
+    const double erased = static_cast<double>(flash.total_erases() - erases0) * flash_emu::kSectorSize;
+    printf("  telemetry erase estimate %.0f KB vs %.0f KB erased (%.2fx)\n", estimated / 1024, erased / 1024,
+           estimated / erased);
+    TEST_ASSERT_TRUE(estimated > 0.75 * erased && estimated < 1.25 * erased);
+
+    TEST_ASSERT_GREATER_OR_EQUAL(kRecordsPerDay * 7, stored);
+    TEST_ASSERT_EQUAL_UINT32(0, flash.program_violations());
+    TEST_ASSERT_TRUE(latency.percentile(0.50) > 0);
+    TEST_ASSERT_TRUE(latency.percentile(0.99) >= latency.percentile(0.50));
+    TEST_ASSERT_EQUAL_size_t(stored, fs_store::record_count());
+    TEST_ASSERT_TRUE(verify(stored));
+}
+
+// Full read of a week of records, as SEND does
+void test_scan_throughput() {
+    flash_emu::Flash flash(kPartitionSectors);
+    mount(flash);
+    const size_t n = kRecordsPerDay * 7;
+    TEST_ASSERT_EQUAL_size_t(n, append_records(flash, 0, n));
+
+    const uint64_t t0 = flash.busy_us();
+    TEST_ASSERT_TRUE(verify(n));
+    const double s = (flash.busy_us() - t0) / 1e6;
+
+    printf("\n[scan, 7 days] %zu records in %.1f ms flash time: %.0f records/s, %.0f KB/s\n",
+           n, s * 1e3, n / s, n * kRecordBytes / s / 1024);
+    TEST_ASSERT_TRUE(s > 0);
+}
+
+// Daily sync: a day of appends, a full scan, then ERASE, for a week
+void test_daily_sync_cycle() {
+    flash_emu::Flash flash(kPartitionSectors);
+    mount(flash);
+
+    Latency latency;
+    uint64_t erase_us = 0;
+    for (int day = 0; day < 7; ++day) {
+        TEST_ASSERT_EQUAL_size_t(kRecordsPerDay, append_records(flash, 0, kRecordsPerDay, &latency));
+        TEST_ASSERT_TRUE(verify(kRecordsPerDay));
+        const uint64_t t0 = flash.busy_us();
+        TEST_ASSERT_TRUE(fs_store::erase());
+        TEST_ASSERT_TRUE(fs_store::begin(true));  // recreates the file like the next append
+        erase_us += flash.busy_us() - t0;
+        TEST_ASSERT_EQUAL_size_t(0, fs_store::record_count());
+    }
+
+    printf("\n[daily sync + erase, 7 days] append p50 %u us, p99 %u us; erase %.1f ms per sync\n",
+           latency.percentile(0.50), latency.percentile(0.99), erase_us / 7 / 1e3);
+    print_wear(flash, 7 * kRecordsPerDay * kRecordBytes);
+    TEST_ASSERT_EQUAL_UINT32(0, flash.program_violations());
+}
+
+// A day of appends with and without idle-time pre-erase between them, as the
+// loop requests it: one sector per kPreEraseIntervalMs, pool of
+// kPreErasePoolSectors
+void test_pre_erase_latency() {
+    struct Run {
+        Latency latency;
+        uint64_t idle_us = 0;
+        uint64_t erases = 0;
+        uint32_t violations = 0;
+        bool intact = false;
+    } runs[2];
+
+    for (int pre = 0; pre < 2; ++pre) {
+        flash_emu::Flash flash(kPartitionSectors);
+        mount(flash);
+        Run& run = runs[pre];
+        run.latency.us.reserve(kRecordsPerDay);
+        for (size_t i = 0; i < kRecordsPerDay; ++i) {
+            TEST_ASSERT_EQUAL_size_t(1, append_records(flash, i, 1, &run.latency));
+            if (!pre) continue;
+            const uint64_t t0 = flash.busy_us();
+            for (uint32_t idle = 0; idle < kRecordPeriodS * 1000 / kPreEraseIntervalMs; ++idle) {
+                if (fs_store::pre_erase(kPreErasePoolSectors, 1) == 0) break;
+            }
+            run.idle_us += flash.busy_us() - t0;
+        }
+        run.erases = flash.total_erases();
+        run.violations = flash.program_violations();
+        run.intact = verify(kRecordsPerDay);
+        LittleFS.end();
+    }
+
+    printf("\n[pre-erase, 1 day] append p50 / p99 / max:\n");
+    for (int pre = 0; pre < 2; ++pre) {
+        const Run& run = runs[pre];
+        printf("  %-8s %6u / %6u / %6u us, %llu erases, %.1f ms idle erase per record\n",
+               pre ? "with" : "without", run.latency.percentile(0.50), run.latency.percentile(0.99),
+               run.latency.max(), static_cast<unsigned long long>(run.erases),
+               run.idle_us / 1e3 / kRecordsPerDay);
+    }
+
+    for (const Run& run : runs) {
+        TEST_ASSERT_EQUAL_UINT32(0, run.violations);
+        TEST_ASSERT_TRUE(run.intact);
+    }
+    TEST_ASSERT_TRUE(runs[1].latency.percentile(0.99) < runs[0].latency.percentile(0.99));
+    // Erases move off the append path; only the pool left over at the end is extra
+    TEST_ASSERT_TRUE(runs[1].erases <= runs[0].erases + kPreErasePoolSectors);
+}
+
+// Power lost part-way through an append: after a reboot the store mounts,
+// every record appended before the cut is intact and the interrupted one is
+// all or nothing
+void test_power_cut_recovery() {
+    for (uint32_t cut_after : {3u, 17u, 101u}) {
+        flash_emu::Flash flash(kPartitionSectors);
+        mount(flash);
+        const size_t before = kRecordsPerDay;
+        TEST_ASSERT_EQUAL_size_t(before, append_records(flash, 0, before));
+
+        // The CPU dies with the flash: nothing runs after the cut
+        flash.cut_power_after(cut_after);
+        size_t acked = before;
+        while (flash.powered()) {
+            const bool ok = fs_store::append(record_at(acked));
+            if (!flash.powered()) break;
+            TEST_ASSERT_TRUE(ok);
+            ++acked;
+        }
+
+        LittleFS.end();
+        flash.power_on();
+        const uint64_t t0 = flash.busy_us();
+        mount(flash);
+        const size_t count = fs_store::record_count();
+        const double recovery_ms = (flash.busy_us() - t0) / 1e3;
+
+        printf("\n[power cut after %u programs] %zu acked, %zu present, mount + open %.2f ms\n",
+               cut_after, acked, count, recovery_ms);
+        TEST_ASSERT_TRUE(count == acked || count == acked + 1);
+        TEST_ASSERT_TRUE(verify(count));
+
+        // And the store keeps working
+        TEST_ASSERT_EQUAL_size_t(10, append_records(flash, count, 10));
+        TEST_ASSERT_TRUE(verify(count + 10));
+        LittleFS.end();
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_append_month);
+    RUN_TEST(test_scan_throughput);
+    RUN_TEST(test_daily_sync_cycle);
+    RUN_TEST(test_pre_erase_latency);
+    RUN_TEST(test_power_cut_recovery);
+    return UNITY_END();
+}
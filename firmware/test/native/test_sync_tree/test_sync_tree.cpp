@@ -0,0 +1,325 @@
+#include <unity.h>
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ble/sync_tree.h"
+
+// Hash-tree reconciliation: FNV-1a 64 test vectors, the tree shape, node
+// digests from one pass against a reference built level by level, and a
+// phone that lost or damaged parts of a month of records walking the tree
+// with TREE and repairing its copy with RANGE, against a full SEND.
+
+namespace {
+
+typedef consolidate::ConsolidatedRecord Record;
+
+constexpr size_t kRecordsPerDay = 24 * 3600 / 15;
+
+// Notifications as the central sees them
+class RecordingLink : public transfer::Link {
+public:
+    bool connected() const override { return true; }
+    bool notify(const uint8_t* data, size_t length) override {
+        packets.push_back(std::vector<uint8_t>(data, data + length));
+        bytes += length;
+        return true;
+    }
+    void delay_ms(uint32_t) override {}
+
+    std::vector<std::vector<uint8_t>> packets;
+    size_t bytes = 0;
+};
+
+std::vector<Record> make_records(size_t n, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<Record> out(n);
+    for (size_t i = 0; i < n; ++i) {
+        Record& r = out[i];
+        r.avg_hr_x10 = static_cast<uint16_t>(600 + rng() % 400);
+        r.avg_temp_x100 = static_cast<int16_t>(3300 + rng() % 200);
+        r.step_count = static_cast<uint16_t>(rng() % 40);
+        r.timestamp = 1700000000u + static_cast<uint32_t>(i) * 15;
+        r.flags = 0;
+    }
+    return out;
+}
+
+sync_tree::RangeSource source_of(const std::vector<Record>& records) {
+    return [&records](size_t first, const transfer::RecordCallback& callback) {
+        for (size_t i = first; i < records.size(); ++i) {
+            if (!callback(records[i], i)) return;
+        }
+    };
+}
+
+// Every level, built from the one below
+std::vector<std::vector<uint64_t>> reference_tree(const std::vector<Record>& records) {
+    std::vector<std::vector<uint64_t>> tree(1);
+    for (size_t i = 0; i < records.size(); i += sync_tree::kSegmentRecords) {
+        const size_t n = std::min(sync_tree::kSegmentRecords, records.size() - i);
+        tree[0].push_back(sync_tree::fnv1a64(&records[i], n * sizeof(Record)));
+    }
+    while (tree.back().size() > 1) {
+        const std::vector<uint64_t>& below = tree.back();
+        std::vector<uint64_t> level;
+        for (size_t i = 0; i < below.size(); i += sync_tree::kFanout) {
+            const size_t n = std::min(sync_tree::kFanout, below.size() - i);
+            level.push_back(sync_tree::fnv1a64(&below[i], n * sizeof(uint64_t)));
+        }
+        tree.push_back(level);
+    }
+    return tree;
+}
+
+bool same_record(const Record& a, const Record& b) {
+    return memcmp(&a, &b, sizeof(Record)) == 0;
+}
+
+struct Reconcile {
+    size_t tree_queries = 0;
+    size_t tree_bytes = 0;
+    size_t range_queries = 0;
+    size_t range_bytes = 0;
+    size_t records_fetched = 0;
+};
+
+// The phone's side: walk down from the root through the nodes whose digests
+// differ from its copy's, then fetch the segments under the differing leaves
+void reconcile(const std::vector<Record>& device, std::vector<Record>& phone, Reconcile& out) {
+    const sync_tree::RangeSource device_source = source_of(device);
+    transfer::Pacing pacing;
+    pacing.after_start_ms = 0;
+    pacing.per_record_ms = 0;
+
+    auto query = [&](uint8_t level, size_t first, std::vector<uint64_t>& digests, uint8_t& levels) {
+        RecordingLink link;
+        TEST_ASSERT_TRUE(sync_tree::send_nodes(link, device_source, device.size(), level, first, pacing));
+        ++out.tree_queries;
+        out.tree_bytes += link.bytes;
+        const std::vector<uint8_t>& header = link.packets[0];
+        TEST_ASSERT_EQUAL_UINT8(sync_tree::kTreeMarker, header[0]);
+        levels = header[5];
+        digests.clear();
+        for (size_t i = 1; i < link.packets.size(); ++i) {
+            uint64_t d;
+            memcpy(&d, &link.packets[i][5], 8);
+            digests.push_back(d);
+        }
+        TEST_ASSERT_EQUAL_size_t(header[7], digests.size());
+    };
+
+    std::vector<uint64_t> got;
+    uint8_t levels = 0;
+    query(sync_tree::kTopLevel, 0, got, levels);
+    std::vector<size_t> differing;
+    uint64_t mine[sync_tree::kFanout];
+    const uint8_t top = static_cast<uint8_t>(levels - 1);
+    // The phone's tree over its own copy; a node it does not have differs
+    auto phone_digests = [&](uint8_t level, size_t first, size_t n) {
+        const size_t have = sync_tree::digests(source_of(phone), phone.size(), level, first, mine, n);
+        for (size_t i = have; i < n; ++i) mine[i] = ~got[i];
+    };
+    phone_digests(top, 0, 1);
+    if (mine[0] != got[0]) differing.push_back(0);
+
+    for (uint8_t level = top; level > 0 && !differing.empty(); --level) {
+        std::vector<size_t> below;
+        for (size_t node : differing) {
+            query(static_cast<uint8_t>(level - 1), node * sync_tree::kFanout, got, levels);
+            phone_digests(static_cast<uint8_t>(level - 1), node * sync_tree::kFanout, got.size());
+            for (size_t i = 0; i < got.size(); ++i) {
+                if (mine[i] != got[i]) below.push_back(node * sync_tree::kFanout + i);
+            }
+        }
+        differing.swap(below);
+    }
+
+    if (phone.size() < device.size()) phone.resize(device.size());
+    for (size_t leaf : differing) {
+        size_t count = 0;
+        const transfer::RecordSource source = sync_tree::range(
+            device_source, device.size(), leaf * sync_tree::kSegmentRecords, sync_tree::kSegmentRecords, count);
+        RecordingLink link;
+        const transfer::Result result = transfer::stream(link, count, source, pacing);
+        TEST_ASSERT_TRUE(result.completed);
+        ++out.range_queries;
+        out.range_bytes += link.bytes;
+        size_t index = leaf * sync_tree::kSegmentRecords;
+        for (const std::vector<uint8_t>& p : link.packets) {
+            if (p[0] != transfer::kDataMarker) continue;
+            memcpy(&phone[index++], &p[1], sizeof(Record));
+            ++out.records_fetched;
+        }
+    }
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_fnv1a64_vectors() {
+    TEST_ASSERT_TRUE(sync_tree::fnv1a64("", 0) == 0xcbf29ce484222325ull);
+    TEST_ASSERT_TRUE(sync_tree::fnv1a64("a", 1) == 0xaf63dc4c8601ec8cull);
+    TEST_ASSERT_TRUE(sync_tree::fnv1a64("foobar", 6) == 0x85944171f73967e8ull);
+    // Incremental over pieces equals one call
+    TEST_ASSERT_TRUE(sync_tree::fnv1a64("bar", 3, sync_tree::fnv1a64("foo", 3)) == 0x85944171f73967e8ull);
+}
+
+void test_tree_shape() {
+    TEST_ASSERT_EQUAL_UINT8(0, sync_tree::levels(0));
+    TEST_ASSERT_EQUAL_UINT8(1, sync_tree::levels(1));
+    TEST_ASSERT_EQUAL_UINT8(1, sync_tree::levels(32));
+    TEST_ASSERT_EQUAL_UINT8(2, sync_tree::levels(33));
+    TEST_ASSERT_EQUAL_UINT8(2, sync_tree::levels(256));
+    TEST_ASSERT_EQUAL_UINT8(3, sync_tree::levels(257));
+    TEST_ASSERT_EQUAL_size_t(0, sync_tree::node_count(0, 0));
+    TEST_ASSERT_EQUAL_size_t(9, sync_tree::node_count(257, 0));
+    TEST_ASSERT_EQUAL_size_t(2, sync_tree::node_count(257, 1));
+    TEST_ASSERT_EQUAL_size_t(1, sync_tree::node_count(257, 2));
+    TEST_ASSERT_EQUAL_size_t(0, sync_tree::node_count(257, 3));
+    TEST_ASSERT_EQUAL_size_t(2048, sync_tree::records_per_node(2));
+    // A month of 15 s records: 5400 segments under six levels
+    TEST_ASSERT_EQUAL_UINT8(6, sync_tree::levels(30 * kRecordsPerDay));
+}
+
+// One-pass digests at every level and offset match the tree built level by
+// level; appending changes only the last node of each level
+void test_digests_match_reference() {
+    std::vector<Record> records = make_records(5000, 1);
+    const std::vector<std::vector<uint64_t>> tree = reference_tree(records);
+    TEST_ASSERT_EQUAL_size_t(tree.size(), sync_tree::levels(records.size()));
+
+    uint64_t out[sync_tree::kFanout];
+    for (uint8_t level = 0; level < tree.size(); ++level) {
+        TEST_ASSERT_EQUAL_size_t(tree[level].size(), sync_tree::node_count(records.size(), level));
+        for (size_t first = 0; first < tree[level].size(); first += 3) {
+            const size_t n = sync_tree::digests(source_of(records), records.size(), level, first, out,
+                                                sync_tree::kFanout);
+            TEST_ASSERT_EQUAL_size_t(std::min(sync_tree::kFanout, tree[level].size() - first), n);
+            for (size_t i = 0; i < n; ++i) TEST_ASSERT_TRUE(out[i] == tree[level][first + i]);
+        }
+    }
+    TEST_ASSERT_EQUAL_size_t(0, sync_tree::digests(source_of(records), records.size(), 0, tree[0].size(), out, 8));
+
+    // A source that ends early (file shortened under the query) gives nothing
+    std::vector<Record> shorter(records.begin(), records.begin() + 4990);
+    TEST_ASSERT_EQUAL_size_t(0, sync_tree::digests(source_of(shorter), records.size(), 0, 152, out, 8));
+
+    records.push_back(make_records(1, 2)[0]);
+    const std::vector<std::vector<uint64_t>> grown = reference_tree(records);
+    for (size_t level = 0; level < tree.size(); ++level) {
+        for (size_t i = 0; i + 1 < tree[level].size(); ++i) TEST_ASSERT_TRUE(grown[level][i] == tree[level][i]);
+        TEST_ASSERT_TRUE(grown[level].back() != tree[level].back());
+    }
+}
+
+// TREE with the node cache: the same digests at every level, and once the
+// cache is warm a root query reads only the records appended since
+void test_cache_reads_only_appended_records() {
+    std::vector<Record> records = make_records(5000, 4);
+    size_t reads = 0;
+    const sync_tree::RangeSource counted = [&records, &reads](size_t first, const transfer::RecordCallback& cb) {
+        for (size_t i = first; i < records.size(); ++i) {
+            ++reads;
+            if (!cb(records[i], i)) return;
+        }
+    };
+    transfer::Pacing pacing;
+    pacing.per_record_ms = 0;
+    sync_tree::NodeCache cache;
+    auto root = [&](sync_tree::NodeCache* c) -> uint64_t {
+        RecordingLink link;
+        if (!sync_tree::send_nodes(link, counted, records.size(), sync_tree::kTopLevel, 0, pacing, c)) return 0;
+        uint64_t d = 0;
+        memcpy(&d, &link.packets[1][5], 8);
+        return d;
+    };
+
+    const uint64_t cold = root(&cache);
+    TEST_ASSERT_EQUAL_size_t(5000 / 256, cache.size());
+    TEST_ASSERT_TRUE(cold == reference_tree(records).back()[0]);
+
+    uint64_t cached[sync_tree::kFanout], plain[sync_tree::kFanout];
+    const std::vector<std::vector<uint64_t>> tree = reference_tree(records);
+    for (uint8_t level = 0; level < tree.size(); ++level) {
+        for (size_t first = 0; first < tree[level].size(); first += 5) {
+            const size_t n = sync_tree::digests(counted, records.size(), level, first, cached, 8, &cache);
+            TEST_ASSERT_EQUAL_size_t(sync_tree::digests(counted, records.size(), level, first, plain, 8), n);
+            for (size_t i = 0; i < n; ++i) TEST_ASSERT_TRUE(cached[i] == plain[i]);
+        }
+    }
+
+    // Warm: the root folds 19 cached nodes and reads the 136-record tail
+    reads = 0;
+    TEST_ASSERT_TRUE(root(&cache) == cold);
+    TEST_ASSERT_EQUAL_size_t(5000 - 19 * 256, reads);
+    reads = 0;
+    root(nullptr);
+    TEST_ASSERT_EQUAL_size_t(5000, reads);
+
+    // An append: the records of the node it completed (and the one after,
+    // which ends that pass), then the new tail
+    const std::vector<Record> more = make_records(200, 5);
+    records.insert(records.end(), more.begin(), more.end());
+    reads = 0;
+    TEST_ASSERT_TRUE(root(&cache) == reference_tree(records).back()[0]);
+    TEST_ASSERT_EQUAL_size_t(20, cache.size());
+    TEST_ASSERT_EQUAL_size_t(256 + 1 + (5200 - 20 * 256), reads);
+
+    // A shorter file (erased and refilled) drops what the cache held
+    records = make_records(600, 6);
+    TEST_ASSERT_TRUE(root(&cache) == reference_tree(records).back()[0]);
+    TEST_ASSERT_EQUAL_size_t(2, cache.size());
+}
+
+// A month on the device; the phone lost a day in the middle, has a few
+// corrupted records and is missing the last hours
+void test_reconcile_damaged_copy() {
+    const std::vector<Record> device = make_records(30 * kRecordsPerDay, 3);
+    std::vector<Record> phone = device;
+    for (size_t i = 12 * kRecordsPerDay; i < 13 * kRecordsPerDay; ++i) phone[i] = Record{};
+    phone[3 * kRecordsPerDay + 17].step_count ^= 1;
+    phone[25 * kRecordsPerDay + 1000].avg_hr_x10 = 0;
+    phone.resize(device.size() - 700);
+
+    Reconcile r;
+    reconcile(device, phone, r);
+    TEST_ASSERT_EQUAL_size_t(device.size(), phone.size());
+    size_t mismatched = 0;
+    for (size_t i = 0; i < device.size(); ++i) mismatched += same_record(device[i], phone[i]) ? 0 : 1;
+    TEST_ASSERT_EQUAL_size_t(0, mismatched);
+
+    const size_t send_bytes = transfer::kStartPacketBytes + device.size() * transfer::kDataPacketBytes + 1;
+    const size_t damaged = kRecordsPerDay + 2 + 700;
+    printf("\n[30 days, %zu records; phone lost %zu]\n", device.size(), damaged);
+    printf("  full SEND: %zu notifications, %zu bytes\n", device.size() + 2, send_bytes);
+    printf("  TREE: %zu queries, %zu bytes | RANGE: %zu queries, %zu records, %zu bytes | %.1f%% of SEND\n",
+           r.tree_queries, r.tree_bytes, r.range_queries, r.records_fetched, r.range_bytes,
+           100.0 * (r.tree_bytes + r.range_bytes) / send_bytes);
+
+    // Only the damaged segments are fetched, plus the partial ones around them
+    TEST_ASSERT_TRUE(r.records_fetched >= damaged);
+    TEST_ASSERT_TRUE(r.records_fetched <= damaged + 4 * sync_tree::kSegmentRecords);
+    TEST_ASSERT_TRUE(r.tree_bytes + r.range_bytes < send_bytes / 10);
+
+    // In sync: the root matches and nothing more is fetched
+    Reconcile again;
+    reconcile(device, phone, again);
+    TEST_ASSERT_EQUAL_size_t(1, again.tree_queries);
+    TEST_ASSERT_EQUAL_size_t(0, again.records_fetched);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fnv1a64_vectors);
+    RUN_TEST(test_tree_shape);
+    RUN_TEST(test_digests_match_reference);
+    RUN_TEST(test_cache_reads_only_appended_records);
+    RUN_TEST(test_reconcile_damaged_copy);
+    return UNITY_END();
+}
@@ -0,0 +1,77 @@
+#include <unity.h>
+
+#include "sensors/wear_detect.h"
+
+using wear_detect::Detector;
+using wear_detect::State;
+
+void setUp() {}
+void tearDown() {}
+
+void test_low_ir_and_still_goes_off_wrist() {
+    Detector d;
+    for (int s = 0; s < 4; ++s) TEST_ASSERT_TRUE(d.update(5000, true, 1000) == State::kOnWrist);
+    TEST_ASSERT_TRUE(d.update(5000, true, 1000) == State::kOffWrist);
+}
+
+void test_motion_delays_off_wrist() {
+    Detector d;
+    // Low IR but moving (watch loose / being carried): only the long timeout applies
+    for (int s = 0; s < 29; ++s) TEST_ASSERT_TRUE(d.update(5000, false, 1000) == State::kOnWrist);
+    TEST_ASSERT_TRUE(d.update(5000, false, 1000) == State::kOffWrist);
+}
+
+void test_skin_contact_resets_timer() {
+    Detector d;
+    for (int s = 0; s < 4; ++s) d.update(5000, true, 1000);
+    d.update(120000, true, 1000);
+    for (int s = 0; s < 4; ++s) TEST_ASSERT_TRUE(d.update(5000, true, 1000) == State::kOnWrist);
+}
+
+void test_probe_schedule_bounds_resume_latency() {
+    Detector d;
+    wear_detect::Config cfg;
+    for (int s = 0; s < 5; ++s) d.update(5000, true, 1000);
+    TEST_ASSERT_TRUE(d.off_wrist());
+    d.mark_off(10000);
+
+    TEST_ASSERT_FALSE(d.probe_due(10000 + cfg.probe_interval_ms - 1, false));
+    TEST_ASSERT_TRUE(d.probe_due(10000 + cfg.probe_interval_ms, false));
+    // Motion pulls the probe forward, but not faster than the minimum gap
+    TEST_ASSERT_FALSE(d.probe_due(10000 + cfg.min_probe_gap_ms - 1, true));
+    TEST_ASSERT_TRUE(d.probe_due(10000 + cfg.min_probe_gap_ms, true));
+
+    // Probe that still sees air keeps it off and restarts the interval
+    TEST_ASSERT_TRUE(d.probe(3000, 12000) == State::kOffWrist);
+    TEST_ASSERT_FALSE(d.probe_due(12000 + cfg.probe_interval_ms - 1, false));
+    // Between the thresholds is not enough (hysteresis)
+    TEST_ASSERT_TRUE(d.probe(30000, 14000) == State::kOffWrist);
+    TEST_ASSERT_TRUE(d.probe(90000, 16000) == State::kOnWrist);
+}
+
+void test_normalise_ir_tracks_agc() {
+    // Same tissue at double the LED current reads double; normalisation undoes it
+    TEST_ASSERT_EQUAL_UINT32(100000, wear_detect::normalise_ir(100000, 0x1F, 411));
+    TEST_ASSERT_EQUAL_UINT32(50000, wear_detect::normalise_ir(100000, 0x3E, 411));
+    TEST_ASSERT_EQUAL_UINT32(0, wear_detect::normalise_ir(100000, 0, 411));
+}
+
+void test_stillness_meter() {
+    wear_detect::StillnessMeter m;
+    for (int i = 0; i < 50; ++i) m.add(0.0f, 0.0f, 1.0f + (i % 2 ? 0.002f : -0.002f));
+    TEST_ASSERT_TRUE(m.finish_window());
+    for (int i = 0; i < 50; ++i) m.add(0.0f, 0.0f, 1.0f + (i % 2 ? 0.2f : -0.2f));
+    TEST_ASSERT_FALSE(m.finish_window());
+    TEST_ASSERT_FALSE(m.finish_window());  // empty window is not evidence of stillness
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_low_ir_and_still_goes_off_wrist);
+    RUN_TEST(test_motion_delays_off_wrist);
+    RUN_TEST(test_skin_contact_resets_timer);
+    RUN_TEST(test_probe_schedule_bounds_resume_latency);
+    RUN_TEST(test_normalise_ir_tracks_agc);
+    RUN_TEST(test_stillness_meter);
+    return UNITY_END();
+}
@@ -1,6 +1,6 @@
 // Phase 2: Integrate sensor sampling at precise rates using hardware timers.
-//  - IMU: 100 Hz
-//  - PPG (MAX30102): 50 Hz
+//  - IMU: read at 105 Hz (the driver runs the BMI270 at 50 Hz ODR)
+//  - PPG (MAX30102): FIFO drained at 55 Hz
 //  - Temperature (MAX30205): 1 Hz
 // We perform I2C reads in the main loop when flags set by ISRs to keep ISRs fast.
 // Each 1 second window we print the averaged values over the prior second.
@@ -8,157 +8,16 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include "app_config.h"
-#include <SparkFun_BMI270_Arduino_Library.h>
-#include <reg_buffer.h>
+#include "i2c_bus/i2c_bus.h"
+#include "ringbuf/reg_buffer.h"
+#include "sensors/bmi270_driver.h"
+#include "sensors/max30102_driver.h"
+#include "sensors/max30205_driver.h"
 
-// Addresses (adapted from sensors_demo.cpp)
-static constexpr uint8_t BMI270_ADDR      = 0x68;
-static constexpr uint8_t BMI270_ADDR_ALT  = 0x69;
-static constexpr uint8_t MAX30102_ADDR    = 0x57;
-static constexpr uint8_t MAX30205_ADDR    = 0x48; // single address variant used
-
-// --- Minimal I2C helpers (blocking; acceptable for demo) ---
-static bool i2c_write8(uint8_t addr, uint8_t reg, uint8_t val) {
-  Wire.beginTransmission(addr);
-  Wire.write(reg);
-  Wire.write(val);
-  return Wire.endTransmission() == 0;
-}
-static int i2c_read8(uint8_t addr, uint8_t reg) {
-  Wire.beginTransmission(addr);
-  Wire.write(reg);
-  if (Wire.endTransmission(false) != 0) return -1;
-  if (Wire.requestFrom((int)addr, 1) != 1) return -1;
-  return Wire.read();
-}
-static size_t i2c_readN(uint8_t addr, uint8_t reg, uint8_t *buf, size_t n) {
-  Wire.beginTransmission(addr);
-  Wire.write(reg);
-  if (Wire.endTransmission(false) != 0) return 0;
-  size_t got = Wire.requestFrom((int)addr, (int)n);
-  for (size_t i = 0; i < got; ++i) buf[i] = Wire.read();
-  return got;
-}
-static bool i2c_ping(uint8_t addr) {
-  Wire.beginTransmission(addr);
-  return Wire.endTransmission() == 0;
-}
-
-// --- BMI270 ---
-static BMI270 g_imu;
-static bool   g_bmi_ok = false;
-static bool bmi270_begin() {
-  if (g_imu.beginI2C(BMI270_ADDR, Wire) != BMI2_OK) {
-    if (g_imu.beginI2C(BMI270_ADDR_ALT, Wire) != BMI2_OK) {
-      Serial.println("BMI270: not found");
-      g_bmi_ok = false; return false;
-    }
-  }
-  int8_t rs;
-  rs = g_imu.setAccelODR(BMI2_ACC_ODR_100HZ);
-  if (rs != BMI2_OK) Serial.printf("BMI270 accel ODR fail (%d)\n", rs);
-  rs = g_imu.setGyroODR(BMI2_GYR_ODR_100HZ);
-  if (rs != BMI2_OK) Serial.printf("BMI270 gyro ODR fail (%d)\n", rs);
-  g_bmi_ok = true;
-  Serial.println("BMI270 ready");
-  return true;
-}
-struct ImuSample { float ax, ay, az; float gx, gy, gz; float tempC; bool ok; };
-static ImuSample bmi270_read() {
-  ImuSample s{0,0,0,0,0,0,NAN,false};
-  if (!g_bmi_ok) return s;
-  if (g_imu.getSensorData() != BMI2_OK) return s;
-  s.ax = g_imu.data.accelX; s.ay = g_imu.data.accelY; s.az = g_imu.data.accelZ;
-  s.gx = g_imu.data.gyroX;  s.gy = g_imu.data.gyroY;  s.gz = g_imu.data.gyroZ;
-  float t; if (g_imu.getTemperature(&t) == BMI2_OK) s.tempC = t; else s.tempC = NAN;
-  s.ok = true;
-  return s;
-}
-
-// --- MAX30102 (configure, drain FIFO like sensors_demo) ---
-static constexpr uint8_t MAX30102_REG_INT_STATUS_1 = 0x00;
-static constexpr uint8_t MAX30102_REG_INT_STATUS_2 = 0x01;
-static constexpr uint8_t MAX30102_REG_INT_ENABLE_1 = 0x02;
-static constexpr uint8_t MAX30102_REG_INT_ENABLE_2 = 0x03;
-static constexpr uint8_t MAX30102_REG_FIFO_WR_PTR  = 0x04;
-static constexpr uint8_t MAX30102_REG_OVF_COUNTER  = 0x05;
-static constexpr uint8_t MAX30102_REG_FIFO_RD_PTR  = 0x06;
-static constexpr uint8_t MAX30102_REG_FIFO_DATA    = 0x07;
-static constexpr uint8_t MAX30102_REG_FIFO_CONFIG  = 0x08;
-static constexpr uint8_t MAX30102_REG_MODE_CONFIG  = 0x09;
-static constexpr uint8_t MAX30102_REG_SPO2_CONFIG  = 0x0A;
-static constexpr uint8_t MAX30102_REG_LED1_PA      = 0x0C;
-static constexpr uint8_t MAX30102_REG_LED2_PA      = 0x0D;
-static constexpr uint8_t MAX30102_REG_PART_ID      = 0xFF;
-
-static bool max30102_begin() {
-  if (!i2c_ping(MAX30102_ADDR)) { Serial.println("MAX30102: not found"); return false; }
-  int part = i2c_read8(MAX30102_ADDR, MAX30102_REG_PART_ID);
-  if (part != 0x15) { Serial.printf("MAX30102: unexpected PART_ID=0x%02X\n", part); return false; }
-  Serial.printf("MAX30102: found PART_ID=0x%02X\n", part);
-  // Reset & wait
-  (void)i2c_write8(MAX30102_ADDR, MAX30102_REG_MODE_CONFIG, 0x40);
-  uint32_t t0 = millis();
-  while (millis() - t0 < 200) {
-    int m = i2c_read8(MAX30102_ADDR, MAX30102_REG_MODE_CONFIG);
-    if (m >= 0 && (m & 0x40) == 0) break;
-    delay(2);
-  }
-  // Clear status
-  (void)i2c_read8(MAX30102_ADDR, MAX30102_REG_INT_STATUS_1);
-  (void)i2c_read8(MAX30102_ADDR, MAX30102_REG_INT_STATUS_2);
-  // Reset FIFO pointers
-  (void)i2c_write8(MAX30102_ADDR, MAX30102_REG_FIFO_WR_PTR, 0x00);
-  (void)i2c_write8(MAX30102_ADDR, MAX30102_REG_OVF_COUNTER, 0x00);
-  (void)i2c_write8(MAX30102_ADDR, MAX30102_REG_FIFO_RD_PTR, 0x00);
-  // FIFO config: avg=4, rollover enable, threshold 0x0F
-  (void)i2c_write8(MAX30102_ADDR, MAX30102_REG_FIFO_CONFIG, 0b01010000 | 0x0F);
-  // SpO2 config: ADC range 4096nA, ~100Hz sample rate, pulse width 411us
-  (void)i2c_write8(MAX30102_ADDR, MAX30102_REG_SPO2_CONFIG, 0b11001111);
-  // LED currents (slightly higher for better SNR)
-  (void)i2c_write8(MAX30102_ADDR, MAX30102_REG_LED1_PA, 0x28);
-  (void)i2c_write8(MAX30102_ADDR, MAX30102_REG_LED2_PA, 0x28);
-  // Enable PPG ready interrupt (not strictly used but set for completeness)
-  (void)i2c_write8(MAX30102_ADDR, MAX30102_REG_INT_ENABLE_1, 0x40);
-  // Mode: SpO2 (RED+IR)
-  (void)i2c_write8(MAX30102_ADDR, MAX30102_REG_MODE_CONFIG, 0x03);
-  delay(50);
-  Serial.println("MAX30102 ready");
-  return true;
-}
-struct PpgSample { uint32_t red; uint32_t ir; bool ok; };
-static PpgSample max30102_readOne() {
-  PpgSample s{0,0,false};
-  int wr = i2c_read8(MAX30102_ADDR, MAX30102_REG_FIFO_WR_PTR);
-  int rd = i2c_read8(MAX30102_ADDR, MAX30102_REG_FIFO_RD_PTR);
-  if (wr < 0 || rd < 0) return s;
-  uint8_t available = (uint8_t)((wr - rd) & 0x1F);
-  if (!available) return s;
-  if (available > 32) available = 32; // safety cap
-  for (uint8_t i = 0; i < available; ++i) {
-    uint8_t data[6];
-    if (i2c_readN(MAX30102_ADDR, MAX30102_REG_FIFO_DATA, data, 6) != 6) { s.ok = false; return s; }
-    uint32_t red = ((uint32_t)(data[0] & 0x03) << 16) | ((uint32_t)data[1] << 8) | data[2];
-    uint32_t ir  = ((uint32_t)(data[3] & 0x03) << 16) | ((uint32_t)data[4] << 8) | data[5];
-    s.red = red; s.ir = ir; s.ok = true; // keep last
-  }
-  return s;
-}
-
-// --- MAX30205 ---
-static bool max30205_ok = false;
-static bool max30205_begin() {
-  if (!i2c_ping(MAX30205_ADDR)) { Serial.println("MAX30205: not found"); return false; }
-  max30205_ok = true; Serial.println("MAX30205 ready"); return true;
-}
-static bool max30205_readTemp(float &c) {
-  if (!max30205_ok) return false;
-  uint8_t buf[2];
-  if (i2c_readN(MAX30205_ADDR, 0x00, buf, 2) != 2) return false;
-  int16_t raw = (int16_t)((buf[0] << 8) | buf[1]);
-  c = raw / 256.0f;
-  return true;
-}
+// Sensors through the firmware's drivers (lib/sensors) and bus helpers (lib/i2c_bus)
+static Bmi270Driver g_imu;
+static Max30102Driver g_ppg(ppg_agc::Settings{0x28, ppg_agc::kPulseWidthCount - 1});
+static Max30205Driver g_temp;
 
 // --- Timer handles ---
 static hw_timer_t* tImu  = nullptr;
@@ -231,12 +90,11 @@ void setup() {
   Serial.begin(115200);
   delay(500);
   Serial.println("\nTimed sensor sampling demo (Phase 2)");
-  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
-  Wire.setClock(400000); // full speed for sensor throughput; adjust if bus stability issues
+  i2c_setup();
   delay(10);
-  (void)bmi270_begin();
-  (void)max30102_begin();
-  (void)max30205_begin();
+  Serial.println(g_imu.begin() ? "BMI270 ready" : "BMI270: not found");
+  Serial.println(g_ppg.begin() ? "MAX30102 ready" : "MAX30102: not found");
+  Serial.println(g_temp.begin() ? "MAX30205 ready" : "MAX30205: not found");
   // Configure timers: APB 80MHz / divider 80 = 1MHz tick
   // Add ~5% headroom: IMU 105 Hz (≈9524 us), PPG 55 Hz (≈18182 us)
   tImu  = setupTimer(0, 80, 9524,     onImuTimer);   // ~105 Hz
@@ -246,27 +104,35 @@ void setup() {
 }
 
 static void sampleImu() {
-  ImuSample s = bmi270_read();
-  if (!s.ok) return;
+  sensor_driver::ImuReading r[1];
+  if (!g_imu.read_batch(r)) return;
+  const sensor_driver::ImuReading& s = r[0];
   axSum += s.ax; aySum += s.ay; azSum += s.az;
   gxSum += s.gx; gySum += s.gy; gzSum += s.gz;
-  if (!isnan(s.tempC)) imuTempSumF += (s.tempC * 1.8 + 32.0);
+  if (!isnan(s.temp_c)) imuTempSumF += (s.temp_c * 1.8 + 32.0);
   imuCount++;
   // half-window accumulation
   halfAxSum += s.ax; halfAySum += s.ay; halfAzSum += s.az;
   halfGxSum += s.gx; halfGySum += s.gy; halfGzSum += s.gz;
-  if (!isnan(s.tempC)) halfImuTempSumF += (s.tempC * 1.8 + 32.0);
+  if (!isnan(s.temp_c)) halfImuTempSumF += (s.temp_c * 1.8 + 32.0);
   halfImuCount++;
 }
+// Drains every sample the FIFO holds (the sensor runs at 100 Hz, the timer at 55 Hz)
 static void samplePpg() {
-  PpgSample p = max30102_readOne();
-  if (!p.ok) return;
-  redSum += p.red; irSum += p.ir; ppgCount++;
-  halfRedSum += p.red; halfIrSum += p.ir; halfPpgCount++;
-  (void)simpleBeatDetect(p.ir); // updates hrBpm internally
+  sensor_driver::PpgReading r[32];
+  const size_t n = g_ppg.read_batch(r);
+  for (size_t i = 0; i < n; ++i) {
+    redSum += r[i].red; irSum += r[i].ir; ppgCount++;
+    halfRedSum += r[i].red; halfIrSum += r[i].ir; halfPpgCount++;
+    (void)simpleBeatDetect(r[i].ir); // updates hrBpm internally
+  }
 }
 static void sampleTemp() {
-  float c; if (!max30205_readTemp(c)) return; bodyTempCSum += c; bodyTempFSum += (c * 9.0/5.0 + 32.0); tempCount++; halfBodyTempCSum += c; halfTempCount++; }
+  sensor_driver::TempReading r[1];
+  if (!g_temp.read_batch(r)) return;
+  const float c = r[0].celsius;
+  bodyTempCSum += c; bodyTempFSum += (c * 9.0/5.0 + 32.0); tempCount++; halfBodyTempCSum += c; halfTempCount++;
+}
 
 static void packHalfWindowIfDue() {
   uint32_t now = millis();
@@ -288,17 +154,15 @@ static void packHalfWindowIfDue() {
     s.gx = (reg_buffer::float16)(isnan(gxAvg) ? 0.f : gxAvg);
     s.gy = (reg_buffer::float16)(isnan(gyAvg) ? 0.f : gyAvg);
     s.gz = (reg_buffer::float16)(isnan(gzAvg) ? 0.f : gzAvg);
-    s.hr_bpm = (reg_buffer::float16)(hrBpm > 0 ? hrBpm : 0);
-    s.temp_c = (reg_buffer::float16)(isnan(bodyTCAvg) ? 0.f : bodyTCAvg);
-    s.epoch_min = (float)millis() / 60000.f;
+    s.timestamp = millis() / 1000;
     if (!g_ringbuf.push(s)) {
       Serial.println("Ring buffer full; sample dropped");
     } else {
-      Serial.printf("RB+ sz=%u ax=%.2f ay=%.2f az=%.2f gx=%.2f gy=%.2f gz=%.2f hr=%.1f tempC=%.2f epoch_min=%.2f\n",
+      Serial.printf("RB+ sz=%u ax=%.2f ay=%.2f az=%.2f gx=%.2f gy=%.2f gz=%.2f hr=%.1f tempC=%.2f t=%us\n",
                     (unsigned)g_ringbuf.size(),
                     (double)s.ax, (double)s.ay, (double)s.az,
                     (double)s.gx, (double)s.gy, (double)s.gz,
-                    (double)s.hr_bpm, (double)s.temp_c, (double)s.epoch_min);
+                    (double)hrBpm, isnan(bodyTCAvg) ? 0.0 : bodyTCAvg, (unsigned)s.timestamp);
     }
   }
   // Reset half-window accumulators